@@ -21,8 +21,9 @@ set PATH=%PATH%;c:\Python34
 
 if %1. == build. goto build
 if %1. == test.  goto test
+if %1. == bench. goto bench
 
-echo Usage: %~dp0appveyor-script.bat "build / test"
+echo Usage: %~dp0appveyor-script.bat "build / test / bench"
 goto :EOF
 
 :build
@@ -79,6 +80,33 @@ goto :EOF
   del /q %APPDATA%\.netrc %APPDATA%\.authinfo
   goto :EOF
 
+::
+:: The cold-start benchmark. Look at the "startup" line of each '--profile' report.
+::
+:: "startup" is everything in 'main()' before the first search. The compilers,
+:: the Pythons and the config-file are set up on first use since they are not
+:: needed for a plain '--path' search. So:
+::   1) "envtool --path notepad.exe" is run 3 times. The 1st run has a cold
+::      file-cache. "startup" is the cold-start time with nothing set up.
+::   2) "envtool --path --inc --lib --python notepad.exe" needs all of it.
+::      The "compilers" phase and the "init" items ("py_init()" and parsing
+::      the config-file) are the work that was moved out of "startup".
+::
+:bench
+  set COLUMNS=120
+  cd %APPVEYOR_BUILD_FOLDER%\src
+
+  for %%i in (1 2 3) do (
+    echo.
+    echo Cold-start benchmark: run %%i of "envtool --path notepad.exe"
+    .\envtool --path --profile notepad.exe
+  )
+
+  echo.
+  echo Cold-start benchmark: "envtool --path --inc --lib --python notepad.exe"
+  .\envtool --path --inc --lib --python --profile notepad.exe
+  goto :EOF
+
 ::
 :: Create a '<root>\.netrc' and '<root>\.authinfo' files for testing of 'src/auth.c' functions
 ::
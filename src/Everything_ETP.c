@@ -438,6 +438,8 @@ static BOOL state_PATH (struct state_CTX *ctx)
   {
     ETP_tracef (ctx, "file: %s", rx+5);
     report_file_ept (ctx, rx + 5, FALSE);
+    if (search_halted())   /* "--max-matches" reached. Do not read the rest */
+       ctx->state = state_closing;
     return (TRUE);
   }
 
@@ -445,6 +447,8 @@ static BOOL state_PATH (struct state_CTX *ctx)
   {
     ETP_tracef (ctx, "folder: %s", rx+7);
     report_file_ept (ctx, rx+7, TRUE);
+    if (search_halted())
+       ctx->state = state_closing;
     return (TRUE);
   }
 
@@ -530,7 +534,7 @@ static BOOL state_closing (struct state_CTX *ctx)
 
   closesocket (ctx->sock);
 
-  if (ctx->results_expected > 0 && ctx->results_got < ctx->results_expected)
+  if (ctx->results_expected > 0 && ctx->results_got < ctx->results_expected && !search_halted())
      WARN ("Expected %u results, but received only %u. Received %s bytes.\n",
            ctx->results_expected, ctx->results_got, dword_str(ETP_total_rcv));
 
@@ -566,6 +566,36 @@ size_t C_flush (void)
   return (len2);
 }
 
+/**
+ * Lock the output so several calls (e.g. a `DEBUGF()` prefix and its
+ * message) are not interleaved with the output of other threads.
+ * The lock is recursive; each `C_lock()` must be matched by a `C_unlock()`.
+ */
+void C_lock (void)
+{
+  if (C_init())
+     EnterCriticalSection (&crit);
+}
+
+/**
+ * Release the lock taken by `C_lock()`.
+ */
+void C_unlock (void)
+{
+  LeaveCriticalSection (&crit);
+}
+
+/**
+ * Set the `FILE` to print to. E.g. `stderr` when `stdout` is used
+ * for something else.
+ */
+void C_set_output (FILE *out)
+{
+  C_init();
+  C_flush();
+  c_out = out;
+}
+
 /**
  * An printf() style console print function.
  */
@@ -592,9 +622,11 @@ int C_vprintf (const char *fmt, va_list args)
 
   if (c_raw)
   {
+    EnterCriticalSection (&crit);
     C_flush();
     len1 = vfprintf (c_out, fmt, args);
     fflush (c_out);
+    LeaveCriticalSection (&crit);
   }
   else
   {
@@ -711,8 +743,10 @@ int C_puts (const char *str)
 {
   int ch, rc = 0;
 
+  C_lock();
   for (rc = 0; (ch = *str) != '\0'; str++)
       rc += C_putc (ch);
+  C_unlock();
   return (rc);
 }
 
@@ -724,8 +758,10 @@ int C_putsn (const char *str, size_t len)
   int    rc = 0;
   size_t i;
 
+  C_lock();
   for (i = 0; i < len; i++)
       rc += C_putc (*str++);
+  C_unlock();
   return (rc);
 }
 
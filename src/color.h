@@ -4,6 +4,7 @@
 #ifndef _COLOR_H
 #define _COLOR_H
 
+#include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdint.h>
@@ -61,6 +62,8 @@ extern int    C_putc_raw (int ch);
 extern int    C_setraw   (int raw);
 extern int    C_setbin   (int bin);
 extern size_t C_flush    (void);
+extern void   C_lock     (void);
+extern void   C_unlock   (void);
 extern void   C_reset    (void);
 extern void   C_exit     (void);
 extern void   C_set_colour (unsigned short col);
@@ -68,6 +71,7 @@ extern void   C_set_ansi (unsigned short col);
 extern void   C_puts_long_line (const char *start, size_t indent);
 extern int    C_init_colour_map (unsigned short col1, ...);
 extern size_t C_screen_width (void);
+extern void   C_set_output (FILE *out);
 extern int    C_trace_level (void);
 extern int    C_conemu_detected (void);
 
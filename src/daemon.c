@@ -0,0 +1,618 @@
+/**\file    daemon.c
+ * \ingroup Misc
+ * \brief
+ *   A resident query server on a local (`AF_UNIX`) socket. For `envtool --daemon`.
+ *
+ * Starting `envtool` and scanning all directories in e.g. `%PATH%` takes
+ * most of the time for a single query. A daemon keeps all this state
+ * warm; a later `envtool` with the same options and environment just
+ * sends the file-spec to it and prints the reply.
+ *
+ * Only the transport is here. What a request means is up to the
+ * `daemon_func` passed to `daemon_serve()`.
+ *
+ * The protocol is simple:
+ *  \li The client sends a 4 byte length (network order) and the request.
+ *  \li The server replies with any number of frames:
+ *      a type byte, a 4 byte length and the data. Type `'O'` is output
+ *      and type `'R'` is the exit-code (4 bytes) and the last frame.
+ *
+ * Requests are served one at a time in the order they arrive. The clients
+ * are the user's own shells, so that is good enough. But a client that
+ * connects and never sends (e.g. killed half-way) must not block the others;
+ * it is dropped after `DAEMON_RECV_TIMEOUT` sec. So is a client that stops
+ * reading the reply for `DAEMON_SEND_TIMEOUT` sec.
+ *
+ * `AF_UNIX` sockets needs Windows 10 (build 17063) or later.
+ *
+ * Build the benchmark program with `-DDAEMON_TEST`. It forks a server and
+ * times a number of round-trips. E.g. on Linux:
+ * ```
+ *  gcc -O2 -DDAEMON_TEST -o daemon daemon.c
+ * ```
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__CYGWIN__)
+  #if !defined(__USE_W32_SOCKETS)
+    #define USE_POSIX_SOCKETS
+  #endif
+#elif !defined(_WIN32)
+  #define USE_POSIX_SOCKETS
+#endif
+
+#if defined(USE_POSIX_SOCKETS)
+  #include <unistd.h>
+  #include <errno.h>
+  #include <sys/select.h>
+  #include <sys/socket.h>
+  #include <sys/un.h>
+  #include <signal.h>
+
+  typedef int SOCKET;
+
+  #define INVALID_SOCKET      -1
+  #define SOCKET_ERROR        -1
+  #define closesocket(s)      close (s)
+  #define SOCK_ERRNO()        errno
+  #define SOCK_UNLINK(path)   unlink (path)
+#else
+  #include <winsock2.h>
+  #include <windows.h>
+
+  #if !defined(UNIX_PATH_MAX)  /* No <afunix.h> */
+    #define UNIX_PATH_MAX 108
+
+    struct sockaddr_un {
+           ADDRESS_FAMILY sun_family;
+           char           sun_path [UNIX_PATH_MAX];
+         };
+  #endif
+
+  #define SOCK_ERRNO()        WSAGetLastError()
+  #define SOCK_UNLINK(path)   DeleteFile (path)
+#endif
+
+#include "test_util.h"
+#include "daemon.h"
+
+#define DAEMON_MAX_REQUEST  (64*1024)   /**< Larger requests are refused */
+#define DAEMON_POLL_MS      500         /**< How often `daemon_serve()` checks `*stop` */
+#define DAEMON_RECV_TIMEOUT 2           /**< Sec. a client has to send its request */
+#define DAEMON_SEND_TIMEOUT 10          /**< Sec. a client may stall reading the reply */
+
+/** A client that has gone away must not raise `SIGPIPE` in `send()`.
+ */
+#if defined(MSG_NOSIGNAL)
+  #define SEND_FLAGS  MSG_NOSIGNAL
+#else
+  #define SEND_FLAGS  0
+#endif
+
+/** The client of the request being served. Used by `daemon_write()`.
+ */
+static SOCKET cur_client = INVALID_SOCKET;
+
+static int send_all (SOCKET s, const void *buf, size_t len)
+{
+  const char *p = buf;
+
+  while (len > 0)
+  {
+    int rc = send (s, p, (int)len, SEND_FLAGS);
+
+    if (rc <= 0)
+       return (-1);
+    p   += rc;
+    len -= rc;
+  }
+  return (0);
+}
+
+static int recv_all (SOCKET s, void *buf, size_t len)
+{
+  char *p = buf;
+
+  while (len > 0)
+  {
+    int rc = recv (s, p, (int)len, 0);
+
+    if (rc <= 0)
+       return (-1);
+    p   += rc;
+    len -= rc;
+  }
+  return (0);
+}
+
+/**
+ * Like `recv_all()`, but give up when `*stop` gets set or the request
+ * has not arrived by `deadline`.
+ */
+static int recv_request (SOCKET s, void *buf, size_t len, time_t deadline, volatile int *stop)
+{
+  char *p = buf;
+
+  while (len > 0)
+  {
+    struct timeval tv;
+    fd_set fds;
+    int    rc;
+
+    if (*stop || time(NULL) > deadline)
+       return (-1);
+
+    FD_ZERO (&fds);
+    FD_SET (s, &fds);
+    tv.tv_sec  = 0;
+    tv.tv_usec = 1000 * DAEMON_POLL_MS;
+
+    rc = select ((int)s+1, &fds, NULL, NULL, &tv);
+    if (rc < 0)
+       return (-1);
+    if (rc == 0)
+       continue;
+
+    rc = recv (s, p, (int)len, 0);
+    if (rc <= 0)
+       return (-1);
+    p   += rc;
+    len -= rc;
+  }
+  return (0);
+}
+
+/**
+ * Do not let a `send()` to a client block for more than `DAEMON_SEND_TIMEOUT` sec.
+ */
+static void sock_send_timeout (SOCKET s)
+{
+#if defined(USE_POSIX_SOCKETS)
+  struct timeval tv;
+
+  tv.tv_sec  = DAEMON_SEND_TIMEOUT;
+  tv.tv_usec = 0;
+#else
+  DWORD tv = 1000 * DAEMON_SEND_TIMEOUT;
+#endif
+
+  if (setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, (const char*)&tv, sizeof(tv)) == SOCKET_ERROR)
+     DEBUGF (1, "setsockopt (SO_SNDTIMEO) failed: %d.\n", SOCK_ERRNO());
+}
+
+static void put32 (unsigned char *p, unsigned long val)
+{
+  p[0] = (unsigned char) (val >> 24);
+  p[1] = (unsigned char) (val >> 16);
+  p[2] = (unsigned char) (val >> 8);
+  p[3] = (unsigned char) val;
+}
+
+static unsigned long get32 (const unsigned char *p)
+{
+  return (((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) |
+          ((unsigned long)p[2] << 8)  | p[3]);
+}
+
+static int send_frame (SOCKET s, int type, const void *buf, size_t len)
+{
+  unsigned char hdr [5];
+
+  hdr[0] = (unsigned char) type;
+  put32 (hdr+1, (unsigned long)len);
+  if (send_all(s, hdr, sizeof(hdr)) < 0)
+     return (-1);
+  return send_all (s, buf, len);
+}
+
+static int sock_init (void)
+{
+#if !defined(USE_POSIX_SOCKETS)
+  WSADATA wsadata;
+
+  if (WSAStartup(MAKEWORD(2,2), &wsadata))
+  {
+    DEBUGF (1, "WSAStartup() failed: %d.\n", SOCK_ERRNO());
+    return (-1);
+  }
+#endif
+  return (0);
+}
+
+static void sock_exit (void)
+{
+#if !defined(USE_POSIX_SOCKETS)
+  WSACleanup();
+#endif
+}
+
+static void sock_addr (struct sockaddr_un *addr, const char *path)
+{
+  memset (addr, '\0', sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  strncpy (addr->sun_path, path, sizeof(addr->sun_path)-1);
+}
+
+/**
+ * Connect to the daemon at `path`.
+ * \retval INVALID_SOCKET if no daemon answered.
+ */
+static SOCKET sock_connect (const char *path)
+{
+  struct sockaddr_un addr;
+  SOCKET s = socket (AF_UNIX, SOCK_STREAM, 0);
+
+  if (s == INVALID_SOCKET)
+     return (s);
+
+  sock_addr (&addr, path);
+  if (connect(s, (const struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR)
+  {
+    DEBUGF (2, "connect (\"%s\") failed: %d.\n", path, SOCK_ERRNO());
+    closesocket (s);
+    return (INVALID_SOCKET);
+  }
+  return (s);
+}
+
+/**
+ * Read one request from `s` and let `func` handle it.
+ * The client is dropped if the request does not arrive within
+ * `DAEMON_RECV_TIMEOUT` sec or `*stop` gets set.
+ */
+static int serve_one (SOCKET s, daemon_func func, void *arg, volatile int *stop)
+{
+  unsigned long len;
+  unsigned char buf [4];
+  char  *request;
+  time_t deadline = time (NULL) + DAEMON_RECV_TIMEOUT;
+  int    rc;
+
+  if (recv_request(s, buf, 4, deadline, stop) < 0)
+  {
+    DEBUGF (1, "No request from client.\n");
+    return (-1);
+  }
+
+  len = get32 (buf);
+  if (len > DAEMON_MAX_REQUEST)
+  {
+    DEBUGF (1, "Request too large: %lu bytes.\n", len);
+    return (-1);
+  }
+
+  request = MALLOC (len + 1);
+  if (recv_request(s, request, len, deadline, stop) < 0)
+  {
+    FREE (request);
+    return (-1);
+  }
+  request [len] = '\0';
+
+  cur_client = s;
+  rc = (*func) (request, arg);
+  cur_client = INVALID_SOCKET;
+  FREE (request);
+
+  put32 (buf, (unsigned long)rc);
+  return send_frame (s, 'R', buf, 4);
+}
+
+/**
+ * Serve requests on the socket `path` until `*stop` gets set.
+ * A stale socket-file from an earlier daemon is removed.
+ *
+ * \param[in] path  the file-name of the socket.
+ * \param[in] func  the function handling each request.
+ * \param[in] arg   passed on to `func`.
+ * \param[in] stop  checked at least every `DAEMON_POLL_MS` msec.
+ *
+ * \retval -1  if another daemon answers on `path` or the socket could not be created.
+ * \retval The number of requests served.
+ */
+int daemon_serve (const char *path, daemon_func func, void *arg, volatile int *stop)
+{
+  struct sockaddr_un addr;
+  SOCKET listener, s;
+  int    num = 0;
+
+  if (sock_init() < 0)
+     return (-1);
+
+#if defined(USE_POSIX_SOCKETS) && !defined(MSG_NOSIGNAL)
+  signal (SIGPIPE, SIG_IGN);
+#endif
+
+  s = sock_connect (path);
+  if (s != INVALID_SOCKET)
+  {
+    closesocket (s);
+    sock_exit();
+    WARN ("A daemon is already running on \"%s\".\n", path);
+    return (-1);
+  }
+  SOCK_UNLINK (path);
+
+  listener = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (listener == INVALID_SOCKET)
+  {
+    WARN ("Failed to create an AF_UNIX socket: %d.\n", SOCK_ERRNO());
+    sock_exit();
+    return (-1);
+  }
+
+  sock_addr (&addr, path);
+  if (bind(listener, (const struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+      listen(listener, 8) == SOCKET_ERROR)
+  {
+    WARN ("Failed to listen on \"%s\": %d.\n", path, SOCK_ERRNO());
+    closesocket (listener);
+    sock_exit();
+    return (-1);
+  }
+
+  while (!*stop)
+  {
+    struct timeval tv;
+    fd_set fds;
+
+    FD_ZERO (&fds);
+    FD_SET (listener, &fds);
+    tv.tv_sec  = 0;
+    tv.tv_usec = 1000 * DAEMON_POLL_MS;
+
+    if (select((int)listener+1, &fds, NULL, NULL, &tv) <= 0)
+       continue;
+
+    s = accept (listener, NULL, NULL);
+    if (s == INVALID_SOCKET)
+       continue;
+
+    sock_send_timeout (s);
+    if (serve_one(s, func, arg, stop) < 0)
+         DEBUGF (1, "Request %d failed.\n", num);
+    else num++;
+    closesocket (s);
+  }
+
+  closesocket (listener);
+  SOCK_UNLINK (path);
+  sock_exit();
+  return (num);
+}
+
+/**
+ * Send output to the client of the request being served.
+ * Only valid while a `daemon_func` is running.
+ */
+int daemon_write (const char *buf, size_t len)
+{
+  if (cur_client == INVALID_SOCKET || len == 0)
+     return (0);
+  return send_frame (cur_client, 'O', buf, len);
+}
+
+/**
+ * Send `request` to the daemon at `path` and pass the output to `out`.
+ *
+ * \retval DAEMON_NO_SERVER   if no daemon answered; nothing was output.
+ * \retval DAEMON_NOT_SERVED  if the daemon refused the request; nothing was output.
+ * \retval The exit-code from the daemon.
+ */
+int daemon_query (const char *path, const char *request, daemon_output out, void *arg)
+{
+  SOCKET        s;
+  unsigned long len = (unsigned long) strlen (request);
+  unsigned char hdr [5];
+  int           rc = DAEMON_NO_SERVER, got_output = 0;
+
+  if (sock_init() < 0)
+     return (DAEMON_NO_SERVER);
+
+  s = sock_connect (path);
+  if (s == INVALID_SOCKET)
+  {
+    sock_exit();
+    return (DAEMON_NO_SERVER);
+  }
+
+  put32 (hdr, len);
+  if (send_all(s, hdr, 4) < 0 || send_all(s, request, len) < 0)
+     goto quit;
+
+  while (1)
+  {
+    char *buf;
+
+    if (recv_all(s, hdr, sizeof(hdr)) < 0)
+       break;
+
+    len = get32 (hdr+1);
+    if (len > DAEMON_MAX_REQUEST)
+       break;
+    buf = MALLOC (len + 1);
+    if (recv_all(s, buf, len) < 0)
+    {
+      FREE (buf);
+      break;
+    }
+    buf [len] = '\0';
+
+    if (hdr[0] == 'R' && len == 4)
+    {
+      rc = (int) get32 ((const unsigned char*)buf);
+      FREE (buf);
+      break;
+    }
+    if (hdr[0] == 'O')
+    {
+      (*out) (buf, len, arg);
+      got_output = 1;
+    }
+    FREE (buf);
+  }
+
+  /* The daemon died half-way. The output can not be taken back.
+   */
+  if (rc == DAEMON_NO_SERVER && got_output)
+     rc = 1;
+
+quit:
+  closesocket (s);
+  sock_exit();
+  return (rc);
+}
+
+#if defined(DAEMON_TEST) && !defined(_WIN32)
+#include <signal.h>
+#include <sys/wait.h>
+
+#define TEST_UTIL_MAIN
+#include "test_util.h"
+
+static volatile int test_stop;
+
+/*
+ * The test-server echoes the request as 3 frames and returns its length.
+ * "quit" stops the server. "flood" sends 1 MByte.
+ */
+static int test_func (const char *request, void *arg)
+{
+  static char chunk [1024];
+  size_t len = strlen (request);
+  int    i;
+
+  (void) arg;
+  if (!strcmp(request, "quit"))
+  {
+    test_stop = 1;
+    return (0);
+  }
+  if (!strcmp(request, "refuse"))
+     return (DAEMON_NOT_SERVED);
+  if (!strcmp(request, "flood"))
+  {
+    for (i = 0; i < 1024; i++)
+        daemon_write (chunk, sizeof(chunk));
+    return (0);
+  }
+
+  daemon_write ("< ", 2);
+  daemon_write (request, len);
+  daemon_write (" >\n", 3);
+  return ((int)len);
+}
+
+static void test_out (const char *buf, size_t len, void *arg)
+{
+  char *reply = arg;
+
+  strncat (reply, buf, len);
+}
+
+int main (int argc, char **argv)
+{
+  const char *path = "/tmp/daemon-test.sock";
+  char        reply [1000], request [100];
+  int         i, rc, loops = 10000, errors = 0;
+  double      start, usec;
+  pid_t       pid;
+  SOCKET      s;
+
+  if (argc > 1)
+     loops = atoi (argv[1]);
+
+  if (daemon_query(path, "x", test_out, reply) != DAEMON_NO_SERVER)
+  {
+    puts ("A server is already running?");
+    return (1);
+  }
+
+  pid = fork();
+  if (pid == 0)
+  {
+    rc = daemon_serve (path, test_func, NULL, &test_stop);
+    exit (rc == loops + 4 ? 0 : 1);
+  }
+
+  for (i = 0; i < 100; i++)   /* Wait for it to listen */
+  {
+    reply[0] = '\0';
+    if (daemon_query(path, "refuse", test_out, reply) == DAEMON_NOT_SERVED)
+       break;
+    usleep (10000);
+  }
+  if (i == 100)
+  {
+    puts ("The server did not start.");
+    kill (pid, SIGTERM);
+    return (1);
+  }
+
+  if (daemon_serve(path, test_func, NULL, &test_stop) != -1)
+  {
+    puts ("A second server was started.");
+    errors++;
+  }
+
+  /* A client that never sends must not block the next one for long.
+   * Nor must a client that goes away before reading the reply kill the server.
+   */
+  s = sock_connect (path);
+  start = get_time();
+  reply[0] = '\0';
+  rc = daemon_query (path, "after silent", test_out, reply);
+  usec = 1E6 * (get_time() - start);
+  if (rc != (int)strlen("after silent") || usec > 1E6 * (DAEMON_RECV_TIMEOUT + 2))
+  {
+    printf ("Query after a silent client: rc: %d, %.0f usec.\n", rc, usec);
+    errors++;
+  }
+  closesocket (s);
+
+  s = sock_connect (path);
+  put32 ((unsigned char*)request, 5);
+  send_all (s, request, 4);
+  send_all (s, "flood", 5);
+  closesocket (s);
+
+  reply[0] = '\0';
+  if (daemon_query(path, "after flood", test_out, reply) != (int)strlen("after flood"))
+  {
+    puts ("The server died after a client went away.");
+    kill (pid, SIGTERM);
+    return (1);
+  }
+
+  start = get_time();
+  for (i = 0; i < loops; i++)
+  {
+    char expect [sizeof(request)+10];
+
+    snprintf (request, sizeof(request), "query %d", i);
+    snprintf (expect, sizeof(expect), "< %s >\n", request);
+    reply[0] = '\0';
+    rc = daemon_query (path, request, test_out, reply);
+    if (rc != (int)strlen(request) || strcmp(reply, expect))
+    {
+      printf ("query %d: rc: %d, reply: \"%s\".\n", i, rc, reply);
+      errors++;
+    }
+  }
+  usec = 1E6 * (get_time() - start) / loops;
+
+  daemon_query (path, "quit", test_out, reply);
+  waitpid (pid, &rc, 0);
+  if (!WIFEXITED(rc) || WEXITSTATUS(rc) != 0)
+  {
+    puts ("The server did not count the requests.");
+    errors++;
+  }
+
+  printf ("%d queries, %.1f usec per round-trip. %d errors.\n", loops, usec, errors);
+  return (errors ? 1 : 0);
+}
+#endif  /* DAEMON_TEST */
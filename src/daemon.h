@@ -0,0 +1,26 @@
+/** \file daemon.h
+ *  \ingroup Misc
+ */
+#ifndef _DAEMON_H
+#define _DAEMON_H
+
+#define DAEMON_NO_SERVER   -1   /**< No daemon answered; run the query locally */
+#define DAEMON_NOT_SERVED  -2   /**< The daemon refused the query; run it locally */
+
+/**
+ * Called by `daemon_serve()` for each request.
+ * Any output is sent to the client using `daemon_write()`.
+ * Returns the exit-code for the client or `DAEMON_NOT_SERVED`.
+ */
+typedef int (*daemon_func) (const char *request, void *arg);
+
+/**
+ * Called by `daemon_query()` for each piece of output from the daemon.
+ */
+typedef void (*daemon_output) (const char *buf, size_t len, void *arg);
+
+extern int  daemon_serve (const char *path, daemon_func func, void *arg, volatile int *stop);
+extern int  daemon_write (const char *buf, size_t len);
+extern int  daemon_query (const char *path, const char *request, daemon_output out, void *arg);
+
+#endif  /* _DAEMON_H */
@@ -0,0 +1,481 @@
+/**\file    dir_cache.c
+ * \ingroup Misc
+ * \brief
+ *   A persistent cache of directory listings.
+ *
+ * Each cached directory is stored with it's last-write time and the
+ * serial-number of it's volume. The last-write time of a directory
+ * changes when an entry is created, deleted or renamed in it. So if neither
+ * has changed since the last run, the cached listing is still valid and the
+ * directory need not be enumerated again.
+ *
+ * \note The last-write time of a directory does \b not change when a file
+ *       in it is modified. Hence the size and time of a cached entry
+ *       could be stale. The caller should refresh these for a matching
+ *       file (see `scan_dir()` in envtool.c).
+ *
+ * The cache-file is a text-file with lines like:
+ * ```
+ *   D <volume-serial> <dir-time> <last-used> <dir>
+ *   F <attributes> <size> <time> <name>
+ * ```
+ *
+ * A `D` line is followed by the `F` lines of it's entries.
+ * A directory not used for `DIR_CACHE_MAX_AGE` days is dropped when the
+ * cache is saved. And only the `DIR_CACHE_MAX_DIRS` most recently used
+ * directories are kept.
+ *
+ * The functions here are thread-safe.
+ */
+#include <windows.h>
+
+#include "envtool.h"
+#include "smartlist.h"
+#include "dirscan.h"
+#include "dir_cache.h"
+
+/**
+ * The first line in a cache-file. Bump the version if the format changes.
+ */
+#define DIR_CACHE_HEADER  "# envtool directory cache. Version 2.\n"
+
+#define DIR_CACHE_MAX_AGE   30         /**< Days a directory is kept after it was last used */
+#define DIR_CACHE_MAX_DIRS  10000      /**< Max number of directories kept in the cache-file */
+#define DIR_CACHE_TOUCH     (24*3600)  /**< Granularity of `dir_cache_rec::last_used` */
+
+/**
+ * A cached directory.
+ */
+struct dir_cache_rec {
+       char        *dir;
+       DWORD        vol_serial;
+       UINT64       dir_mtime;   /**< The `ftLastWriteTime` of `dir` */
+       time_t       last_used;   /**< When `dir` was last listed from (or into) the cache */
+       smartlist_t *entries;     /**< Of `struct dirscan_entry` */
+     };
+
+static smartlist_t     *records;      /* Sorted on `dir_cache_rec::dir` */
+static smartlist_t     *retired;      /* Replaced records; possibly still in use */
+static char            *cache_fname;
+static BOOL             dirty;
+static CRITICAL_SECTION lock;
+static unsigned         num_hits, num_misses;
+
+static int compare_rec (const void **_a, const void **_b)
+{
+  const struct dir_cache_rec *a = *_a;
+  const struct dir_cache_rec *b = *_b;
+
+  return stricmp (a->dir, b->dir);
+}
+
+static int compare_dir (const void *key, const void **member)
+{
+  const struct dir_cache_rec *rec = *member;
+
+  return stricmp ((const char*)key, rec->dir);
+}
+
+/**
+ * Sort the most recently used first.
+ */
+static int compare_used (const void **_a, const void **_b)
+{
+  const struct dir_cache_rec *a = *_a;
+  const struct dir_cache_rec *b = *_b;
+
+  if (a->last_used > b->last_used)
+     return (-1);
+  if (a->last_used < b->last_used)
+     return (1);
+  return (0);
+}
+
+static void rec_free (struct dir_cache_rec *rec)
+{
+  int i, max = smartlist_len (rec->entries);
+
+  for (i = 0; i < max; i++)
+  {
+    struct dirscan_entry *de = smartlist_get (rec->entries, i);
+    char  *name = (char*) de->name;
+
+    FREE (name);
+    FREE (de);
+  }
+  smartlist_free (rec->entries);
+  FREE (rec->dir);
+  FREE (rec);
+}
+
+static struct dir_cache_rec *rec_new (const char *dir, DWORD vol_serial, UINT64 dir_mtime, time_t last_used)
+{
+  struct dir_cache_rec *rec = MALLOC (sizeof(*rec));
+
+  rec->dir        = STRDUP (dir);
+  rec->vol_serial = vol_serial;
+  rec->dir_mtime  = dir_mtime;
+  rec->last_used  = last_used;
+  rec->entries    = smartlist_new();
+  return (rec);
+}
+
+static void rec_add_entry (struct dir_cache_rec *rec, const char *name,
+                           DWORD attrib, UINT64 fsize, time_t mtime)
+{
+  struct dirscan_entry *de = MALLOC (sizeof(*de));
+
+  de->name        = STRDUP (name);
+  de->attrib      = attrib;
+  de->is_dir      = ((attrib & FILE_ATTRIBUTE_DIRECTORY) != 0);
+  de->is_junction = ((attrib & FILE_ATTRIBUTE_REPARSE_POINT) != 0);
+  de->fsize       = fsize;
+  de->mtime       = mtime;
+  de->valid       = DS_HAVE_ALL;
+  smartlist_add (rec->entries, de);
+}
+
+/**
+ * Get the volume serial-number and the last-write time of `dir`.
+ * A junction is followed to it's target.
+ */
+static BOOL get_dir_key (const char *dir, DWORD *vol_serial, UINT64 *dir_mtime)
+{
+  BY_HANDLE_FILE_INFORMATION info;
+  HANDLE hnd;
+  BOOL   rc;
+
+  hnd = CreateFile (dir, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                    NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+  if (hnd == INVALID_HANDLE_VALUE)
+     return (FALSE);
+
+  rc = GetFileInformationByHandle (hnd, &info);
+  CloseHandle (hnd);
+  if (!rc || !(info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+     return (FALSE);
+
+  *vol_serial = info.dwVolumeSerialNumber;
+  *dir_mtime  = ((UINT64)info.ftLastWriteTime.dwHighDateTime << 32) +
+                info.ftLastWriteTime.dwLowDateTime;
+  return (TRUE);
+}
+
+/**
+ * Read the cache-file into `records`.
+ * A file with a wrong header is ignored. So is the rest of it from a
+ * corrupt or truncated record (a line without a newline) and on.
+ */
+static void dir_cache_read (const char *fname)
+{
+  struct dir_cache_rec *rec = NULL;
+  FILE  *f = fopen (fname, "rt");
+  char   buf [2*_MAX_PATH];
+  int    line = 0;
+
+  if (!f)
+     return;
+
+  while (fgets(buf, sizeof(buf), f))
+  {
+    unsigned long val1;
+    UINT64        val2, val3, val4;
+    int           len = 0;
+
+    if (line++ == 0)
+    {
+      if (strcmp(buf, DIR_CACHE_HEADER))
+      {
+        DEBUGF (1, "\"%s\" has a wrong header; ignoring it.\n", fname);
+        break;
+      }
+      continue;
+    }
+    if (!strchr(buf, '\n'))
+    {
+      DEBUGF (1, "\"%s\" is truncated at line %d; ignoring the rest.\n", fname, line);
+      break;
+    }
+    strip_nl (buf);
+
+    if (sscanf(buf, "D %lx %" U64_FMT " %" U64_FMT " %n", &val1, &val2, &val4, &len) >= 3 && len > 0)
+    {
+      rec = rec_new (buf+len, (DWORD)val1, val2, (time_t)val4);
+      smartlist_add (records, rec);
+    }
+    else if (rec && sscanf(buf, "F %lx %" U64_FMT " %" U64_FMT " %n", &val1, &val2, &val3, &len) >= 3 && len > 0)
+      rec_add_entry (rec, buf+len, (DWORD)val1, val2, (time_t)val3);
+    else
+    {
+      DEBUGF (1, "\"%s\" is corrupt at line %d; ignoring the rest.\n", fname, line);
+      break;
+    }
+  }
+  fclose (f);
+  smartlist_sort (records, compare_rec);
+}
+
+static void rec_free_cb (void *rec)
+{
+  rec_free (rec);
+}
+
+static int rec_unused (const void *_rec, void *_oldest)
+{
+  const struct dir_cache_rec *rec = _rec;
+  const time_t               *oldest = _oldest;
+
+  return (rec->last_used < *oldest);
+}
+
+/**
+ * Drop the directories not used for `DIR_CACHE_MAX_AGE` days and all but
+ * the `DIR_CACHE_MAX_DIRS` most recently used ones (those used the same
+ * day as the last one kept are kept too). Called before `records` is saved.
+ */
+static void dir_cache_prune (void)
+{
+  time_t oldest = time (NULL) - DIR_CACHE_MAX_AGE * 24 * 3600;
+  int    i, max = smartlist_len (records);
+  int    num_dropped;
+
+  if (max > DIR_CACHE_MAX_DIRS)
+  {
+    /* Find the `last_used` of the last directory to keep.
+     */
+    smartlist_t *by_use = smartlist_new();
+    const struct dir_cache_rec *rec;
+
+    for (i = 0; i < max; i++)
+        smartlist_add (by_use, smartlist_get(records, i));
+    smartlist_sort (by_use, compare_used);
+    rec = smartlist_get (by_use, DIR_CACHE_MAX_DIRS-1);
+    if (rec->last_used > oldest)
+       oldest = rec->last_used;
+    smartlist_free (by_use);
+  }
+
+  num_dropped = smartlist_remove_if (records, rec_unused, &oldest, rec_free_cb);
+  DEBUGF (1, "Dropped %d unused directories.\n", num_dropped);
+}
+
+/**
+ * Write `records` to a temporary file and replace the cache-file with it.
+ * So another `envtool` process never reads a half-written file.
+ * If writing failed (e.g. the disk is full), the old cache-file is kept.
+ */
+static void dir_cache_write (const char *fname)
+{
+  FILE *f;
+  char  tmp [_MAX_PATH];
+  int   i, j, max, err;
+
+  dir_cache_prune();
+
+  snprintf (tmp, sizeof(tmp), "%s.%lu", fname, (unsigned long)GetCurrentProcessId());
+  f = fopen (tmp, "w+t");
+  if (!f)
+  {
+    DEBUGF (1, "Failed to create \"%s\".\n", tmp);
+    return;
+  }
+
+  fputs (DIR_CACHE_HEADER, f);
+  max = smartlist_len (records);
+  for (i = 0; i < max; i++)
+  {
+    const struct dir_cache_rec *rec = smartlist_get (records, i);
+    int   max_j = smartlist_len (rec->entries);
+
+    fprintf (f, "D %lx %" U64_FMT " %" U64_FMT " %s\n",
+             (unsigned long)rec->vol_serial, rec->dir_mtime, (UINT64)rec->last_used, rec->dir);
+    for (j = 0; j < max_j; j++)
+    {
+      const struct dirscan_entry *de = smartlist_get (rec->entries, j);
+
+      fprintf (f, "F %lx %" U64_FMT " %" U64_FMT " %s\n",
+               (unsigned long)de->attrib, de->fsize, (UINT64)de->mtime, de->name);
+    }
+  }
+  err = ferror (f);
+  if (fclose(f) != 0 || err)
+  {
+    DEBUGF (1, "Failed to write \"%s\"; keeping the old cache.\n", tmp);
+    DeleteFile (tmp);
+    return;
+  }
+
+  if (!MoveFileEx(tmp, fname, MOVEFILE_REPLACE_EXISTING))
+  {
+    DEBUGF (1, "Failed to rename \"%s\"; %s\n", tmp, win_strerror(GetLastError()));
+    DeleteFile (tmp);
+  }
+}
+
+/**
+ * Load the cache from `fname`.
+ *
+ * \param[in] fname  The cache-file. Environment variables are expanded.
+ */
+void dir_cache_init (const char *fname)
+{
+  if (records)
+     return;
+
+  InitializeCriticalSection (&lock);
+  records = smartlist_new();
+  retired = smartlist_new();
+  cache_fname = getenv_expand (fname);
+  if (cache_fname)
+     dir_cache_read (cache_fname);
+  dirty = FALSE;
+
+  DEBUGF (1, "Loaded %d directories from \"%s\".\n", smartlist_len(records), cache_fname);
+}
+
+/**
+ * Save the cache if it was changed and free it.
+ */
+void dir_cache_exit (void)
+{
+  int i, max;
+
+  if (!records)
+     return;
+
+  DEBUGF (1, "%u hits, %u misses.\n", num_hits, num_misses);
+
+  if (dirty && cache_fname && !halt_flag)
+     dir_cache_write (cache_fname);
+
+  max = smartlist_len (records);
+  for (i = 0; i < max; i++)
+      rec_free (smartlist_get(records, i));
+
+  max = smartlist_len (retired);
+  for (i = 0; i < max; i++)
+      rec_free (smartlist_get(retired, i));
+
+  smartlist_free (records);
+  smartlist_free (retired);
+  records = retired = NULL;
+  FREE (cache_fname);
+  DeleteCriticalSection (&lock);
+}
+
+/**
+ * Prune the cache and write it if it was changed since it was loaded or
+ * last saved. For a long-running `--daemon`; so the cache does not grow
+ * without bounds and is not lost if the process is killed.
+ *
+ * Only to be called when no list returned by `dir_cache_list()` is in use.
+ */
+void dir_cache_save (void)
+{
+  if (!records)
+     return;
+
+  EnterCriticalSection (&lock);
+  if (dirty && !halt_flag)
+  {
+    if (cache_fname)
+         dir_cache_write (cache_fname);
+    else dir_cache_prune();
+    dirty = FALSE;
+  }
+  LeaveCriticalSection (&lock);
+}
+
+/**
+ * Free the records replaced since the last call.
+ *
+ * Only to be called when no list returned by `dir_cache_list()` is in use.
+ * E.g. between two `--batch` or `--daemon` queries.
+ */
+void dir_cache_trim (void)
+{
+  int i, max;
+
+  if (!records)
+     return;
+
+  EnterCriticalSection (&lock);
+  max = smartlist_len (retired);
+  for (i = 0; i < max; i++)
+      rec_free (smartlist_get(retired, i));
+  smartlist_clear (retired);
+  LeaveCriticalSection (&lock);
+
+  if (max > 0)
+     DEBUGF (2, "Freed %d replaced directories.\n", max);
+}
+
+/**
+ * Return the listing of `dir` as a smartlist of `struct dirscan_entry`.
+ *
+ * If `dir` is unchanged since it was cached, the cached listing is returned.
+ * Otherwise `dir` is enumerated and the cache updated.
+ *
+ * \retval NULL  if the cache is not initialised or `dir` is not a
+ *               directory. The caller should scan it the normal way.
+ * \note The returned list is owned by the cache and is valid until
+ *       `dir_cache_trim()` or `dir_cache_exit()` is called.
+ */
+const smartlist_t *dir_cache_list (const char *dir)
+{
+  const struct dirscan_entry *de;
+  struct dir_cache_rec       *rec;
+  DIRSCAN *ds;
+  DWORD    vol_serial;
+  UINT64   dir_mtime;
+  time_t   now;
+  int      idx, found;
+
+  /* Get the key before a possible enumeration. So if `dir` is changed
+   * while it's being enumerated, the next run will re-enumerate it.
+   */
+  if (!records || !get_dir_key(dir, &vol_serial, &dir_mtime))
+     return (NULL);
+
+  now = time (NULL);
+  EnterCriticalSection (&lock);
+  rec = smartlist_bsearch (records, dir, compare_dir);
+  if (rec && rec->vol_serial == vol_serial && rec->dir_mtime == dir_mtime)
+  {
+    num_hits++;
+
+    /* Do not rewrite the cache-file just for a new `last_used`
+     * unless it's more than a day old.
+     */
+    if (now - rec->last_used >= DIR_CACHE_TOUCH)
+    {
+      rec->last_used = now;
+      dirty = TRUE;
+    }
+    LeaveCriticalSection (&lock);
+    return (rec->entries);
+  }
+  num_misses++;
+  LeaveCriticalSection (&lock);
+
+  rec = rec_new (dir, vol_serial, dir_mtime, now);
+  ds = dirscan_open (dir, "*");
+  while (ds && (de = dirscan_next(ds)) != NULL)
+     rec_add_entry (rec, de->name, de->attrib, de->fsize, de->mtime);
+  dirscan_close (ds);
+
+  EnterCriticalSection (&lock);
+  idx = smartlist_bsearch_idx (records, dir, compare_dir, &found);
+  if (found)
+  {
+    smartlist_add (retired, smartlist_get(records, idx));
+    smartlist_set (records, idx, rec);
+  }
+  else
+    smartlist_insert (records, idx, rec);
+  dirty = TRUE;
+  LeaveCriticalSection (&lock);
+
+  DEBUGF (2, "Cached %d entries for \"%s\".\n", smartlist_len(rec->entries), dir);
+  return (rec->entries);
+}
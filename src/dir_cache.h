@@ -0,0 +1,16 @@
+/** \file dir_cache.h
+ *  \ingroup Misc
+ */
+#ifndef _DIR_CACHE_H
+#define _DIR_CACHE_H
+
+#include "smartlist.h"
+#include "dirscan.h"
+
+extern void               dir_cache_init (const char *fname);
+extern void               dir_cache_exit (void);
+extern void               dir_cache_trim (void);
+extern void               dir_cache_save (void);
+extern const smartlist_t *dir_cache_list (const char *dir);
+
+#endif  /* _DIR_CACHE_H */
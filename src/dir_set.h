@@ -0,0 +1,18 @@
+/** \file dir_set.h
+ *  \ingroup Misc
+ */
+#ifndef _DIR_SET_H
+#define _DIR_SET_H
+
+/**
+ * A hash-set of directory names. Opaque to the user.
+ */
+typedef struct dir_set dir_set;
+
+extern dir_set *dir_set_new  (int nocase);
+extern unsigned dir_set_add  (dir_set *set, const char *dir);
+extern unsigned dir_set_find (const dir_set *set, const char *dir);
+extern unsigned dir_set_len  (const dir_set *set);
+extern void     dir_set_free (dir_set *set);
+
+#endif  /* _DIR_SET_H */
@@ -0,0 +1,493 @@
+/**\file    dir_size.c
+ * \ingroup Misc
+ * \brief
+ *   Getting the allocated size of a directory tree. For `envtool --size -D`.
+ *
+ * Each directory in a tree is a task for a pool of worker-threads.
+ * A task sums the allocation-size of the files in it's directory and
+ * submits a task for each sub-directory not already sized. When the last
+ * task in a sub-tree is done, the size of the sub-tree is added to
+ * it's parent. Nobody waits for a sub-task; so a pool with a FIFO-queue
+ * cannot dead-lock.
+ *
+ * The size of each sub-tree is memoized. So when matched directories nest
+ * (e.g. `"c:\foo"` and `"c:\foo\bar"`), a sub-tree is sized only once.
+ *
+ * A file allocates a whole number of clusters and a directory is assumed
+ * to allocate one cluster. The cluster-size of each volume is cached.
+ * A junction is not recursed into.
+ *
+ * Sizing a tree is stopped when it takes longer than the time-budget.
+ * The size is then partial and it is not memoized.
+ */
+#include <windows.h>
+
+#include "envtool.h"
+#include "smartlist.h"
+#include "dirscan.h"
+#include "thread_pool.h"
+#include "dir_size.h"
+
+/**
+ * A directory being sized.
+ */
+struct size_node {
+       char             *dir;
+       struct size_node *parent;
+       struct size_job  *job;
+       UINT64            size;      /**< of the files here and the sub-trees done so far */
+       LONG              pending;   /**< 1 for the scan of `dir` + the sub-trees not done */
+       BOOL              partial;   /**< a part of the sub-tree was skipped */
+     };
+
+/**
+ * Sizing the tree under one directory.
+ */
+struct size_job {
+       CRITICAL_SECTION  lock;          /**< protects the `size`, `partial` and `pending` of nodes */
+       HANDLE            done;          /**< set when the top node is done */
+       smartlist_t      *serial;        /**< the queued nodes when there is no pool */
+       DWORD             cluster_size;  /**< 0 if unknown */
+       DWORD             start;         /**< `GetTickCount()` at start */
+       UINT64            size;          /**< the result */
+       BOOL              partial;
+     };
+
+/**
+ * A memoized sub-tree in the `memo` hash-table.
+ */
+struct size_memo {
+       char             *dir;
+       UINT64            size;
+       struct size_memo *next;
+     };
+
+/**
+ * A cached cluster-size of a volume.
+ */
+struct volume_info {
+       char  *root;
+       DWORD  cluster_size;
+     };
+
+static thread_pool       *size_pool;
+static DWORD              size_budget;    /* in msec. 0 means no limit */
+static BOOL               size_inited;
+static CRITICAL_SECTION   memo_lock;      /* protects `memo` and `volumes` */
+static struct size_memo **memo;
+static size_t             memo_size, memo_len;
+static smartlist_t       *volumes;
+static unsigned           num_hits, num_dirs, num_timeouts;
+
+/**
+ * The hash of a memo-key. Case-insensitive.
+ */
+static size_t memo_hash (const char *dir)
+{
+  DWORD h = 2166136261U;
+
+  for ( ; *dir; dir++)
+  {
+    h ^= (BYTE) TOUPPER (*dir);
+    h *= 16777619U;
+  }
+  return (h & (memo_size - 1));
+}
+
+/**
+ * Make `dir` a memo-key: all `\\` and without a trailing slash.
+ */
+static void memo_key (char *key, size_t key_size, const char *dir)
+{
+  size_t len;
+
+  if (strlen(dir) >= key_size)
+  {
+    _strlcpy (key, dir, key_size);
+    return;
+  }
+  slashify2 (key, dir, '\\');
+  len = strlen (key);
+  if (len > 3 && key[len-1] == '\\')
+     key [len-1] = '\0';
+}
+
+static BOOL memo_get (const char *dir, UINT64 *size)
+{
+  const struct size_memo *m;
+  BOOL  found = FALSE;
+
+  EnterCriticalSection (&memo_lock);
+  for (m = memo [memo_hash(dir)]; m; m = m->next)
+      if (!stricmp(m->dir, dir))
+      {
+        *size = m->size;
+        found = TRUE;
+        num_hits++;
+        break;
+      }
+  LeaveCriticalSection (&memo_lock);
+  return (found);
+}
+
+static void memo_grow (void)
+{
+  struct size_memo **old = memo;
+  size_t i, old_size = memo_size;
+
+  memo_size *= 2;
+  memo = CALLOC (sizeof(*memo), memo_size);
+  for (i = 0; i < old_size; i++)
+  {
+    struct size_memo *m, *next;
+
+    for (m = old[i]; m; m = next)
+    {
+      size_t h = memo_hash (m->dir);
+
+      next = m->next;
+      m->next = memo[h];
+      memo[h] = m;
+    }
+  }
+  FREE (old);
+}
+
+static void memo_add (const char *dir, UINT64 size)
+{
+  struct size_memo *m = MALLOC (sizeof(*m));
+  size_t h;
+
+  m->dir  = STRDUP (dir);
+  m->size = size;
+
+  EnterCriticalSection (&memo_lock);
+  if (memo_len >= memo_size)
+     memo_grow();
+  h = memo_hash (dir);
+  m->next = memo[h];
+  memo[h] = m;
+  memo_len++;
+  LeaveCriticalSection (&memo_lock);
+}
+
+/**
+ * Return the cluster-size of the volume `dir` is on.
+ * A volume mounted on a directory is handled too.
+ *
+ * \retval 0 if unknown.
+ */
+static DWORD get_cluster_size (const char *dir)
+{
+  const struct volume_info *vi;
+  struct volume_info       *new_vi;
+  DWORD  sect_per_cluster, bytes_per_sector, free_clusters, total_clusters;
+  char   root [_MAX_PATH];
+  int    i, max;
+
+  if (!GetVolumePathName(dir, root, sizeof(root)))
+     return (0);
+
+  EnterCriticalSection (&memo_lock);
+  max = smartlist_len (volumes);
+  for (i = 0; i < max; i++)
+  {
+    vi = smartlist_get (volumes, i);
+    if (!stricmp(vi->root, root))
+    {
+      LeaveCriticalSection (&memo_lock);
+      return (vi->cluster_size);
+    }
+  }
+  LeaveCriticalSection (&memo_lock);
+
+  new_vi = MALLOC (sizeof(*new_vi));
+  new_vi->root = STRDUP (root);
+  new_vi->cluster_size = 0;
+  if (GetDiskFreeSpace(root, &sect_per_cluster, &bytes_per_sector, &free_clusters, &total_clusters))
+     new_vi->cluster_size = sect_per_cluster * bytes_per_sector;
+
+  DEBUGF (1, "Volume \"%s\": cluster_size: %lu.\n", root, (unsigned long)new_vi->cluster_size);
+
+  EnterCriticalSection (&memo_lock);
+  smartlist_add (volumes, new_vi);
+  LeaveCriticalSection (&memo_lock);
+  return (new_vi->cluster_size);
+}
+
+/**
+ * Return the allocation-size of a file of `size` bytes.
+ * `size == (UINT64)-1` means it's a directory.
+ */
+static UINT64 alloc_size (const struct size_job *job, UINT64 size)
+{
+  UINT64 num_clusters;
+
+  if (job->cluster_size == 0)
+     return (size == (UINT64)-1 ? 0 : size);
+
+  if (size == (UINT64)-1)
+     return (job->cluster_size);
+
+  num_clusters = size / job->cluster_size;
+  if (size % job->cluster_size)
+     num_clusters++;
+  return (num_clusters * job->cluster_size);
+}
+
+static struct size_node *node_new (const char *dir, struct size_node *parent, struct size_job *job)
+{
+  struct size_node *node = CALLOC (sizeof(*node), 1);
+
+  node->dir     = STRDUP (dir);
+  node->parent  = parent;
+  node->job     = job;
+  node->pending = 1;
+  return (node);
+}
+
+static void node_free (struct size_node *node)
+{
+  FREE (node->dir);
+  FREE (node);
+}
+
+static void size_task (void *arg);
+
+static void node_submit (struct size_node *node)
+{
+  if (size_pool)
+       pool_submit (size_pool, size_task, node);
+  else smartlist_add (node->job->serial, node);
+}
+
+/**
+ * A sub-tree is done. Memoize it and add it to it's parent.
+ * If that was the last pending sub-tree of the parent, the parent is done too.
+ */
+static void node_done (struct size_node *node)
+{
+  struct size_job *job = node->job;
+
+  while (node)
+  {
+    struct size_node *parent = node->parent;
+    BOOL   last;
+
+    if (!node->partial)
+       memo_add (node->dir, node->size);
+
+    if (!parent)
+    {
+      job->size    = node->size;
+      job->partial = node->partial;
+      node_free (node);
+      if (size_pool)
+         SetEvent (job->done);
+      break;
+    }
+
+    EnterCriticalSection (&job->lock);
+    parent->size    += node->size;
+    parent->partial |= node->partial;
+    last = (--parent->pending == 0);
+    LeaveCriticalSection (&job->lock);
+
+    node_free (node);
+    node = last ? parent : NULL;
+  }
+}
+
+/**
+ * Size the files in `node->dir` and submit a task for each sub-directory
+ * that is not memoized.
+ */
+static void size_task (void *arg)
+{
+  struct size_node           *node = (struct size_node*) arg;
+  struct size_job            *job  = node->job;
+  const struct dirscan_entry *de;
+  smartlist_t *children = smartlist_new();
+  DIRSCAN     *ds;
+  UINT64       size = 0;
+  BOOL         partial = FALSE;
+  BOOL         last;
+  int          i, num;
+
+  if (halt_flag || (size_budget && GetTickCount() - job->start >= size_budget))
+     partial = TRUE;
+
+  else if ((ds = dirscan_open(node->dir, "*")) != NULL)
+  {
+    while ((de = dirscan_next(ds)) != NULL)
+    {
+      char   path [_MAX_PATH];
+      UINT64 sub_size;
+
+      if (!de->is_dir)
+      {
+        if (!(de->valid & DS_HAVE_SIZE))
+           dirscan_stat (ds, DS_HAVE_SIZE);
+        size += alloc_size (job, de->fsize);
+        continue;
+      }
+
+      size += alloc_size (job, (UINT64)-1);
+      if (de->is_junction)
+      {
+        DEBUGF (2, "Not recursing into junction \"%s\\%s\".\n", node->dir, de->name);
+        continue;
+      }
+
+      snprintf (path, sizeof(path), "%s\\%s", node->dir, de->name);
+      if (memo_get(path, &sub_size))
+           size += sub_size;
+      else smartlist_add (children, node_new(path, node, job));
+    }
+    dirscan_close (ds);
+  }
+
+  num = smartlist_len (children);
+
+  EnterCriticalSection (&job->lock);
+  num_dirs++;
+  node->size    += size;
+  node->partial |= partial;
+  node->pending += num;
+  last = (--node->pending == 0);
+  LeaveCriticalSection (&job->lock);
+
+  /* `node` may be freed by another thread from here on.
+   */
+  for (i = 0; i < num; i++)
+      node_submit (smartlist_get(children, i));
+  smartlist_free (children);
+
+  if (last)
+     node_done (node);
+}
+
+/**
+ * Set up the directory-sizing.
+ *
+ * \param[in] num_threads  number of worker-threads. If 0, use `pool_default_threads()`.
+ *                         If 1, size the directories in the calling thread.
+ * \param[in] budget_ms    the max time to size one tree. 0 means no limit.
+ */
+void dir_size_init (int num_threads, DWORD budget_ms)
+{
+  if (size_inited)
+     return;
+
+  InitializeCriticalSection (&memo_lock);
+  memo_size = 1024;
+  memo      = CALLOC (sizeof(*memo), memo_size);
+  volumes   = smartlist_new();
+
+  size_budget = budget_ms;
+  if (num_threads != 1)
+     size_pool = pool_create (num_threads);
+  size_inited = TRUE;
+}
+
+void dir_size_exit (void)
+{
+  size_t i;
+  int    j, max;
+
+  if (!size_inited)
+     return;
+
+  DEBUGF (1, "Sized %u directories. %u memo-hits, %u time-outs.\n", num_dirs, num_hits, num_timeouts);
+
+  pool_destroy (size_pool);
+  size_pool = NULL;
+
+  for (i = 0; i < memo_size; i++)
+  {
+    struct size_memo *m, *next;
+
+    for (m = memo[i]; m; m = next)
+    {
+      next = m->next;
+      FREE (m->dir);
+      FREE (m);
+    }
+  }
+  FREE (memo);
+  memo_size = memo_len = 0;
+
+  max = smartlist_len (volumes);
+  for (j = 0; j < max; j++)
+  {
+    struct volume_info *vi = smartlist_get (volumes, j);
+
+    FREE (vi->root);
+    FREE (vi);
+  }
+  smartlist_free (volumes);
+  DeleteCriticalSection (&memo_lock);
+  size_inited = FALSE;
+}
+
+/**
+ * Get the allocated size of the files and directories under `dir`.
+ *
+ * \param[in]  dir      the top directory. It's own size is not included.
+ * \param[out] partial  set to TRUE if the size is only partial since
+ *                      the time-budget was exceeded. (may be NULL).
+ */
+UINT64 dir_size_get (const char *dir, BOOL *partial)
+{
+  struct size_job job;
+  char   key [_MAX_PATH];
+  UINT64 size;
+
+  if (partial)
+     *partial = FALSE;
+
+  if (!size_inited)
+     dir_size_init (1, 0);
+
+  memo_key (key, sizeof(key), dir);
+  if (memo_get(key, &size))
+     return (size);
+
+  memset (&job, '\0', sizeof(job));
+  InitializeCriticalSection (&job.lock);
+  job.cluster_size = get_cluster_size (key);
+  job.start = GetTickCount();
+
+  if (size_pool)
+  {
+    job.done = CreateEvent (NULL, TRUE, FALSE, NULL);
+    node_submit (node_new(key, NULL, &job));
+    WaitForSingleObject (job.done, INFINITE);
+    CloseHandle (job.done);
+  }
+  else
+  {
+    job.serial = smartlist_new();
+    node_submit (node_new(key, NULL, &job));
+    while (smartlist_len(job.serial) > 0)
+    {
+      int   last = smartlist_len (job.serial) - 1;
+      void *node = smartlist_get (job.serial, last);
+
+      smartlist_del (job.serial, last);
+      size_task (node);
+    }
+    smartlist_free (job.serial);
+  }
+  DeleteCriticalSection (&job.lock);
+
+  if (job.partial)
+  {
+    num_timeouts++;
+    DEBUGF (1, "Sizing \"%s\" took more than %lu msec; the size is partial.\n",
+            key, (unsigned long)size_budget);
+  }
+  if (partial)
+     *partial = job.partial;
+  return (job.size);
+}
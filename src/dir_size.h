@@ -0,0 +1,11 @@
+/** \file dir_size.h
+ *  \ingroup Misc
+ */
+#ifndef _DIR_SIZE_H
+#define _DIR_SIZE_H
+
+extern void   dir_size_init (int num_threads, DWORD budget_ms);
+extern void   dir_size_exit (void);
+extern UINT64 dir_size_get  (const char *dir, BOOL *partial);
+
+#endif  /* _DIR_SIZE_H */
@@ -0,0 +1,561 @@
+/**\file    dir_walk.c
+ * \ingroup Misc
+ * \brief
+ *   A multi-threaded directory tree walker with work-stealing.
+ *
+ * Each directory in the tree is a task (a `walk_node`). A worker-thread
+ * owns a deque of tasks; it pushes the sub-directories it finds to the
+ * bottom of it's own deque and pops from the bottom (depth-first). An idle
+ * worker steals from the top of another deque (i.e. the oldest and
+ * largest sub-tree).
+ *
+ * The results are reported by the calling thread in the same depth-first
+ * pre-order as a serial walk would give. While waiting for a directory
+ * that no worker has started on yet, the calling thread simply scans it
+ * itself. Hence it never waits for a queued task.
+ *
+ * The number of scanned, but not yet reported, directory results is
+ * bounded by `WALK_MAX_PENDING`. A node is freed as soon as it's sub-tree
+ * is reported and no deque refers to it. And a deque holds at most
+ * `WALK_MAX_QUEUED` nodes; a sub-directory that does not fit is left
+ * for the calling thread. So the memory used depends on the depth and
+ * width of the tree, not on it's size.
+ *
+ * Junction (and symlink) cycles are detected by resolving the target
+ * with `get_reparse_point()`.
+ */
+#include <limits.h>
+#include <windows.h>
+
+#include "envtool.h"
+#include "smartlist.h"
+#include "dirscan.h"
+#include "thread_pool.h"
+#include "dir_walk.h"
+
+/**
+ * \def WALK_MAX_PENDING
+ * The max number of directories scanned by the workers and not yet reported.
+ *
+ * \def WALK_MAX_QUEUED
+ * The max number of nodes in a deque.
+ *
+ * \def WALK_MAX_DEPTH
+ * A safety-net against too deep (or undetected cyclic) trees.
+ */
+#define WALK_MAX_PENDING  1024
+#define WALK_MAX_QUEUED   4096
+#define WALK_MAX_DEPTH    100
+
+/**
+ * The states of a `walk_node`.
+ */
+#define WALK_QUEUED   0
+#define WALK_RUNNING  1
+#define WALK_DONE     2
+
+/**
+ * A directory in the tree.
+ */
+struct walk_node {
+       char              *dir;
+       char              *link;           /**< resolved target if `dir` is a junction */
+       struct walk_node  *parent;
+       struct walk_node **children;       /**< in enumeration order */
+       int                num_children;
+       int                depth;
+       volatile LONG      state;          /**< `WALK_QUEUED`, `WALK_RUNNING` or `WALK_DONE` */
+       volatile LONG      refs;           /**< one for the tree and one for each deque holding it */
+       BOOL               by_worker;      /**< scanned by a worker; holds a `pending` slot */
+       void              *result;         /**< from the `walk_scan_func` */
+     };
+
+/**
+ * A deque of `walk_node`s.
+ */
+struct walk_deque {
+       CRITICAL_SECTION   lock;
+       struct walk_node **nodes;
+       int                top;
+       int                bottom;
+       int                size;
+     };
+
+struct walk_state {
+       walk_scan_func     scan;
+       void              *arg;
+       struct walk_deque *deques;      /**< one per worker + one for the calling thread */
+       int                num_deques;
+       HANDLE             pending;     /**< semaphore counting free `WALK_MAX_PENDING` slots */
+       HANDLE             queued;      /**< semaphore released for each node pushed on a deque */
+       HANDLE             node_done;   /**< set each time a node is done */
+       HANDLE             quit;        /**< set when the workers should stop */
+       CRITICAL_SECTION   reparse_lock;
+     };
+
+struct walk_worker {
+       struct walk_state *walk;
+       int                index;
+     };
+
+static struct walk_node *node_new (const char *dir, struct walk_node *parent)
+{
+  struct walk_node *node = CALLOC (sizeof(*node), 1);
+
+  node->dir    = STRDUP (dir);
+  node->parent = parent;
+  node->depth  = parent ? parent->depth + 1 : 0;
+  node->state  = WALK_QUEUED;
+  node->refs   = 1;
+  return (node);
+}
+
+/**
+ * Drop a reference to `node`. Free it when the last one is gone.
+ * The children are not freed here; each holds it's own reference.
+ */
+static void node_release (struct walk_node *node)
+{
+  if (InterlockedDecrement(&node->refs) > 0)
+     return;
+  FREE (node->children);
+  FREE (node->link);
+  FREE (node->dir);
+  FREE (node);
+}
+
+static void deque_init (struct walk_deque *dq)
+{
+  InitializeCriticalSection (&dq->lock);
+  dq->nodes = NULL;
+  dq->top = dq->bottom = dq->size = 0;
+}
+
+static void deque_free (struct walk_deque *dq)
+{
+  while (dq->bottom > dq->top)
+     node_release (dq->nodes [--dq->bottom]);
+  DeleteCriticalSection (&dq->lock);
+  FREE (dq->nodes);
+}
+
+/**
+ * Drop the nodes in `dq` that were already taken by the calling thread.
+ * The caller must hold the lock.
+ */
+static void deque_compact (struct walk_deque *dq)
+{
+  int i, j = 0;
+
+  for (i = dq->top; i < dq->bottom; i++)
+  {
+    struct walk_node *node = dq->nodes [i];
+
+    if (node->state == WALK_QUEUED)
+         dq->nodes [j++] = node;
+    else node_release (node);
+  }
+  dq->top    = 0;
+  dq->bottom = j;
+}
+
+/**
+ * Push `node` on the bottom of `dq`.
+ * \retval FALSE if `dq` is full of queued nodes.
+ */
+static BOOL deque_push (struct walk_deque *dq, struct walk_node *node)
+{
+  BOOL rc = TRUE;
+
+  EnterCriticalSection (&dq->lock);
+  if (dq->bottom >= dq->size)
+     deque_compact (dq);
+
+  if (dq->bottom >= dq->size)
+  {
+    if (dq->size >= WALK_MAX_QUEUED)
+       rc = FALSE;
+    else
+    {
+      dq->size  = dq->size ? 2*dq->size : 64;
+      dq->nodes = REALLOC (dq->nodes, dq->size * sizeof(struct walk_node*));
+    }
+  }
+  if (rc)
+  {
+    InterlockedIncrement (&node->refs);
+    dq->nodes [dq->bottom++] = node;
+  }
+  LeaveCriticalSection (&dq->lock);
+  return (rc);
+}
+
+/**
+ * Drop the nodes at the bottom of `dq` that are no longer queued.
+ * The calling thread takes the nodes it pushed itself in this order.
+ */
+static void deque_trim (struct walk_deque *dq)
+{
+  EnterCriticalSection (&dq->lock);
+  while (dq->bottom > dq->top && dq->nodes[dq->bottom-1]->state != WALK_QUEUED)
+     node_release (dq->nodes [--dq->bottom]);
+  LeaveCriticalSection (&dq->lock);
+}
+
+/**
+ * The owner takes the newest node.
+ */
+static struct walk_node *deque_pop (struct walk_deque *dq)
+{
+  struct walk_node *node = NULL;
+
+  EnterCriticalSection (&dq->lock);
+  if (dq->bottom > dq->top)
+     node = dq->nodes [--dq->bottom];
+  LeaveCriticalSection (&dq->lock);
+  return (node);
+}
+
+/**
+ * A thief takes the oldest node.
+ */
+static struct walk_node *deque_steal (struct walk_deque *dq)
+{
+  struct walk_node *node = NULL;
+
+  EnterCriticalSection (&dq->lock);
+  if (dq->bottom > dq->top)
+     node = dq->nodes [dq->top++];
+  LeaveCriticalSection (&dq->lock);
+  return (node);
+}
+
+/**
+ * Return TRUE if `inner` is equal to `outer` or is a sub-directory of it.
+ * Case-insensitive and ignoring the type of slashes.
+ */
+static BOOL path_is_within (const char *inner, const char *outer)
+{
+  while (*outer)
+  {
+    if (IS_SLASH(*outer) && IS_SLASH(*inner))
+       ;
+    else if (tolower(*(const unsigned char*)outer) != tolower(*(const unsigned char*)inner))
+       return (FALSE);
+    outer++;
+    inner++;
+  }
+  if (IS_SLASH(outer[-1]))
+     return (TRUE);
+  return (*inner == '\0' || IS_SLASH(*inner));
+}
+
+/**
+ * Return TRUE if entering a junction in `node` with the resolved target
+ * `target` would lead us back to a directory we are already inside.
+ */
+static BOOL is_junction_cycle (const struct walk_node *node, const char *target)
+{
+  const struct walk_node *p;
+
+  for (p = node; p; p = p->parent)
+  {
+    if (path_is_within(p->dir, target))
+       return (TRUE);
+    if (p->link && path_is_within(p->link, target))
+       return (TRUE);
+  }
+  return (FALSE);
+}
+
+/**
+ * Resolve the junction `dir` into `target`.
+ * A relative symlink target is relative to `parent_dir`.
+ */
+static BOOL resolve_junction (struct walk_state *walk, const char *parent_dir,
+                              const char *dir, char *target)
+{
+  char result [_MAX_PATH];
+  BOOL rc;
+
+  /* `get_reparse_point()` keeps it's error-text in a static buffer.
+   */
+  EnterCriticalSection (&walk->reparse_lock);
+  rc = get_reparse_point (dir, result, TRUE);
+  LeaveCriticalSection (&walk->reparse_lock);
+
+  if (!rc)
+     return (FALSE);
+
+  if (_has_drive(result) || (IS_SLASH(result[0]) && IS_SLASH(result[1])))
+       _fix_path (result, target);
+  else
+  {
+    char tmp [_MAX_PATH];
+
+    snprintf (tmp, sizeof(tmp), "%s\\%s", parent_dir, result);
+    _fix_path (tmp, target);
+  }
+  return (TRUE);
+}
+
+/**
+ * Push `node` on `dq` and wake a worker.
+ * If `dq == NULL` (no workers) or it is full, the node is left for the
+ * calling thread to scan in `node_wait()`.
+ */
+static void walk_push (struct walk_state *walk, struct walk_deque *dq, struct walk_node *node)
+{
+  if (dq && deque_push(dq, node))
+     ReleaseSemaphore (walk->queued, 1, NULL);
+}
+
+/**
+ * Scan a directory: call the `walk_scan_func` and create the child
+ * nodes for the sub-directories. The children are pushed on `dq` in
+ * reverse order so that the owner pops the first child first.
+ */
+static void node_process (struct walk_state *walk, struct walk_node *node, struct walk_deque *dq)
+{
+  const struct dirscan_entry *de;
+  DIRSCAN     *ds;
+  smartlist_t *subdirs;
+  int          i;
+
+  if (search_halted())
+     goto done;
+
+  node->result = (*walk->scan) (node->dir, walk->arg);
+
+  if (node->depth >= WALK_MAX_DEPTH)
+  {
+    DEBUGF (1, "Max depth %d reached at '%s'.\n", WALK_MAX_DEPTH, node->dir);
+    goto done;
+  }
+
+  ds = dirscan_open (node->dir, "*");
+  if (!ds)
+     goto done;
+
+  subdirs = smartlist_new();
+  while ((de = dirscan_next(ds)) != NULL)
+  {
+    struct walk_node *child;
+    char   path   [_MAX_PATH];
+    char   target [_MAX_PATH];
+
+    if (!de->is_dir)
+       continue;
+
+    snprintf (path, sizeof(path), "%s%c%s", node->dir, DIR_SEP, de->name);
+    child = NULL;
+
+    if (!de->is_junction)
+       child = node_new (path, node);
+
+    else if (!resolve_junction(walk, node->dir, path, target))
+       DEBUGF (1, "Cannot resolve junction '%s'. Skipping it.\n", path);
+
+    else if (is_junction_cycle(node, target))
+       DEBUGF (1, "Junction '%s' -> '%s' is a cycle. Skipping it.\n", path, target);
+
+    else
+    {
+      child = node_new (path, node);
+      child->link = STRDUP (target);
+    }
+    if (child)
+       smartlist_add (subdirs, child);
+  }
+  dirscan_close (ds);
+
+  node->num_children = smartlist_len (subdirs);
+  if (node->num_children > 0)
+  {
+    node->children = MALLOC (node->num_children * sizeof(struct walk_node*));
+    for (i = 0; i < node->num_children; i++)
+        node->children[i] = smartlist_get (subdirs, i);
+    for (i = node->num_children - 1; i >= 0; i--)
+        walk_push (walk, dq, node->children[i]);
+  }
+  smartlist_free (subdirs);
+
+done:
+  InterlockedExchange (&node->state, WALK_DONE);
+  SetEvent (walk->node_done);
+}
+
+/**
+ * Find a node to work on: first from our own deque, then steal
+ * from the others.
+ */
+static struct walk_node *worker_get_node (struct walk_state *walk, int index)
+{
+  struct walk_node *node = deque_pop (walk->deques + index);
+  int    i;
+
+  for (i = 1; !node && i < walk->num_deques; i++)
+      node = deque_steal (walk->deques + ((index + i) % walk->num_deques));
+  return (node);
+}
+
+/**
+ * A worker first takes a `pending` slot, then waits for a queued node.
+ * Both waits are also ended by the `quit` event.
+ */
+static void walk_worker_run (void *arg)
+{
+  struct walk_worker *w    = (struct walk_worker*) arg;
+  struct walk_state  *walk = w->walk;
+  HANDLE              wait_pending [2];
+  HANDLE              wait_queued  [2];
+  BOOL                have_slot = FALSE;
+
+  wait_pending[0] = wait_queued[0] = walk->quit;
+  wait_pending[1] = walk->pending;
+  wait_queued[1]  = walk->queued;
+
+  while (1)
+  {
+    struct walk_node *node;
+
+    if (!have_slot)
+    {
+      if (WaitForMultipleObjects(2, wait_pending, FALSE, INFINITE) != WAIT_OBJECT_0 + 1)
+         break;
+      have_slot = TRUE;
+    }
+    if (WaitForMultipleObjects(2, wait_queued, FALSE, INFINITE) != WAIT_OBJECT_0 + 1)
+       break;
+
+    node = worker_get_node (walk, w->index);
+    if (!node)
+       continue;
+
+    /* The calling thread could have scanned this node already.
+     */
+    if (InterlockedCompareExchange(&node->state, WALK_RUNNING, WALK_QUEUED) == WALK_QUEUED)
+    {
+      node->by_worker = TRUE;
+      have_slot = FALSE;
+      node_process (walk, node, walk->deques + w->index);
+    }
+    node_release (node);
+  }
+}
+
+/**
+ * Wait for `node` to be done. Scan it here if no worker has started on it.
+ */
+static void node_wait (struct walk_state *walk, struct walk_node *node)
+{
+  struct walk_deque *dq = walk->deques + walk->num_deques - 1;
+
+  if (InterlockedCompareExchange(&node->state, WALK_RUNNING, WALK_QUEUED) == WALK_QUEUED)
+  {
+    deque_trim (dq);
+    node_process (walk, node, walk->num_deques > 1 ? dq : NULL);
+    return;
+  }
+  while (node->state != WALK_DONE)
+     WaitForSingleObject (walk->node_done, INFINITE);
+}
+
+/**
+ * Report the results of `node` and it's children in pre-order.
+ * The results are freed by the `walk_report_func`. And `node` is
+ * released when it's sub-tree is reported.
+ */
+static int node_report (struct walk_state *walk, struct walk_node *node,
+                        walk_report_func report)
+{
+  int i, found;
+
+  node_wait (walk, node);
+  found = (*report) (node->dir, node->result, walk->arg);
+  node->result = NULL;
+
+  if (node->by_worker)
+     ReleaseSemaphore (walk->pending, 1, NULL);
+
+  for (i = 0; i < node->num_children; i++)
+      found += node_report (walk, node->children[i], report);
+  node_release (node);
+  return (found);
+}
+
+/**
+ * Walk the directory tree under `root` (including `root` itself).
+ *
+ * \param[in] root         the top directory.
+ * \param[in] num_threads  number of worker-threads. If <= 1, the walk is
+ *                         done serially in the calling thread.
+ * \param[in] scan         called for each directory (possibly in a worker-thread).
+ * \param[in] report       called for each directory in the calling thread in
+ *                         depth-first pre-order.
+ * \param[in] arg          passed to `scan` and `report`.
+ *
+ * \retval the sum of the values returned from `report`.
+ */
+int dir_walk (const char *root, int num_threads,
+              walk_scan_func scan, walk_report_func report, void *arg)
+{
+  struct walk_state   walk;
+  struct walk_worker *workers = NULL;
+  struct walk_node   *top;
+  thread_pool        *pool = NULL;
+  int                 i, found, num_workers = 0;
+
+  memset (&walk, '\0', sizeof(walk));
+  walk.scan = scan;
+  walk.arg  = arg;
+
+  if (num_threads > 1)
+  {
+    pool = pool_create (num_threads);
+    num_workers = pool_num_threads (pool);
+  }
+
+  walk.num_deques = num_workers + 1;
+  walk.deques     = CALLOC (sizeof(struct walk_deque), walk.num_deques);
+  for (i = 0; i < walk.num_deques; i++)
+      deque_init (walk.deques + i);
+
+  walk.pending   = CreateSemaphore (NULL, WALK_MAX_PENDING, WALK_MAX_PENDING, NULL);
+  walk.queued    = CreateSemaphore (NULL, 0, LONG_MAX, NULL);
+  walk.node_done = CreateEvent (NULL, FALSE, FALSE, NULL);
+  walk.quit      = CreateEvent (NULL, TRUE, FALSE, NULL);
+  InitializeCriticalSection (&walk.reparse_lock);
+
+  top = node_new (root, NULL);
+
+  if (pool)
+  {
+    walk_push (&walk, walk.deques + 0, top);
+    workers = CALLOC (sizeof(*workers), num_workers);
+    for (i = 0; i < num_workers; i++)
+    {
+      workers[i].walk  = &walk;
+      workers[i].index = i;
+      pool_submit (pool, walk_worker_run, workers + i);
+    }
+  }
+
+  found = node_report (&walk, top, report);
+
+  SetEvent (walk.quit);
+  pool_destroy (pool);
+
+  DEBUGF (2, "Walked '%s' using %d workers.\n", root, num_workers);
+
+  for (i = 0; i < walk.num_deques; i++)
+      deque_free (walk.deques + i);
+  FREE (walk.deques);
+  FREE (workers);
+  CloseHandle (walk.pending);
+  CloseHandle (walk.queued);
+  CloseHandle (walk.node_done);
+  CloseHandle (walk.quit);
+  DeleteCriticalSection (&walk.reparse_lock);
+  return (found);
+}
@@ -0,0 +1,22 @@
+/** \file dir_walk.h
+ *  \ingroup Misc
+ */
+#ifndef _DIR_WALK_H
+#define _DIR_WALK_H
+
+/**
+ * Called for each directory in the tree. Possibly from a worker-thread.
+ * Must not print anything. Returns a result for the `walk_report_func`.
+ */
+typedef void *(*walk_scan_func) (const char *dir, void *arg);
+
+/**
+ * Called from the calling thread for each directory in the tree in
+ * depth-first pre-order. Must consume (free) the `result`.
+ */
+typedef int (*walk_report_func) (const char *dir, void *result, void *arg);
+
+extern int dir_walk (const char *root, int num_threads,
+                     walk_scan_func scan, walk_report_func report, void *arg);
+
+#endif  /* _DIR_WALK_H */
@@ -0,0 +1,63 @@
+/** \file dirscan.h
+ *  \ingroup Misc
+ */
+#ifndef _DIRSCAN_H
+#define _DIRSCAN_H
+
+#include <time.h>
+
+#if defined(DIRSCAN_POSIX)
+  #include <stdint.h>
+
+  typedef int      BOOL;
+  typedef uint32_t DWORD;
+  typedef uint64_t UINT64;
+
+  #ifndef TRUE
+  #define TRUE  1
+  #define FALSE 0
+  #endif
+#else
+  #include <windows.h>
+#endif
+
+/**
+ * Bits in `dirscan_entry::valid` telling which fields the
+ * directory enumeration itself supplied.
+ */
+#define DS_HAVE_TYPE    0x01   /**< `is_dir` and `is_junction` are valid */
+#define DS_HAVE_ATTRIB  0x02   /**< `attrib` is valid */
+#define DS_HAVE_SIZE    0x04   /**< `fsize` is valid */
+#define DS_HAVE_MTIME   0x08   /**< `mtime` is valid */
+#define DS_HAVE_ALL     0x0F
+
+/**
+ * A flag for `dirscan_stat()` to do a `stat()` even if the enumeration
+ * already supplied what was asked for. E.g. to follow a junction.
+ */
+#define DS_FORCE_STAT   0x100
+
+/**
+ * One entry returned from `dirscan_next()`.
+ * The `name` is only the base-name (without any sub-dir part given in `spec`)
+ * and it is only valid until the next call to `dirscan_next()`.
+ */
+struct dirscan_entry {
+       const char *name;
+       unsigned    valid;        /**< `DS_HAVE_x` bits */
+       BOOL        is_dir;
+       BOOL        is_junction;  /**< A Reparse-Point (or a symlink on POSIX) */
+       DWORD       attrib;       /**< `FILE_ATTRIBUTE_x` bits. 0 on POSIX. */
+       UINT64      fsize;
+       time_t      mtime;
+     };
+
+typedef struct dirscan DIRSCAN;
+
+extern DIRSCAN                    *dirscan_open  (const char *dir, const char *spec);
+extern const struct dirscan_entry *dirscan_next  (DIRSCAN *ds);
+extern int                         dirscan_stat  (DIRSCAN *ds, unsigned need);
+extern void                        dirscan_close (DIRSCAN *ds);
+extern unsigned long               dirscan_num_stat (void);
+
+#endif /* _DIRSCAN_H */
@@ -42,11 +42,23 @@
 #include "auth.h"
 #include "color.h"
 #include "smartlist.h"
+#include "vector.h"
 #include "regex.h"
 #include "ignore.h"
 #include "envtool.h"
 #include "envtool_py.h"
 #include "dirlist.h"
+#include "dirscan.h"
+#include "thread_pool.h"
+#include "dir_walk.h"
+#include "dir_cache.h"
+#include "dir_size.h"
+#include "dir_set.h"
+#include "re_literal.h"
+#include "shadow.h"
+#include "daemon.h"
+#include "profile.h"
+#include "watch.h"
 #include "sort.h"
 #include "vcpkg.h"
 #include "get_file_assoc.h"
@@ -126,7 +138,36 @@ struct registry_array {
        HKEY    key;
      };
 
-static smartlist_t *dir_array, *reg_array;
+static vector_t dir_array, reg_array;
+
+/**
+ * The directories added to `dir_array`; used to set `num_dup`.
+ * Created in `add_to_dir_array()` and freed in `free_dir_array()`.
+ */
+static dir_set *dir_array_set;
+
+/**
+ * The compiled `opt.owners` patterns. Same index as in `opt.owners`.
+ */
+static smartlist_t *owner_specs;
+
+/**
+ * With several file-specs, the one that matched the file to report.
+ * And the width of the longest file-spec.
+ */
+static const char *report_spec;
+static int         report_spec_width;
+
+/**
+ * The search-mode written to a sink with `"--format=ndjson|binary"`.
+ */
+static const char *report_mode;
+
+/**
+ * The number of matches printed (or written to a sink) in all modes.
+ * Checked against `opt.max_matches` in `search_halted()`.
+ */
+static volatile int num_reported;
 
 /**
  * All program options are kept here.
@@ -170,6 +211,7 @@ static regmatch_t re_matches[3];  /* regex sub-expressions */
 static int        re_err;         /* last regex error-code */
 static char       re_errbuf[300]; /* regex error-buffer */
 static int        re_alloc;       /* the above `re_hnd` was allocated */
+static re_literal *re_lit;        /* a literal any match must contain */
 
 volatile int halt_flag;
 
@@ -198,6 +240,8 @@ static void get_evry_bitness (HWND wnd);
 
 static void  usage (const char *fmt, ...) ATTR_PRINTF(1,2);
 static int   do_check (void);
+static int   do_shadow (void);
+static void  daemon_add_missing (const char *dir);
 static int   do_tests (void);
 static void  search_and_add_all_cc (BOOL print_info, BOOL print_lib_path);
 static void  print_build_cflags (void);
@@ -205,6 +249,7 @@ static void  print_build_ldflags (void);
 static int   get_pkg_config_info (char **exe_p, struct ver_info *ver);
 static int   get_vcpkg_info (char **exe_p, struct ver_info *ver);
 static int   get_cmake_info (char **exe_p, struct ver_info *ver);
+static int   process_dirs (vector_t *dirs, const char *prefix, HKEY key, BOOL recursive);
 
 /**
  * \todo Add support for *kpathsea*-like path searches (which some TeX programs uses). <br>
@@ -609,7 +654,8 @@ static int show_help (void)
           "    ~6--python~0[~3=X~0]   check and search in ~3%PYTHONPATH%~0 and ~3sys.path[]~0. ~2[3]~0\n"
           "    ~6--vcpkg~0        check and search for ~3VCPKG~0 packages.             ~2[4]~0\n"
           "    ~6--check~0        check for missing directories in ~6all~0 supported environment variables\n"
-          "                   and missing files in ~3HKx\\Microsoft\\Windows\\CurrentVersion\\App Paths~0 keys.\n");
+          "                   and missing files in ~3HKx\\Microsoft\\Windows\\CurrentVersion\\App Paths~0 keys.\n"
+          "    ~6--shadow~0       report programs and DLLs on ~3%PATH%~0 shadowed by another copy earlier on ~3%PATH%~0.\n");
 
   C_puts ("  ~6[options]~0\n"
           "    ~6--no-gcc~0       don't spawn " PFX_GCC " prior to checking.      ~2[2]~0\n"
@@ -636,6 +682,19 @@ static int show_help (void)
           "    ~6--signed=0~0     report only PE-files files that are ~4unsigned~0.\n"
           "    ~6--signed=1~0     report only PE-files files that are ~4signed~0.\n"
           "    ~6--no-cwd~0       don't add current directory to search-lists.\n"
+          "    ~6--threads~0[~3=N~0]  scan the directories of an env-var concurrently using ~3N~0 threads.\n"
+          "    ~6--dir-cache~0    use a cache of directory listings in ~3%LOCALAPPDATA%\\envtool-dirs.cache~0.\n"
+          "    ~6--spec-file~0=~3file~0  read more ~6<file-spec>~0s from ~3file~0; one on each line.\n"
+          "    ~6--sort-mem~0=~3N~0   sort at most ~3N~0 MByte of matches in memory; the rest on disk (default 100).\n"
+          "    ~6--size-budget~0=~3N~0  with ~6--size -D~0, give up sizing a directory after ~3N~0 sec (default 10).\n"
+          "    ~6--format~0=~3fmt~0   write the matches as ~3text~0 (default), ~3ndjson~0 or ~3binary~0 records.\n"
+          "    ~6--output~0=~3file~0  write the ~6--format~0 records to ~3file~0 instead of stdout.\n"
+          "    ~6--first~0        stop after the first match. Same as ~6--max-matches=1~0.\n"
+          "    ~6--max-matches~0=~3N~0  stop all searches after ~3N~0 matches (default 0; no limit).\n"
+          "    ~6--watch~0        with ~6--path~0, ~6--lib~0 or ~6--inc~0, report matches added or removed until ~3^C~0.\n"
+          "    ~6--batch~0[~3=file~0] search for each ~6<file-spec>~0 in ~3file~0 (default stdin); one on each line.\n"
+          "    ~6--daemon~0       keep running and answer later queries with the same options; until ~3^C~0.\n"
+          "    ~6--profile~0      print the time spent in each phase and the slowest directories and programs.\n"
           "    ~6-c~0             be case-sensitive.\n"
           "    ~6-d~0, ~6--debug~0    set debug level (~3-dd~0 sets ~3PYTHONVERBOSE=1~0 in ~6--python~0 mode).\n"
           "    ~6-D~0, ~6--dir~0      looks only for directories matching ~6<file-spec>~0.\n");
@@ -644,7 +703,7 @@ static int show_help (void)
             "    ~6-s~0, ~6--size~0     show size of files or directories found.\n"
             "    ~6-S~3x~0, ~6--sort=~3y~0  sort files on ~3%s~0 / ", get_sort_methods_short());
 
-  C_printf ("~3%s~0 (not yet effective).\n", get_sort_methods_long());
+  C_printf ("~3%s~0.\n", get_sort_methods_long());
 
   C_puts ("    ~6-q~0, ~6--quiet~0    disable warnings.\n"
           "    ~6-t~0             do some internal tests. Use ~6--owner~0, ~6--py~0 or ~6--evry~0 for extra tests.\n"
@@ -709,6 +768,8 @@ static int show_help (void)
           "  ~6<file-spec>~0 accepts Posix ranges. E.g. \"[a-f]*.txt\".\n"
           "  ~6<file-spec>~0 matches both files and directories. If ~6-D~0/~6--dir~0 is used, only\n"
           "              matching directories are reported.\n"
+          "  Several ~6<file-spec>~0s are searched for in one pass (not in ~6--evry~0, ~6--python~0 or ~6--vcpkg~0\n"
+          "              modes). Each match is shown with the ~6<file-spec>~0 it matched.\n"
           "  Quote argument if it contains a shell-character [~6^&%~0]."
           " E.g. use ~6--regex \"^foo%%\\.exe$\"~0\n"
           "  Commonly used options can be set in ~3%ENVTOOL_OPTIONS%~0.\n");
@@ -716,10 +777,10 @@ static int show_help (void)
 }
 
 /**
- * Add the `dir` to the `dir_array` smartlist.
+ * Add the `dir` to the `dir_array` vector.
  * `is_cwd` == 1 if `dir` == current working directory.
  *
- * \param[in] dir     the directory to add to the smartlist.
+ * \param[in] dir     the directory to add to the vector.
  * \param[in] is_cwd  TRUE if `dir` is the current working directory.
  * \param[in] line    at what line was `add_to_dir_array()` called.
 
@@ -728,9 +789,10 @@ static int show_help (void)
  */
 void add_to_dir_array (const char *dir, int is_cwd, unsigned line)
 {
-  struct directory_array *d = CALLOC (1, sizeof(*d));
+  struct directory_array *d = VECTOR_ADD (&dir_array, struct directory_array);
   struct stat st;
-  int    max, i, exp_ok = (dir && *dir != '%');
+  int    exp_ok = (dir && *dir != '%');
+  unsigned num_dup;
   BOOL   exists = FALSE;
   BOOL   is_dir = FALSE;
 
@@ -789,19 +851,16 @@ void add_to_dir_array (const char *dir, int is_cwd, unsigned line)
   }
 #endif
 
-  smartlist_add (dir_array, d);
+  /* Count how many times this `dir` was added before. Equal to looping over
+   * the earlier `dir_array` elements, but O(1) instead of O(n).
+   */
+  if (!dir_array_set)
+     dir_array_set = dir_set_new (!opt.case_sensitive);
+  num_dup = dir_set_add (dir_array_set, dir);
 
   if (is_cwd || !exp_ok)
      return;
-
-  max = smartlist_len (dir_array);
-  for (i = 0; i < max-1; i++)
-  {
-    const struct directory_array *d2 = smartlist_get (dir_array, i);
-
-    if (!str_equal(dir,d2->dir))
-       d->num_dup++;
-  }
+  d->num_dup = num_dup;
 }
 
 static int dump_dir_array (const char *where, const char *note)
@@ -810,10 +869,10 @@ static int dump_dir_array (const char *where, const char *note)
 
   DEBUGF (2, "%s now%s:\n", where, note);
 
-  max = smartlist_len (dir_array);
+  max = vector_len (&dir_array);
   for (i = 0; i < max; i++)
   {
-    const struct directory_array *dir = smartlist_get (dir_array, i);
+    const struct directory_array *dir = vector_get (&dir_array, i);
 
     DEBUGF (2, "  dir_array[%d]: exist:%d, num_dup:%d, %s  %s\n",
             (int)i, dir->exist, dir->num_dup, dir->dir, dir->cyg_dir ? dir->cyg_dir : "");
@@ -822,31 +881,9 @@ static int dump_dir_array (const char *where, const char *note)
 }
 
 /**
- * `smartlist_make_uniq()` helper.
- *
- * \param[in] _a  The first `dir_array` element to check.
- * \param[in] _b  The second `dir_array` element to check.
- *
- * No need to use `stricmp()` or `str_equal()` since we already checked for
- * duplicates when items where added. Use the `num_dup` count instead.
- */
-static int dir_array_compare (const void **_a, const void **_b)
-{
-  struct directory_array *a = *(struct directory_array **) _a;
-  struct directory_array *b = *(struct directory_array **) _b;
-
-  if (b->num_dup > 0)  /* this will get removed */
-  {
-    a->num_dup = 0;
-    return (0);
-  }
-  return (1);
-}
-
-/**
- * `smartlist_wipe()` helper.
+ * `vector_wipe()` helper.
  *
- * \param[in] _r  The item in the `reg_array` smartlist to free.
+ * \param[in] _r  The item in the `reg_array` vector to free.
  */
 static void reg_array_free (void *_r)
 {
@@ -855,13 +892,12 @@ static void reg_array_free (void *_r)
   FREE (r->fname);
   FREE (r->real_fname);
   FREE (r->path);
-  FREE (r);
 }
 
 /**
- * `smartlist_wipe()` and `smartlist_make_uniq()` helper.
+ * `vector_wipe()` and `make_unique_dir_array()` helper.
  *
- * \param[in] _d  The item in the `reg_array` smartlist to free.
+ * \param[in] _d  The item in the `dir_array` vector to free.
  */
 static void dir_array_free (void *_d)
 {
@@ -869,7 +905,17 @@ static void dir_array_free (void *_d)
 
   FREE (d->dir);
   FREE (d->cyg_dir);
-  FREE (d);
+}
+
+/**
+ * `vector_remove_if()` helper for `make_unique_dir_array()`.
+ */
+static int dir_array_is_dup (const void *_d, void *arg)
+{
+  const struct directory_array *d = (const struct directory_array*) _d;
+
+  ARGSUSED (arg);
+  return (d->num_dup > 0);
 }
 
 /**
@@ -877,9 +923,13 @@ static void dir_array_free (void *_d)
  * non-canonical names. CygWin is more messy than others. So just remove the
  * duplicates.
  *
- * Loop over the `dir_array` smartlist and remove all non-unique items.
+ * Loop over the `dir_array` vector and remove all non-unique items.
  * Also used for Watcom's include-path.
  *
+ * No need to compare the directories since we already checked for
+ * duplicates when items where added. Keep the items with `num_dup == 0`
+ * in one pass. The order is kept.
+ *
  * \param[in]  where  Where this function was used;
  *                    equals `"%NT_INCLUDE%"` for `do_check_watcom_includes()` or
  *                    `"library paths"` for `setup_gcc_library_path()`.
@@ -889,13 +939,13 @@ static int make_unique_dir_array (const char *where)
   int old_len, new_len;
 
   old_len = dump_dir_array (where, ", non-unique");
-  smartlist_make_uniq (dir_array, dir_array_compare, dir_array_free);
+  vector_remove_if (&dir_array, dir_array_is_dup, NULL, dir_array_free);
   new_len = dump_dir_array (where, ", unique");
   return (old_len - new_len);    /* This should always be 0 or positive */
 }
 
 /**
- * Add elements to the `reg_array` smartlist:
+ * Add elements to the `reg_array` vector:
  *  \param[in] key     the key the entry came from: `HKEY_CURRENT_USER` or `HKEY_LOCAL_MACHINE`.
  *  \param[in] fname   the result from `RegEnumKeyEx()`; name of each key.
  *  \param[in] fqdn    the result from `enum_sub_values()`. This value includes the full path.
@@ -917,8 +967,7 @@ static void add_to_reg_array (HKEY key, const char *fname, const char *fqdn)
     return;
   }
 
-  reg = CALLOC (1, sizeof(*reg));
-  smartlist_add (reg_array, reg);
+  reg = VECTOR_ADD (&reg_array, struct registry_array);
 
   rc = safe_stat (fqdn, &st, NULL);
   reg->mtime      = st.st_mtime;
@@ -933,10 +982,10 @@ static void add_to_reg_array (HKEY key, const char *fname, const char *fqdn)
 /**
  * Sort the `reg_array` on `path` + `real_fname`.
  */
-static int reg_array_compare (const void **_a, const void **_b)
+static int reg_array_compare (const void *_a, const void *_b)
 {
-  const struct registry_array *a = *_a;
-  const struct registry_array *b = *_b;
+  const struct registry_array *a = _a;
+  const struct registry_array *b = _b;
   char  fqdn_a [_MAX_PATH];
   char  fqdn_b [_MAX_PATH];
   char  slash = (opt.show_unix_paths ? '/' : '\\');
@@ -956,34 +1005,36 @@ static void print_reg_array (const char *intro)
 
   DEBUGF (3, intro);
 
-  max = smartlist_len (reg_array);
+  max = vector_len (&reg_array);
   for (i = 0; i < max; i++)
   {
-    reg = smartlist_get (reg_array, i);
+    reg = vector_get (&reg_array, i);
     DEBUGF (3, "%2d: FQDN: %s%c%s.\n", i, reg->path, slash, reg->real_fname);
   }
 }
 
 static void sort_reg_array (void)
 {
-  print_reg_array ("before smartlist_sort():\n");
-  smartlist_sort (reg_array, reg_array_compare);
-  print_reg_array ("after smartlist_sort():\n");
+  print_reg_array ("before vector_sort():\n");
+  vector_sort (&reg_array, reg_array_compare);
+  print_reg_array ("after vector_sort():\n");
 }
 
 static void free_reg_array (void)
 {
-  smartlist_wipe (reg_array, reg_array_free);
+  vector_wipe (&reg_array, reg_array_free);
 }
 
 static void free_dir_array (void)
 {
-  smartlist_wipe (dir_array, dir_array_free);
+  vector_wipe (&dir_array, dir_array_free);
+  dir_set_free (dir_array_set);
+  dir_array_set = NULL;
 }
 
 /**
  * Parses an environment string and returns all components as an array of
- * `struct directory_array` pointing into the global `dir_array` smartlist.
+ * `struct directory_array` in the global `dir_array` vector.
  * This works since we handle only one env-var at a time. The `dir_array`
  * gets cleared in `free_dir_array()` first (in case it was used already).
  *
@@ -991,7 +1042,7 @@ static void free_dir_array (void)
  *
  * Convert CygWin style paths to Windows paths: `"/cygdrive/x/.."` -> `"x:/.."`.
  */
-static smartlist_t *split_env_var (const char *env_name, const char *value)
+static vector_t *split_env_var (const char *env_name, const char *value)
 {
   char *tok, *val;
   int   is_cwd, max, i;
@@ -1099,7 +1150,7 @@ static smartlist_t *split_env_var (const char *env_name, const char *value)
   }
 
   FREE (val);
-  return (dir_array);
+  return (&dir_array);
 }
 
 /**
@@ -1196,32 +1247,36 @@ static void print_PE_file_details (const char *filler)
 }
 
 /**
- * With the "--pe" (and "--32" or "--64") option, check if a `file` is a PE-file.
- * If so, save the checksum, version-info, signing-status for later when
- * `report_file()` is ready to print this info.
+ * With the "--pe" (and "--32" or "--64") option, check if a `file` is a PE-file
+ * of the wanted bitness.
  */
-static BOOL get_PE_file_brief (const char *file, const char *filler, HKEY key, char *dest, size_t dest_size)
+static BOOL check_PE_file (const char *file, HKEY key, enum Bitness *bits)
 {
-  struct ver_info ver;
-  enum Bitness    bits;
-  const char     *bitness;
-  BOOL            chksum_ok  = FALSE;
-  BOOL            version_ok = FALSE;
-
-  *dest = '\0';
-
   if (key == HKEY_INC_LIB_FILE || key == HKEY_MAN_FILE ||
       key == HKEY_EVERYTHING_ETP || key == HKEY_PKGCONFIG_FILE)
      return (FALSE);
 
-  if (!check_if_PE(file,&bits))
+  if (!check_if_PE(file,bits))
      return (FALSE);
 
-  if (opt.only_32bit && bits != bit_32)
+  if (opt.only_32bit && *bits != bit_32)
      return (FALSE);
 
-  if (opt.only_64bit && bits != bit_64)
+  if (opt.only_64bit && *bits != bit_64)
      return (FALSE);
+  return (TRUE);
+}
+
+/**
+ * For a PE-file passing `check_PE_file()`, save the checksum and version-info
+ * for later when `report_file()` is ready to print this info.
+ */
+static void get_PE_file_brief (const char *file, const char *filler, enum Bitness bits, char *dest, size_t dest_size)
+{
+  struct ver_info ver;
+  const char     *bitness;
+  BOOL            chksum_ok  = FALSE;
+  BOOL            version_ok = FALSE;
 
   memset (&ver, 0, sizeof(ver));
   chksum_ok  = verify_PE_checksum (file);
@@ -1232,12 +1287,11 @@ static BOOL get_PE_file_brief (const char *file, const char *filler, HKEY key, c
   bitness = (bits == bit_32) ? "~232" :
             (bits == bit_64) ? "~364" : "~5?";
 
-  /** Do not add a `\n` since `wintrust_check()` is called right after this function.
+  /** Do not add a `\n` since the trust-information is printed right after this.
    */
   snprintf (dest, dest_size, "\n%sver ~6%u.%u.%u.%u~0, %s~0-bit, Chksum %s~0",
             filler, ver.val_1, ver.val_2, ver.val_3, ver.val_4,
             bitness, chksum_ok ? "~2OK" : "~5fail");
-  return (TRUE);
 }
 
 /**
@@ -1308,41 +1362,6 @@ static BOOL get_wintrust_info (const char *file, char *dest, size_t dest_size)
   return (FALSE);
 }
 
-UINT64 get_directory_size (const char *dir)
-{
-  struct dirent2 **namelist = NULL;
-  int    i, n = scandir2 (dir, &namelist, NULL, NULL);
-  UINT64 size = 0;
-
-  for (i = 0; i < n; i++)
-  {
-    int   is_dir      = (namelist[i]->d_attrib & FILE_ATTRIBUTE_DIRECTORY);
-    int   is_junction = (namelist[i]->d_attrib & FILE_ATTRIBUTE_REPARSE_POINT);
-    const char *link;
-
-    if (is_junction)
-    {
-      link = namelist[i]->d_link ? namelist[i]->d_link : "?";
-      DEBUGF (1, "Not recursing into junction \"%s\"\n", link);
-      size += get_file_alloc_size (dir, (UINT64)-1);
-    }
-    else if (is_dir)
-    {
-      DEBUGF (1, "Recursing into \"%s\"\n", namelist[i]->d_name);
-      size += get_file_alloc_size (namelist[i]->d_name, (UINT64)-1);
-      size += get_directory_size (namelist[i]->d_name);
-    }
-    else
-      size += get_file_alloc_size (namelist[i]->d_name, namelist[i]->d_fsize);
-  }
-
-  while (n--)
-    FREE (namelist[n]);
-  FREE (namelist);
-
-  return (size);
-}
-
 /**
  * Return the indentation needed for the next `she-bang` or `man-file link`
  * to align up more nicely.
@@ -1381,12 +1400,280 @@ static void print_raw (const char *file, const char *before, const char *after)
      C_puts (after);
 }
 
+/**
+ * Return the name of the (pseudo) key a match was found under.
+ * For the `sink_rec::source` field.
+ */
+static const char *report_source (HKEY key)
+{
+  return (key == HKEY_CURRENT_USER              ? "hkcu-app-path" :
+          key == HKEY_LOCAL_MACHINE             ? "hklm-app-path" :
+          key == HKEY_CURRENT_USER_ENV          ? "hkcu-env"      :
+          key == HKEY_LOCAL_MACHINE_SESSION_MAN ? "hklm-env"      :
+          key == HKEY_PYTHON_PATH               ? "python-path"   :
+          key == HKEY_PYTHON_EGG                ? "python-egg"    :
+          key == HKEY_EVERYTHING                ? "everything"    :
+          key == HKEY_EVERYTHING_ETP            ? "everything-etp":
+          key == HKEY_MAN_FILE                  ? "man"           :
+          key == HKEY_INC_LIB_FILE              ? "compiler"      :
+          key == HKEY_PKGCONFIG_FILE            ? "pkg-config"    : NULL);
+}
+
+/**
+ * The state of a match passed through the `report_steps[]`.
+ */
+struct report_ctx {
+       const char   *file;
+       UINT64        fsize;
+       BOOL          is_dir;
+       HKEY          key;
+       BOOL          possible_PE_file;
+       BOOL          show_dir_size;
+       BOOL          size_partial;  /**< Set by `step_dir_size()` if the time-budget was exceeded */
+       const char   *filler;        /**< The indent of the PE-information */
+       enum Bitness  bits;          /**< Set by `step_PE_check()` */
+       char          owner [100];   /**< Set by `step_owner()`; "" if unknown */
+       const char   *link;          /**< Set by `step_link()`; a she-bang or man-page link */
+       FMT_buf      *ver_info;      /**< Set by `step_PE_version()` */
+       FMT_buf      *trust_info;    /**< Set by `step_trust()` */
+       unsigned      done;          /**< The `REPORT_STEP_x` bits of the steps run */
+     };
+
+/**
+ * \def REPORT_STEP_PE_CHECK
+ *   The bit for `step_PE_check()`. And so on.
+ */
+#define REPORT_STEP_PE_CHECK    0x01
+#define REPORT_STEP_OWNER       0x02
+#define REPORT_STEP_TRUST       0x04
+#define REPORT_STEP_PE_VERSION  0x08
+#define REPORT_STEP_ALLOC_SIZE  0x10
+#define REPORT_STEP_DIR_SIZE    0x20
+#define REPORT_STEP_LINK        0x40
+
+/**
+ * An enrichment step of `report_file_now()`.
+ */
+struct report_step {
+       unsigned    bit;
+       unsigned    depends;   /**< The steps that must have run before this one */
+       const char *name;
+
+       /** Return TRUE if a filter or an output column needs this step.
+        */
+       BOOL (*needed) (const struct report_ctx *ctx);
+
+       /** Run the step. Return FALSE if the match is filtered out.
+        */
+       BOOL (*run) (struct report_ctx *ctx);
+     };
+
+static BOOL need_PE_check (const struct report_ctx *ctx)
+{
+  return (opt.PE_check && ctx->possible_PE_file);
+}
+
+static BOOL step_PE_check (struct report_ctx *ctx)
+{
+  return check_PE_file (ctx->file, ctx->key, &ctx->bits);
+}
+
+static BOOL need_owner (const struct report_ctx *ctx)
+{
+  return (opt.show_owner && ctx->key != HKEY_EVERYTHING_ETP);
+}
+
+/**
+ * Get the owner of the file/directory. Show it only if it matches
+ * (or not matches) one of the owners in `opt.owners`.
+ * With `opt.owners == "*"`, match all.
+ * With `opt.owners == "!*"`, match none.
+ *
+ * E.g. with:
+ *   envtool --man --owner=Admin*  pkcs7*
+ *   show only Man-pages matching "pkcs7*" and owners "Admin*":
+ *
+ *   envtool --man --owner=!Admin* pkcs7*
+ *   show only Man-pages matching "pkcs7*" and owners not matching "Admin*":
+ *
+ * The remote `file` from EveryThing is not something Windows knows
+ * about. Hence no point in trying to get the DomainName + AccountName
+ * for it.
+ */
+static BOOL step_owner (struct report_ctx *ctx)
+{
+  char       *account_name;
+  const char *found_owner = NULL;
+  BOOL        inverse = FALSE;
+  BOOL        show = TRUE;
+  int         i, max;
+
+  if (!get_file_owner(ctx->file, NULL, &account_name))
+     return (TRUE);
+
+  /* Assume no, if there are >= 1 owner-patterns to check for
+   */
+  max = smartlist_len (opt.owners);
+  if (max > 0)
+     show = FALSE;
+
+  for (i = 0; i < max; i++)
+  {
+    const char         *owner = smartlist_get (opt.owners, i);
+    const fnmatch_spec *spec  = smartlist_get (owner_specs, i);
+
+    if (owner[0] == '!' && fnmatch_exec(spec, account_name) == FNM_NOMATCH)
+    {
+      inverse = TRUE;
+      found_owner = owner + 1;
+      show = TRUE;
+      break;
+    }
+    else if (owner[0] != '!' && fnmatch_exec(spec, account_name) == FNM_MATCH)
+    {
+      found_owner = owner;
+      show = TRUE;
+      break;
+    }
+  }
+
+  if (found_owner)
+  {
+    DEBUGF (2, "account_name (%s) %smatches owner (%s).\n", account_name, inverse ? "does not " : "", found_owner);
+    _strlcpy (ctx->owner, account_name, sizeof(ctx->owner));
+  }
+  else
+    DEBUGF (2, "account_name (%s) did not match any wanted owner(s) for file '%s'.\n",
+            account_name, basename(ctx->file));
+
+  FREE (account_name);
+  return (show);
+}
+
+/**
+ * The trust-information is only printed with text output.
+ * But `"--signed=0|1"` is a filter in all formats.
+ */
+static BOOL need_trust (const struct report_ctx *ctx)
+{
+  if (!opt.PE_check || !ctx->possible_PE_file || opt.signed_status == SIGN_CHECK_NONE)
+     return (FALSE);
+  return (opt.sink_format == SINK_TEXT || opt.signed_status != SIGN_CHECK_ALL);
+}
+
+static BOOL step_trust (struct report_ctx *ctx)
+{
+  return get_wintrust_info (ctx->file, ctx->trust_info->buffer_start, ctx->trust_info->buffer_size);
+}
+
+static BOOL need_PE_version (const struct report_ctx *ctx)
+{
+  return (opt.PE_check && ctx->possible_PE_file && opt.sink_format == SINK_TEXT);
+}
+
+static BOOL step_PE_version (struct report_ctx *ctx)
+{
+  get_PE_file_brief (ctx->file, ctx->filler, ctx->bits, ctx->ver_info->buffer_start, ctx->ver_info->buffer_size);
+  return (TRUE);
+}
+
+static BOOL need_alloc_size (const struct report_ctx *ctx)
+{
+  return (opt.show_size && !(opt.dir_mode && ctx->show_dir_size) && ctx->fsize < (__int64)-1);
+}
+
+static BOOL step_alloc_size (struct report_ctx *ctx)
+{
+  if (ctx->key == HKEY_EVERYTHING_ETP)
+       total_size += ctx->fsize;
+  else total_size += get_file_alloc_size (ctx->file, ctx->fsize);
+  return (TRUE);
+}
+
+/**
+ * Recursively get the size of files under directory matching `file`.
+ * See dir_size.c.
+ * The ETP-server (key == HKEY_EVERYTHING_ETP) can not reliably report size
+ * of directories.
+ */
+static BOOL need_dir_size (const struct report_ctx *ctx)
+{
+  return (opt.show_size && opt.dir_mode && ctx->show_dir_size);
+}
+
+static BOOL step_dir_size (struct report_ctx *ctx)
+{
+  if (ctx->is_dir)
+     ctx->fsize = dir_size_get (ctx->file, &ctx->size_partial);
+  total_size += ctx->fsize;
+  return (TRUE);
+}
+
+static BOOL need_link (const struct report_ctx *ctx)
+{
+  return (!ctx->is_dir && opt.sink_format == SINK_TEXT);
+}
+
+static BOOL step_link (struct report_ctx *ctx)
+{
+  if (ctx->key == HKEY_MAN_FILE)
+  {
+    ctx->link = get_man_link (ctx->file);
+    if (!ctx->link && !isdigit((int)*get_file_ext(ctx->file)))
+       ctx->link = get_gzip_link (ctx->file);
+  }
+  else
+    ctx->link = check_if_shebang (ctx->file);
+  return (TRUE);
+}
+
+/**
+ * The enrichment steps in the order they are run.
+ * The filters first; the cheapest first. Then the steps for the output
+ * columns. So no expensive step is run for a match that is filtered out.
+ */
+static const struct report_step report_steps[] = {
+  { REPORT_STEP_PE_CHECK,   0,                    "PE-check",   need_PE_check,   step_PE_check   },
+  { REPORT_STEP_OWNER,      0,                    "owner",      need_owner,      step_owner      },
+  { REPORT_STEP_TRUST,      REPORT_STEP_PE_CHECK, "WinTrust",   need_trust,      step_trust      },
+  { REPORT_STEP_PE_VERSION, REPORT_STEP_PE_CHECK, "PE-version", need_PE_version, step_PE_version },
+  { REPORT_STEP_ALLOC_SIZE, 0,                    "alloc-size", need_alloc_size, step_alloc_size },
+  { REPORT_STEP_DIR_SIZE,   0,                    "dir-size",   need_dir_size,   step_dir_size   },
+  { REPORT_STEP_LINK,       0,                    "link",       need_link,       step_link       }
+};
+
+/**
+ * Run the needed `report_steps[]` on a match.
+ *
+ * \retval FALSE if a step filtered it out.
+ */
+static BOOL run_report_steps (struct report_ctx *ctx)
+{
+  const struct report_step *step;
+  size_t i;
+
+  for (i = 0, step = report_steps; i < DIM(report_steps); i++, step++)
+  {
+    if ((ctx->done & step->depends) != step->depends || !(*step->needed)(ctx))
+       continue;
+
+    if (!(*step->run)(ctx))
+    {
+      DEBUGF (3, "Step '%s' filtered out '%s'.\n", step->name, ctx->file);
+      return (FALSE);
+    }
+    ctx->done |= step->bit;
+  }
+  return (TRUE);
+}
+
 /**
  * This is the main printer for a file/dir.
  * Prints any notes, time-stamp, size, file/dir name.
  * Also any she-bang statements, links for a gzipped man-page,
  * PE-information like resource version or trust information
- * and file-owner.
+ * and file-owner. These are gathered by `run_report_steps()` only
+ * when needed.
  *
  * \param[in] file         the file or directory to report.
  * \param[in] mtime        the modification time of the file or directory (-1 if unknown).
@@ -1395,28 +1682,29 @@ static void print_raw (const char *file, const char *before, const char *after)
  * \param[in] is_junction  TRUE if file (i.e. directory) was a reparse-point) not used yet.
  * \param[in] key          the (pseudo) key the search was a result of.
  */
-int report_file (const char *file, time_t mtime, UINT64 fsize, BOOL is_dir, BOOL is_junction, HKEY key)
+static int report_file_now (const char *file, time_t mtime, UINT64 fsize, BOOL is_dir, BOOL is_junction, HKEY key)
 {
+  struct report_ctx ctx;
   const char *note   = NULL;
   const char *filler = "      ";
   char        size [40] = "?";
   BOOL        have_it = TRUE;
-  BOOL        show_dir_size = TRUE;
   BOOL        show_pc_files_only = FALSE;
-  BOOL        show_this_file = TRUE;
-  BOOL        possible_PE_file = TRUE;
 
-  FMT_buf     fmt_buf_time_size;
   FMT_buf     fmt_buf_file_info;
-  FMT_buf     fmt_buf_owner_info;
   FMT_buf     fmt_buf_ver_info;
   FMT_buf     fmt_buf_trust_info;
 
-  BUF_INIT (&fmt_buf_time_size, 100);
-  BUF_INIT (&fmt_buf_file_info, 100 + _MAX_PATH);
-  BUF_INIT (&fmt_buf_owner_info, 100);
-  BUF_INIT (&fmt_buf_ver_info, 100);
-  BUF_INIT (&fmt_buf_trust_info, 100);
+  memset (&ctx, '\0', sizeof(ctx));
+  ctx.file             = file;
+  ctx.fsize            = fsize;
+  ctx.is_dir           = is_dir;
+  ctx.key              = key;
+  ctx.possible_PE_file = TRUE;
+  ctx.show_dir_size    = TRUE;
+  ctx.filler           = filler;
+  ctx.ver_info         = &fmt_buf_ver_info;
+  ctx.trust_info       = &fmt_buf_trust_info;
 
   if (key == HKEY_CURRENT_USER)
   {
@@ -1441,7 +1729,7 @@ int report_file (const char *file, time_t mtime, UINT64 fsize, BOOL is_dir, BOOL
   else if (key == HKEY_PYTHON_EGG)
   {
     found_in_python_egg++;
-    possible_PE_file = FALSE;
+    ctx.possible_PE_file = FALSE;
     note = " (5)  ";
   }
   else if (key == HKEY_EVERYTHING)
@@ -1464,13 +1752,13 @@ int report_file (const char *file, time_t mtime, UINT64 fsize, BOOL is_dir, BOOL
   }
   else if (key == HKEY_EVERYTHING_ETP)
   {
-    show_dir_size = FALSE;
-    possible_PE_file = FALSE;
+    ctx.show_dir_size = FALSE;
+    ctx.possible_PE_file = FALSE;
   }
   else if (key == HKEY_PKGCONFIG_FILE)
   {
     show_pc_files_only = TRUE;
-    possible_PE_file = FALSE;
+    ctx.possible_PE_file = FALSE;
   }
   else
   {
@@ -1481,190 +1769,197 @@ int report_file (const char *file, time_t mtime, UINT64 fsize, BOOL is_dir, BOOL
      note = "<DIR> ";
 
   if ((!is_dir && opt.dir_mode) || !have_it)
+     return (0);
+
+  if (show_pc_files_only && stricmp(get_file_ext(file),"pc"))
+     return (0);
+
+  BUF_INIT (&fmt_buf_ver_info, 100);
+  BUF_INIT (&fmt_buf_trust_info, 100);
+
+  if (!run_report_steps(&ctx))
   {
-    show_this_file = FALSE;
+    get_PE_version_info_free();
     return (0);
   }
+  fsize = ctx.fsize;
 
-  if (show_pc_files_only)
+  if (opt.sink_format != SINK_TEXT)
   {
-    const char *ext = get_file_ext (file);
+    struct sink_rec rec;
 
-    if (stricmp(ext,"pc"))
-    {
-      show_this_file = FALSE;
-      return (0);
-    }
+    rec.mode        = report_mode;
+    rec.source      = report_source (key);
+    rec.spec        = report_spec;
+    rec.file        = file;
+    rec.owner       = ctx.owner[0] ? ctx.owner : NULL;
+    rec.version     = NULL;
+    rec.mtime       = mtime;
+    rec.fsize       = fsize;
+    rec.is_dir      = is_dir;
+    rec.is_junction = is_junction;
+    sink_write (&rec);
+    report_header = NULL;
+    return (1);
   }
 
- /*
-  * Recursively get the size of files under directory matching `file`.
-  * The ETP-server (key == HKEY_EVERYTHING_ETP) can not reliably report size
-  * of directories.
-  */
-  if (opt.show_size && opt.dir_mode && show_dir_size)
-  {
-    if (is_dir)
-       fsize = get_directory_size (file);
-    snprintf (size, sizeof(size), " - %s", get_file_size_str(fsize));
-    total_size += fsize;
-  }
-  else if (opt.show_size)
-  {
-    snprintf (size, sizeof(size), " - %s", get_file_size_str(fsize));
-    if (fsize < (__int64)-1)
-    {
-      if (key == HKEY_EVERYTHING_ETP)
-           total_size += fsize;
-      else total_size += get_file_alloc_size (file, fsize);
-    }
-  }
-  else
-    size[0] = '\0';
+  if (opt.show_size)
+       snprintf (size, sizeof(size), " - %s%s", get_file_size_str(fsize), ctx.size_partial ? "+" : "");
+  else size[0] = '\0';
 
   if (report_header)
      C_printf ("~3%s~0", report_header);
 
   report_header = NULL;
 
-  if (possible_PE_file && opt.PE_check)
-  {
-    static DWORD num_version_ok_last = 0;
-
-    show_this_file = get_PE_file_brief (file, filler, key, fmt_buf_ver_info.buffer_start, fmt_buf_ver_info.buffer_size);
-    if (show_this_file && opt.signed_status != SIGN_CHECK_NONE)
-    {
-      show_this_file = get_wintrust_info (file, fmt_buf_trust_info.buffer_start, fmt_buf_trust_info.buffer_size);
-      if (!show_this_file && num_version_ok_last < num_version_ok)
-         num_version_ok--;  /* Fix this counter for the  'final_report()' */
-    }
-    num_version_ok_last = num_version_ok;
-  }
+  C_printf ("~3%s~0%s%s: ", note ? note : filler, get_time_str(mtime), size);
 
-  buf_printf (&fmt_buf_time_size, "~3%s~0%s%s: ",
-              note ? note : filler, get_time_str(mtime), size);
+  if (ctx.done & REPORT_STEP_OWNER)
+     C_printf ("%-18s", ctx.owner[0] ? str_shorten(ctx.owner,18) : "<None>");
 
-  /* The remote `file` from EveryThing is not something Windows knows
-   * about. Hence no point in trying to get the DomainName + AccountName
-   * for it.
-   */
-  if (opt.show_owner && key != HKEY_EVERYTHING_ETP)
+  if (report_spec)
   {
-    char       *account_name;
-    const char *found_owner = NULL;
-    BOOL        inverse = FALSE;
-
-    if (get_file_owner(file, NULL, &account_name))
-    {
-      int i, max = smartlist_len (opt.owners);
-
-      /* Show only the file/directory if it matches (or not matches) one of the
-       * owners in `opt.owners`.
-       * With `opt.owners == "*"`, match all.
-       * With `opt.owners == "!*"`, match none.
-       *
-       * E.g. with:
-       *   envtool --man --owner=Admin*  pkcs7*
-       *   show only Man-pages matching "pkcs7*" and owners "Admin*":
-       *
-       *   envtool --man --owner=!Admin* pkcs7*
-       *   show only Man-pages matching "pkcs7*" and owners not matching "Admin*":
-       */
-      if (max > 0)
-         show_this_file = FALSE; /* Assume no, if there are >= 1 owner-patterns to check for */
-
-      for (i = 0; i < max; i++)
-      {
-        const char *owner = smartlist_get (opt.owners, i);
-
-        if (owner[0] == '!' && fnmatch(owner+1, account_name, FNM_FLAG_NOCASE) == FNM_NOMATCH)
-        {
-          inverse = TRUE;
-          found_owner = owner + 1;
-          show_this_file = TRUE;
-          break;
-        }
-        else if (fnmatch(owner, account_name, FNM_FLAG_NOCASE) == FNM_MATCH)
-        {
-          found_owner = owner;
-          show_this_file = TRUE;
-          break;
-        }
-      }
-    }
-
-    if (found_owner)
-    {
-      DEBUGF (2, "account_name (%s) %smatches owner (%s).\n", account_name, inverse ? "does not " : "", found_owner);
-      buf_printf (&fmt_buf_owner_info, "%-18s", str_shorten(account_name,18));
-    }
-    else
-    {
-      buf_printf (&fmt_buf_owner_info, "%-18s", "<None>");
-      DEBUGF (2, "account_name (%s) did not match any wanted owner(s) for file '%s'.\n",
-              account_name, basename(file));
-    }
-    FREE (account_name);
+    print_raw (report_spec, NULL, NULL);
+    C_printf ("%*s", 1 + report_spec_width - (int)strlen(report_spec), " ");
   }
 
   /* `slashify2()` will remove excessive `/` or `\\` anywhere in the name.
    * Add a trailing slash to directories.
    */
+  BUF_INIT (&fmt_buf_file_info, 100 + _MAX_PATH);
   buf_printf (&fmt_buf_file_info, "%s%c", file, is_dir ? DIR_SEP: '\0');
   slashify2 (fmt_buf_file_info.buffer_start, fmt_buf_file_info.buffer_start,
              opt.show_unix_paths ? '/' : '\\');
 
-  if (!is_dir && key == HKEY_MAN_FILE)
-  {
-    const char *link = get_man_link (file);
-    const char *ext  = get_file_ext (file);
-
-    if (!link && !isdigit((int)*ext))
-       link = get_gzip_link (file);
-    if (link)
-       buf_printf (&fmt_buf_file_info, "%*s(%s)", get_trailing_indent(file), " ", link);
-  }
-  else if (!is_dir)
-  {
-    const char *shebang = check_if_shebang (file);
-
-    if (shebang)
-       buf_printf (&fmt_buf_file_info, "%*s(%s)", get_trailing_indent(file), " ", shebang);
-  }
-
-  if (!show_this_file)
-  {
-    get_PE_version_info_free();
-    return (0);
-  }
-
-  C_puts (fmt_buf_time_size.buffer_start);
-  C_puts (fmt_buf_owner_info.buffer_start);
+  if (ctx.link)
+     buf_printf (&fmt_buf_file_info, "%*s(%s)", get_trailing_indent(file), " ", ctx.link);
 
   print_raw (fmt_buf_file_info.buffer_start, NULL, NULL);
 
   /* All this must be printed on the next line
    */
-  if (opt.PE_check && fmt_buf_ver_info.buffer_start[0])
+  if ((ctx.done & REPORT_STEP_PE_VERSION) && fmt_buf_ver_info.buffer_start[0])
   {
     C_printf ("%-60s", fmt_buf_ver_info.buffer_start);
     C_puts (fmt_buf_trust_info.buffer_start);
     print_PE_file_details (filler);
   }
+  else
+    get_PE_version_info_free();
 
   C_putc ('\n');
-
-  ARGSUSED (is_junction);
   return (1);
 }
 
-static void final_report (int found)
+/**
+ * Report a file or directory. Called for each match in all modes.
+ *
+ * With a sort-method (`-S` or `--sort`), the match is only added to a list
+ * here. The list is sorted and printed by `report_sorted()`.
+ *
+ * \retval 1 if the match was printed or added to the list.
+ * \retval 0 if not printed.
+ */
+int report_file (const char *file, time_t mtime, UINT64 fsize, BOOL is_dir, BOOL is_junction, HKEY key)
 {
-  BOOL do_warn = FALSE;
-  char duplicates [50] = "";
-  char ignored [50] = "";
+  if (opt.sort_method == SORT_FILE_UNSORTED)
+  {
+    int rc;
 
-  if ((found_in_hkey_current_user || found_in_hkey_current_user_env ||
+    if (search_halted())
+       return (0);
+    rc = report_file_now (file, mtime, fsize, is_dir, is_junction, key);
+    num_reported += rc;
+    return (rc);
+  }
+
+  sort_add (report_header, file, mtime, fsize, is_dir, is_junction, key, report_spec);
+  return (1);
+}
+
+/**
+ * The `sort_flush()` callback; report a match in sorted order.
+ */
+static int report_sorted_file (const char *header, const char *file, time_t mtime, UINT64 fsize,
+                               BOOL is_dir, BOOL is_junction, HKEY key, const char *spec)
+{
+  int rc;
+
+  if (header)
+     report_header = (char*) (*header ? header : NULL);
+
+  if (search_halted())
+     return (0);
+
+  report_spec = spec;
+  rc = report_file_now (file, mtime, fsize, is_dir, is_junction, key);
+  report_spec = NULL;
+  num_reported += rc;
+  return (rc);
+}
+
+/**
+ * Should the search stop?
+ *
+ * \retval TRUE if `^C` was pressed or if `opt.max_matches` matches
+ *         (with `--first` or `--max-matches`) were reported.
+ *
+ * Safe to call from a worker-thread. All the loops doing directory,
+ * EveryThing or Python I/O check this.
+ */
+BOOL search_halted (void)
+{
+  if (halt_flag > 0)
+     return (TRUE);
+  return (opt.max_matches > 0 && num_reported >= opt.max_matches);
+}
+
+/**
+ * Return the number of matches that can be reported before
+ * `opt.max_matches` is reached.
+ *
+ * \retval `UINT_MAX` if there is no limit. Also with a sort-method, since
+ *         then all matches must be found and sorted first.
+ */
+unsigned matches_left (void)
+{
+  if (opt.max_matches <= 0 || opt.sort_method != SORT_FILE_UNSORTED)
+     return (UINT_MAX);
+  if (num_reported >= opt.max_matches)
+     return (0);
+  return (opt.max_matches - num_reported);
+}
+
+/**
+ * Sort and print the matches listed by `report_file()` in a mode.
+ * Called after each mode, so each mode is sorted on it's own.
+ *
+ * \retval The correction to the number of matches found in that mode.
+ *         `report_file()` counted all listed matches, but some could be
+ *         filtered out when printed.
+ */
+static int report_sorted (void)
+{
+  int listed = sort_count();
+  int found;
+
+  if (listed == 0)
+     return (0);
+
+  found = sort_flush (report_sorted_file);
+  report_header = NULL;
+  return (found - listed);
+}
+
+static void final_report (int found)
+{
+  BOOL do_warn = FALSE;
+  char duplicates [50] = "";
+  char ignored [50] = "";
+  char *specs = STRDUP (opt.file_spec);
+  int   i, max = opt.file_specs ? smartlist_len (opt.file_specs) : 0;
+
+  if ((found_in_hkey_current_user || found_in_hkey_current_user_env ||
        found_in_hkey_local_machine || found_in_hkey_local_machine_sess_man) &&
        found_in_default_env)
   {
@@ -1719,8 +2014,15 @@ static void final_report (int found)
      snprintf (ignored, sizeof(ignored), " (%lu ignored)",
                (unsigned long)num_evry_ignored);
 
+  for (i = 1; i < max; i++)
+  {
+    specs = _stracat (specs, "\", \"");
+    specs = _stracat (specs, smartlist_get(opt.file_specs, i));
+  }
+
   C_printf ("%s match%s found for \"%s\"%s%s.",
-            dword_str((DWORD)found), (found == 0 || found > 1) ? "es" : "", opt.file_spec, duplicates, ignored);
+            dword_str((DWORD)found), (found == 0 || found > 1) ? "es" : "", specs, duplicates, ignored);
+  FREE (specs);
 
   if (opt.show_size && total_size > 0)
      C_printf (" Totalling %s (%s bytes). ",
@@ -1742,6 +2044,62 @@ static void final_report (int found)
   C_putc ('\n');
 }
 
+/**
+ * Return `fspec` with a long-name for a SFN and a suffix (or a
+ * trailing wildcard) added if it has none.
+ * E.g. `"foo"` -> `"foo.*"`.
+ *
+ * \note `fspec` is freed (or reallocated) here.
+ */
+static char *fix_file_suffix (char *fspec)
+{
+  char *end, *dot;
+
+  if (strchr(fspec,'~') > fspec)
+  {
+    char *sfn = fspec;
+
+    fspec = _fix_path (sfn, NULL);
+    FREE (sfn);
+  }
+
+  end = strrchr (fspec, '\0');
+  dot = strrchr (fspec, '.');
+  if (!dot && !opt.do_vcpkg)
+  {
+    if (opt.do_pkg && end > fspec && end[-1] != '*')
+       fspec = _stracat (fspec, ".pc*");
+
+    else if (opt.do_vcpkg && end > fspec && end[-1] != '*')
+       fspec = _stracat (fspec, "*");
+
+    else if (end > fspec && end[-1] != '*' && end[-1] != '$')
+       fspec = _stracat (fspec, ".*");
+  }
+  return (fspec);
+}
+
+/**
+ * Check if the modes and options given can be used with several file-specs.
+ * They are only used in the modes that scans directories with `scan_dir()`.
+ */
+static void check_file_specs (void)
+{
+  int i, max = smartlist_len (opt.file_specs);
+
+  if (opt.use_regex || opt.do_evry || opt.do_python || opt.do_vcpkg)
+     usage ("Several ~6<file-spec>~0s can not be used with \"--regex\", \"--evry\", "
+            "\"--python\" or \"--vcpkg\".\n");
+
+  for (i = 0; i < max; i++)
+  {
+    const char *spec = smartlist_get (opt.file_specs, i);
+
+    if (strpbrk(spec, "/\\"))
+       usage ("The ~6<file-spec>~0 \"%s\" has a sub-dir part. Not possible with several ~6<file-spec>~0s.\n", spec);
+  }
+}
+
 /**
  * Check for suffix or trailing wildcards. If not found, add a
  * trailing `"*"`.
@@ -1930,14 +2288,14 @@ static BOOL enum_sub_values (HKEY top_key, const char *key_name, const char **re
 
 /**
  * Enumerate all keys under `top_key + REG_APP_PATH` and build up
- * the `reg_array` smartlist.
+ * the `reg_array` vector.
  *
  * Either under: <br>
  *   `HKEY_LOCAL_MACHINE\SOFTWARE\Microsoft\Windows\CurrentVersion\App Paths` <br>
  * or <br>
  *   `HKEY_CURRENT_USER\SOFTWARE\Microsoft\Windows\CurrentVersion\App Paths` <br>
  *
- * The number of entries added is given by `smartlist_len (reg_array)`.
+ * The number of entries added is given by `vector_len (&reg_array)`.
  */
 static void build_reg_array_app_path (HKEY top_key)
 {
@@ -2036,17 +2394,9 @@ static void scan_reg_environment (HKEY top_key, const char *sub_key,
 
 static int do_check_env2 (HKEY key, const char *env, const char *value)
 {
-  smartlist_t *list = split_env_var (env, value);
-  int          found = 0;
-  int          i, max = list ? smartlist_len (list) : 0;
-
-  for (i = 0; i < max; i++)
-  {
-    const struct directory_array *arr = smartlist_get (list, i);
+  vector_t    *list  = split_env_var (env, value);
+  int          found = process_dirs (list, env, key, FALSE);
 
-    found += process_dir (arr->dir, arr->num_dup, arr->exist, arr->check_empty,
-                          arr->is_dir, arr->exp_ok, env, key, FALSE);
-  }
   free_dir_array();
   return (found);
 }
@@ -2101,11 +2451,11 @@ static int scan_user_env (void)
  */
 static int report_registry (const char *reg_key)
 {
-  int i, found, max = smartlist_len (reg_array);
+  int i, found, max = vector_len (&reg_array);
 
   for (i = found = 0; i < max; i++)
   {
-    const struct registry_array *arr = smartlist_get (reg_array, i);
+    const struct registry_array *arr = vector_get (&reg_array, i);
     char  fqfn [_MAX_PATH];
     int   match = FNM_NOMATCH;
 
@@ -2158,74 +2508,227 @@ static int do_check_registry (void)
 }
 
 /**
- * Check if directory is empty (no files or directories except
- * `"."` and `".."`).
+ * What one enumeration of a directory tells about it.
+ * Used by `envtool --check` and for the "directory is empty" warning
+ * in the search modes.
  *
  * \note It is quite normal that e.g. `"%INCLUDE"` contain a directory with
  *       no .h-files but at least 1 subdirectory with .h-files.
  */
-static BOOL dir_is_empty (const char *dir)
+struct dir_probe {
+       BOOL exist;        /**< The directory could be enumerated */
+       BOOL is_reparse;   /**< It is a junction or a symlink */
+       int  num_entries;  /**< Number of files and directories except `"."` and `".."` */
+     };
+
+/**
+ * A directory is empty only if it could be enumerated.
+ * Otherwise we really can't tell.
+ */
+#define DIR_PROBE_EMPTY(p)  ((p)->exist && (p)->num_entries == 0)
+
+static void dir_probe_init (const char *dir, struct dir_probe *probe)
 {
-  HANDLE          handle;
-  WIN32_FIND_DATA ff_data;
-  char            path  [_MAX_PATH];
-  int             num_entries = 0;
+  DWORD attr = GetFileAttributes (dir);
 
-  snprintf (path, sizeof(path), "%s\\*", dir);
-  handle = FindFirstFile (path, &ff_data);
-  if (handle == INVALID_HANDLE_VALUE)
-     return (FALSE);    /* We really can't tell */
+  memset (probe, '\0', sizeof(*probe));
+  probe->is_reparse = (attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_REPARSE_POINT));
+}
 
-  do
-  {
-    if (strcmp(ff_data.cFileName,".") && strcmp(ff_data.cFileName,".."))
-       num_entries++;
-  }
-  while (num_entries == 0 && FindNextFile(handle, &ff_data));
+/**
+ * Probe `dir` by enumerating all entries in it.
+ */
+static void dir_probe_list (const char *dir, struct dir_probe *probe)
+{
+  DIRSCAN *ds;
+
+  dir_probe_init (dir, probe);
+  ds = dirscan_open (dir, "*");
+  if (!ds)
+     return;
 
-  DEBUGF (3, "%s(): at least %d entries in '%s'.\n", __FUNCTION__, num_entries, dir);
-  FindClose (handle);
-  return (num_entries == 0);
+  probe->exist = TRUE;
+  while (dirscan_next(ds))
+     probe->num_entries++;
+  dirscan_close (ds);
+  DEBUGF (3, "%s(): %d entries in '%s'.\n", __FUNCTION__, probe->num_entries, dir);
 }
 
 /**
  * Try to match `str` against the global regular expression in `opt.file_spec`.
+ *
+ * When scanning with worker-threads, the `regexec()` calls are serialised
+ * via `re_lock` (the GNU regex engine compiles a fastmap on first use).
+ *
+ * A `str` without the literal `re_lit` can not match. So it is rejected
+ * before taking the lock and calling `regexec()`.
  */
+static CRITICAL_SECTION *re_lock = NULL;
+
 static BOOL regex_match (const char *str)
 {
+  BOOL rc = FALSE;
+
+  if (re_lit && !re_literal_exec(re_lit, str))
+     return (FALSE);
+
+  if (re_lock)
+     EnterCriticalSection (re_lock);
+
   memset (&re_matches, '\0', sizeof(re_matches));
   re_err = regexec (&re_hnd, str, DIM(re_matches), re_matches, 0);
   DEBUGF (3, "regex() pattern '%s' against '%s'. re_err: %d\n", opt.file_spec, str, re_err);
 
-  if (re_err == REG_NOMATCH)
-     return (FALSE);
-
   if (re_err == REG_NOERROR)
-     return (TRUE);
+     rc = TRUE;
 
-  regerror (re_err, &re_hnd, re_errbuf, sizeof(re_errbuf));
-  DEBUGF (0, "Error while matching \"%s\": %d\n", str, re_err);
-  return (FALSE);
+  else if (re_err != REG_NOMATCH)
+  {
+    regerror (re_err, &re_hnd, re_errbuf, sizeof(re_errbuf));
+    DEBUGF (0, "Error while matching \"%s\": %d\n", str, re_err);
+  }
+
+  if (re_lock)
+     LeaveCriticalSection (re_lock);
+  return (rc);
 }
 
 /**
- * Process directory specified by `path` and report any matches
- * to the global `opt.file_spec`.
+ * A matching file or directory found by `scan_dir()`.
+ * Kept until `report_dir_matches()` is called.
  */
-int process_dir (const char *path, int num_dup, BOOL exist, BOOL check_empty,
-                 BOOL is_dir, BOOL exp_ok, const char *prefix, HKEY key,
-                 BOOL recursive)
+struct dir_match {
+       char       *file;
+       time_t      mtime;
+       UINT64      fsize;
+       BOOL        is_dir;
+       BOOL        is_junction;
+       const char *spec;     /**< The file-spec that matched; with several file-specs only */
+     };
+
+/**
+ * What `scan_dir()` looks for.
+ */
+struct scan_spec {
+       const char   *fspec;         /**< The `FindFirstFile()` spec */
+       const char   *subdir;        /**< The sub-dir part of `opt.file_spec` (or NULL) */
+       fnmatch_spec *file_spec;     /**< The compiled `opt.file_spec` (NULL if `opt.use_regex`) */
+       fnmatch_spec *find_spec;     /**< The compiled `fspec`; to filter a cached listing */
+       fnmatch_spec *find_dotless;  /**< The compiled `"foo"` for a `"foo.*"` spec (or NULL) */
+       fnmatch_set  *file_set;      /**< The compiled `opt.file_specs` (or NULL) */
+       int           num_specs;     /**< The number of `opt.file_specs` */
+       smartlist_t  *set_tags;      /**< The file-spec for each pattern in `file_set` */
+     };
+
+static struct scan_spec scan_spec;
+
+/**
+ * Set up `ss` for several file-specs in `opt.file_specs`.
+ *
+ * All of them are matched in one pass over each directory. Hence the
+ * directory is listed with a `"*"` spec and the file-specs are compiled
+ * into a pattern-set. None of them has a sub-dir part (see `main()`).
+ *
+ * `FindFirstFile()` lets a `"foo.*"` also match a dotless `"foo"`. So a
+ * `"foo"` pattern is added after all the others for such a file-spec.
+ */
+static const struct scan_spec *get_scan_set (struct scan_spec *ss)
+{
+  int i, len, max = smartlist_len (opt.file_specs);
+
+  ss->fspec     = "*";
+  ss->find_spec = fnmatch_compile (ss->fspec, FNM_FLAG_NOCASE | FNM_FLAG_NOESCAPE);
+  ss->file_set  = fnmatch_set_new (fnmatch_case(0) | FNM_FLAG_NOESCAPE);
+  ss->set_tags  = smartlist_new();
+  ss->num_specs = max;
+
+  for (i = 0; i < max; i++)
+  {
+    char *spec = smartlist_get (opt.file_specs, i);
+
+    fnmatch_set_add (ss->file_set, spec);
+    smartlist_add (ss->set_tags, spec);
+
+    len = (int) strlen (spec);
+    if (len > report_spec_width)
+       report_spec_width = len;
+  }
+
+  for (i = 0; i < max; i++)
+  {
+    char *spec = smartlist_get (opt.file_specs, i);
+    char  buf [_MAX_PATH];
+
+    len = (int) strlen (spec);
+    if (len >= 2 && !strcmp(spec+len-2, ".*"))
+    {
+      _strlcpy (buf, spec, len-1);
+      fnmatch_set_add (ss->file_set, buf);
+      smartlist_add (ss->set_tags, spec);
+    }
+  }
+  DEBUGF (2, "%d file-specs in a set of %d patterns.\n", max, fnmatch_set_len(ss->file_set));
+  return (ss);
+}
+
+/**
+ * Return the `FindFirstFile()` spec, sub-dir part and compiled patterns for `opt.file_spec`.
+ * We need to set these only once; `opt.file_spec` is constant throughout the program.
+ * Must be called from the main thread before any `scan_dir()` in a worker-thread.
+ */
+static const struct scan_spec *get_scan_spec (void)
 {
-  HANDLE          handle;
-  WIN32_FIND_DATA ff_data;
-  char            fqfn  [_MAX_PATH];  /* Fully qualified file-name */
-  int             found = 0;
+  struct scan_spec *ss = &scan_spec;
+  char   *subdir = NULL;  /* Looking for a `opt.file_spec` with a sub-dir part in it. */
+  size_t  len;
+
+  if (ss->fspec)
+     return (ss);
+
+  if (opt.file_specs)
+     return get_scan_set (ss);
+
+  ss->fspec  = (opt.use_regex ? "*" : fix_filespec(&subdir));
+  ss->subdir = subdir;
 
-  /* We need to set these only once; `opt.file_spec` is constant throughout the program.
+  if (!opt.use_regex)
+     ss->file_spec = fnmatch_compile (opt.file_spec, fnmatch_case(0) | FNM_FLAG_NOESCAPE);
+  ss->find_spec = fnmatch_compile (ss->fspec, FNM_FLAG_NOCASE | FNM_FLAG_NOESCAPE);
+
+  /* `FindFirstFile()` lets a `"foo.*"` also match a dotless `"foo"`.
    */
-  static char *fspec  = NULL;
-  static char *subdir = NULL;  /* Looking for a `opt.file_spec` with a sub-dir part in it. */
+  len = strlen (ss->fspec);
+  if (len >= 2 && !strcmp(ss->fspec+len-2, ".*"))
+  {
+    char buf [_MAX_PATH];
+
+    _strlcpy (buf, ss->fspec, len-1);
+    ss->find_dotless = fnmatch_compile (buf, FNM_FLAG_NOCASE | FNM_FLAG_NOESCAPE);
+  }
+  DEBUGF (2, "opt.file_spec: %s match, fspec: %s match.\n",
+          ss->file_spec ? fnmatch_class(ss->file_spec) : "regex", fnmatch_class(ss->find_spec));
+  return (ss);
+}
+
+static void free_scan_spec (void)
+{
+  fnmatch_set_free (scan_spec.file_set);
+  smartlist_free (scan_spec.set_tags);
+  fnmatch_free (scan_spec.file_spec);
+  fnmatch_free (scan_spec.find_spec);
+  fnmatch_free (scan_spec.find_dotless);
+  memset (&scan_spec, '\0', sizeof(scan_spec));
+}
 
+/**
+ * Print the warnings for a directory `path` that `process_dir()` would print.
+ *
+ * \retval TRUE  if `path` should be scanned.
+ * \retval FALSE if not.
+ */
+static BOOL check_process_dir (const char *path, int num_dup, BOOL exist, BOOL is_dir,
+                               BOOL exp_ok, const char *prefix)
+{
   if (num_dup > 0)
   {
 #if 0     /* \todo */
@@ -2233,19 +2736,20 @@ int process_dir (const char *path, int num_dup, BOOL exist, BOOL check_empty,
 #else
     WARN ("%s: directory \"%s\" is duplicated. Skipping.\n", prefix, path);
 #endif
-    return (0);
+    return (FALSE);
   }
 
   if (!exp_ok)
   {
     WARN ("%s: directory \"%s\" has an unexpanded value.\n", prefix, path);
-    return (0);
+    return (FALSE);
   }
 
   if (!exist)
   {
+    daemon_add_missing (path);
     WARN ("%s: directory \"%s\" doesn't exist.\n", prefix, path);
-    return (0);
+    return (FALSE);
   }
 
   if (!is_dir)
@@ -2254,64 +2758,78 @@ int process_dir (const char *path, int num_dup, BOOL exist, BOOL check_empty,
   if (!opt.file_spec)
   {
     DEBUGF (1, "\n");
-    return (0);
+    return (FALSE);
   }
+  return (TRUE);
+}
 
-  if (check_empty && is_dir && dir_is_empty(path))
-     WARN ("%s: directory \"%s\" is empty.\n", prefix, path);
+/**
+ * Check if the directory entry `de` in `path` is a match to the
+ * global `opt.file_spec`.
+ *
+ * \retval A new `struct dir_match` or NULL if no match.
+ */
+static struct dir_match *scan_match (const char *path, const struct scan_spec *ss,
+                                     const struct dirscan_entry *de)
+{
+  struct dir_match *m;
+  const char *subdir = ss->subdir;
+  const char *spec = NULL;
+  char  *base, *file;
+  char   fqfn [_MAX_PATH];  /* Fully qualified file-name */
+  int    match, idx, len;
+  BOOL   is_dir, is_junction;
+
+  is_dir      = de->is_dir;
+  is_junction = de->is_junction;
 
-  if (!fspec)
-     fspec = (opt.use_regex ? "*" : fix_filespec(&subdir));
+  /* `safe_stat()` used to refuse hidden and system files. Keep it that way.
+   */
+  if (!is_dir && (de->attrib & (FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM)))
+     return (NULL);
+
+  len  = snprintf (fqfn, sizeof(fqfn), "%s%c", path, DIR_SEP);
+  base = fqfn + len;
+  snprintf (base, sizeof(fqfn)-len, "%s%s", subdir ? subdir : "", de->name);
 
-  snprintf (fqfn, sizeof(fqfn), "%s%c%s%s", path, DIR_SEP, subdir ? subdir : "", fspec);
-  handle = FindFirstFile (fqfn, &ff_data);
-  if (handle == INVALID_HANDLE_VALUE)
+  if (opt.use_regex)
   {
-    DEBUGF (1, "\"%s\" not found.\n", fqfn);
-    return (0);
+    if (!regex_match(fqfn))
+       return (NULL);
+    file = fqfn;
+ // regex_print (&re_hnd, re_matches, fqfn);
   }
-
-  do
+  else if (ss->file_set)
   {
-    struct stat   st;
-    char  *base, *file;
-    int    match, len;
-    BOOL   is_junction;
-    BOOL   ignore = /* opt.use_regex && */
-                    ((ff_data.cFileName[0] == '.' && ff_data.cFileName[1] == '\0') ||
-                    !strcmp(ff_data.cFileName,".."));
-    if (ignore)
-       continue;
+    file = slashify2 (fqfn, fqfn, DIR_SEP);
+    idx  = fnmatch_set_exec (ss->file_set, base);
 
-    len  = snprintf (fqfn, sizeof(fqfn), "%s%c", path, DIR_SEP);
-    base = fqfn + len;
-    snprintf (base, sizeof(fqfn)-len, "%s%s", subdir ? subdir : "", ff_data.cFileName);
+    /* A dotless match is for a file only. As below.
+     */
+    if (idx >= ss->num_specs && (is_dir || opt.dir_mode || opt.man_mode))
+       idx = -1;
 
-    is_dir      = ((ff_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0);
-    is_junction = ((ff_data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0);
+    if (is_dir && opt.do_lib)  /* A directory is never a match for a library */
+       idx = -1;
 
-    if (opt.use_regex)
-    {
-      if (regex_match(fqfn) && safe_stat(fqfn, &st, NULL) == 0)
-      {
-        if (report_file(fqfn, st.st_mtime, st.st_size, is_dir, is_junction, key))
-        {
-          found++;
-       // regex_print (&re_hnd, re_matches, fqfn);
-        }
-      }
-      continue;
-    }
+    if (idx < 0)
+       return (NULL);
 
+    spec = smartlist_get (ss->set_tags, idx);
+    DEBUGF (1, "Testing \"%s\". is_dir: %d, is_junction: %d, matched \"%s\"\n",
+            file, is_dir, is_junction, spec);
+  }
+  else
+  {
     file  = slashify2 (fqfn, fqfn, DIR_SEP);
-    match = fnmatch (opt.file_spec, base, fnmatch_case(0) | FNM_FLAG_NOESCAPE);
+    match = fnmatch_exec (ss->file_spec, base);
 
 #if 0
     if (opt.man_mode)
     {
       DEBUGF (2, "opt.file_spec: \"%s\", base: \"%s\".\n", opt.file_spec, base);
       if (match == FNM_NOMATCH)
-         continue;
+         return (NULL);
     }
 
     if (match == FNM_NOMATCH && strchr(opt.file_spec,'~'))
@@ -2340,2811 +2858,4743 @@ int process_dir (const char *path, int num_dup, BOOL exist, BOOL check_empty,
     DEBUGF (1, "Testing \"%s\". is_dir: %d, is_junction: %d, %s\n",
             file, is_dir, is_junction, fnmatch_res(match));
 
-    if (match == FNM_MATCH && safe_stat(file, &st, NULL) == 0)
-    {
-      if (report_file(file, st.st_mtime, st.st_size, is_dir, is_junction, key))
-         found++;
-    }
+    if (match != FNM_MATCH)
+       return (NULL);
   }
-  while (FindNextFile(handle, &ff_data));
 
-  FindClose (handle);
-  ARGSUSED (recursive);
-  return (found);
+  m = MALLOC (sizeof(*m));
+  m->file        = STRDUP (file);
+  m->mtime       = de->mtime;
+  m->fsize       = de->fsize;
+  m->is_dir      = is_dir;
+  m->is_junction = is_junction;
+  m->spec        = spec;
+  return (m);
 }
 
-static const char *evry_strerror (DWORD err)
+/**
+ * Return TRUE if `name` would be returned from `FindFirstFile()` with `ss->fspec`.
+ * Used to filter a listing from the directory-cache the same way.
+ */
+static BOOL spec_match (const struct scan_spec *ss, const char *name)
 {
-  static char buf[30];
+  if (fnmatch_exec(ss->find_spec, name) == FNM_MATCH)
+     return (TRUE);
 
-  switch (err)
-  {
-    case EVERYTHING_OK:
-         return ("No error");
-    case EVERYTHING_ERROR_MEMORY:
-         return ("Memory error");
-    case EVERYTHING_ERROR_IPC:
-         return ("IPC error");
-    case EVERYTHING_ERROR_REGISTERCLASSEX:
-         return ("Error in RegisterClassEx()");
-    case EVERYTHING_ERROR_CREATEWINDOW:
-         return ("Error in CreateWindow()");
-    case EVERYTHING_ERROR_CREATETHREAD:
-         return ("Error in CreateThread()");
-    case EVERYTHING_ERROR_INVALIDINDEX:
-         return ("Invalid index given");
-    case EVERYTHING_ERROR_INVALIDCALL:
-         return ("Invalid call");
-    case EVERYTHING_ERROR_INVALIDREQUEST:
-         return ("Invalid request data");
-    case EVERYTHING_ERROR_INVALIDPARAMETER:
-         return ("Bad parameter");
-  }
-  snprintf (buf, sizeof(buf), "Unknown error %lu", (u_long)err);
-  return (buf);
+  if (ss->find_dotless && !strchr(name, '.'))
+     return (fnmatch_exec(ss->find_dotless, name) == FNM_MATCH);
+  return (FALSE);
 }
 
-static void check_sys_dir (const char *dir, const char *name, BOOL *have_it)
+/**
+ * List the directory `path` for matches to the global `opt.file_spec`.
+ *
+ * With `envtool --dir-cache`, the listing is taken from the directory-cache
+ * if `path` is unchanged since the last run.
+ *
+ * If `probe != NULL`, `path` is probed in the same pass. All entries are
+ * enumerated and counted and `spec_match()` selects the candidates.
+ * Unless `opt.file_spec` has a sub-dir part; then `path` must be probed
+ * on it's own.
+ *
+ * \retval A smartlist of `struct dir_match` (possibly empty) or NULL
+ *         if `path` could not be scanned.
+ */
+static smartlist_t *list_dir_matches (const char *path, struct dir_probe *probe)
 {
-  DWORD attr = GetFileAttributes (dir);
-  BOOL  is_dir = (attr != INVALID_FILE_ATTRIBUTES) &&
-                 (attr & FILE_ATTRIBUTE_DIRECTORY);
+  DIRSCAN                    *ds;
+  const struct dirscan_entry *de;
+  const smartlist_t          *cached = NULL;
+  smartlist_t                *matches;
+  struct dir_match           *m;
+  const struct scan_spec     *ss = get_scan_spec();
+  const char                 *subdir = ss->subdir;
+  char                        spec  [_MAX_PATH];
+  int                         i, max, len;
 
-  if (is_dir)
-       DEBUGF (1, "%s: '%s' okay\n", name, dir);
-  else DEBUGF (1, "%s: '%s', GetLastError(): %lu\n", name, dir, (unsigned long)GetLastError());
+  if (probe && subdir)
+  {
+    dir_probe_list (path, probe);
+    probe = NULL;
+  }
 
-  if (have_it)
-     *have_it = is_dir;
-}
+  if (opt.use_dir_cache)
+  {
+    /* The cache is keyed on the directory actually listed.
+     * I.e. including any sub-dir part, but without a trailing slash.
+     */
+    if (subdir)
+         len = snprintf (spec, sizeof(spec), "%s%c%s", path, DIR_SEP, subdir);
+    else len = snprintf (spec, sizeof(spec), "%s", path);
+    if (len > 3 && IS_SLASH(spec[len-1]))
+       spec [len-1] = '\0';
+    cached = dir_cache_list (spec);
+  }
 
-static void check_sys_dirs (void)
-{
-  check_sys_dir (sys_dir, "sys_dir", NULL);
-#if (IS_WIN64 == 0)
-  check_sys_dir (sys_native_dir, "sys_native_dir", &have_sys_native_dir);
-  check_sys_dir (sys_wow64_dir, "sys_wow64_dir", &have_sys_wow64_dir);
-#else
-  ARGSUSED (have_sys_wow64_dir);
-#endif
-}
+  if (cached)
+  {
+    matches = smartlist_new();
+    max = smartlist_len (cached);
+    if (probe)
+    {
+      dir_probe_init (path, probe);
+      probe->exist       = TRUE;
+      probe->num_entries = max;
+    }
+    for (i = 0; i < max; i++)
+    {
+      WIN32_FILE_ATTRIBUTE_DATA fa;
 
-/**
- * Figure out if `file` can have a shadow in `%WinDir%\sysnative`.
- * Makes no sense on Win64.
- */
-static const char *get_sysnative_file (const char *file, struct stat *st)
-{
-#if (IS_WIN64 == 0)
-  if (!str_equal_n(sys_dir,file,strlen(sys_dir)) && sys_native_dir[0])
+      de = smartlist_get (cached, i);
+      if (!spec_match(ss, de->name))
+         continue;
+
+      m = scan_match (path, ss, de);
+      if (!m)
+         continue;
+
+      /* The cached size and time could be stale. Refresh them for a match.
+       */
+      if (GetFileAttributesEx(m->file, GetFileExInfoStandard, &fa))
+      {
+        m->fsize = ((UINT64)fa.nFileSizeHigh << 32) + fa.nFileSizeLow;
+        m->mtime = FILETIME_to_time_t (&fa.ftLastWriteTime);
+      }
+      smartlist_add (matches, m);
+    }
+    return (matches);
+  }
+
+  if (probe)
   {
-    static char shadow [_MAX_PATH];
+    dir_probe_init (path, probe);
+    _strlcpy (spec, "*", sizeof(spec));
+  }
+  else
+    snprintf (spec, sizeof(spec), "%s%s", subdir ? subdir : "", ss->fspec);
 
-    snprintf (shadow, sizeof(shadow), "%s\\%s", sys_native_dir, file+strlen(sys_dir)+1);
-    safe_stat (shadow, st, NULL);
-    return (shadow);
+  ds = dirscan_open (path, spec);
+  if (!ds)
+     return (NULL);
+
+  matches = smartlist_new();
+  if (probe)
+     probe->exist = TRUE;
+
+  /* The `WIN32_FIND_DATA` record is the only source of meta-data here.
+   * No `safe_stat()` is done for a matching file.
+   */
+  while ((de = dirscan_next(ds)) != NULL)
+  {
+    if (probe)
+    {
+      probe->num_entries++;
+      if (!spec_match(ss, de->name))
+         continue;
+    }
+    m = scan_match (path, ss, de);
+    if (m)
+       smartlist_add (matches, m);
   }
-#else
-  ARGSUSED (st);
-#endif
-  return (file);
+  dirscan_close (ds);
+  return (matches);
 }
 
 /**
- * \todo
- * \parblock
- *   If the result returns a file on a remote disk (X:) and the
- *   remote computer is down, EveryThing will return the
- *   the entry in it's database. But then the stat() below <br>
- *   will fail after a long SMB timeout (SessTimeOut, default 60 sec).
- *
- *   Try to detect this if `file[0:1]` is `X:` prior to calling
- *   `stat()`. Use:
- *     `GetFileAttributes(file)` and test if `GetLastError()`
- *     returns `ERROR_BAD_NETPATH` ??
- *
- *  Or simply exclude the remote disk `X:` in the query.
- *  \eg
- *   ```
- *    C:\> envtool --evry foxitre*.exe
- *   ```
- *  should query for:
- *   ```
- *    ^[^X]:\\.*foxitre.*\.exe$
- *   ```
- *
- * But then we need a-priori knowledge that `X:` is remote. Like
- *  `C:\> net use` does:
- *  \code
- *   Status       Local     External                  Network
- *   -------------------------------------------------------------------------------
- *   Disconnected X:        \\DONALD\X-PARTITION      Microsoft Windows Network
- *   ^^
- *   \endcode
- *  where to get this state?
+ * The result of each directory scanned in this run.
  *
- * \endparblock
+ * Several modes (E.g. `envtool --path --inc --lib`) and the compiler
+ * specific passes often search the same directories. Like a MinGW
+ * include-directory that is also in `%INCLUDE%`. Or a directory in the
+ * `HKLM` and `HKCU` environments and in `%PATH%`. Since the matches in a
+ * directory are the same for all modes, each directory is enumerated once.
+ * Each mode gets a copy of the matches and reports them as before.
  */
-static int report_evry_file (const char *file, time_t mtime, UINT64 fsize, BOOL *is_shadow)
+struct scan_memo {
+       char        *dir;
+       BOOL             scanned;   /**< `list_dir_matches()` was called */
+       unsigned         flags;     /**< The `scan_memo_flags()` when it was called */
+       smartlist_t     *matches;   /**< Of `struct dir_match`. NULL if `dir` could not be scanned */
+       BOOL             probed;    /**< `probe` is valid */
+       struct dir_probe probe;
+     };
+
+static smartlist_t     *scan_memo;    /* Sorted on `scan_memo::dir` */
+static CRITICAL_SECTION scan_memo_lock;
+static unsigned         scan_memo_hits, scan_memo_misses;
+
+/**
+ * The options `scan_match()` depends on (besides the `scan_spec`).
+ * E.g. `do_check_manpath()` sets `opt.man_mode` for a while. The matches
+ * of a directory scanned with other flags are not re-used.
+ */
+static unsigned scan_memo_flags (void)
 {
-  struct stat st;
-  BOOL        is_dir = FALSE;
-  const char *file2;
-  DWORD       attr;
+  return ((opt.man_mode  ? 0x01 : 0) |
+          (opt.dir_mode  ? 0x02 : 0) |
+          (opt.do_lib    ? 0x04 : 0) |
+          (opt.use_regex ? 0x08 : 0));
+}
 
-  memset (&st, '\0', sizeof(st));
-  *is_shadow = FALSE;
+static int compare_memo (const void *key, const void **member)
+{
+  const struct scan_memo *sm = *member;
 
-  /* Do not use the slower `safe_stat()` unless needed.
-   * See below.
-   */
-  attr = GetFileAttributes (file);
-  if (attr != INVALID_FILE_ATTRIBUTES)
-     is_dir = (attr & FILE_ATTRIBUTE_DIRECTORY);
+  return stricmp ((const char*)key, sm->dir);
+}
 
-  else if (attr == INVALID_FILE_ATTRIBUTES)
+static void free_matches (smartlist_t *matches)
+{
+  int i, max = matches ? smartlist_len (matches) : 0;
+
+  for (i = 0; i < max; i++)
   {
-    file2 = get_sysnative_file (file, &st);
-    if (file2 != file)
-    {
-      DEBUGF (1, "shadow: '%s' -> '%s'\n", file, file2);
-      *is_shadow = TRUE;
-    }
-    file = file2;
+    struct dir_match *m = smartlist_get (matches, i);
+
+    FREE (m->file);
+    FREE (m);
   }
+  smartlist_free (matches);
+}
 
-  if (st.st_mtime == 0)
+static smartlist_t *copy_matches (const smartlist_t *matches)
+{
+  smartlist_t *copy;
+  int          i, max;
+
+  if (!matches)
+     return (NULL);
+
+  copy = smartlist_new();
+  max  = smartlist_len (matches);
+  for (i = 0; i < max; i++)
   {
-    /* If EveryThing older than 1.4.1 was used, these are not set.
-     */
-    if (mtime == 0)
-    {
-      safe_stat (file, &st, NULL);
-      mtime = st.st_mtime;
-    }
-    if (fsize == (__int64)-1)
-    {
-      safe_stat (file, &st, NULL);
-      fsize = st.st_size;
-    }
+    struct dir_match *m = MALLOC (sizeof(*m));
+
+    *m = *(const struct dir_match*) smartlist_get (matches, i);
+    m->file = STRDUP (m->file);
+    smartlist_add (copy, m);
   }
+  return (copy);
+}
 
-  return report_file (file, mtime, is_dir ? (__int64)-1 : fsize,
-                      is_dir, FALSE, HKEY_EVERYTHING);
+static void scan_memo_init (void)
+{
+  InitializeCriticalSection (&scan_memo_lock);
+  scan_memo = smartlist_new();
 }
 
-/**
- * Check if EveryThing database is loaded and not busy indexing itself.
- */
-static BOOL evry_IsDBLoaded (HWND wnd)
+static void scan_memo_exit (void)
 {
-  int loaded = 0;
-  int busy = 0;
+  int i, max;
 
-  if (wnd)
+  if (!scan_memo)
+     return;
+
+  DEBUGF (1, "%u directories enumerated, %u re-used.\n", scan_memo_misses, scan_memo_hits);
+
+  max = smartlist_len (scan_memo);
+  for (i = 0; i < max; i++)
   {
-    loaded = (int) SendMessage (wnd, WM_USER, EVERYTHING_IPC_IS_DB_LOADED, 0);
-    busy   = (int) SendMessage (wnd, WM_USER, EVERYTHING_IPC_IS_DB_BUSY, 0);
+    struct scan_memo *sm = smartlist_get (scan_memo, i);
+
+    free_matches (sm->matches);
+    FREE (sm->dir);
+    FREE (sm);
   }
-  DEBUGF (1, "wnd: %p, loaded: %d, busy: %d.\n", wnd, loaded, busy);
-  return (loaded && !busy);
+  smartlist_free (scan_memo);
+  scan_memo = NULL;
+  DeleteCriticalSection (&scan_memo_lock);
 }
 
 /**
- * The handler for option `--evry`. Search the EveryThing database.
+ * Forget all the matches; they are for the previous `opt.file_spec`.
+ * The directory probes are kept.
  */
-static int do_check_evry (void)
+static void scan_memo_forget (void)
 {
-  DWORD  i, err, num, request_flags, response_flags, version = 0;
-  char   query_buf [_MAX_PATH+8];
-  char  *query = query_buf;
-  char  *dir   = NULL;
-  char  *base  = NULL;
-  int    len, found = 0;
-  HWND   wnd;
-  struct ver_info evry_ver = { 0, 0, 0, 0 };
+  int i, max = scan_memo ? smartlist_len (scan_memo) : 0;
 
-  wnd = FindWindow (EVERYTHING_IPC_WNDCLASS, 0);
-  if (!wnd)
+  for (i = 0; i < max; i++)
   {
-    C_printf ("  Everything search engine not found.\n");
-    return (0);
+    struct scan_memo *sm = smartlist_get (scan_memo, i);
+
+    free_matches (sm->matches);
+    sm->matches = NULL;
+    sm->scanned = FALSE;
   }
+}
 
-  num_evry_dups = 0;
+/**
+ * Return the memo-record for `dir`. Add a new one if not found.
+ * Must be called with `scan_memo_lock` held.
+ */
+static struct scan_memo *scan_memo_get (const char *dir)
+{
+  struct scan_memo *sm;
+  char   key [_MAX_PATH];
+  int    idx, found;
+  size_t len;
 
-  if (evry_bitness == bit_unknown)
-     get_evry_bitness (wnd);
+  slashify2 (key, dir, '\\');
+  len = strlen (key);
+  if (len > 3 && key[len-1] == '\\')
+     key [len-1] = '\0';
 
-  if (get_evry_version(wnd,&evry_ver))
-     version = (evry_ver.val_1 << 16) + (evry_ver.val_2 << 8) + evry_ver.val_3;
+  idx = smartlist_bsearch_idx (scan_memo, key, compare_memo, &found);
+  if (found)
+     return smartlist_get (scan_memo, idx);
 
-  DEBUGF (1, "version %u.%u.%u, build: %u\n",
-          evry_ver.val_1,
-          evry_ver.val_2,
-          evry_ver.val_3,
-          evry_ver.val_4);
+  sm = CALLOC (sizeof(*sm), 1);
+  sm->dir = STRDUP (key);
+  smartlist_insert (scan_memo, idx, sm);
+  return (sm);
+}
 
-  if (opt.evry_raw)
-     query = opt.file_spec;
-  else
+/**
+ * As `dir_probe_list()`, but a directory is probed only once in this run.
+ * Also if it was probed while scanned by `scan_dir_probe()`.
+ *
+ * \retval TRUE if `dir` is known to be empty.
+ */
+static BOOL probe_dir (const char *dir, struct dir_probe *probe)
+{
+  struct scan_memo *sm;
+
+  if (!scan_memo)
   {
-    /* EveryThing seems not to support `\\`. Must split the `opt.file_spec`
-     * into a `dir` and `base` part.
-     */
-    if (strpbrk(opt.file_spec, "/\\"))
-    {
-      dir  = dirname (opt.file_spec);   /* Allocates memory */
-      base = basename (opt.file_spec);
-    }
+    dir_probe_list (dir, probe);
+    return DIR_PROBE_EMPTY (probe);
+  }
 
-    /* With option `-D/--dir`, match only folders.
-     */
-    if (opt.dir_mode && !opt.use_regex)
-    {
-      snprintf (query_buf, sizeof(query_buf), "regex:^%s$ folder:", translate_shell_pattern(opt.file_spec));
-      DEBUGF (2, "Simple directory mode: '%s'\n", query_buf);
-    }
-    else
-    {
-      if (opt.use_regex)
-      {
-        len = snprintf (query_buf, sizeof(query_buf), "regex:%s", opt.file_spec);
-        if (opt.dir_mode)
-           snprintf (query_buf+len, sizeof(query_buf)-len, " folder:");
-      }
-      else if (dir)
-      {
-        /* If user didn't use the `-r/--regex` option, we must convert
-         * `opt.file_spec` into a RegExp compatible format.
-         * E.g. "ez_*.py" -> "^ez_.*\.py$"
-         */
-        len = snprintf (query_buf, sizeof(query_buf), "regex:%s\\\\%s", dir, base);
-      }
-      else
-        len = snprintf (query_buf, sizeof(query_buf), "regex:^%s$", translate_shell_pattern(opt.file_spec));
-    }
+  EnterCriticalSection (&scan_memo_lock);
+  sm = scan_memo_get (dir);
+  if (sm->probed)
+  {
+    *probe = sm->probe;
+    LeaveCriticalSection (&scan_memo_lock);
+    return DIR_PROBE_EMPTY (probe);
+  }
+  LeaveCriticalSection (&scan_memo_lock);
 
-#if 0   /* \todo Query contents with option "--grep" */
-    if (opt.evry_grep && len > 0)
-       snprintf (query_buf+len, sizeof(query_buf)-len, "content: %s", opt.evry_grep);
-#endif
+  dir_probe_list (dir, probe);
 
-    FREE (dir);
+  EnterCriticalSection (&scan_memo_lock);
+  sm = scan_memo_get (dir);
+  if (!sm->probed)
+  {
+    sm->probed = TRUE;
+    sm->probe  = *probe;
   }
+  LeaveCriticalSection (&scan_memo_lock);
+  return DIR_PROBE_EMPTY (probe);
+}
 
-  Everything_SetMatchCase (opt.case_sensitive);
+/**
+ * Scan the directory `path` for matches to the global `opt.file_spec`.
+ * Nothing is printed here (except debug-output). Hence this is safe
+ * to call from a worker-thread.
+ *
+ * If `probe != NULL`, `path` is probed in the same enumeration.
+ * A directory already scanned with the same `scan_memo_flags()` (or probed)
+ * in this run is not enumerated again.
+ *
+ * \retval A smartlist of `struct dir_match` (possibly empty) or NULL
+ *         if `path` could not be scanned. The caller owns this list.
+ */
+static smartlist_t *scan_dir_probe (const char *path, struct dir_probe *probe)
+{
+  struct scan_memo *sm;
+  smartlist_t      *matches;
+  UINT64            start = profile_start();
+  unsigned          flags = scan_memo_flags();
 
-  DEBUGF (1, "Everything_SetSearch (\"%s\").\n"
-             "                 Everything_SetMatchCase (%d).\n",
-             query, opt.case_sensitive);
+  if (!scan_memo)
+  {
+    matches = list_dir_matches (path, probe);
+    profile_item ("dir", path, start);
+    return (matches);
+  }
 
-  request_flags = Everything_GetRequestFlags();
+  EnterCriticalSection (&scan_memo_lock);
+  sm = scan_memo_get (path);
+  if (probe && sm->probed)
+  {
+    *probe = sm->probe;
+    probe  = NULL;
+  }
+  if (sm->scanned && sm->flags == flags)
+  {
+    scan_memo_hits++;
+    matches = copy_matches (sm->matches);
+    LeaveCriticalSection (&scan_memo_lock);
+    DEBUGF (2, "Re-using the matches in \"%s\".\n", path);
+    if (probe)
+       probe_dir (path, probe);
+    return (matches);
+  }
+  scan_memo_misses++;
+  LeaveCriticalSection (&scan_memo_lock);
 
-  /* The request flags: EVERYTHING_REQUEST_SIZE and/or EVERYTHING_REQUEST_DATE_MODIFIED
-   * needs v. 1.4.1 or later.
-   * Ref:
-   *   http://www.voidtools.com/support/everything/sdk/everything_setrequestflags/
-   *
-   * But do not request the file size/time since that could be "old information" when
-   *  files are frequently updated.
+  /* Enumerate without the lock. If another thread does the same
+   * directory meanwhile, the first result is kept.
    */
-#if 0
-  if (version >= 0x010401)
+  matches = list_dir_matches (path, probe);
+  profile_item ("dir", path, start);
+
+  EnterCriticalSection (&scan_memo_lock);
+  sm = scan_memo_get (path);   /* the list could have been changed */
+  if (!sm->scanned)
   {
-    request_flags |= EVERYTHING_REQUEST_SIZE | EVERYTHING_REQUEST_DATE_MODIFIED;
-    Everything_SetRequestFlags (request_flags);
-    request_flags = Everything_GetRequestFlags();  /* should be the same as set above */
+    sm->scanned = TRUE;
+    sm->flags   = flags;
+    sm->matches = copy_matches (matches);
   }
-#endif
+  if (probe && !sm->probed)
+  {
+    sm->probed = TRUE;
+    sm->probe  = *probe;
+  }
+  LeaveCriticalSection (&scan_memo_lock);
+  return (matches);
+}
 
-  Everything_SetSearchA (query);
-  Everything_QueryA (TRUE);
+static smartlist_t *scan_dir (const char *path)
+{
+  return scan_dir_probe (path, NULL);
+}
 
-  err = Everything_GetLastError();
-  DEBUGF (1, "Everything_Query: %s\n", evry_strerror(err));
+/**
+ * Report and free the matches found by `scan_dir()`.
+ */
+static int report_dir_matches (smartlist_t *matches, HKEY key)
+{
+  int i, max, found = 0;
 
-  if (halt_flag > 0)
+  if (!matches)
      return (0);
 
-  if (err == EVERYTHING_ERROR_IPC)
+  max = smartlist_len (matches);
+  for (i = 0; i < max; i++)
   {
-    WARN ("Everything IPC service is not running.\n");
-    return (0);
+    struct dir_match *m = smartlist_get (matches, i);
+
+    if (search_halted())
+       break;
+    report_spec = m->spec;
+    if (report_file(m->file, m->mtime, m->fsize, m->is_dir, m->is_junction, key))
+       found++;
+    report_spec = NULL;
   }
-  if (!evry_IsDBLoaded(wnd))
+  free_matches (matches);
+  return (found);
+}
+
+static void *walk_scan (const char *dir, void *arg)
+{
+  ARGSUSED (arg);
+  return scan_dir (dir);
+}
+
+static int walk_report (const char *dir, void *result, void *arg)
+{
+  ARGSUSED (dir);
+  return report_dir_matches ((smartlist_t*)result, *(HKEY*)arg);
+}
+
+/**
+ * Recursively report matches in `path` and all it's sub-directories.
+ * With `envtool --threads`, the tree is walked by a pool of worker-threads.
+ */
+static int process_dir_tree (const char *path, HKEY key)
+{
+  CRITICAL_SECTION lock;
+  int              found;
+
+  get_scan_spec();   /* initialise it in this thread */
+  if (opt.scan_threads > 1)
   {
-    WARN ("Everything is busy loading it's database.\n");
-    return (0);
+    InitializeCriticalSection (&lock);
+    re_lock = &lock;
   }
 
-  num = Everything_GetNumResults();
-  DEBUGF (1, "Everything_GetNumResults() num: %lu, err: %s\n",
-          (u_long)num, evry_strerror(Everything_GetLastError()));
+  found = dir_walk (path, opt.scan_threads, walk_scan, walk_report, &key);
 
-  if (num == 0)
+  if (opt.scan_threads > 1)
   {
-    if (opt.use_regex)
-         WARN ("Nothing matched your regexp \"%s\".\n"
-               "Are you sure it is correct? Try quoting it.\n",
-               opt.file_spec);
-    else WARN ("Nothing matched your search \"%s\".\n"
-               "Are you sure all NTFS disks are indexed by EveryThing? Try adding folders manually.\n",
-               opt.file_spec);
-    return (0);
+    re_lock = NULL;
+    DeleteCriticalSection (&lock);
   }
+  return (found);
+}
 
-  /* Sort results by path (ignore case).
-   * This will fail if `request_flags` has either `EVERYTHING_REQUEST_SIZE`
-   * or `EVERYTHING_REQUEST_DATE_MODIFIED` since version 2 of the query protocol
-   * is used.
-   * Ref: The comment in Everything.c; "//TODO: sort list2"
+/**
+ * Process directory specified by `path` and report any matches
+ * to the global `opt.file_spec`. If `recursive`, search all
+ * sub-directories too.
+ */
+int process_dir (const char *path, int num_dup, BOOL exist, BOOL check_empty,
+                 BOOL is_dir, BOOL exp_ok, const char *prefix, HKEY key,
+                 BOOL recursive)
+{
+  struct dir_probe probe;
+  smartlist_t     *matches = NULL;
+  BOOL             is_empty = FALSE;
+
+  if (!check_process_dir(path, num_dup, exist, is_dir, exp_ok, prefix))
+     return (0);
+
+  /* Check if it's empty in the same pass as the scan.
    */
-  Everything_SortResultsByPath();
-  err = Everything_GetLastError();
-  if (err != EVERYTHING_OK)
+  check_empty = (check_empty && is_dir);
+  if (recursive)
   {
-    DEBUGF (2, "Everything_SortResultsByPath(), err: %s\n", evry_strerror(err));
-    Everything_SetLastError (EVERYTHING_OK);
+    if (check_empty)
+       is_empty = probe_dir (path, &probe);
+  }
+  else
+  {
+    matches = scan_dir_probe (path, check_empty ? &probe : NULL);
+    is_empty = (check_empty && DIR_PROBE_EMPTY(&probe));
   }
 
-  for (i = 0; i < num; i++)
+  if (is_empty)
+     WARN ("%s: directory \"%s\" is empty.\n", prefix, path);
+
+  if (recursive)
+     return process_dir_tree (path, key);
+  return report_dir_matches (matches, key);
+}
+
+/**
+ * A directory-scan job for a worker-thread in `process_dirs()`.
+ */
+struct scan_job {
+       const struct directory_array *arr;
+       struct dir_probe              probe;      /**< set by `scan_dir_probe()` if `arr->check_empty` */
+       smartlist_t                  *matches;    /**< result of `scan_dir()` */
+       HANDLE                        done;       /**< signalled when the job is finished */
+     };
+
+static void scan_job_run (void *arg)
+{
+  struct scan_job              *job = (struct scan_job*) arg;
+  const struct directory_array *arr = job->arr;
+
+  if (!search_halted() && arr->num_dup == 0 && arr->exp_ok && arr->exist && opt.file_spec)
   {
-    static char prev [_MAX_PATH];
-    char   file [_MAX_PATH];
-    UINT64 fsize = (__int64)-1;  /* since a 0-byte file is valid */
-    time_t mtime = 0;
-    BOOL   is_shadow = FALSE;
+    BOOL check_empty = (arr->check_empty && arr->is_dir);
 
-    if (halt_flag > 0)
-       break;
+    job->matches = scan_dir_probe (arr->dir, check_empty ? &job->probe : NULL);
+  }
+  SetEvent (job->done);
+}
 
-    len = Everything_GetResultFullPathName (i, file, sizeof(file));
-    err = Everything_GetLastError();
-    if (len == 0 || err != EVERYTHING_OK)
-    {
-      DEBUGF (2, "Everything_GetResultFullPathName(), err: %s\n",
-              evry_strerror(err));
-      len = 0;
-      break;
-    }
+/**
+ * Process all directories in the `dirs` smartlist of `struct directory_array`.
+ *
+ * With `envtool --threads`, all directories are scanned concurrently in a
+ * pool of worker-threads. The results are buffered per directory and reported
+ * here in the original order. So the output is the same as in the serial mode.
+ */
+static int process_dirs (vector_t *dirs, const char *prefix, HKEY key, BOOL recursive)
+{
+  CRITICAL_SECTION lock;
+  struct scan_job *jobs;
+  thread_pool     *pool = NULL;
+  int              i, max, found = 0;
 
-    if (cfg_ignore_lookup("[EveryThing]",file))
-    {
-      num_evry_ignored++;
-      continue;
-    }
+  max = dirs ? vector_len (dirs) : 0;
 
-    response_flags = 0;
+  /* A recursive search is parallelised in `process_dir_tree()` instead.
+   */
+  if (opt.scan_threads > 1 && max > 1 && opt.file_spec && !recursive)
+     pool = pool_create (opt.scan_threads);
 
-    if (request_flags & EVERYTHING_REQUEST_DATE_MODIFIED)
+  if (!pool)
+  {
+    for (i = 0; i < max && !search_halted(); i++)
     {
-      FILETIME ft;
+      const struct directory_array *arr = vector_get (dirs, i);
 
-      if (Everything_GetResultDateModified(i,&ft))
-      {
-        response_flags |= EVERYTHING_REQUEST_DATE_MODIFIED;
-        mtime = FILETIME_to_time_t (&ft);
-        DEBUGF (2, "%3lu: Everything_GetResultDateModified(), mtime: %.24s\n",
-                i, mtime ? ctime(&mtime) : "<N/A>");
-      }
-      else
-      {
-        err = Everything_GetLastError();
-        DEBUGF (2, "%3lu: Everything_GetResultDateModified(), err: %s\n",
-                i, evry_strerror(err));
-      }
+      found += process_dir (arr->dir, arr->num_dup, arr->exist, arr->check_empty,
+                            arr->is_dir, arr->exp_ok, prefix, key, recursive);
     }
-    if (request_flags & EVERYTHING_REQUEST_SIZE)
-    {
-      LARGE_INTEGER fs;
+    return (found);
+  }
 
-      if (Everything_GetResultSize(i,&fs))
-      {
-        response_flags |= EVERYTHING_REQUEST_SIZE;
-        fsize = ((UINT64)fs.u.HighPart << 32) + fs.u.LowPart;
-        DEBUGF (2, "%3lu: Everything_GetResultSize(), %s\n",
-                i, get_file_size_str(fsize));
-      }
-      else
-      {
-        err = Everything_GetLastError();
-        DEBUGF (2, "%3lu: Everything_GetResultSize(), err: %s\n",
-                i, evry_strerror(err));
-      }
-    }
+  get_scan_spec();   /* initialise it in this thread */
+  InitializeCriticalSection (&lock);
+  re_lock = &lock;
 
-    if ((response_flags & EVERYTHING_REQUEST_DATE_MODIFIED) == 0 ||
-        (response_flags & EVERYTHING_REQUEST_SIZE) == 0 )
-    {
-      struct stat st;
+  jobs = CALLOC (sizeof(*jobs), max);
+  for (i = 0; i < max; i++)
+  {
+    jobs[i].arr  = vector_get (dirs, i);
+    jobs[i].done = CreateEvent (NULL, TRUE, FALSE, NULL);
+    pool_submit (pool, scan_job_run, jobs + i);
+  }
 
-      if (safe_stat(file, &st, NULL) == 0)
-      {
-        mtime = st.st_mtime;
-        if (opt.show_size)
-           fsize = st.st_size;
-      }
-    }
+  for (i = 0; i < max; i++)
+  {
+    struct scan_job              *job = jobs + i;
+    const struct directory_array *arr = job->arr;
 
-    /* Clear any error so the next Everything_XX() won't
-     * trigger an error.
-     */
-    Everything_SetLastError (EVERYTHING_OK);
+    WaitForSingleObject (job->done, INFINITE);
+    CloseHandle (job->done);
 
-    if (len > 0)
+    if (check_process_dir(arr->dir, arr->num_dup, arr->exist, arr->is_dir, arr->exp_ok, prefix))
     {
-      if (!opt.dir_mode && prev[0] && !strcmp(prev, file))
-         num_evry_dups++;
-      else if (report_evry_file(file, mtime, fsize, &is_shadow))
-         found++;
-      if (!is_shadow)
-         _strlcpy (prev, file, sizeof(prev));
+      if (DIR_PROBE_EMPTY(&job->probe))
+         WARN ("%s: directory \"%s\" is empty.\n", prefix, arr->dir);
     }
+    found += report_dir_matches (job->matches, key);
   }
+
+  pool_destroy (pool);
+  re_lock = NULL;
+  DeleteCriticalSection (&lock);
+  FREE (jobs);
   return (found);
 }
 
 /**
- * The main work-horse of this program.
+ * A directory watched in `--watch` mode and the matches in it.
  */
-static int do_check_env (const char *env_name, BOOL recursive)
+struct watch_entry {
+       const char  *env;       /**< The env-var it came from; `"PATH"` etc. */
+       char        *dir;       /**< The directory as in `struct directory_array` */
+       char        *watched;   /**< `dir` + any sub-dir part of `opt.file_spec` */
+       smartlist_t *names;     /**< Sorted base-names of the current matches */
+     };
+
+static int compare_watch_name (const void *key, const void **member)
 {
-  smartlist_t *list;
-  int          i, max, found = 0;
-  BOOL         check_empty = FALSE;
-  char        *orig_e = getenv_expand (env_name);
+  return stricmp ((const char*)key, (const char*)*member);
+}
 
-  if (!orig_e)
-  {
-    DEBUGF (1, "Env-var %s not defined.\n", env_name);
-    return (0);
-  }
+static int sort_watch_names (const void **_a, const void **_b)
+{
+  return stricmp ((const char*)*_a, (const char*)*_b);
+}
 
-  if (!strcmp(env_name,"PATH") ||
-      !strcmp(env_name,"LIB") ||
-      !strcmp(env_name,"LIBRARY_PATH") ||
-      !strcmp(env_name,"INCLUDE") ||
-      !strcmp(env_name,"C_INCLUDE_PATH") ||
-      !strcmp(env_name,"CPLUS_INCLUDE_PATH"))
-    check_empty = TRUE;
+static void watch_report (const struct watch_entry *we, const char *what, const char *name)
+{
+  char file [_MAX_PATH];
+
+  snprintf (file, sizeof(file), "%s%c%s", we->watched, DIR_SEP, name);
+  slashify2 (file, file, opt.show_unix_paths ? '/' : '\\');
+  C_printf ("%s: ~3%%%s~0 ~2%-8s~0", get_time_str(time(NULL)), we->env, what);
+  print_raw (file, NULL, NULL);
+  C_putc ('\n');
+}
+
+/**
+ * Set the names of the matches in `we` from a `scan_dir()` result.
+ * If `report`, print what was added or removed since the last time.
+ */
+static void watch_set_names (struct watch_entry *we, smartlist_t *matches, BOOL report)
+{
+  smartlist_t *names = smartlist_new();
+  int          i, max = matches ? smartlist_len (matches) : 0;
 
-  list = split_env_var (env_name, orig_e);
-  max  = smartlist_len (list);
   for (i = 0; i < max; i++)
   {
-    struct directory_array *arr = smartlist_get (list, i);
+    const struct dir_match *m = smartlist_get (matches, i);
 
-    if (check_empty && arr->exist)
-       arr->check_empty = check_empty;
-    found += process_dir (arr->dir, arr->num_dup, arr->exist, arr->check_empty,
-                          arr->is_dir, arr->exp_ok, env_name, NULL,
-                          recursive);
+    smartlist_add (names, STRDUP(basename(m->file)));
   }
-  free_dir_array();
-  FREE (orig_e);
-  return (found);
+  smartlist_sort (names, sort_watch_names);
+  free_matches (matches);
+
+  if (report && we->names)
+  {
+    max = smartlist_len (we->names);
+    for (i = 0; i < max; i++)
+    {
+      const char *name = smartlist_get (we->names, i);
+
+      if (!smartlist_bsearch(names, name, compare_watch_name))
+         watch_report (we, "removed", name);
+    }
+    max = smartlist_len (names);
+    for (i = 0; i < max; i++)
+    {
+      const char *name = smartlist_get (names, i);
+
+      if (!smartlist_bsearch(we->names, name, compare_watch_name))
+         watch_report (we, "added", name);
+    }
+  }
+  smartlist_free_all (we->names);
+  we->names = names;
 }
 
 /**
- * Check a single MANPAGE directory for man-page match(es).
+ * Check if the file `name` in a watched directory is a match.
+ * Like `list_dir_matches()` does for each entry, but for one file only.
  */
-static int check_man_dir (const char *dir, const char *env_name)
+static BOOL watch_match (const struct watch_entry *we, const char *name)
 {
-  const char *_dir;
+  const struct scan_spec   *ss = get_scan_spec();
+  struct dirscan_entry      de;
+  struct dir_match         *m;
+  WIN32_FILE_ATTRIBUTE_DATA fa;
+  char   file [_MAX_PATH];
 
-  if (!strcmp(dir,"\\"))
-       _dir = current_dir;
-  else _dir = dir;
+  if (!spec_match(ss, name))
+     return (FALSE);
 
-  DEBUGF (1, "Looking for \"%s\" in \"%s\".\n", opt.file_spec, _dir);
-  return process_dir (dir, 0, TRUE, TRUE, 1, TRUE, env_name, HKEY_MAN_FILE, FALSE);
+  snprintf (file, sizeof(file), "%s%c%s", we->watched, DIR_SEP, name);
+  if (!GetFileAttributesEx(file, GetFileExInfoStandard, &fa))
+     return (FALSE);
+
+  memset (&de, '\0', sizeof(de));
+  de.name        = name;
+  de.valid       = DS_HAVE_ALL;
+  de.attrib      = fa.dwFileAttributes;
+  de.is_dir      = (fa.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+  de.is_junction = (fa.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+  de.fsize       = ((UINT64)fa.nFileSizeHigh << 32) + fa.nFileSizeLow;
+  de.mtime       = FILETIME_to_time_t (&fa.ftLastWriteTime);
+
+  m = scan_match (we->dir, ss, &de);
+  if (!m)
+     return (FALSE);
+  FREE (m->file);
+  FREE (m);
+  return (TRUE);
 }
 
 /**
- * The `MANPATH` checking needs to be recursive (1 level); check all
- * `man*` and `cat*` directories under each directory in `%MANPATH`.
- *
- * If `".\\"` (or `"./"`) is in `%MANPATH`, test for existence in `current_dir`
- * first.
+ * The `watch_wait()` callback. Only the changed name is matched again.
+ * If the events overflowed, the directory is listed again. So it is if
+ * it can no longer be watched; e.g. it was deleted.
  */
-static int do_check_manpath (void)
+static void watch_changed (const struct watch_event *ev, void *arg)
 {
-  struct directory_array *arr;
-  smartlist_t *list;
-  int    i, j, max, found = 0;
-  char  *orig_e;
-  char   report [300];
-  BOOL   save1, save2, done_cwd = FALSE;
-  static const char env_name[] = "MANPATH";
+  struct watch_entry *we = smartlist_get ((smartlist_t*)arg, ev->dir);
+  BOOL   match;
+  int    idx, found;
 
-  /* \todo
-   *   This should be all directories matching "man?[pn]" or "cat?[pn]".
-   *   Make this array into a smartlist too?
-   */
-  static const char *sub_dirs[] = { "cat1", "cat2", "cat3", "cat4", "cat5",
-                                    "cat6", "cat7", "cat8", "cat9",
-                                    "man1", "man2", "man3", "man4", "man5",
-                                    "man6", "man7", "man8", "man9", "mann"
-                                  };
+  if (ev->action == WATCH_OVERFLOW)
+  {
+    DEBUGF (1, "Events lost for \"%s\"; listing it again.\n", we->watched);
+    watch_set_names (we, list_dir_matches(we->dir, NULL), TRUE);
+    return;
+  }
+  if (ev->action == WATCH_STOPPED)
+  {
+    WARN ("%%%s: cannot watch \"%s\" any more.\n", we->env, we->watched);
+    watch_set_names (we, list_dir_matches(we->dir, NULL), TRUE);
+    return;
+  }
 
-  /* Do not implicit add current directory in searches.
-   * Unless `%MANPATH` contain a "./;" or a ".\;".
-   */
-  save1 = opt.no_cwd;
-  opt.no_cwd = 1;
+  idx   = smartlist_bsearch_idx (we->names, ev->name, compare_watch_name, &found);
+  match = (ev->action != WATCH_REMOVED && watch_match(we, ev->name));
 
-  orig_e = getenv_expand (env_name);
-  list   = orig_e ? split_env_var (env_name, orig_e) : NULL;
-  if (!list)
+  if (match && !found)
   {
-    WARN ("Env-var %s not defined.\n", env_name);
-    opt.no_cwd = save1;
-    return (0);
+    smartlist_insert (we->names, idx, STRDUP(ev->name));
+    watch_report (we, "added", ev->name);
   }
-
-  snprintf (report, sizeof(report), "Matches in %%%s:\n", env_name);
-  report_header = report;
-
-  /* Man-files should have an extension. Hence do not report dotless files as a
-   * match in process_dir().
-   */
-  save2 = opt.man_mode;
-  opt.man_mode = 1;
-
-  max = smartlist_len (list);
-  for (i = 0; i < max; i++)
+  else if (!match && found)
   {
-    arr = smartlist_get (list, i);
-    if (!arr->exist)
-    {
-      WARN ("%s: directory \"%s\" doesn't exist.\n", env_name, arr->dir);
-      continue;
-    }
-
-    /* If `%MANPATH` contains a `./`, check in current-dir.
-     * If the path contains multiple `./`, do this only once (with a warning).
-     * Also if current-dir contains `man*` sub-directories, check them too in the
-     * below for-loop.
-     */
-    if (arr->is_cwd)
-    {
-      if (done_cwd)
-           WARN ("%s: Contains multiple \"%s\".\n", env_name, ".\\");
-      else found += check_man_dir (".\\", env_name);
-      done_cwd = TRUE;
-    }
+    char *name = smartlist_get (we->names, idx);
 
-    for (j = 0; j < 1+DIM(sub_dirs); j++)
-    {
-      char dir [_MAX_PATH];
-
-      if (j == 0)
-           _strlcpy (dir, arr->dir, sizeof(dir));
-      else snprintf (dir, sizeof(dir), "%s%c%s", arr->dir, DIR_SEP, sub_dirs[j-1]);
-      if (FILE_EXISTS(dir))
-         found += check_man_dir (dir, env_name);
-    }
+    watch_report (we, "removed", ev->name);
+    smartlist_del_keeporder (we->names, idx);
+    FREE (name);
   }
-
-  opt.no_cwd   = save1;
-  opt.man_mode = save2;
-  free_dir_array();
-  FREE (orig_e);
-  return (found);
 }
 
 /**
- * Find the version and location `pkg-config.exe` (on `PATH`).
+ * Handle the `--watch` option.
+ *
+ * Keep the directories of `%PATH%`, `%LIB%` and/or `%INCLUDE%` (as
+ * given by `--path`, `--lib` and `--inc`) and the matches in them.
+ * Then wait for changes to them until `^C` is pressed. Each added or
+ * removed match is printed. A directory in several env-vars is watched once.
+ *
+ * \retval The number of directories watched.
  */
-static int pkg_config_major, pkg_config_minor;
-
-static int find_pkg_config_version_cb (char *buf, int index)
-{
-  ARGSUSED (index);
-  if (sscanf (buf, "%d.%d", &pkg_config_major, &pkg_config_minor) == 2)
-     return (1);
-  return (0);
-}
-
-static int get_pkg_config_info (char **exe_p, struct ver_info *ver)
+static int do_watch (void)
 {
-  char  exe_copy [_MAX_PATH];
-  char *exe;
+  const char  *envs [3];
+  dir_watch   *w;
+  dir_set     *seen;
+  smartlist_t *entries;
+  int          i, j, max, num_envs = 0;
 
-  *exe_p = NULL;
-  pkg_config_major = pkg_config_minor = -1;
-  exe = searchpath ("pkg-config.exe", "PATH");
-  if (exe == NULL)
-     return (0);
+  if (opt.do_path)
+     envs [num_envs++] = "PATH";
+  if (opt.do_lib)
+     envs [num_envs++] = "LIB";
+  if (opt.do_include)
+     envs [num_envs++] = "INCLUDE";
 
-  slashify2 (exe_copy, exe, '\\');
+  if (num_envs == 0 || !opt.file_spec)
+  {
+    WARN ("\"--watch\" needs a file-spec and \"--path\", \"--lib\" or \"--inc\".\n");
+    return (0);
+  }
 
-  if (popen_runf(find_pkg_config_version_cb, "\"%s\" --version", exe_copy) > 0)
+  w = watch_new();
+  if (!w)
   {
-    ver->val_1 = pkg_config_major;
-    ver->val_2 = pkg_config_minor;
-    *exe_p = STRDUP (exe);
-    return (1);
+    WARN ("Failed to create a directory watch; %s.\n", win_strerror(GetLastError()));
+    return (0);
   }
-  return (0);
-}
 
-/**
- * Find the version and location `vcpkg.exe` (on `PATH`).
- */
-static int vcpkg_major, vcpkg_minor, vcpkg_micro;
+  get_scan_spec();
+  seen    = dir_set_new (!opt.case_sensitive);
+  entries = smartlist_new();
 
-static int find_vcpkg_version_cb (char *buf, int index)
-{
-  ARGSUSED (index);
-  if (sscanf(buf, "Vcpkg package management program version %d.%d.%d", &vcpkg_major, &vcpkg_minor, &vcpkg_micro) >= 2)
-     return (1);
-  return (0);
-}
+  for (i = 0; i < num_envs; i++)
+  {
+    char        *value = getenv_expand (envs[i]);
+    vector_t    *list  = split_env_var (envs[i], value);
 
-static int get_vcpkg_info (char **exe_p, struct ver_info *ver)
-{
-  char  exe_copy [_MAX_PATH];
-  char *exe;
+    max = list ? vector_len (list) : 0;
+    for (j = 0; j < max; j++)
+    {
+      const struct directory_array *arr = vector_get (list, j);
+      struct watch_entry           *we;
+      char   watched [_MAX_PATH];
 
-  *exe_p = NULL;
-  vcpkg_major = vcpkg_minor = vcpkg_micro = -1;
-  exe = searchpath ("vcpkg.exe", "PATH");
-  if (exe == NULL)
-     return (0);
+      if (arr->num_dup > 0 || !arr->exp_ok || !arr->exist || !arr->is_dir ||
+          dir_set_add(seen, arr->dir) > 0)
+         continue;
 
-  slashify2 (exe_copy, exe, '\\');
+      if (scan_spec.subdir)
+           snprintf (watched, sizeof(watched), "%s%c%s", arr->dir, DIR_SEP, scan_spec.subdir);
+      else _strlcpy (watched, arr->dir, sizeof(watched));
 
-  if (popen_runf(find_vcpkg_version_cb, "\"%s\" version", exe_copy) > 0)
-  {
-    ver->val_1 = vcpkg_major;
-    ver->val_2 = vcpkg_minor;
-    ver->val_3 = vcpkg_micro;
-    *exe_p = STRDUP (exe);
-    return (1);
+      if (watch_add(w, watched) < 0)
+      {
+        WARN ("%%%s: cannot watch \"%s\".\n", envs[i], watched);
+        continue;
+      }
+      we = CALLOC (1, sizeof(*we));
+      we->env     = envs[i];
+      we->dir     = STRDUP (arr->dir);
+      we->watched = STRDUP (watched);
+      watch_set_names (we, scan_dir(arr->dir), FALSE);
+      smartlist_add (entries, we);
+    }
+    free_dir_array();
+    FREE (value);
   }
-  return (0);
-}
 
-/**
- * Search and check along `%PKG_CONFIG_PATH%` for a
- * matching `<filespec>.pc` file.
- */
-static int do_check_pkg (void)
-{
-  smartlist_t *list;
-  int          i, max, num, prev_num = 0, found = 0;
-  BOOL         do_warn = FALSE;
-  char        *orig_e;
-  char         report [300];
-  static const char env_name[] = "PKG_CONFIG_PATH";
+  max = smartlist_len (entries);
+  C_printf ("~3Watching %d directories for \"%s\". Press ^C to stop.~0\n", max, opt.file_spec);
+  C_flush();
 
-  orig_e = getenv_expand (env_name);
-  list = orig_e ? split_env_var (env_name, orig_e) : NULL;
-  if (!list)
+  while (max > 0 && !halt_flag)
   {
-    WARN ("Env-var %s not defined.\n", env_name);
-    return (0);
+    if (watch_wait(w, 500, watch_changed, entries) < 0)
+    {
+      WARN ("Waiting for changes failed; %s. Stopped watching.\n", win_strerror(GetLastError()));
+      break;
+    }
+    C_flush();
   }
 
-  snprintf (report, sizeof(report), "Matches in %%%s:\n", env_name);
-  report_header = report;
-
-  max = smartlist_len (list);
+  watch_free (w);
   for (i = 0; i < max; i++)
   {
-    const struct directory_array *arr = smartlist_get (list, i);
-
-    DEBUGF (2, "Checking in dir '%s'\n", arr->dir);
-    num = process_dir (arr->dir, 0, arr->exist, TRUE, arr->is_dir, arr->exp_ok,
-                       env_name, HKEY_PKGCONFIG_FILE, FALSE);
+    struct watch_entry *we = smartlist_get (entries, i);
 
-    if (arr->num_dup == 0 && prev_num > 0 && num > 0)
-       do_warn = TRUE;
-    if (prev_num == 0 && num > 0)
-       prev_num = num;
-    found += num;
+    smartlist_free_all (we->names);
+    FREE (we->dir);
+    FREE (we->watched);
+    FREE (we);
   }
+  smartlist_free (entries);
+  dir_set_free (seen);
+  return (max);
+}
 
-  free_dir_array();
-  FREE (orig_e);
+static const char *evry_strerror (DWORD err)
+{
+  static char buf[30];
 
-  if (do_warn && !opt.quiet)
+  switch (err)
   {
-    WARN ("Note: ");
-    C_printf ("~6There seems to be several '%s' files in different %%%s directories.\n"
-              "      \"pkgconfig\" will only select the first.~0\n", opt.file_spec, env_name);
+    case EVERYTHING_OK:
+         return ("No error");
+    case EVERYTHING_ERROR_MEMORY:
+         return ("Memory error");
+    case EVERYTHING_ERROR_IPC:
+         return ("IPC error");
+    case EVERYTHING_ERROR_REGISTERCLASSEX:
+         return ("Error in RegisterClassEx()");
+    case EVERYTHING_ERROR_CREATEWINDOW:
+         return ("Error in CreateWindow()");
+    case EVERYTHING_ERROR_CREATETHREAD:
+         return ("Error in CreateThread()");
+    case EVERYTHING_ERROR_INVALIDINDEX:
+         return ("Invalid index given");
+    case EVERYTHING_ERROR_INVALIDCALL:
+         return ("Invalid call");
+    case EVERYTHING_ERROR_INVALIDREQUEST:
+         return ("Invalid request data");
+    case EVERYTHING_ERROR_INVALIDPARAMETER:
+         return ("Bad parameter");
   }
-  return (found);
+  snprintf (buf, sizeof(buf), "Unknown error %lu", (u_long)err);
+  return (buf);
 }
 
-/**
- * Search for VCPKG packages matching the `opt.file_spec`.
- * Also show if a package matching `opt.file_spec` is installed.
- */
-static int do_check_vcpkg (void)
+static void check_sys_dir (const char *dir, const char *name, BOOL *have_it)
 {
-  unsigned num;
+  DWORD attr = GetFileAttributes (dir);
+  BOOL  is_dir = (attr != INVALID_FILE_ATTRIBUTES) &&
+                 (attr & FILE_ATTRIBUTE_DIRECTORY);
 
-  vcpkg_get_list();
-  num = vcpkg_get_num_CONTROLS();
-  if (num >= 1)
-     return (int) vcpkg_dump_control (opt.file_spec);
+  if (is_dir)
+       DEBUGF (1, "%s: '%s' okay\n", name, dir);
+  else DEBUGF (1, "%s: '%s', GetLastError(): %lu\n", name, dir, (unsigned long)GetLastError());
 
-  if (!opt.quiet)
-     C_printf ("%s.\n", vcpkg_last_error());
-  return (0);
+  if (have_it)
+     *have_it = is_dir;
+}
+
+static void check_sys_dirs (void)
+{
+  check_sys_dir (sys_dir, "sys_dir", NULL);
+#if (IS_WIN64 == 0)
+  check_sys_dir (sys_native_dir, "sys_native_dir", &have_sys_native_dir);
+  check_sys_dir (sys_wow64_dir, "sys_wow64_dir", &have_sys_wow64_dir);
+#else
+  ARGSUSED (have_sys_wow64_dir);
+#endif
 }
 
 /**
- * Before checking the `CMAKE_MODULE_PATH`, we need to find the version and location
- * of `cmake.exe` (on `PATH`). Then assume it's built-in Module-path is relative to this.
- * E.g:
- * \code
- *   cmake.exe     -> f:\MinGW32\bin\CMake\bin\cmake.exe.
- *   built-in path -> f:\MinGW32\bin\CMake\share\cmake-X.Y\Modules
- * \endcode
+ * Figure out if `file` can have a shadow in `%WinDir%\sysnative`.
+ * Makes no sense on Win64.
  */
-static int cmake_major, cmake_minor, cmake_micro;
-
-static int find_cmake_version_cb (char *buf, int index)
+static const char *get_sysnative_file (const char *file, struct stat *st)
 {
-  static char prefix[] = "cmake version ";
-
-  if (!strncmp(buf,prefix,sizeof(prefix)-1) && strlen(buf) >= sizeof(prefix))
+#if (IS_WIN64 == 0)
+  if (!str_equal_n(sys_dir,file,strlen(sys_dir)) && sys_native_dir[0])
   {
-    char *p = buf + sizeof(prefix) - 1;
+    static char shadow [_MAX_PATH];
 
-    sscanf (p, "%d.%d.%d", &cmake_major, &cmake_minor, &cmake_micro);
-    return (1);
+    snprintf (shadow, sizeof(shadow), "%s\\%s", sys_native_dir, file+strlen(sys_dir)+1);
+    safe_stat (shadow, st, NULL);
+    return (shadow);
   }
-  ARGSUSED (index);
-  return (0);
+#else
+  ARGSUSED (st);
+#endif
+  return (file);
 }
 
-static int get_cmake_info (char **exe_p, struct ver_info *ver)
+/**
+ * \todo
+ * \parblock
+ *   If the result returns a file on a remote disk (X:) and the
+ *   remote computer is down, EveryThing will return the
+ *   the entry in it's database. But then the stat() below <br>
+ *   will fail after a long SMB timeout (SessTimeOut, default 60 sec).
+ *
+ *   Try to detect this if `file[0:1]` is `X:` prior to calling
+ *   `stat()`. Use:
+ *     `GetFileAttributes(file)` and test if `GetLastError()`
+ *     returns `ERROR_BAD_NETPATH` ??
+ *
+ *  Or simply exclude the remote disk `X:` in the query.
+ *  \eg
+ *   ```
+ *    C:\> envtool --evry foxitre*.exe
+ *   ```
+ *  should query for:
+ *   ```
+ *    ^[^X]:\\.*foxitre.*\.exe$
+ *   ```
+ *
+ * But then we need a-priori knowledge that `X:` is remote. Like
+ *  `C:\> net use` does:
+ *  \code
+ *   Status       Local     External                  Network
+ *   -------------------------------------------------------------------------------
+ *   Disconnected X:        \\DONALD\X-PARTITION      Microsoft Windows Network
+ *   ^^
+ *   \endcode
+ *  where to get this state?
+ *
+ * \endparblock
+ */
+static int report_evry_file (const char *file, time_t mtime, UINT64 fsize, BOOL *is_shadow)
 {
-  char  exe_copy [_MAX_PATH];
-  char *exe;
-
-  *exe_p = NULL;
-  cmake_major = cmake_minor = cmake_micro = -1;
-
-  exe = searchpath ("cmake.exe", "PATH");
-  if (exe == NULL)
-     return (0);
-
-  slashify2 (exe_copy, exe, '\\');
-
-  if (popen_runf(find_cmake_version_cb, "\"%s\" -version", exe_copy) > 0)
-  {
-    ver->val_1 = cmake_major;
-    ver->val_2 = cmake_minor;
-    ver->val_3 = cmake_micro;
-    ver->val_4 = 0;
-    *exe_p = STRDUP (exe);
-    return (1);
-  }
-  return (0);
-}
+  struct stat st;
+  BOOL        is_dir = FALSE;
+  const char *file2;
+  DWORD       attr;
 
-static int do_check_cmake (void)
-{
-  const char *cmake_bin = searchpath ("cmake.exe", "PATH");
-  const char *env_name = "CMAKE_MODULE_PATH";
-  int         found = 0;
-  BOOL        check_env = TRUE;
-  char        report [_MAX_PATH+50];
+  memset (&st, '\0', sizeof(st));
+  *is_shadow = FALSE;
 
-  cmake_major = cmake_minor = cmake_micro = -1;
+  /* Do not use the slower `safe_stat()` unless needed.
+   * See below.
+   */
+  attr = GetFileAttributes (file);
+  if (attr != INVALID_FILE_ATTRIBUTES)
+     is_dir = (attr & FILE_ATTRIBUTE_DIRECTORY);
 
-  if (!getenv(env_name))
+  else if (attr == INVALID_FILE_ATTRIBUTES)
   {
-    WARN ("Env-var %s not defined.\n", env_name);
-    check_env = FALSE;
+    file2 = get_sysnative_file (file, &st);
+    if (file2 != file)
+    {
+      DEBUGF (1, "shadow: '%s' -> '%s'\n", file, file2);
+      *is_shadow = TRUE;
+    }
+    file = file2;
   }
 
-  if (cmake_bin)
+  if (st.st_mtime == 0)
   {
-    char *cmake_root = dirname (cmake_bin);
-    char  cmake_copy [_MAX_PATH];
-
-    DEBUGF (3, "cmake -> '%s', cmake_root: '%s'\n", cmake_bin, cmake_root);
-    slashify2 (cmake_copy, cmake_bin, '\\');
-
-    if (popen_runf(find_cmake_version_cb, "\"%s\" -version", cmake_copy) > 0)
+    /* If EveryThing older than 1.4.1 was used, these are not set.
+     */
+    if (mtime == 0)
     {
-      char dir [_MAX_PATH];
-
-      snprintf (dir, sizeof(dir), "%s\\..\\share\\cmake-%d.%d\\Modules",
-                cmake_root, cmake_major, cmake_minor);
-      _fix_path (dir, dir);
-
-      DEBUGF (1, "found Cmake version %d.%d.%d. Module-dir -> '%s'\n",
-              cmake_major, cmake_minor, cmake_micro, dir);
-
-      report_header = "Matches among built-in Cmake modules:\n";
-      found = process_dir (dir, 0, TRUE, TRUE, 1, TRUE, env_name, NULL, FALSE);
+      safe_stat (file, &st, NULL);
+      mtime = st.st_mtime;
+    }
+    if (fsize == (__int64)-1)
+    {
+      safe_stat (file, &st, NULL);
+      fsize = st.st_size;
     }
-    else
-      WARN ("Calling '%s' failed.\n", cmake_bin);
-
-    FREE (cmake_root);
-  }
-  else
-  {
-    WARN ("cmake.exe not found on PATH.\n");
-    if (check_env)
-       WARN (" Checking %%%s anyway.\n", env_name);
   }
 
-  if (check_env)
-  {
-    snprintf (report, sizeof(report), "Matches in %%%s:\n", env_name);
-    report_header = report;
-    found += do_check_env ("CMAKE_MODULE_PATH", TRUE);
-  }
-  report_header = NULL;
-  return (found);
+  return report_file (file, mtime, is_dir ? (__int64)-1 : fsize,
+                      is_dir, FALSE, HKEY_EVERYTHING);
 }
 
 /**
- * Handling of GNU-compilers (`*gcc.exe`, `*g++.exe`), MSVC,
- * clang-cl, Borland and Watcom.
- *
- * \enum compiler_type
- */
-typedef enum compiler_type {
-             CC_UNKNOWN = 0, /**< Unknown compiler (not initialised value) */
-             CC_GNU_GCC,     /**< Some sort of (prefixed) `*gcc.exe`. */
-             CC_GNU_GPP,     /**< Some sort of (prefixed) `*g++.exe`. */
-             CC_MSVC,        /**< A MSVC compiler */
-             CC_CLANG_CL,    /**< A clang/clang-cl compiler */
-             CC_BORLAND,     /**< A Borland / Embarcadero compiler */
-             CC_WATCOM       /**< A Watcom/OpenWatcom compiler */
-           } compiler_type;
-
-/** \struct compiler_info
- */
-typedef struct compiler_info {
-        char          *short_name;  /**< the short name we're looking for on `%PATH` */
-        char          *full_name;   /**< the full name if found `%PATH` */
-        compiler_type  type;        /**< what type is it? */
-        BOOL           ignore;      /**< shall we ignore it? */
-        BOOL           no_prefix;   /**< shall we check gnu prefixed gcc/g++? */
-      } compiler_info;
-
-/**
- * The information for all added compilers is in this list;
- * an array of `compiler_info` created by `search_and_add_all_cc()`.
- */
-static smartlist_t *all_cc = NULL;
-
-static size_t longest_cc        = 0;
-static BOOL   ignore_all_gcc    = FALSE;
-static BOOL   ignore_all_gpp    = FALSE;
-static BOOL   looks_like_cygwin = FALSE;
-static BOOL   found_search_line = FALSE;
-static char  *cygwin_root       = NULL;
-static char   cygwin_fqfn [_MAX_PATH];
-static char  *watcom_dir[4];
-
-/**
- * Free the memory allocated by `search_and_add_all_cc()`.
+ * Check if EveryThing database is loaded and not busy indexing itself.
  */
-static void free_all_compilers (void)
+static BOOL evry_IsDBLoaded (HWND wnd)
 {
-  int i, max = all_cc ? smartlist_len (all_cc) : 0;
+  int loaded = 0;
+  int busy = 0;
 
-  for (i = 0; i < max; i++)
+  if (wnd)
   {
-    compiler_info *cc = smartlist_get (all_cc, i);
-
-    FREE (cc->short_name);
-    FREE (cc->full_name);
-    FREE (cc);
+    loaded = (int) SendMessage (wnd, WM_USER, EVERYTHING_IPC_IS_DB_LOADED, 0);
+    busy   = (int) SendMessage (wnd, WM_USER, EVERYTHING_IPC_IS_DB_BUSY, 0);
   }
-  smartlist_free (all_cc);
+  DEBUGF (1, "wnd: %p, loaded: %d, busy: %d.\n", wnd, loaded, busy);
+  return (loaded && !busy);
 }
 
 /**
- * Check if we shall ignore this compiler.
- *
- * + if `cc->full_name` is non-NULL (i.e. found), check the ignore-list for that.
- * + if `cc->full_name` is NULL, check the ignore-list for the `cc->short_name`.
- *
- * \eg if the config-file contains a `"ignore = i386-mingw32-gcc.exe"`, and
- *     `"i386-mingw32-gcc.exe"` is not found, don't try to spawn it (since it
- *     will fail).
- *
- * \param[in] cc the the `compiler_info` to check.
+ * The handler for option `--evry`. Search the EveryThing database.
  */
-static void compiler_check_ignore (compiler_info *cc)
+static int do_check_evry (void)
 {
-  BOOL ignore = FALSE;
+  DWORD  i, err, num, request_flags, response_flags;
+  char   query_buf [_MAX_PATH+8];
+  char  *query = query_buf;
+  char  *dir   = NULL;
+  char  *base  = NULL;
+  int    len, found = 0;
+  UINT64 start;
+  static HWND  wnd = NULL;
+  static DWORD version = 0;
 
-  /* "envtool --no-prefix .." given and this `cc->short_name` is
-   * a prefixed `*-gcc.exe` or `*-g++.exe`.
+  /* Find the EveryThing window and it's version only once.
+   * In `--batch` mode, this is re-used for all queries.
    */
-  if (cc->no_prefix)
-     ignore = TRUE;
+  if (!wnd || !IsWindow(wnd))
+  {
+    struct ver_info evry_ver = { 0, 0, 0, 0 };
 
-  /* "envtool --no-gcc .." given and this `cc->type == CC_GNU_GCC`.
-   */
-  else if (cc->type == CC_GNU_GCC && opt.no_gcc)
-     ignore = TRUE;
+    wnd = FindWindow (EVERYTHING_IPC_WNDCLASS, 0);
+    if (!wnd)
+    {
+      C_printf ("  Everything search engine not found.\n");
+      return (0);
+    }
 
-  /* "envtool --no-g++ .." given and this `cc->type == CC_GNU_GPP`.
-   */
-  else if (cc->type == CC_GNU_GPP && opt.no_gpp)
-     ignore = TRUE;
+    if (evry_bitness == bit_unknown)
+       get_evry_bitness (wnd);
 
-  /* "envtool --no-watcom .." given and this `cc->type == CC_WATCOM`.
-   */
-  else if (cc->type == CC_WATCOM && opt.no_watcom)
-     ignore = TRUE;
+    if (get_evry_version(wnd,&evry_ver))
+       version = (evry_ver.val_1 << 16) + (evry_ver.val_2 << 8) + evry_ver.val_3;
 
-  /* "envtool --no-borland .." given and this `cc->type == CC_BORLAND`.
-   */
-  else if (cc->type == CC_BORLAND && opt.no_borland)
-     ignore = TRUE;
+    DEBUGF (1, "version %u.%u.%u, build: %u\n",
+            evry_ver.val_1,
+            evry_ver.val_2,
+            evry_ver.val_3,
+            evry_ver.val_4);
+  }
 
-  /* "envtool --no-clang .." given and this `cc->type == CC_CLANG_CL`.
-   */
-  else if (cc->type == CC_CLANG_CL && opt.no_clang)
-     ignore = TRUE;
+  num_evry_dups = 0;
 
-  else if (cc->full_name)
-    ignore = cfg_ignore_lookup ("[Compiler]", cc->full_name);
+  if (opt.evry_raw)
+     query = opt.file_spec;
+  else
+  {
+    /* EveryThing seems not to support `\\`. Must split the `opt.file_spec`
+     * into a `dir` and `base` part.
+     */
+    if (strpbrk(opt.file_spec, "/\\"))
+    {
+      dir  = dirname (opt.file_spec);   /* Allocates memory */
+      base = basename (opt.file_spec);
+    }
 
-  /* Last chance to check ignore.
-   */
-  if (!ignore)
-     ignore = cfg_ignore_lookup ("[Compiler]", cc->short_name);
+    /* With option `-D/--dir`, match only folders.
+     */
+    if (opt.dir_mode && !opt.use_regex)
+    {
+      snprintf (query_buf, sizeof(query_buf), "regex:^%s$ folder:", translate_shell_pattern(opt.file_spec));
+      DEBUGF (2, "Simple directory mode: '%s'\n", query_buf);
+    }
+    else
+    {
+      if (opt.use_regex)
+      {
+        len = snprintf (query_buf, sizeof(query_buf), "regex:%s", opt.file_spec);
+        if (opt.dir_mode)
+           snprintf (query_buf+len, sizeof(query_buf)-len, " folder:");
+      }
+      else if (dir)
+      {
+        /* If user didn't use the `-r/--regex` option, we must convert
+         * `opt.file_spec` into a RegExp compatible format.
+         * E.g. "ez_*.py" -> "^ez_.*\.py$"
+         */
+        len = snprintf (query_buf, sizeof(query_buf), "regex:%s\\\\%s", dir, base);
+      }
+      else
+        len = snprintf (query_buf, sizeof(query_buf), "regex:^%s$", translate_shell_pattern(opt.file_spec));
+    }
 
-  DEBUGF (1, "Checking %s (%s), ignore: %d.\n",
-          cc->short_name, cc->full_name ? cc->full_name : "<not found>", ignore);
+#if 0   /* \todo Query contents with option "--grep" */
+    if (opt.evry_grep && len > 0)
+       snprintf (query_buf+len, sizeof(query_buf)-len, "content: %s", opt.evry_grep);
+#endif
 
-  cc->ignore = ignore;
-}
+    FREE (dir);
+  }
 
-/**
- * Having several gcc compilers installed makes it nearly impossible to
- * set `C_INCLUDE_PATH` to the desired compiler's include-dir. So Envtool
- * simply asks `*gcc.exe` for what it think is the include search-path.
- * Do that by spawning the `*gcc.exe` and parsing the include paths.
- *
- * Same goes for the `LIBRARY_PATH`.
- */
-static void check_if_cygwin (const char *path)
-{
-  static const char cyg_usr[] = "/usr/";
-  static const char cyg_drv[] = "/cygdrive/";
+  Everything_SetMatchCase (opt.case_sensitive);
 
-  if (looks_like_cygwin)
-     return;
+  DEBUGF (1, "Everything_SetSearch (\"%s\").\n"
+             "                 Everything_SetMatchCase (%d).\n",
+             query, opt.case_sensitive);
 
-  if (!memcmp(path,&cyg_usr,sizeof(cyg_usr)-1) || !memcmp(path,&cyg_drv,sizeof(cyg_drv)-1))
+  request_flags = Everything_GetRequestFlags();
+
+  /* The request flags: EVERYTHING_REQUEST_SIZE and/or EVERYTHING_REQUEST_DATE_MODIFIED
+   * needs v. 1.4.1 or later.
+   * Ref:
+   *   http://www.voidtools.com/support/everything/sdk/everything_setrequestflags/
+   *
+   * But do not request the file size/time since that could be "old information" when
+   *  files are frequently updated.
+   */
+#if 0
+  if (version >= 0x010401)
   {
-    looks_like_cygwin = TRUE;
-//  opt.conv_cygdrive = 1;
-    DEBUGF (2, "looks_like_cygwin = %d, cygwin_root: '%s'\n", looks_like_cygwin, cygwin_root);
+    request_flags |= EVERYTHING_REQUEST_SIZE | EVERYTHING_REQUEST_DATE_MODIFIED;
+    Everything_SetRequestFlags (request_flags);
+    request_flags = Everything_GetRequestFlags();  /* should be the same as set above */
   }
-}
-
-/**
- * In case the `gcc` is a CygWin gcc, we need to figure out the root-directory.
- * Since `gcc` reports `C_INCLUDE_PATH` like `"/usr/lib/gcc/i686-w64-mingw32/6.4.0/include"`,
- * we must prefix this as `"<cygwin_root>/usr/lib/gcc/i686-w64-mingw32/6.4.0/include"`.
- *
- * Otherwise `FILE_EXISTS()` wont work for non-Cygwin targets.
- * An alternative would be to parse the `"<cygwin_root>/etc/fstab"` file!
- */
-static void setup_cygwin_root (const compiler_info *cc)
-{
-  looks_like_cygwin = FALSE;
-  cygwin_root = NULL;
-  cygwin_fqfn[0] = '\0';
+#endif
 
-  if (cc->full_name && !cc->ignore)
+  /* With `--first` or `--max-matches`, let EveryThing return no more
+   * than needed. But not if some results could be filtered out here.
+   */
+  if (matches_left() != UINT_MAX && !opt.PE_check && !opt.show_owner &&
+      !cfg_ignore_first("[EveryThing]"))
   {
-    char *bin_dir;
+    DEBUGF (1, "Everything_SetMax (%u).\n", matches_left());
+    Everything_SetMax (matches_left());
+  }
+  else
+    Everything_SetMax (0xFFFFFFFF);   /* The default; in case an earlier query set it */
 
-    slashify2 (cygwin_fqfn, cc->full_name, '/');
-    bin_dir = strstr (cygwin_fqfn, "/bin");
-    if (bin_dir)
-    {
-      cygwin_root = STRDUP (cygwin_fqfn);
-      *strstr (cygwin_root, "/bin") = '\0';
-    }
+  Everything_SetSearchA (query);
+  start = profile_start();
+  Everything_QueryA (TRUE);
+  profile_item ("ipc", query, start);
+
+  err = Everything_GetLastError();
+  DEBUGF (1, "Everything_Query: %s\n", evry_strerror(err));
+
+  if (halt_flag > 0)
+     return (0);
+
+  if (err == EVERYTHING_ERROR_IPC)
+  {
+    WARN ("Everything IPC service is not running.\n");
+    return (0);
+  }
+  if (!evry_IsDBLoaded(wnd))
+  {
+    WARN ("Everything is busy loading it's database.\n");
+    return (0);
   }
-}
 
-static int find_include_path_cb (char *buf, int index)
-{
-  static const char start[] = "#include <...> search starts here:";
-  static const char end[]   = "End of search list.";
-  const  char *p;
+  num = Everything_GetNumResults();
+  DEBUGF (1, "Everything_GetNumResults() num: %lu, err: %s\n",
+          (u_long)num, evry_strerror(Everything_GetLastError()));
 
-  if (!found_search_line && !memcmp(buf,&start,sizeof(start)-1))
+  if (num == 0)
   {
-    found_search_line = TRUE;
+    if (opt.use_regex)
+         WARN ("Nothing matched your regexp \"%s\".\n"
+               "Are you sure it is correct? Try quoting it.\n",
+               opt.file_spec);
+    else WARN ("Nothing matched your search \"%s\".\n"
+               "Are you sure all NTFS disks are indexed by EveryThing? Try adding folders manually.\n",
+               opt.file_spec);
     return (0);
   }
 
-  if (found_search_line)
+  /* Sort results by path (ignore case).
+   * This will fail if `request_flags` has either `EVERYTHING_REQUEST_SIZE`
+   * or `EVERYTHING_REQUEST_DATE_MODIFIED` since version 2 of the query protocol
+   * is used.
+   * Ref: The comment in Everything.c; "//TODO: sort list2"
+   */
+  Everything_SortResultsByPath();
+  err = Everything_GetLastError();
+  if (err != EVERYTHING_OK)
   {
-    p = str_ltrim (buf);
-    check_if_cygwin (p);
+    DEBUGF (2, "Everything_SortResultsByPath(), err: %s\n", evry_strerror(err));
+    Everything_SetLastError (EVERYTHING_OK);
+  }
 
-    if (!memcmp(buf,&end,sizeof(end)-1)) /* got: "End of search list.". No more paths excepted. */
+  for (i = 0; i < num; i++)
+  {
+    static char prev [_MAX_PATH];
+    char   file [_MAX_PATH];
+    UINT64 fsize = (__int64)-1;  /* since a 0-byte file is valid */
+    time_t mtime = 0;
+    BOOL   is_shadow = FALSE;
+
+    if (search_halted())
+       break;
+
+    len = Everything_GetResultFullPathName (i, file, sizeof(file));
+    err = Everything_GetLastError();
+    if (len == 0 || err != EVERYTHING_OK)
     {
-      found_search_line = FALSE;
-      return (-1);
+      DEBUGF (2, "Everything_GetResultFullPathName(), err: %s\n",
+              evry_strerror(err));
+      len = 0;
+      break;
     }
 
-#if defined(__CYGWIN__)
-    if (looks_like_cygwin)
+    if (cfg_ignore_lookup("[EveryThing]",file))
     {
-      char result [_MAX_PATH];
-      int  rc = cygwin_conv_path (CCP_POSIX_TO_WIN_A, p, result, sizeof(result));
+      num_evry_ignored++;
+      continue;
+    }
 
-      if (rc == 0)
+    response_flags = 0;
+
+    if (request_flags & EVERYTHING_REQUEST_DATE_MODIFIED)
+    {
+      FILETIME ft;
+
+      if (Everything_GetResultDateModified(i,&ft))
       {
-        DEBUGF (2, "CygWin path detected. Converting '%s' -> '%s'\n", p, result);
-        p = _fix_drive (result);
+        response_flags |= EVERYTHING_REQUEST_DATE_MODIFIED;
+        mtime = FILETIME_to_time_t (&ft);
+        DEBUGF (2, "%3lu: Everything_GetResultDateModified(), mtime: %.24s\n",
+                i, mtime ? ctime(&mtime) : "<N/A>");
+      }
+      else
+      {
+        err = Everything_GetLastError();
+        DEBUGF (2, "%3lu: Everything_GetResultDateModified(), err: %s\n",
+                i, evry_strerror(err));
       }
-      /* otherwise add 'p' as-is */
     }
-    else
-#endif
+    if (request_flags & EVERYTHING_REQUEST_SIZE)
     {
-      char buf2 [_MAX_PATH];
+      LARGE_INTEGER fs;
 
-#if !defined(__CYGWIN__)
-      if (looks_like_cygwin && cygwin_root)
+      if (Everything_GetResultSize(i,&fs))
       {
-        snprintf (buf2, sizeof(buf2), "%s%s", cygwin_root, str_trim(buf));
-        p = buf2;
+        response_flags |= EVERYTHING_REQUEST_SIZE;
+        fsize = ((UINT64)fs.u.HighPart << 32) + fs.u.LowPart;
+        DEBUGF (2, "%3lu: Everything_GetResultSize(), %s\n",
+                i, get_file_size_str(fsize));
       }
       else
-#endif
-        p = _fix_path (str_trim(buf), buf2);
+      {
+        err = Everything_GetLastError();
+        DEBUGF (2, "%3lu: Everything_GetResultSize(), err: %s\n",
+                i, evry_strerror(err));
+      }
     }
 
-    add_to_dir_array (p, !stricmp(current_dir,p), __LINE__);
-    DEBUGF (3, "line: '%s'\n", p);
-    return (1);
-  }
-
-  ARGSUSED (index);
-  return (0);
-}
+    if ((response_flags & EVERYTHING_REQUEST_DATE_MODIFIED) == 0 ||
+        (response_flags & EVERYTHING_REQUEST_SIZE) == 0 )
+    {
+      struct stat st;
 
-static int find_library_path_cb (char *buf, int index)
-{
-  static const char prefix[] = "LIBRARY_PATH=";
-  char   buf2 [_MAX_PATH];
-  char   sep[2], *p, *tok, *rc, *end;
-  int    i = 0;
+      if (safe_stat(file, &st, NULL) == 0)
+      {
+        mtime = st.st_mtime;
+        if (opt.show_size)
+           fsize = st.st_size;
+      }
+    }
 
-  if (strncmp(buf,prefix,sizeof(prefix)-1) || strlen(buf) <= sizeof(prefix))
-     return (0);
+    /* Clear any error so the next Everything_XX() won't
+     * trigger an error.
+     */
+    Everything_SetLastError (EVERYTHING_OK);
 
-  p = buf + sizeof(prefix) - 1;
+    if (len > 0)
+    {
+      if (!opt.dir_mode && prev[0] && !strcmp(prev, file))
+         num_evry_dups++;
+      else if (report_evry_file(file, mtime, fsize, &is_shadow))
+         found++;
+      if (!is_shadow)
+         _strlcpy (prev, file, sizeof(prev));
+    }
+  }
+  return (found);
+}
 
-  check_if_cygwin (p);
+/**
+ * The main work-horse of this program.
+ */
+static int do_check_env (const char *env_name, BOOL recursive)
+{
+  vector_t    *list;
+  int          i, max, found = 0;
+  BOOL         check_empty = FALSE;
+  char        *orig_e = getenv_expand (env_name);
 
-  sep[0] = looks_like_cygwin ? ':' : ';';
-  sep[1] = '\0';
+  if (!orig_e)
+  {
+    DEBUGF (1, "Env-var %s not defined.\n", env_name);
+    return (0);
+  }
 
-  for (i = 0, tok = strtok(p,sep); tok; tok = strtok(NULL,sep), i++)
+  if (!strcmp(env_name,"PATH") ||
+      !strcmp(env_name,"LIB") ||
+      !strcmp(env_name,"LIBRARY_PATH") ||
+      !strcmp(env_name,"INCLUDE") ||
+      !strcmp(env_name,"C_INCLUDE_PATH") ||
+      !strcmp(env_name,"CPLUS_INCLUDE_PATH"))
+    check_empty = TRUE;
+
+  list = split_env_var (env_name, orig_e);
+  max  = vector_len (list);
+  for (i = 0; i < max; i++)
   {
-#if defined(__CYGWIN__)
-    if (looks_like_cygwin)
-    {
-      char result [_MAX_PATH];
-      int  rc1 = cygwin_conv_path (CCP_POSIX_TO_WIN_A, tok, result, sizeof(result));
+    struct directory_array *arr = vector_get (list, i);
 
-      if (rc1 == 0)
-           rc = _fix_drive (result);
-      else rc = tok;  /* otherwise add 'tok' as-is */
-    }
-    else
-#endif
-    {
-#if !defined(__CYGWIN__)
-      if (looks_like_cygwin && cygwin_root)
-      {
-        snprintf (buf2, sizeof(buf2), "%s%s", cygwin_root, tok);
-        rc = _fix_path (buf2, buf2);
-        end = rc ? strrchr(rc,'\\') : NULL;
-        if (end)
-           *end = '\0';
-      }
-      else
-#endif
-      {
-        rc = _fix_path (tok, buf2);
-        end = rc ? strrchr(rc,'\\') : NULL;
-        if (end)
-           *end = '\0';
-      }
-    }
-    add_to_dir_array (rc, FALSE, __LINE__);
-    DEBUGF (3, "tok %d: '%s'\n", i, rc);
+    if (check_empty && arr->exist)
+       arr->check_empty = check_empty;
   }
-  ARGSUSED (index);
-  return (i);
+  found = process_dirs (list, env_name, NULL, recursive);
+  free_dir_array();
+  FREE (orig_e);
+  return (found);
 }
 
 /**
- * Print a warning on last error from a gnu `popen_runf()` callback.
+ * Check a single MANPAGE directory for man-page match(es).
  */
-static void gnu_popen_warn (const char *gcc, int rc)
+static int check_man_dir (const char *dir, const char *env_name)
 {
-  const char *err = popen_last_line();
+  const char *_dir;
 
-  if (*err != '\0')
-     err = strstr (err, "error: ");
+  if (!strcmp(dir,"\\"))
+       _dir = current_dir;
+  else _dir = dir;
 
-  WARN ("Calling %s returned %d", cygwin_fqfn[0] ? cygwin_fqfn : gcc, rc);
-  if (err && !opt.quiet)
-     C_printf (":\n  %s.\n", err);
+  DEBUGF (1, "Looking for \"%s\" in \"%s\".\n", opt.file_spec, _dir);
+  return process_dir (dir, 0, TRUE, TRUE, 1, TRUE, env_name, HKEY_MAN_FILE, FALSE);
 }
 
 /**
- * The include-directory for C++ headers is not reported in the
- * `find_include_path_cb()` callback.
+ * The `MANPATH` checking needs to be recursive (1 level); check all
+ * `man*` and `cat*` directories under each directory in `%MANPATH`.
  *
- * Insert a `x/c++` to the list where a `c++` subdirectory is found.
+ * If `".\\"` (or `"./"`) is in `%MANPATH`, test for existence in `current_dir`
+ * first.
  */
-static void gnu_add_gpp_path (void)
+static int do_check_manpath (void)
 {
-  struct directory_array *d;
-  int    i, j, max = smartlist_len (dir_array);
-  char   fqdn [_MAX_PATH];
+  struct directory_array *arr;
+  vector_t *list;
+  int    i, j, max, found = 0;
+  char  *orig_e;
+  char   report [300];
+  BOOL   save1, save2, done_cwd = FALSE;
+  static const char env_name[] = "MANPATH";
+
+  /* \todo
+   *   This should be all directories matching "man?[pn]" or "cat?[pn]".
+   *   Make this array into a smartlist too?
+   */
+  static const char *sub_dirs[] = { "cat1", "cat2", "cat3", "cat4", "cat5",
+                                    "cat6", "cat7", "cat8", "cat9",
+                                    "man1", "man2", "man3", "man4", "man5",
+                                    "man6", "man7", "man8", "man9", "mann"
+                                  };
+
+  /* Do not implicit add current directory in searches.
+   * Unless `%MANPATH` contain a "./;" or a ".\;".
+   */
+  save1 = opt.no_cwd;
+  opt.no_cwd = 1;
+
+  orig_e = getenv_expand (env_name);
+  list   = orig_e ? split_env_var (env_name, orig_e) : NULL;
+  if (!list)
+  {
+    WARN ("Env-var %s not defined.\n", env_name);
+    opt.no_cwd = save1;
+    return (0);
+  }
+
+  snprintf (report, sizeof(report), "Matches in %%%s:\n", env_name);
+  report_header = report;
+
+  /* Man-files should have an extension. Hence do not report dotless files as a
+   * match in process_dir().
+   */
+  save2 = opt.man_mode;
+  opt.man_mode = 1;
 
+  max = vector_len (list);
   for (i = 0; i < max; i++)
   {
-    d = smartlist_get (dir_array, i);
-    snprintf (fqdn, sizeof(fqdn), "%s%c%s", d->dir, DIR_SEP, "c++");
-    if (is_directory(fqdn))
+    arr = vector_get (list, i);
+    if (!arr->exist)
     {
-      /* This will be added at `dir_array[max+1]`.
-       */
-      add_to_dir_array (fqdn, 0, __LINE__);
+      WARN ("%s: directory \"%s\" doesn't exist.\n", env_name, arr->dir);
+      continue;
+    }
 
-#if 0
-      /* Insert the new `c++` directory at the `i`-th element.
-       */
-      j = smartlist_len (dir_array) - 1;
-      d = smartlist_get (dir_array, j);
-      smartlist_insert (dir_array, i, d);
-#else
-      ARGSUSED (j);
-#endif
-      break;
+    /* If `%MANPATH` contains a `./`, check in current-dir.
+     * If the path contains multiple `./`, do this only once (with a warning).
+     * Also if current-dir contains `man*` sub-directories, check them too in the
+     * below for-loop.
+     */
+    if (arr->is_cwd)
+    {
+      if (done_cwd)
+           WARN ("%s: Contains multiple \"%s\".\n", env_name, ".\\");
+      else found += check_man_dir (".\\", env_name);
+      done_cwd = TRUE;
+    }
+
+    for (j = 0; j < 1+DIM(sub_dirs); j++)
+    {
+      char dir [_MAX_PATH];
+
+      if (j == 0)
+           _strlcpy (dir, arr->dir, sizeof(dir));
+      else snprintf (dir, sizeof(dir), "%s%c%s", arr->dir, DIR_SEP, sub_dirs[j-1]);
+      if (FILE_EXISTS(dir))
+         found += check_man_dir (dir, env_name);
     }
   }
+
+  opt.no_cwd   = save1;
+  opt.man_mode = save2;
+  free_dir_array();
+  FREE (orig_e);
+  return (found);
 }
 
-#if defined(__CYGWIN__)
-  #define CLANG_DUMP_FMT "%s -v -dM -xc -c - < /dev/null 2>&1"
-  #define GCC_DUMP_FMT   "%s %s -v -dM -xc -c - < /dev/null 2>&1"
-#else
-  #define CLANG_DUMP_FMT "%s -o NUL -v -dM -xc -c - < NUL 2>&1"
-  #define GCC_DUMP_FMT   "%s %s -o NUL -v -dM -xc -c - < NUL 2>&1"
-#endif             /* gcc ^, ^ '', '-m32' or '-m64' */
+/**
+ * Find the version and location `pkg-config.exe` (on `PATH`).
+ */
+static int pkg_config_major, pkg_config_minor;
 
-static int setup_gcc_includes (const compiler_info *cc)
+static int find_pkg_config_version_cb (char *buf, int index)
 {
-  const char *gcc = cc->full_name;
-  int   found;
+  ARGSUSED (index);
+  if (sscanf (buf, "%d.%d", &pkg_config_major, &pkg_config_minor) == 2)
+     return (1);
+  return (0);
+}
 
-  free_dir_array();
+static int get_pkg_config_info (char **exe_p, struct ver_info *ver)
+{
+  char  exe_copy [_MAX_PATH];
+  char *exe;
 
-  /* We want the output of stderr only. But that seems impossible on CMD/4NT.
-   * Hence redirect stderr + stdout into the same pipe for us to read.
-   * Also assume that the `*gcc` is on PATH.
-   */
-  found_search_line = FALSE;
+  *exe_p = NULL;
+  pkg_config_major = pkg_config_minor = -1;
+  exe = searchpath ("pkg-config.exe", "PATH");
+  if (exe == NULL)
+     return (0);
 
-  setup_cygwin_root (cc);
+  slashify2 (exe_copy, exe, '\\');
 
-  found = popen_runf (find_include_path_cb, GCC_DUMP_FMT, gcc, "");
-  if (found > 0)
+  if (popen_runf(find_pkg_config_version_cb, "\"%s\" --version", exe_copy) > 0)
   {
-    DEBUGF (1, "found %d include paths for %s.\n", found, gcc);
-    if (cc->type == CC_GNU_GPP)
-       gnu_add_gpp_path();
+    ver->val_1 = pkg_config_major;
+    ver->val_2 = pkg_config_minor;
+    *exe_p = STRDUP (exe);
+    return (1);
   }
-  else
-    gnu_popen_warn (gcc, found);
-  return (found);
+  return (0);
 }
 
-static int setup_gcc_library_path (const compiler_info *cc, BOOL warn)
-{
-  const char *m_cpu, *gcc = cc->full_name;
-  int   found, duplicates;
-
-  free_dir_array();
-
-  /* Tell `*gcc.exe` to return 32 or 64-bot or both types of libs.
-   * (assuming it supports the `-m32/-m64` switches.
-   */
-  if (opt.only_32bit)
-       m_cpu = "-m32";
-  else if (opt.only_64bit)
-       m_cpu = "-m64";
-  else m_cpu = "";
+/**
+ * Find the version and location `vcpkg.exe` (on `PATH`).
+ */
+static int vcpkg_major, vcpkg_minor, vcpkg_micro;
 
-  /* We want the output of stderr only. But that seems impossible on CMD/4NT.
-   * Hence redirect stderr + stdout into the same pipe for us to read.
-   * Also assume that the `*gcc` is on PATH.
-   */
-  found_search_line = FALSE;
+static int find_vcpkg_version_cb (char *buf, int index)
+{
+  ARGSUSED (index);
+  if (sscanf(buf, "Vcpkg package management program version %d.%d.%d", &vcpkg_major, &vcpkg_minor, &vcpkg_micro) >= 2)
+     return (1);
+  return (0);
+}
 
-  setup_cygwin_root (cc);
+static int get_vcpkg_info (char **exe_p, struct ver_info *ver)
+{
+  char  exe_copy [_MAX_PATH];
+  char *exe;
 
-  found = popen_runf (find_library_path_cb, GCC_DUMP_FMT, gcc, m_cpu);
-  if (found <= 0)
-  {
-    if (warn)
-       gnu_popen_warn (gcc, found);
-    return (found);
-  }
+  *exe_p = NULL;
+  vcpkg_major = vcpkg_minor = vcpkg_micro = -1;
+  exe = searchpath ("vcpkg.exe", "PATH");
+  if (exe == NULL)
+     return (0);
 
-  DEBUGF (1, "found %d library paths for %s.\n", found, gcc);
+  slashify2 (exe_copy, exe, '\\');
 
-#if defined(__CYGWIN__)
-  /*
-   * The Windows-API lib-dir isn't among the defaults. Just add it
-   * at the end of list anyway. In case it was already reported, we'll
-   * remove it below.
-   */
-  if (looks_like_cygwin)
+  if (popen_runf(find_vcpkg_version_cb, "\"%s\" version", exe_copy) > 0)
   {
-    char result [_MAX_PATH];
-    int  rc = cygwin_conv_path (CCP_POSIX_TO_WIN_A, "/usr/lib/w32api", result, sizeof(result));
-
-    if (rc == 0)
-       add_to_dir_array (result, FALSE, __LINE__);
+    ver->val_1 = vcpkg_major;
+    ver->val_2 = vcpkg_minor;
+    ver->val_3 = vcpkg_micro;
+    *exe_p = STRDUP (exe);
+    return (1);
   }
-#endif
-
-  duplicates = make_unique_dir_array ("library paths");
-  if (duplicates > 0)
-     DEBUGF (1, "found %d duplicates in library paths for %s.\n", duplicates, gcc);
-  return (found);
+  return (0);
 }
 
 /**
- * Check library-paths found in setup_gcc_library_path(). <br>
- * Check include-paths found in setup_gcc_includes().
+ * Search and check along `%PKG_CONFIG_PATH%` for a
+ * matching `<filespec>.pc` file.
  */
-static int process_gcc_dirs (const char *gcc, int *num_dirs)
+static int do_check_pkg (void)
 {
-  int i, found, max = smartlist_len (dir_array);
+  vector_t    *list;
+  int          i, max, num, prev_num = 0, found = 0;
+  BOOL         do_warn = FALSE;
+  char        *orig_e;
+  char         report [300];
+  static const char env_name[] = "PKG_CONFIG_PATH";
 
-  for (i = found = 0; i < max; i++)
+  orig_e = getenv_expand (env_name);
+  list = orig_e ? split_env_var (env_name, orig_e) : NULL;
+  if (!list)
   {
-    const struct directory_array *arr = smartlist_get (dir_array, i);
-
-    DEBUGF (2, "dir: %s\n", arr->dir);
-    found += process_dir (arr->dir, arr->num_dup, arr->exist, arr->check_empty,
-                          arr->is_dir, arr->exp_ok, gcc, HKEY_INC_LIB_FILE, FALSE);
+    WARN ("Env-var %s not defined.\n", env_name);
+    return (0);
   }
-  *num_dirs = max;
-  free_dir_array();
-  return (found);
-}
 
-/**
- * Add all supported GNU gcc/g++ compilers to the `all_cc` smartlist.
- * But only add the first `"*gcc.exe"` / `"*g++.exe"` found on `PATH`.
- *
- * The first pair added has no prefix (simply `"gcc.exe"` / `"g++.exe"`).
- * The others pairs use the prefixes in `gnu_prefixes[]`.
- */
-static void add_gnu_compilers (void)
-{
-  char   short_name[30];
-  size_t i;
+  snprintf (report, sizeof(report), "Matches in %%%s:\n", env_name);
+  report_header = report;
 
-  for (i = 0; i < DIM(gnu_prefixes); i++)
+  max = vector_len (list);
+  for (i = 0; i < max; i++)
   {
-    compiler_info *gcc = CALLOC (sizeof(*gcc), 1);
-    compiler_info *gpp = CALLOC (sizeof(*gpp), 1);
+    const struct directory_array *arr = vector_get (list, i);
 
-    snprintf (short_name, sizeof(short_name)-1, "%sgcc.exe", gnu_prefixes[i]);
-    gcc->short_name = STRDUP (short_name);
-    gcc->no_prefix  = (i > 0 && opt.gcc_no_prefixed);
-
-    snprintf (short_name, sizeof(short_name)-1, "%sg++.exe", gnu_prefixes[i]);
-    gpp->short_name = STRDUP (short_name);
-    gpp->no_prefix  = (i > 0 && opt.gcc_no_prefixed);
-
-    gcc->type = CC_GNU_GCC;
-    gpp->type = CC_GNU_GPP;
+    DEBUGF (2, "Checking in dir '%s'\n", arr->dir);
+    num = process_dir (arr->dir, 0, arr->exist, TRUE, arr->is_dir, arr->exp_ok,
+                       env_name, HKEY_PKGCONFIG_FILE, FALSE);
 
-    gcc->full_name = searchpath (gcc->short_name, "PATH");
-    if (gcc->full_name)
-       gcc->full_name = STRDUP (gcc->full_name);
+    if (arr->num_dup == 0 && prev_num > 0 && num > 0)
+       do_warn = TRUE;
+    if (prev_num == 0 && num > 0)
+       prev_num = num;
+    found += num;
+  }
 
-    gpp->full_name = searchpath (gpp->short_name, "PATH");
-    if (gpp->full_name)
-       gpp->full_name = STRDUP (gpp->full_name);
+  free_dir_array();
+  FREE (orig_e);
 
-    smartlist_add (all_cc, gcc);
-    smartlist_add (all_cc, gpp);
+  if (do_warn && !opt.quiet)
+  {
+    WARN ("Note: ");
+    C_printf ("~6There seems to be several '%s' files in different %%%s directories.\n"
+              "      \"pkgconfig\" will only select the first.~0\n", opt.file_spec, env_name);
   }
+  return (found);
 }
 
 /**
- * Simple; only add the first `cl.exe` found on `PATH`.
- * \todo
- *   do as with `envtool --path cl.exe` does and add all `cl.exe` found
- *   on PATH to the list.
+ * Search for VCPKG packages matching the `opt.file_spec`.
+ * Also show if a package matching `opt.file_spec` is installed.
  */
-static void add_msvc_compilers (void)
+static int do_check_vcpkg (void)
 {
-  compiler_info *cl = CALLOC (sizeof(*cl), 1);
-  const char    *full_name;
+  unsigned num;
 
-  cl->type       = CC_MSVC;
-  cl->short_name = STRDUP ("cl.exe");
-  full_name      = searchpath (cl->short_name, "PATH");
-  if (full_name)
-      cl->full_name = STRDUP (full_name);
-  smartlist_add (all_cc, cl);
+  vcpkg_get_list();
+  num = vcpkg_get_num_CONTROLS();
+  if (num >= 1 && opt.sink_format != SINK_TEXT)
+  {
+    const struct vcpkg_node *node;
+    struct sink_rec          rec;
+    int   i = 0, found = 0;
+
+    memset (&rec, '\0', sizeof(rec));
+    rec.mode  = report_mode;
+    rec.spec  = opt.file_spec;
+    rec.fsize = (UINT64)-1;
+    while (vcpkg_get_control(&i, &node, opt.file_spec))
+    {
+      rec.file    = node->package;
+      rec.version = node->version[0] ? node->version : NULL;
+      sink_write (&rec);
+      found++;
+    }
+    return (found);
+  }
+  if (num >= 1)
+     return (int) vcpkg_dump_control (opt.file_spec);
+
+  if (!opt.quiet)
+     C_printf ("%s.\n", vcpkg_last_error());
+  return (0);
 }
 
 /**
- * Search and add supported clang compilers to the `all_cc` smartlist.
+ * Before checking the `CMAKE_MODULE_PATH`, we need to find the version and location
+ * of `cmake.exe` (on `PATH`). Then assume it's built-in Module-path is relative to this.
+ * E.g:
+ * \code
+ *   cmake.exe     -> f:\MinGW32\bin\CMake\bin\cmake.exe.
+ *   built-in path -> f:\MinGW32\bin\CMake\share\cmake-X.Y\Modules
+ * \endcode
  */
-static void add_clang_cl_compilers (void)
+static int cmake_major, cmake_minor, cmake_micro;
+
+static int find_cmake_version_cb (char *buf, int index)
 {
-  static const char *clang[] = {
-                    "clang.exe",
-                    "clang-cl.exe"
-                  };
-  int i;
+  static char prefix[] = "cmake version ";
 
-  for (i = 0; i < DIM(clang); i++)
+  if (!strncmp(buf,prefix,sizeof(prefix)-1) && strlen(buf) >= sizeof(prefix))
   {
-    compiler_info *cl = CALLOC (sizeof(*cl), 1);
-    const char    *full_name;
+    char *p = buf + sizeof(prefix) - 1;
 
-    cl->type       = CC_CLANG_CL;
-    cl->short_name = STRDUP (clang[i]);
-    full_name      = searchpath (cl->short_name, "PATH");
-    if (full_name)
-        cl->full_name = STRDUP (full_name);
-    smartlist_add (all_cc, cl);
+    sscanf (p, "%d.%d.%d", &cmake_major, &cmake_minor, &cmake_micro);
+    return (1);
   }
+  ARGSUSED (index);
+  return (0);
 }
 
-/**
- * Search and add supported Borland compilers to the `all_cc` smartlist.
- */
-static void add_borland_compilers (void)
+static int get_cmake_info (char **exe_p, struct ver_info *ver)
 {
-  static const char *borland[] = {
-                    "bcc32.exe",
-                    "bcc32c.exe"
-                  };
-  int i;
+  char  exe_copy [_MAX_PATH];
+  char *exe;
 
-  for (i = 0; i < DIM(borland); i++)
-  {
-    compiler_info *bcc = CALLOC (sizeof(*bcc), 1);
-    const char    *full_name;
+  *exe_p = NULL;
+  cmake_major = cmake_minor = cmake_micro = -1;
 
-    bcc->type       = CC_BORLAND;
-    bcc->short_name = STRDUP (borland[i]);
-    full_name       = searchpath (bcc->short_name, "PATH");
-    if (full_name)
-       bcc->full_name = STRDUP (full_name);
-    smartlist_add (all_cc, bcc);
+  exe = searchpath ("cmake.exe", "PATH");
+  if (exe == NULL)
+     return (0);
+
+  slashify2 (exe_copy, exe, '\\');
+
+  if (popen_runf(find_cmake_version_cb, "\"%s\" -version", exe_copy) > 0)
+  {
+    ver->val_1 = cmake_major;
+    ver->val_2 = cmake_minor;
+    ver->val_3 = cmake_micro;
+    ver->val_4 = 0;
+    *exe_p = STRDUP (exe);
+    return (1);
   }
+  return (0);
 }
 
-/**
- * Search and add supported Watcom compilers to the `all_cc` smartlist.
- */
-static void add_watcom_compilers (void)
+static int do_check_cmake (void)
 {
-  static const char *wcc[] = {
-                    "wcc386.exe",
-                    "wpp386.exe",
-#if 0
-                    /* x86 16-bit C/C++ compilers
-                     */
-                    "wcc.exe",
-                    "wpp.exe",
+  const char *cmake_bin = searchpath ("cmake.exe", "PATH");
+  const char *env_name = "CMAKE_MODULE_PATH";
+  int         found = 0;
+  BOOL        check_env = TRUE;
+  char        report [_MAX_PATH+50];
 
-                    /* MIPS / PowerPC, C compilers
-                     */
-                    "wccmps.exe",
-                    "wccppc.exe",
-#endif
-                    /* Museum stuff; Alpha AXP, C/C++ compilers
-                     */
-                    "wccaxp.exe",
-                    "wppaxp.exe"
-                  };
-  int i;
+  cmake_major = cmake_minor = cmake_micro = -1;
 
-  for (i = 0; i < DIM(wcc); i++)
+  if (!getenv(env_name))
   {
-    compiler_info *wc = CALLOC (sizeof(*wc), 1);
-    const char    *full_name;
-
-    wc->type       = CC_WATCOM;
-    wc->short_name = STRDUP (wcc[i]);
-    full_name      = searchpath (wc->short_name, "PATH");
-    if (full_name)
-       wc->full_name = STRDUP (full_name);
-    smartlist_add (all_cc, wc);
+    WARN ("Env-var %s not defined.\n", env_name);
+    check_env = FALSE;
   }
-}
-
-/**
- * This is used to find the longest `cc->short_name`. For aligning the 1st column
- * (e.g. `"cl.exe"`) to fit the compiler with the longest `cc->short_name`.
- * I.e. `"x86_64-w64-mingw32-gcc.exe"`.
- */
-static size_t get_longest_short_name (void)
-{
-  int    i, max = smartlist_len (all_cc);
-  size_t longest = 0;
 
-  for (i = 0; i < max; i++)
+  if (cmake_bin)
   {
-    const  compiler_info *cc = smartlist_get (all_cc, i);
-    size_t len = strlen (cc->short_name);
-
-    if (!cc->ignore && len > longest)
-       longest = len;
-  }
-  return (longest);
-}
+    char *cmake_root = dirname (cmake_bin);
+    char  cmake_copy [_MAX_PATH];
 
-/**
- * Print the internal `"*gcc"` or `"*g++"` `LIBRARY_PATH` returned from
- * `setup_gcc_library_path()`.
- * I.e. only the directories \b not in `%LIBRARY_PATH%`.
- *
- * If we have no `%LIBRARY_PATH%`, the `copy[]` will contain only internal
- * directories.
- */
-static void print_gcc_internal_dirs (const char *env_name, const char *env_value)
-{
-  struct directory_array *arr;
-  smartlist_t            *list;
-  char                  **copy;
-  char                    slash = (opt.show_unix_paths ? '/' : '\\');
-  int                     i, j, max;
-  static BOOL done_note = FALSE;
+    DEBUGF (3, "cmake -> '%s', cmake_root: '%s'\n", cmake_bin, cmake_root);
+    slashify2 (cmake_copy, cmake_bin, '\\');
 
-  max = smartlist_len (dir_array);
-  if (max == 0)
-     return;
+    if (popen_runf(find_cmake_version_cb, "\"%s\" -version", cmake_copy) > 0)
+    {
+      char dir [_MAX_PATH];
 
-  copy = alloca ((max+1) * sizeof(char*));
-  for (i = 0; i < max; i++)
-  {
-    arr = smartlist_get (dir_array, i);
-    copy[i] = STRDUP (arr->dir);
-    slashify2 (copy[i], copy[i], slash);
-  }
-  copy[i] = NULL;
-  DEBUGF (3, "Made a 'copy[]' of %d directories.\n", max);
+      snprintf (dir, sizeof(dir), "%s\\..\\share\\cmake-%d.%d\\Modules",
+                cmake_root, cmake_major, cmake_minor);
+      _fix_path (dir, dir);
 
-  free_dir_array();
+      DEBUGF (1, "found Cmake version %d.%d.%d. Module-dir -> '%s'\n",
+              cmake_major, cmake_minor, cmake_micro, dir);
 
-  list = split_env_var (env_name, env_value);
-  max  = list ? smartlist_len (list) : 0;
-  DEBUGF (3, "smartlist for '%s' have %d entries.\n", env_name, max);
+      report_header = "Matches among built-in Cmake modules:\n";
+      found = process_dir (dir, 0, TRUE, TRUE, 1, TRUE, env_name, NULL, FALSE);
+    }
+    else
+      WARN ("Calling '%s' failed.\n", cmake_bin);
 
-  for (i = 0; copy[i]; i++)
+    FREE (cmake_root);
+  }
+  else
   {
-    BOOL  found = FALSE;
-    const char *dir;
-
-    for (j = 0; j < max; j++)
-    {
-      arr = smartlist_get (list, j);
-      dir = slashify2 (arr->dir, arr->dir, slash);
-      if (!stricmp(dir,copy[i]))
-      {
-        found = TRUE;
-        break;
-      }
-    }
-    if (!found)
-    {
-      C_printf ("%*s%s %s\n", (int)(longest_cc+8), "", copy[i], done_note ? "" : "~3(1)~0");
-      done_note = TRUE;
-    }
+    WARN ("cmake.exe not found on PATH.\n");
+    if (check_env)
+       WARN (" Checking %%%s anyway.\n", env_name);
   }
 
-  for (i = 0; copy[i]; i++)
-      FREE (copy[i]);
-  free_dir_array();
+  if (check_env)
+  {
+    snprintf (report, sizeof(report), "Matches in %%%s:\n", env_name);
+    report_header = report;
+    found += do_check_env ("CMAKE_MODULE_PATH", TRUE);
+  }
+  report_header = NULL;
+  return (found);
 }
 
 /**
- * Called during `envtool -VV` to print:
- * ```
- *  Compilers on PATH:
- *    gcc.exe                    -> f:\MingW32\TDM-gcc\bin\gcc.exe
- *    ...
- * ```
+ * Handling of GNU-compilers (`*gcc.exe`, `*g++.exe`), MSVC,
+ * clang-cl, Borland and Watcom.
  *
- * `envtool -VVV (print_lib_path = TRUE)` will print the internal
- * `*gcc` or `*g++` library paths too.
+ * \enum compiler_type
  */
-static void print_compiler_info (const compiler_info *cc, BOOL print_lib_path)
-{
-  BOOL   is_gnu;
-  size_t len = strlen (cc->short_name);
+typedef enum compiler_type {
+             CC_UNKNOWN = 0, /**< Unknown compiler (not initialised value) */
+             CC_GNU_GCC,     /**< Some sort of (prefixed) `*gcc.exe`. */
+             CC_GNU_GPP,     /**< Some sort of (prefixed) `*g++.exe`. */
+             CC_MSVC,        /**< A MSVC compiler */
+             CC_CLANG_CL,    /**< A clang/clang-cl compiler */
+             CC_BORLAND,     /**< A Borland / Embarcadero compiler */
+             CC_WATCOM       /**< A Watcom/OpenWatcom compiler */
+           } compiler_type;
 
-  C_printf ("    %s%*s -> ", cc->short_name, (int)(longest_cc-len), "");
-  if (cc->full_name)
-       C_printf ("~6%s~0\n", cc->full_name);
-  else C_printf ("~5Not found~0\n");
+/** \struct compiler_info
+ */
+typedef struct compiler_info {
+        char          *short_name;  /**< the short name we're looking for on `%PATH` */
+        char          *full_name;   /**< the full name if found `%PATH` */
+        compiler_type  type;        /**< what type is it? */
+        BOOL           ignore;      /**< shall we ignore it? */
+        BOOL           no_prefix;   /**< shall we check gnu prefixed gcc/g++? */
+      } compiler_info;
 
-  if (!cc->full_name || cc->ignore || !print_lib_path)
-     return;
+/**
+ * The information for all added compilers is in this list;
+ * an array of `compiler_info` created by `add_compilers()`.
+ */
+static smartlist_t *all_cc = NULL;
 
-  is_gnu = (cc->type == CC_GNU_GCC || cc->type == CC_GNU_GPP);
-  if (is_gnu && setup_gcc_library_path(cc,FALSE) > 0)
-  {
-    char *env = getenv_expand ("LIBRARY_PATH");
+/**
+ * The `compiler_type`s added to `all_cc` so far; one bit for each.
+ */
+static unsigned cc_added = 0;
 
-    print_gcc_internal_dirs ("LIBRARY_PATH", env);
-    FREE (env);
-  }
-  FREE (cygwin_root);
-}
+static size_t longest_cc        = 0;
+static BOOL   ignore_all_gcc    = FALSE;
+static BOOL   ignore_all_gpp    = FALSE;
+static BOOL   looks_like_cygwin = FALSE;
+static BOOL   found_search_line = FALSE;
+static char  *cygwin_root       = NULL;
+static char   cygwin_fqfn [_MAX_PATH];
+static char  *watcom_dir[4];
 
 /**
- * Return TRUE if we shall ignore all gnu-type compilers.
+ * Free the memory allocated by `add_compilers()`.
  */
-static BOOL ignore_all_gnus (compiler_type type)
+static void free_all_compilers (void)
 {
-  int i, num_gnu = 0, gnu_ignore = 0;
-  int max = smartlist_len (all_cc);
+  int i, max = all_cc ? smartlist_len (all_cc) : 0;
 
   for (i = 0; i < max; i++)
   {
-    const compiler_info *cc = smartlist_get (all_cc, i);
-
-    if (cc->type != type)
-       continue;
+    compiler_info *cc = smartlist_get (all_cc, i);
 
-     num_gnu++;
-     if (cc->ignore)
-        gnu_ignore++;
+    FREE (cc->short_name);
+    FREE (cc->full_name);
+    FREE (cc);
   }
-  return (gnu_ignore >= num_gnu);
+  smartlist_free (all_cc);
+  all_cc   = NULL;
+  cc_added = 0;
 }
 
 /**
- * In `--lib` or `--inc` mode, search the `PATH` for all supported compilers.
+ * Check if we shall ignore this compiler.
  *
- * \param[in] print_info      If called from `show_version()`, print additional
- *                            information on each compiler (unless it is in the ignore-list).
- * \param[in] print_lib_path  If called from `show_version()` and `envtool -VVV` was used,
- *                            print the internal GCC library paths too.
+ * + if `cc->full_name` is non-NULL (i.e. found), check the ignore-list for that.
+ * + if `cc->full_name` is NULL, check the ignore-list for the `cc->short_name`.
+ *
+ * \eg if the config-file contains a `"ignore = i386-mingw32-gcc.exe"`, and
+ *     `"i386-mingw32-gcc.exe"` is not found, don't try to spawn it (since it
+ *     will fail).
+ *
+ * \param[in] cc the the `compiler_info` to check.
  */
-static void search_and_add_all_cc (BOOL print_info, BOOL print_lib_path)
+static void compiler_check_ignore (compiler_info *cc)
 {
-  struct compiler_info *cc;
-  BOOL   at_least_one_gnu = FALSE;
-  int    i, max, ignored, save = opt.cache_ver_level;
-  int    save_u;
-
-  ASSERT (all_cc == NULL);
-  all_cc = smartlist_new();
-
-  if (print_info && print_lib_path)
-     opt.cache_ver_level = 3;
+  BOOL ignore = FALSE;
 
-  save_u = opt.show_unix_paths;
-  if (!print_info)
-     opt.show_unix_paths = 0;
+  /* "envtool --no-prefix .." given and this `cc->short_name` is
+   * a prefixed `*-gcc.exe` or `*-g++.exe`.
+   */
+  if (cc->no_prefix)
+     ignore = TRUE;
 
-  add_gnu_compilers();
-  add_msvc_compilers();
-  add_clang_cl_compilers();
-  add_borland_compilers();
-  add_watcom_compilers();
+  /* "envtool --no-gcc .." given and this `cc->type == CC_GNU_GCC`.
+   */
+  else if (cc->type == CC_GNU_GCC && opt.no_gcc)
+     ignore = TRUE;
 
-  opt.show_unix_paths = save_u;
-
-  max = smartlist_len (all_cc);
-  for (i = 0; i < max; i++)
-      compiler_check_ignore (smartlist_get(all_cc, i));
+  /* "envtool --no-g++ .." given and this `cc->type == CC_GNU_GPP`.
+   */
+  else if (cc->type == CC_GNU_GPP && opt.no_gpp)
+     ignore = TRUE;
 
-  longest_cc = get_longest_short_name();
+  /* "envtool --no-watcom .." given and this `cc->type == CC_WATCOM`.
+   */
+  else if (cc->type == CC_WATCOM && opt.no_watcom)
+     ignore = TRUE;
 
-  ignore_all_gcc = ignore_all_gnus (CC_GNU_GCC);
-  ignore_all_gpp = ignore_all_gnus (CC_GNU_GPP);
+  /* "envtool --no-borland .." given and this `cc->type == CC_BORLAND`.
+   */
+  else if (cc->type == CC_BORLAND && opt.no_borland)
+     ignore = TRUE;
 
-  DEBUGF (1, "ignore_all_gcc: %d, ignore_all_gpp: %d.\n", ignore_all_gcc, ignore_all_gpp);
+  /* "envtool --no-clang .." given and this `cc->type == CC_CLANG_CL`.
+   */
+  else if (cc->type == CC_CLANG_CL && opt.no_clang)
+     ignore = TRUE;
 
-  if (!print_info)
-     return;
+  else if (cc->full_name)
+    ignore = cfg_ignore_lookup ("[Compiler]", cc->full_name);
 
-  /* Count the # of compilers that were ignored.
-   * And print some info if it wasn't ignored.
+  /* Last chance to check ignore.
    */
-  for (i = ignored = 0; i < max; i++)
-  {
-    cc = smartlist_get (all_cc, i);
-    if (cc->ignore)
-         ignored++;
-    else print_compiler_info (cc, print_lib_path);
+  if (!ignore)
+     ignore = cfg_ignore_lookup ("[Compiler]", cc->short_name);
 
-    if (!at_least_one_gnu)
-       at_least_one_gnu = (cc->type == CC_GNU_GCC || cc->type == CC_GNU_GPP);
-  }
+  DEBUGF (1, "Checking %s (%s), ignore: %d.\n",
+          cc->short_name, cc->full_name ? cc->full_name : "<not found>", ignore);
 
-  if (print_lib_path && at_least_one_gnu)
-     C_puts ("    ~3(1)~0: internal GCC library paths.\n");
+  cc->ignore = ignore;
+}
 
-  opt.cache_ver_level = save;
+/**
+ * Having several gcc compilers installed makes it nearly impossible to
+ * set `C_INCLUDE_PATH` to the desired compiler's include-dir. So Envtool
+ * simply asks `*gcc.exe` for what it think is the include search-path.
+ * Do that by spawning the `*gcc.exe` and parsing the include paths.
+ *
+ * Same goes for the `LIBRARY_PATH`.
+ */
+static void check_if_cygwin (const char *path)
+{
+  static const char cyg_usr[] = "/usr/";
+  static const char cyg_drv[] = "/cygdrive/";
 
-  if (ignored == 0)
+  if (looks_like_cygwin)
      return;
 
-  /* Show the ignored ones
-   */
-  C_puts ("\n    Ignored:\n");
-  for (i = 0; i < max; i++)
+  if (!memcmp(path,&cyg_usr,sizeof(cyg_usr)-1) || !memcmp(path,&cyg_drv,sizeof(cyg_drv)-1))
   {
-    cc = smartlist_get (all_cc, i);
-    if (cc->ignore)
-       C_printf ("      %s%s\n",
-                 cc->full_name ? cc->full_name : cc->short_name,
-                 cc->full_name == NULL ? "  ~5Not found~0" : "");
+    looks_like_cygwin = TRUE;
+//  opt.conv_cygdrive = 1;
+    DEBUGF (2, "looks_like_cygwin = %d, cygwin_root: '%s'\n", looks_like_cygwin, cygwin_root);
   }
 }
 
 /**
- * Common to both gcc/g++ checking of include-dirs.
+ * In case the `gcc` is a CygWin gcc, we need to figure out the root-directory.
+ * Since `gcc` reports `C_INCLUDE_PATH` like `"/usr/lib/gcc/i686-w64-mingw32/6.4.0/include"`,
+ * we must prefix this as `"<cygwin_root>/usr/lib/gcc/i686-w64-mingw32/6.4.0/include"`.
+ *
+ * Otherwise `FILE_EXISTS()` wont work for non-Cygwin targets.
+ * An alternative would be to parse the `"<cygwin_root>/etc/fstab"` file!
  */
-static int check_gnu_includes (compiler_type type, int *num_dirs)
+static void setup_cygwin_root (const compiler_info *cc)
 {
-  char  report [_MAX_PATH+50];
-  int   i, max, found;
-  const compiler_info *cc;
-  const char          *env;
+  looks_like_cygwin = FALSE;
+  cygwin_root = NULL;
+  cygwin_fqfn[0] = '\0';
 
-  *num_dirs = 0;
-  max = smartlist_len (all_cc);
+  if (cc->full_name && !cc->ignore)
+  {
+    char *bin_dir;
 
-  for (i = found = 0; i < max; i++)
+    slashify2 (cygwin_fqfn, cc->full_name, '/');
+    bin_dir = strstr (cygwin_fqfn, "/bin");
+    if (bin_dir)
+    {
+      cygwin_root = STRDUP (cygwin_fqfn);
+      *strstr (cygwin_root, "/bin") = '\0';
+    }
+  }
+}
+
+static int find_include_path_cb (char *buf, int index)
+{
+  static const char start[] = "#include <...> search starts here:";
+  static const char end[]   = "End of search list.";
+  const  char *p;
+
+  if (!found_search_line && !memcmp(buf,&start,sizeof(start)-1))
   {
-    cc = smartlist_get (all_cc, i);
-    if (cc->type == type && !cc->ignore && setup_gcc_includes(cc) > 0)
+    found_search_line = TRUE;
+    return (0);
+  }
+
+  if (found_search_line)
+  {
+    p = str_ltrim (buf);
+    check_if_cygwin (p);
+
+    if (!memcmp(buf,&end,sizeof(end)-1)) /* got: "End of search list.". No more paths excepted. */
     {
-      env = (cc->type == CC_GNU_GCC) ? "%C_INCLUDE_PATH%" : "%CPLUS_INCLUDE_PATH%";
-      snprintf (report, sizeof(report), "Matches in %s %s path:\n", cc->full_name, env);
-      report_header = report;
-      found += process_gcc_dirs (cc->short_name, num_dirs);
+      found_search_line = FALSE;
+      return (-1);
     }
-    FREE (cygwin_root);
+
+#if defined(__CYGWIN__)
+    if (looks_like_cygwin)
+    {
+      char result [_MAX_PATH];
+      int  rc = cygwin_conv_path (CCP_POSIX_TO_WIN_A, p, result, sizeof(result));
+
+      if (rc == 0)
+      {
+        DEBUGF (2, "CygWin path detected. Converting '%s' -> '%s'\n", p, result);
+        p = _fix_drive (result);
+      }
+      /* otherwise add 'p' as-is */
+    }
+    else
+#endif
+    {
+      char buf2 [_MAX_PATH];
+
+#if !defined(__CYGWIN__)
+      if (looks_like_cygwin && cygwin_root)
+      {
+        snprintf (buf2, sizeof(buf2), "%s%s", cygwin_root, str_trim(buf));
+        p = buf2;
+      }
+      else
+#endif
+        p = _fix_path (str_trim(buf), buf2);
+    }
+
+    add_to_dir_array (p, !stricmp(current_dir,p), __LINE__);
+    DEBUGF (3, "line: '%s'\n", p);
+    return (1);
   }
-  return (found);
+
+  ARGSUSED (index);
+  return (0);
 }
 
-static int do_check_gcc_includes (void)
+static int find_library_path_cb (char *buf, int index)
 {
-  int num_dirs;
-  int found = check_gnu_includes (CC_GNU_GCC, &num_dirs);
+  static const char prefix[] = "LIBRARY_PATH=";
+  char   buf2 [_MAX_PATH];
+  char   sep[2], *p, *tok, *rc, *end;
+  int    i = 0;
 
-  if (num_dirs == 0 && !ignore_all_gcc)  /* Impossible unless we ignore all `*gcc` */
-     WARN ("No gcc.exe programs returned any include paths.\n");
-  return (found);
+  if (strncmp(buf,prefix,sizeof(prefix)-1) || strlen(buf) <= sizeof(prefix))
+     return (0);
+
+  p = buf + sizeof(prefix) - 1;
+
+  check_if_cygwin (p);
+
+  sep[0] = looks_like_cygwin ? ':' : ';';
+  sep[1] = '\0';
+
+  for (i = 0, tok = strtok(p,sep); tok; tok = strtok(NULL,sep), i++)
+  {
+#if defined(__CYGWIN__)
+    if (looks_like_cygwin)
+    {
+      char result [_MAX_PATH];
+      int  rc1 = cygwin_conv_path (CCP_POSIX_TO_WIN_A, tok, result, sizeof(result));
+
+      if (rc1 == 0)
+           rc = _fix_drive (result);
+      else rc = tok;  /* otherwise add 'tok' as-is */
+    }
+    else
+#endif
+    {
+#if !defined(__CYGWIN__)
+      if (looks_like_cygwin && cygwin_root)
+      {
+        snprintf (buf2, sizeof(buf2), "%s%s", cygwin_root, tok);
+        rc = _fix_path (buf2, buf2);
+        end = rc ? strrchr(rc,'\\') : NULL;
+        if (end)
+           *end = '\0';
+      }
+      else
+#endif
+      {
+        rc = _fix_path (tok, buf2);
+        end = rc ? strrchr(rc,'\\') : NULL;
+        if (end)
+           *end = '\0';
+      }
+    }
+    add_to_dir_array (rc, FALSE, __LINE__);
+    DEBUGF (3, "tok %d: '%s'\n", i, rc);
+  }
+  ARGSUSED (index);
+  return (i);
 }
 
-static int do_check_gpp_includes (void)
+/**
+ * Print a warning on last error from a gnu `popen_runf()` callback.
+ */
+static void gnu_popen_warn (const char *gcc, int rc)
 {
-  int num_dirs;
-  int found = check_gnu_includes (CC_GNU_GPP, &num_dirs);
+  const char *err = popen_last_line();
 
-  if (num_dirs == 0 && !ignore_all_gpp)  /* Impossible unless we ignore all `*g++.exe` */
-     WARN ("No g++.exe programs returned any include paths.\n");
-  return (found);
+  if (*err != '\0')
+     err = strstr (err, "error: ");
+
+  WARN ("Calling %s returned %d", cygwin_fqfn[0] ? cygwin_fqfn : gcc, rc);
+  if (err && !opt.quiet)
+     C_printf (":\n  %s.\n", err);
 }
 
-static int do_check_gcc_library_paths (void)
+/**
+ * The include-directory for C++ headers is not reported in the
+ * `find_include_path_cb()` callback.
+ *
+ * Insert a `x/c++` to the list where a `c++` subdirectory is found.
+ */
+static void gnu_add_gpp_path (void)
+{
+  struct directory_array *d;
+  int    i, j, max = vector_len (&dir_array);
+  char   fqdn [_MAX_PATH];
+
+  for (i = 0; i < max; i++)
+  {
+    d = vector_get (&dir_array, i);
+    snprintf (fqdn, sizeof(fqdn), "%s%c%s", d->dir, DIR_SEP, "c++");
+    if (is_directory(fqdn))
+    {
+      /* This will be added at `dir_array[max+1]`.
+       */
+      add_to_dir_array (fqdn, 0, __LINE__);
+
+#if 0
+      /* Move the new `c++` directory to the `i`-th element.
+       */
+      struct directory_array cpp;
+
+      j = vector_len (&dir_array) - 1;
+      cpp = *VECTOR_GET (&dir_array, struct directory_array, j);
+      vector_del_keeporder (&dir_array, j);
+      *(struct directory_array*) vector_insert (&dir_array, i) = cpp;
+#else
+      ARGSUSED (j);
+#endif
+      break;
+    }
+  }
+}
+
+#if defined(__CYGWIN__)
+  #define CLANG_DUMP_FMT "%s -v -dM -xc -c - < /dev/null 2>&1"
+  #define GCC_DUMP_FMT   "%s %s -v -dM -xc -c - < /dev/null 2>&1"
+#else
+  #define CLANG_DUMP_FMT "%s -o NUL -v -dM -xc -c - < NUL 2>&1"
+  #define GCC_DUMP_FMT   "%s %s -o NUL -v -dM -xc -c - < NUL 2>&1"
+#endif             /* gcc ^, ^ '', '-m32' or '-m64' */
+
+static int setup_gcc_includes (const compiler_info *cc)
+{
+  const char *gcc = cc->full_name;
+  int   found;
+
+  free_dir_array();
+
+  /* We want the output of stderr only. But that seems impossible on CMD/4NT.
+   * Hence redirect stderr + stdout into the same pipe for us to read.
+   * Also assume that the `*gcc` is on PATH.
+   */
+  found_search_line = FALSE;
+
+  setup_cygwin_root (cc);
+
+  found = popen_runf (find_include_path_cb, GCC_DUMP_FMT, gcc, "");
+  if (found > 0)
+  {
+    DEBUGF (1, "found %d include paths for %s.\n", found, gcc);
+    if (cc->type == CC_GNU_GPP)
+       gnu_add_gpp_path();
+  }
+  else
+    gnu_popen_warn (gcc, found);
+  return (found);
+}
+
+static int setup_gcc_library_path (const compiler_info *cc, BOOL warn)
+{
+  const char *m_cpu, *gcc = cc->full_name;
+  int   found, duplicates;
+
+  free_dir_array();
+
+  /* Tell `*gcc.exe` to return 32 or 64-bot or both types of libs.
+   * (assuming it supports the `-m32/-m64` switches.
+   */
+  if (opt.only_32bit)
+       m_cpu = "-m32";
+  else if (opt.only_64bit)
+       m_cpu = "-m64";
+  else m_cpu = "";
+
+  /* We want the output of stderr only. But that seems impossible on CMD/4NT.
+   * Hence redirect stderr + stdout into the same pipe for us to read.
+   * Also assume that the `*gcc` is on PATH.
+   */
+  found_search_line = FALSE;
+
+  setup_cygwin_root (cc);
+
+  found = popen_runf (find_library_path_cb, GCC_DUMP_FMT, gcc, m_cpu);
+  if (found <= 0)
+  {
+    if (warn)
+       gnu_popen_warn (gcc, found);
+    return (found);
+  }
+
+  DEBUGF (1, "found %d library paths for %s.\n", found, gcc);
+
+#if defined(__CYGWIN__)
+  /*
+   * The Windows-API lib-dir isn't among the defaults. Just add it
+   * at the end of list anyway. In case it was already reported, we'll
+   * remove it below.
+   */
+  if (looks_like_cygwin)
+  {
+    char result [_MAX_PATH];
+    int  rc = cygwin_conv_path (CCP_POSIX_TO_WIN_A, "/usr/lib/w32api", result, sizeof(result));
+
+    if (rc == 0)
+       add_to_dir_array (result, FALSE, __LINE__);
+  }
+#endif
+
+  duplicates = make_unique_dir_array ("library paths");
+  if (duplicates > 0)
+     DEBUGF (1, "found %d duplicates in library paths for %s.\n", duplicates, gcc);
+  return (found);
+}
+
+/**
+ * Check library-paths found in setup_gcc_library_path(). <br>
+ * Check include-paths found in setup_gcc_includes().
+ */
+static int process_gcc_dirs (const char *gcc, int *num_dirs)
+{
+  int found = process_dirs (&dir_array, gcc, HKEY_INC_LIB_FILE, FALSE);
+
+  *num_dirs = vector_len (&dir_array);
+  free_dir_array();
+  return (found);
+}
+
+/**
+ * Add all supported GNU gcc/g++ compilers to the `all_cc` smartlist.
+ * But only add the first `"*gcc.exe"` / `"*g++.exe"` found on `PATH`.
+ *
+ * The first pair added has no prefix (simply `"gcc.exe"` / `"g++.exe"`).
+ * The others pairs use the prefixes in `gnu_prefixes[]`.
+ */
+static void add_gnu_compilers (void)
+{
+  char   short_name[30];
+  size_t i;
+
+  for (i = 0; i < DIM(gnu_prefixes); i++)
+  {
+    compiler_info *gcc = CALLOC (sizeof(*gcc), 1);
+    compiler_info *gpp = CALLOC (sizeof(*gpp), 1);
+
+    snprintf (short_name, sizeof(short_name)-1, "%sgcc.exe", gnu_prefixes[i]);
+    gcc->short_name = STRDUP (short_name);
+    gcc->no_prefix  = (i > 0 && opt.gcc_no_prefixed);
+
+    snprintf (short_name, sizeof(short_name)-1, "%sg++.exe", gnu_prefixes[i]);
+    gpp->short_name = STRDUP (short_name);
+    gpp->no_prefix  = (i > 0 && opt.gcc_no_prefixed);
+
+    gcc->type = CC_GNU_GCC;
+    gpp->type = CC_GNU_GPP;
+
+    gcc->full_name = searchpath (gcc->short_name, "PATH");
+    if (gcc->full_name)
+       gcc->full_name = STRDUP (gcc->full_name);
+
+    gpp->full_name = searchpath (gpp->short_name, "PATH");
+    if (gpp->full_name)
+       gpp->full_name = STRDUP (gpp->full_name);
+
+    smartlist_add (all_cc, gcc);
+    smartlist_add (all_cc, gpp);
+  }
+}
+
+/**
+ * Simple; only add the first `cl.exe` found on `PATH`.
+ * \todo
+ *   do as with `envtool --path cl.exe` does and add all `cl.exe` found
+ *   on PATH to the list.
+ */
+static void add_msvc_compilers (void)
+{
+  compiler_info *cl = CALLOC (sizeof(*cl), 1);
+  const char    *full_name;
+
+  cl->type       = CC_MSVC;
+  cl->short_name = STRDUP ("cl.exe");
+  full_name      = searchpath (cl->short_name, "PATH");
+  if (full_name)
+      cl->full_name = STRDUP (full_name);
+  smartlist_add (all_cc, cl);
+}
+
+/**
+ * Search and add supported clang compilers to the `all_cc` smartlist.
+ */
+static void add_clang_cl_compilers (void)
+{
+  static const char *clang[] = {
+                    "clang.exe",
+                    "clang-cl.exe"
+                  };
+  int i;
+
+  for (i = 0; i < DIM(clang); i++)
+  {
+    compiler_info *cl = CALLOC (sizeof(*cl), 1);
+    const char    *full_name;
+
+    cl->type       = CC_CLANG_CL;
+    cl->short_name = STRDUP (clang[i]);
+    full_name      = searchpath (cl->short_name, "PATH");
+    if (full_name)
+        cl->full_name = STRDUP (full_name);
+    smartlist_add (all_cc, cl);
+  }
+}
+
+/**
+ * Search and add supported Borland compilers to the `all_cc` smartlist.
+ */
+static void add_borland_compilers (void)
+{
+  static const char *borland[] = {
+                    "bcc32.exe",
+                    "bcc32c.exe"
+                  };
+  int i;
+
+  for (i = 0; i < DIM(borland); i++)
+  {
+    compiler_info *bcc = CALLOC (sizeof(*bcc), 1);
+    const char    *full_name;
+
+    bcc->type       = CC_BORLAND;
+    bcc->short_name = STRDUP (borland[i]);
+    full_name       = searchpath (bcc->short_name, "PATH");
+    if (full_name)
+       bcc->full_name = STRDUP (full_name);
+    smartlist_add (all_cc, bcc);
+  }
+}
+
+/**
+ * Search and add supported Watcom compilers to the `all_cc` smartlist.
+ */
+static void add_watcom_compilers (void)
+{
+  static const char *wcc[] = {
+                    "wcc386.exe",
+                    "wpp386.exe",
+#if 0
+                    /* x86 16-bit C/C++ compilers
+                     */
+                    "wcc.exe",
+                    "wpp.exe",
+
+                    /* MIPS / PowerPC, C compilers
+                     */
+                    "wccmps.exe",
+                    "wccppc.exe",
+#endif
+                    /* Museum stuff; Alpha AXP, C/C++ compilers
+                     */
+                    "wccaxp.exe",
+                    "wppaxp.exe"
+                  };
+  int i;
+
+  for (i = 0; i < DIM(wcc); i++)
+  {
+    compiler_info *wc = CALLOC (sizeof(*wc), 1);
+    const char    *full_name;
+
+    wc->type       = CC_WATCOM;
+    wc->short_name = STRDUP (wcc[i]);
+    full_name      = searchpath (wc->short_name, "PATH");
+    if (full_name)
+       wc->full_name = STRDUP (full_name);
+    smartlist_add (all_cc, wc);
+  }
+}
+
+/**
+ * This is used to find the longest `cc->short_name`. For aligning the 1st column
+ * (e.g. `"cl.exe"`) to fit the compiler with the longest `cc->short_name`.
+ * I.e. `"x86_64-w64-mingw32-gcc.exe"`.
+ */
+static size_t get_longest_short_name (void)
+{
+  int    i, max = smartlist_len (all_cc);
+  size_t longest = 0;
+
+  for (i = 0; i < max; i++)
+  {
+    const  compiler_info *cc = smartlist_get (all_cc, i);
+    size_t len = strlen (cc->short_name);
+
+    if (!cc->ignore && len > longest)
+       longest = len;
+  }
+  return (longest);
+}
+
+/**
+ * Print the internal `"*gcc"` or `"*g++"` `LIBRARY_PATH` returned from
+ * `setup_gcc_library_path()`.
+ * I.e. only the directories \b not in `%LIBRARY_PATH%`.
+ *
+ * If we have no `%LIBRARY_PATH%`, the `copy[]` will contain only internal
+ * directories.
+ */
+static void print_gcc_internal_dirs (const char *env_name, const char *env_value)
+{
+  struct directory_array *arr;
+  vector_t               *list;
+  char                  **copy;
+  char                    slash = (opt.show_unix_paths ? '/' : '\\');
+  int                     i, j, max;
+  static BOOL done_note = FALSE;
+
+  max = vector_len (&dir_array);
+  if (max == 0)
+     return;
+
+  copy = alloca ((max+1) * sizeof(char*));
+  for (i = 0; i < max; i++)
+  {
+    arr = vector_get (&dir_array, i);
+    copy[i] = STRDUP (arr->dir);
+    slashify2 (copy[i], copy[i], slash);
+  }
+  copy[i] = NULL;
+  DEBUGF (3, "Made a 'copy[]' of %d directories.\n", max);
+
+  free_dir_array();
+
+  list = split_env_var (env_name, env_value);
+  max  = list ? vector_len (list) : 0;
+  DEBUGF (3, "smartlist for '%s' have %d entries.\n", env_name, max);
+
+  for (i = 0; copy[i]; i++)
+  {
+    BOOL  found = FALSE;
+    const char *dir;
+
+    for (j = 0; j < max; j++)
+    {
+      arr = vector_get (list, j);
+      dir = slashify2 (arr->dir, arr->dir, slash);
+      if (!stricmp(dir,copy[i]))
+      {
+        found = TRUE;
+        break;
+      }
+    }
+    if (!found)
+    {
+      C_printf ("%*s%s %s\n", (int)(longest_cc+8), "", copy[i], done_note ? "" : "~3(1)~0");
+      done_note = TRUE;
+    }
+  }
+
+  for (i = 0; copy[i]; i++)
+      FREE (copy[i]);
+  free_dir_array();
+}
+
+/**
+ * Called during `envtool -VV` to print:
+ * ```
+ *  Compilers on PATH:
+ *    gcc.exe                    -> f:\MingW32\TDM-gcc\bin\gcc.exe
+ *    ...
+ * ```
+ *
+ * `envtool -VVV (print_lib_path = TRUE)` will print the internal
+ * `*gcc` or `*g++` library paths too.
+ */
+static void print_compiler_info (const compiler_info *cc, BOOL print_lib_path)
+{
+  BOOL   is_gnu;
+  size_t len = strlen (cc->short_name);
+
+  C_printf ("    %s%*s -> ", cc->short_name, (int)(longest_cc-len), "");
+  if (cc->full_name)
+       C_printf ("~6%s~0\n", cc->full_name);
+  else C_printf ("~5Not found~0\n");
+
+  if (!cc->full_name || cc->ignore || !print_lib_path)
+     return;
+
+  is_gnu = (cc->type == CC_GNU_GCC || cc->type == CC_GNU_GPP);
+  if (is_gnu && setup_gcc_library_path(cc,FALSE) > 0)
+  {
+    char *env = getenv_expand ("LIBRARY_PATH");
+
+    print_gcc_internal_dirs ("LIBRARY_PATH", env);
+    FREE (env);
+  }
+  FREE (cygwin_root);
+}
+
+/**
+ * Return TRUE if we shall ignore all gnu-type compilers.
+ */
+static BOOL ignore_all_gnus (compiler_type type)
+{
+  int i, num_gnu = 0, gnu_ignore = 0;
+  int max = smartlist_len (all_cc);
+
+  for (i = 0; i < max; i++)
+  {
+    const compiler_info *cc = smartlist_get (all_cc, i);
+
+    if (cc->type != type)
+       continue;
+
+     num_gnu++;
+     if (cc->ignore)
+        gnu_ignore++;
+  }
+  return (gnu_ignore >= num_gnu);
+}
+
+/**
+ * Add the compilers of `type` to `all_cc` unless already done.
+ * The gcc and g++ compilers are added together.
+ */
+static void add_compilers (compiler_type type)
+{
+  int i, max;
+
+  if (cc_added & (1 << type))
+     return;
+
+  if (!all_cc)
+     all_cc = smartlist_new();
+  i = smartlist_len (all_cc);
+
+  switch (type)
+  {
+    case CC_GNU_GCC:
+    case CC_GNU_GPP:
+         add_gnu_compilers();
+         cc_added |= (1 << CC_GNU_GCC) | (1 << CC_GNU_GPP);
+         break;
+    case CC_MSVC:
+         add_msvc_compilers();
+         break;
+    case CC_CLANG_CL:
+         add_clang_cl_compilers();
+         break;
+    case CC_BORLAND:
+         add_borland_compilers();
+         break;
+    case CC_WATCOM:
+         add_watcom_compilers();
+         break;
+    default:
+         break;
+  }
+  cc_added |= (1 << type);
+
+  max = smartlist_len (all_cc);
+  for ( ; i < max; i++)
+      compiler_check_ignore (smartlist_get(all_cc, i));
+
+  longest_cc = get_longest_short_name();
+
+  if (type == CC_GNU_GCC || type == CC_GNU_GPP)
+  {
+    ignore_all_gcc = ignore_all_gnus (CC_GNU_GCC);
+    ignore_all_gpp = ignore_all_gnus (CC_GNU_GPP);
+    DEBUGF (1, "ignore_all_gcc: %d, ignore_all_gpp: %d.\n", ignore_all_gcc, ignore_all_gpp);
+  }
+}
+
+/**
+ * In `--lib` or `--inc` mode, add the compilers of `type` on first use.
+ * Only the compilers a search needs are searched for on `PATH`.
+ * E.g. with `--no-gcc --no-g++`, no `*gcc.exe` is looked for.
+ */
+static void need_compilers (compiler_type type)
+{
+  int save_u = opt.show_unix_paths;
+
+  if (cc_added & (1 << type))
+     return;
+
+  profile_enter ("compilers");
+  opt.show_unix_paths = 0;
+  add_compilers (type);
+  opt.show_unix_paths = save_u;
+  profile_leave();
+}
+
+/**
+ * Search the `PATH` for all supported compilers.
+ *
+ * \param[in] print_info      If called from `show_version()`, print additional
+ *                            information on each compiler (unless it is in the ignore-list).
+ * \param[in] print_lib_path  If called from `show_version()` and `envtool -VVV` was used,
+ *                            print the internal GCC library paths too.
+ */
+static void search_and_add_all_cc (BOOL print_info, BOOL print_lib_path)
+{
+  struct compiler_info *cc;
+  BOOL   at_least_one_gnu = FALSE;
+  int    i, max, ignored, save = opt.cache_ver_level;
+  int    save_u;
+
+  if (print_info && print_lib_path)
+     opt.cache_ver_level = 3;
+
+  save_u = opt.show_unix_paths;
+  if (!print_info)
+     opt.show_unix_paths = 0;
+
+  add_compilers (CC_GNU_GCC);
+  add_compilers (CC_MSVC);
+  add_compilers (CC_CLANG_CL);
+  add_compilers (CC_BORLAND);
+  add_compilers (CC_WATCOM);
+
+  opt.show_unix_paths = save_u;
+  max = smartlist_len (all_cc);
+
+  if (!print_info)
+     return;
+
+  /* Count the # of compilers that were ignored.
+   * And print some info if it wasn't ignored.
+   */
+  for (i = ignored = 0; i < max; i++)
+  {
+    cc = smartlist_get (all_cc, i);
+    if (cc->ignore)
+         ignored++;
+    else print_compiler_info (cc, print_lib_path);
+
+    if (!at_least_one_gnu)
+       at_least_one_gnu = (cc->type == CC_GNU_GCC || cc->type == CC_GNU_GPP);
+  }
+
+  if (print_lib_path && at_least_one_gnu)
+     C_puts ("    ~3(1)~0: internal GCC library paths.\n");
+
+  opt.cache_ver_level = save;
+
+  if (ignored == 0)
+     return;
+
+  /* Show the ignored ones
+   */
+  C_puts ("\n    Ignored:\n");
+  for (i = 0; i < max; i++)
+  {
+    cc = smartlist_get (all_cc, i);
+    if (cc->ignore)
+       C_printf ("      %s%s\n",
+                 cc->full_name ? cc->full_name : cc->short_name,
+                 cc->full_name == NULL ? "  ~5Not found~0" : "");
+  }
+}
+
+/**
+ * Common to both gcc/g++ checking of include-dirs.
+ */
+static int check_gnu_includes (compiler_type type, int *num_dirs)
+{
+  char  report [_MAX_PATH+50];
+  int   i, max, found;
+  const compiler_info *cc;
+  const char          *env;
+
+  need_compilers (type);
+  *num_dirs = 0;
+  max = smartlist_len (all_cc);
+
+  for (i = found = 0; i < max; i++)
+  {
+    cc = smartlist_get (all_cc, i);
+    if (cc->type == type && !cc->ignore && setup_gcc_includes(cc) > 0)
+    {
+      env = (cc->type == CC_GNU_GCC) ? "%C_INCLUDE_PATH%" : "%CPLUS_INCLUDE_PATH%";
+      snprintf (report, sizeof(report), "Matches in %s %s path:\n", cc->full_name, env);
+      report_header = report;
+      found += process_gcc_dirs (cc->short_name, num_dirs);
+    }
+    FREE (cygwin_root);
+  }
+  return (found);
+}
+
+static int do_check_gcc_includes (void)
+{
+  int num_dirs;
+  int found = check_gnu_includes (CC_GNU_GCC, &num_dirs);
+
+  if (num_dirs == 0 && !ignore_all_gcc)  /* Impossible unless we ignore all `*gcc` */
+     WARN ("No gcc.exe programs returned any include paths.\n");
+  return (found);
+}
+
+static int do_check_gpp_includes (void)
+{
+  int num_dirs;
+  int found = check_gnu_includes (CC_GNU_GPP, &num_dirs);
+
+  if (num_dirs == 0 && !ignore_all_gpp)  /* Impossible unless we ignore all `*g++.exe` */
+     WARN ("No g++.exe programs returned any include paths.\n");
+  return (found);
+}
+
+static int do_check_gcc_library_paths (void)
+{
+  char  report [_MAX_PATH+50];
+  int   found = 0;
+  int   num_dirs = 0;
+  int   i, max;
+  BOOL  is_gnu;
+  const compiler_info *cc;
+  const char          *gcc;
+
+  need_compilers (CC_GNU_GCC);
+  max = smartlist_len (all_cc);
+
+  for (i = 0; i < max; i++)
+  {
+    cc     = smartlist_get (all_cc, i);
+    is_gnu = (cc->type == CC_GNU_GCC || cc->type == CC_GNU_GPP);
+    if (is_gnu && !cc->ignore && setup_gcc_library_path(cc,TRUE) > 0)
+    {
+      gcc = cc->short_name;
+      snprintf (report, sizeof(report), "Matches in %s %%LIBRARY_PATH%% path:\n", cc->full_name);
+      report_header = report;
+      found += process_gcc_dirs (gcc, &num_dirs);
+    }
+    FREE (cygwin_root);
+  }
+
+  if (num_dirs == 0 && !ignore_all_gcc)  /* Impossible unless we ignore all `*gcc` */
+     WARN ("No gcc.exe programs returned any LIBRARY_PATH paths!?.\n");
+
+  return (found);
+}
+
+/*
+ * Check along clang directories
+ */
+static int process_clang_dirs (const char *cc, int *num_dirs)
+{
+  int found = process_dirs (&dir_array, cc, HKEY_INC_LIB_FILE, FALSE);
+
+  *num_dirs = vector_len (&dir_array);
+  free_dir_array();
+  return (found);
+}
+
+static void clang_popen_warn (const compiler_info *cc, int rc)
+{
+  const char *err = popen_last_line();
+
+  if (*err != '\0')
+     err = strstr (err, "error: ");
+
+  WARN ("Calling %s returned %d", cc->full_name, rc);
+  if (err && !opt.quiet)
+     C_printf (":\n  %s.\n", err);
+}
+
+static int setup_clang_includes (const compiler_info *cc)
+{
+  int found;
+
+  free_dir_array();
+
+  /* We want the output of stderr only. But that seems impossible on CMD/4NT.
+   * Hence redirect stderr + stdout into the same pipe for us to read.
+   * Also assume that the `*gcc` is on PATH.
+   */
+  found_search_line = FALSE;
+
+  found = popen_runf (find_include_path_cb, CLANG_DUMP_FMT, cc->full_name);
+  if (found > 0)
+       DEBUGF (1, "found %d include paths for %s.\n", found, cc->full_name);
+  else clang_popen_warn (cc, found);
+  return (found);
+}
+
+static int find_clang_library_path_cb (char *buf, int index)
+{
+  static const char prefix[] = "libraries: =";
+  char  *p, *tok;
+  int    i = 0;
+
+  if (strncmp(buf,prefix,sizeof(prefix)-1) || strlen(buf) <= sizeof(prefix))
+     return (0);
+
+  p = buf + sizeof(prefix) - 1;
+
+  for (i = 0, tok = strtok(p,";"); tok; tok = strtok(NULL,";"), i++)
+  {
+    char buf1 [_MAX_PATH];
+    char buf2 [_MAX_PATH];
+
+    _strlcpy (buf1, tok, sizeof(buf1));
+    _strlcpy (buf2, buf1, sizeof(buf2));
+
+#ifdef HAVE_STRCAT_S
+    strcat_s (buf1, sizeof(buf1), "\\lib\\windows");
+    strcat_s (buf2, sizeof(buf2), "\\..\\..");
+#else
+    strcat (buf1, "\\lib\\windows");
+    strcat (buf2, "\\..\\..");
+#endif
+
+    _fix_path (buf1, buf1);
+    _fix_path (buf2, buf2);
+
+    DEBUGF (2, "buf1: '%s'\n", buf1);
+    add_to_dir_array (buf1, FALSE, __LINE__);
+
+    DEBUGF (2, "buf2: '%s'\n", buf2);
+    add_to_dir_array (buf2, FALSE, __LINE__);
+  }
+  ARGSUSED (index);
+  return (2*i);
+}
+
+static int setup_clang_library_path (const compiler_info *cc)
+{
+  int found;
+
+  free_dir_array();
+
+  /* We want the output of stderr only. But that seems impossible on CMD/4NT.
+   * Hence redirect stderr + stdout into the same pipe for us to read.
+   * Also assume that the `*gcc` is on PATH.
+   */
+  found_search_line = FALSE;
+
+  found = popen_runf (find_clang_library_path_cb, "%s -print-search-dirs", cc->full_name);
+  if (found > 0)
+       DEBUGF (1, "found %d library paths for %s.\n", found, cc->full_name);
+  else clang_popen_warn (cc, found);
+  return (found);
+}
+
+/**
+ * Checking of clang include-dirs.
+ */
+static int do_check_clang_includes (void)
+{
+  char report [_MAX_PATH+50];
+  int  i, max, found, num_dirs = 0;
+
+  need_compilers (CC_CLANG_CL);
+  max = smartlist_len (all_cc);
+
+  for (i = found = 0; i < max; i++)
+  {
+    const compiler_info *cc = smartlist_get (all_cc, i);
+
+    if (cc->type == CC_CLANG_CL && !cc->ignore &&
+        !stricmp("clang.exe",cc->short_name)   &&   /* Do it for clang.exe only */
+        setup_clang_includes(cc) > 0)
+    {
+      snprintf (report, sizeof(report), "Matches in %s %%INCLUDE%% path:\n", cc->full_name);
+      report_header = report;
+      found += process_clang_dirs (cc->short_name, &num_dirs);
+    }
+    FREE (cygwin_root);
+  }
+
+  if (num_dirs == 0)
+     WARN ("No clang.exe programs returned any include paths.\n");
+  return (found);
+}
+
+/**
+ * Checking of special clang library-dirs.
+ */
+static int do_check_clang_library_paths (void)
+{
+  char report [_MAX_PATH+50];
+  int  i, max, found, num_dirs = 0;
+
+  need_compilers (CC_CLANG_CL);
+  max = smartlist_len (all_cc);
+
+  for (i = found = 0; i < max; i++)
+  {
+    const compiler_info *cc = smartlist_get (all_cc, i);
+
+    if (cc->type == CC_CLANG_CL && !cc->ignore &&
+        !stricmp("clang.exe",cc->short_name)   &&   /* Do it for clang.exe only */
+        setup_clang_library_path(cc) > 0)
+    {
+      snprintf (report, sizeof(report), "Matches in %s %%LIB%% path:\n", cc->full_name);
+      report_header = report;
+      found += process_clang_dirs (cc->short_name, &num_dirs);
+    }
+    FREE (cygwin_root);
+  }
+
+  if (num_dirs == 0)
+     WARN ("\nNo clang.exe programs returned any library paths.\n");
+  return (found);
+}
+
+/**
+ * Common stuff for Watcom checking.
+ */
+static int setup_watcom_dirs (const char *dir0, const char *dir1, const char *dir2)
+{
+  const compiler_info *cc;
+  int   i, found, ignored, max;
+  BOOL  dir2_found;
+
+  need_compilers (CC_WATCOM);
+  max = smartlist_len (all_cc);
+  for (i = found = ignored = 0; i < max; i++)
+  {
+    cc = smartlist_get (all_cc, i);
+    if (!cc->full_name || cc->type != CC_WATCOM)
+       continue;
+
+    found++;
+    if (cc->ignore)
+       ignored++;
+  }
+
+  if (found == 0)
+  {
+    DEBUGF (1, "No Watcom compilers found.\n");
+    return (0);
+  }
+
+  if (ignored >= found)
+  {
+    DEBUGF (1, "All Watcom compilers were ignored.\n");
+    return (0);
+  }
+
+  if (!getenv("WATCOM"))
+  {
+    DEBUGF (1, "%%WATCOM%% not defined.\n");
+    return (0);
+  }
+
+  if (!opt.no_cwd)
+     add_to_dir_array (current_dir, 1, __LINE__);
+
+  watcom_dir[0] = getenv_expand (dir0);
+  watcom_dir[1] = getenv_expand (dir1);
+  watcom_dir[2] = getenv_expand (dir2);
+
+  /* This directory exist only on newer Watcom distos.
+   * Like "%WATCOM%\\lh" for Linux headers.
+   */
+  dir2_found = is_directory (watcom_dir[2]);
+
+  add_to_dir_array (watcom_dir[0], 0, __LINE__);
+  add_to_dir_array (watcom_dir[1], 0, __LINE__);
+  if (dir2_found)
+     add_to_dir_array (watcom_dir[2], 0, __LINE__);
+
+  return (1);
+}
+
+static void free_watcom_dirs (void)
+{
+  FREE (watcom_dir[0]);
+  FREE (watcom_dir[1]);
+  FREE (watcom_dir[2]);
+  FREE (watcom_dir[3]);
+}
+
+/**
+ * Check in Watcom's include-directories:
+ * \code
+ *   %WATCOM%\h
+ *   %WATCOM%\nt
+ *   %WATCOM%\lh    (Linux headers in recent OpenWatcom)
+ * \endcode
+ *
+ * And full path given by `%NT_INCLUDE%`.
+ *
+ * \note We do not spawn `"wcc*.exe"` to ask for it's internal include-directory
+ *   (as we do for `"gcc*"`). Simply search along the above directories.
+ *   Does not searches `"%INCLUDE%"`.
+ */
+static int do_check_watcom_includes (void)
+{
+  int i, max, save, found = 0;
+
+  watcom_dir[3] = getenv_expand ("%NT_INCLUDE%");
+
+  if (!watcom_dir[3])
+       DEBUGF (1, "Env-var %s not defined.\n", "%NT_INCLUDE%");
+  else split_env_var ("%NT_INCLUDE%", watcom_dir[3]);
+
+  /* This will append to what was inserted in `dir_array` above.
+   * Do not add `".\\"` again (set `opt.no_cwd` to 1).
+   */
+  save = opt.no_cwd;
+  opt.no_cwd = 1;
+  if (!setup_watcom_dirs("%WATCOM%\\h", "%WATCOM%\\h\\nt", "%WATCOM%\\lh"))
+     goto quit;
+
+  /* The above adding of `"%NT_INCLUDE"` will probably create duplicate
+   * entries. Remove them.
+   */
+  make_unique_dir_array ("%NT_INCLUDE%");
+
+  report_header = "Matches in %NT_INCLUDE:\n";
+
+  max = vector_len (&dir_array);
+  for (i = 0; i < max; i++)
+  {
+    struct directory_array *arr = vector_get (&dir_array, i);
+
+    found += process_dir (arr->dir, arr->num_dup, arr->exist, TRUE,
+                          arr->is_dir, arr->exp_ok, "WATCOM", HKEY_INC_LIB_FILE, FALSE);
+  }
+
+quit:
+  opt.no_cwd = save;
+  free_watcom_dirs();
+  free_dir_array();
+  return (found);
+}
+
+/**
+ * Check in Watcom's library-directories:
+ * \code
+ *   %WATCOM%\lib386
+ *   %WATCOM%\lib386\nt
+ *   %WATCOM%\lib386\linux    (Linux libs in recent OpenWatcom)
+ * \endcode
+ */
+static int do_check_watcom_library_paths (void)
+{
+  int i, max, found;
+
+  if (!setup_watcom_dirs("%WATCOM%\\lib386", "%WATCOM%\\lib386\\nt", "%WATCOM%\\lib386\\linux"))
+     return (0);
+
+  report_header = "Matches in %WATCOM libraries:\n";
+
+  max = vector_len (&dir_array);
+  for (i = found = 0; i < max; i++)
+  {
+    struct directory_array *arr = vector_get (&dir_array, i);
+
+    found += process_dir (arr->dir, arr->num_dup, arr->exist, TRUE,
+                          arr->is_dir, arr->exp_ok, "WATCOM", HKEY_INC_LIB_FILE, FALSE);
+  }
+  dump_dir_array ("Watcom libs", "");
+  free_watcom_dirs();
+  free_dir_array();
+  return (found);
+}
+
+/**
+ * Common stuff for Borland checking.
+ */
+static char *bcc_root = NULL;
+
+typedef void (*bcc_parser_func) (smartlist_t *sl, char *line);
+
+/**
+ * Check in Borland's include-directories which are given by the format in
+ * `<bcc_root>\bcc32c.cfg`:
+ * ```
+ *  -isystem @\..\include\dinkumware64
+ *  -isystem @\..\include\windows\crtl
+ * ```
+ *
+ * Or the older format in `<bcc_root>\bcc32.cfg`:
+ * ```
+ *  -I<inc_path1>;<inc_path2>...
+ * ```
+ */
+static void bcc32_cfg_parse_inc (smartlist_t *sl, char *line)
+{
+  const char *isystem = "-isystem @\\..\\";
+
+  line = strip_nl (str_ltrim(line));
+  DEBUGF (2, "line: %s.\n", line);
+
+  if (!strnicmp(line,isystem,strlen(isystem)))
+  {
+    char dir [MAX_PATH];
+
+    snprintf (dir, sizeof(dir), "%s\\%s", bcc_root, line + strlen(isystem));
+    DEBUGF (2, "dir: %s.\n", dir);
+    add_to_dir_array (dir, FALSE, __LINE__);
+  }
+  else if (!strncmp(line,"-I",2))
+  {
+    split_env_var ("Borland INC", str_ltrim(line+2));
+  }
+  ARGSUSED (sl);
+}
+
+/**
+ * Check in Borland's library-directories which are given by the format in
+ * `<bcc_root>\bcc32c.cfg`:
+ * ```
+ *   -L@\..\lib\win32c\debug
+ *   -L@\..\lib\win32c\release
+ * ```
+ *
+ * Or the older format in `<bcc_root>\bcc32.cfg`:
+ * ```
+ *  -L<lib_path1>;<lib_path2>...
+ * ```
+ */
+static void bcc32_cfg_parse_lib (smartlist_t *sl, char *line)
+{
+  const char *Ldir = "-L@\\..\\";
+
+  line = strip_nl (str_ltrim(line));
+  DEBUGF (2, "line: %s.\n", line);
+
+  if (!strnicmp(line,Ldir,strlen(Ldir)))
+  {
+    char dir [MAX_PATH];
+
+    snprintf (dir, sizeof(dir), "%s\\%s", bcc_root, line + strlen(Ldir));
+    DEBUGF (2, "dir: %s.\n", dir);
+    add_to_dir_array (dir, FALSE, __LINE__);
+  }
+  else if (!strncmp(line,"-L",2))
+  {
+    split_env_var ("Borland LIB", str_ltrim(line+2));
+  }
+  ARGSUSED (sl);
+}
+
+/**
+ * Setup Borland directories for either a INC or LIB search.
+ */
+static BOOL setup_borland_dirs (const compiler_info *cc, bcc_parser_func parser)
+{
+  smartlist_t *dir_list;
+  char        *bin_dir;
+  char         bcc_cfg [_MAX_PATH];
+
+  bcc_root = strlwr (STRDUP(cc->full_name));
+  bin_dir =  strrchr (bcc_root, '\\');
+  *bin_dir = '\0';
+  bin_dir =  strrchr (bcc_root, '\\');
+  *bin_dir = '\0';
+
+  DEBUGF (2, "bcc_root: %s, short_name: %s\n", bcc_root, cc->short_name);
+
+  /* Get the `bcc*.cfg` filename:
+   * <bcc_root>\bccX.exe -> <bcc_root>\bccX.cfg
+   */
+  snprintf (bcc_cfg, sizeof(bcc_cfg), "%s\\bin\\%.*s.cfg",
+            bcc_root, strrchr(cc->short_name,'.') - cc->short_name, cc->short_name);
+
+  DEBUGF (2, "bcc_cfg: %s.\n", bcc_cfg);
+
+  dir_list = smartlist_read_file (bcc_cfg, (smartlist_parse_func)parser);
+  if (!dir_list)
+  {
+    FREE (bcc_root);
+    return (FALSE);
+  }
+  smartlist_free (dir_list);  /* No need for this */
+  return (TRUE);
+}
+
+static int do_check_borland_inc_lib (const char *inc_lib, const char *matches, bcc_parser_func parser)
+{
+  int   ignored, bcc_found, found = 0;
+  int   i, j, max_i, max_j;
+  const compiler_info *cc;
+
+  need_compilers (CC_BORLAND);
+  max_i = smartlist_len (all_cc);
+
+  for (i = bcc_found = ignored = 0; i < max_i; i++)
+  {
+    cc = smartlist_get (all_cc, i);
+    if (!cc->full_name || cc->type != CC_BORLAND)
+       continue;
+
+    bcc_found++;
+    if (cc->ignore)
+       ignored++;
+
+    if (!cc->ignore && setup_borland_dirs(cc, parser))
+    {
+      char report [_MAX_PATH+50];
+
+      snprintf (report, sizeof(report), matches, cc->full_name);
+      report_header = report;
+
+      max_j = vector_len (&dir_array);
+      for (j = 0; j < max_j; j++)
+      {
+        struct directory_array *arr = vector_get (&dir_array, j);
+
+        DEBUGF (1, "arr->dir: %s.\n", arr->dir);
+
+        found += process_dir (arr->dir, arr->num_dup, arr->exist, TRUE,
+                              arr->is_dir, arr->exp_ok, inc_lib,
+                              HKEY_INC_LIB_FILE, FALSE);
+      }
+      free_dir_array();
+      FREE (bcc_root);
+    }
+  }
+
+  if (bcc_found == 0)
+  {
+    DEBUGF (1, "No Borland compilers found.\n");
+    return (0);
+  }
+  if (ignored >= bcc_found)
+  {
+    DEBUGF (1, "All Borland compilers were ignored.\n");
+    return (0);
+  }
+  return (found);
+}
+
+/**
+ * Check all `bcc*.exe` found on `PATH` for an `INC` search.
+ */
+static int do_check_borland_includes (void)
+{
+  return do_check_borland_inc_lib ("Borland INC", "Matches in %s headers:\n",
+                                   bcc32_cfg_parse_inc);
+}
+
+/**
+ * Check all `bcc*.exe` found on `PATH` for a `LIB` search.
+ */
+static int do_check_borland_library_paths (void)
+{
+  return do_check_borland_inc_lib ("Borland LIB", "Matches in %s libraries:\n",
+                                   bcc32_cfg_parse_lib);
+}
+
+/**
+ * getopt_long() processing.
+ */
+static const struct option long_options[] = {
+           { "help",        no_argument,       NULL, 'h' },
+           { "help",        no_argument,       NULL, '?' },  /* 1 */
+           { "version",     no_argument,       NULL, 'V' },
+           { "inc",         no_argument,       NULL, 0 },    /* 3 */
+           { "path",        no_argument,       NULL, 0 },
+           { "lib",         no_argument,       NULL, 0 },    /* 5 */
+           { "python",      optional_argument, NULL, 0 },
+           { "dir",         no_argument,       NULL, 'D' },  /* 7 */
+           { "debug",       optional_argument, NULL, 'd' },
+           { "no-sys",      no_argument,       NULL, 0 },    /* 9 */
+           { "no-usr",      no_argument,       NULL, 0 },
+           { "no-app",      no_argument,       NULL, 0 },    /* 11 */
+           { "test",        no_argument,       NULL, 't' },
+           { "quiet",       no_argument,       NULL, 'q' },  /* 13 */
+           { "no-gcc",      no_argument,       NULL, 0 },
+           { "no-g++",      no_argument,       NULL, 0 },    /* 15 */
+           { "verbose",     no_argument,       NULL, 'v' },
+           { "pe",          no_argument,       NULL, 0 },    /* 17 */
+           { "no-colour",   no_argument,       NULL, 0 },
+           { "no-color",    no_argument,       NULL, 0 },    /* 19 */
+           { "evry",        optional_argument, NULL, 0 },
+           { "regex",       no_argument,       NULL, 0 },    /* 21 */
+           { "size",        no_argument,       NULL, 0 },
+           { "man",         no_argument,       NULL, 0 },    /* 23 */
+           { "cmake",       no_argument,       NULL, 0 },
+           { "pkg",         no_argument,       NULL, 0 },    /* 25 */
+           { "32",          no_argument,       NULL, 0 },
+           { "64",          no_argument,       NULL, 0 },    /* 27 */
+           { "no-prefix",   no_argument,       NULL, 0 },
+           { "no-ansi",     no_argument,       NULL, 0 },    /* 29 */
+           { "host",        required_argument, NULL, 0 },
+           { "buffered-io", no_argument,       NULL, 0 },    /* 31 */
+           { "nonblock-io", no_argument,       NULL, 0 },
+           { "no-watcom",   no_argument,       NULL, 0 },    /* 33 */
+           { "no-borland",  no_argument,       NULL, 0 },
+           { "no-clang",    no_argument,       NULL, 0 },    /* 35 */
+           { "owner",       optional_argument, NULL, 0 },
+           { "check",       no_argument,       NULL, 0 },    /* 37 */
+           { "signed",      optional_argument, NULL, 0 },
+           { "no-cwd",      no_argument,       NULL, 0 },    /* 39 */
+           { "sort",        required_argument, NULL, 0 },
+           { "vcpkg",       no_argument,       NULL, 0 },    /* 41 */
+           { "threads",     optional_argument, NULL, 0 },
+           { "dir-cache",   no_argument,       NULL, 0 },    /* 43 */
+           { "spec-file",   required_argument, NULL, 0 },
+           { "sort-mem",    required_argument, NULL, 0 },    /* 45 */
+           { "format",      required_argument, NULL, 0 },
+           { "output",      required_argument, NULL, 0 },    /* 47 */
+           { "size-budget", required_argument, NULL, 0 },
+           { "first",       no_argument,       NULL, 0 },    /* 49 */
+           { "max-matches", required_argument, NULL, 0 },
+           { "watch",       no_argument,       NULL, 0 },    /* 51 */
+           { "shadow",      no_argument,       NULL, 0 },
+           { "batch",       optional_argument, NULL, 0 },    /* 53 */
+           { "daemon",      no_argument,       NULL, 0 },
+           { "profile",     no_argument,       NULL, 0 },    /* 55 */
+           { NULL,          no_argument,       NULL, 0 }
+         };
+
+static int *values_tab[] = {
+            NULL,
+            NULL,                     /* 1 */
+            NULL,
+            &opt.do_include,          /* 3 */
+            &opt.do_path,
+            &opt.do_lib,              /* 5 */
+            &opt.do_python,
+            &opt.dir_mode,            /* 7 */
+            NULL,
+            &opt.no_sys_env,          /* 9 */
+            &opt.no_usr_env,
+            &opt.no_app_path,         /* 11 */
+            NULL,
+            NULL,                     /* 13 */
+            &opt.no_gcc,
+            &opt.no_gpp,              /* 15 */
+            &opt.verbose,
+            &opt.PE_check,            /* 17 */
+            &opt.no_colours,
+            &opt.no_colours,          /* 19 */
+            &opt.do_evry,
+            &opt.use_regex,           /* 21 */
+            &opt.show_size,
+            &opt.do_man,              /* 23 */
+            &opt.do_cmake,
+            &opt.do_pkg,              /* 25 */
+            &opt.only_32bit,
+            &opt.only_64bit,          /* 27 */
+            &opt.gcc_no_prefixed,
+            &opt.no_ansi,             /* 29 */
+            (int*)&opt.evry_host,
+            &opt.use_buffered_io,     /* 31 */
+            &opt.use_nonblock_io,
+            &opt.no_watcom,           /* 33 */
+            &opt.no_borland,
+            &opt.no_clang,            /* 35 */
+            &opt.show_owner,
+            &opt.do_check,            /* 37 */
+            (int*)&opt.signed_status,
+            &opt.no_cwd,              /* 39 */
+            (int*)&opt.sort_method,
+            &opt.do_vcpkg,            /* 41 */
+            &opt.scan_threads,
+            &opt.use_dir_cache,       /* 43 */
+            (int*)&opt.file_specs,
+            &opt.sort_mem,            /* 45 */
+            (int*)&opt.sink_format,
+            (int*)&opt.sink_file,     /* 47 */
+            &opt.size_budget,
+            &opt.max_matches,         /* 49 */
+            &opt.max_matches,
+            &opt.do_watch,            /* 51 */
+            &opt.do_shadow,
+            (int*)&opt.batch_file,    /* 53 */
+            &opt.do_daemon,
+            &opt.do_profile           /* 55 */
+          };
+
+/**
+ * `getopt_long()` handler for option `--python=<short_name>`.
+ *
+ * Accept only a Python `short_name` which is compiled in.
+ *
+ * Ref. the `all_py_programs[]` array in envtool_py.c.
+ */
+static void set_python_variant (const char *arg)
 {
-  char  report [_MAX_PATH+50];
-  int   found = 0;
-  int   num_dirs = 0;
-  int   i, max;
-  BOOL  is_gnu;
-  const compiler_info *cc;
-  const char          *gcc;
+  const char **py = py_get_variants();
+  unsigned     v  = UNKNOWN_PYTHON;
+  int          i;
 
-  max = smartlist_len (all_cc);
+  DEBUGF (2, "optarg: '%s'\n", arg);
+  ASSERT (arg);
 
-  for (i = 0; i < max; i++)
+  for (i = 0; py[i]; i++)
+     if (!stricmp(arg,py[i]))
+     {
+       v = py_variant_value (arg, NULL);
+       break;
+    }
+
+  if (v == UNKNOWN_PYTHON)
   {
-    cc     = smartlist_get (all_cc, i);
-    is_gnu = (cc->type == CC_GNU_GCC || cc->type == CC_GNU_GPP);
-    if (is_gnu && !cc->ignore && setup_gcc_library_path(cc,TRUE) > 0)
+    char buf[100], *p = buf;
+    int  left = sizeof(buf)-1;
+
+    for (i = 0; py[i] && left > 4; i++)
     {
-      gcc = cc->short_name;
-      snprintf (report, sizeof(report), "Matches in %s %%LIBRARY_PATH%% path:\n", cc->full_name);
-      report_header = report;
-      found += process_gcc_dirs (gcc, &num_dirs);
+      p += snprintf (p, left, "\"%s\", ", py[i]);
+      left = (int) (sizeof(buf) - (p - buf));
     }
-    FREE (cygwin_root);
+    if (p > buf+2)
+       p[-2] = '\0';
+    usage ("Illegal '--python' option: '%s'.\n"
+           "Use one of these: %s.\n", arg, buf);
   }
 
-  if (num_dirs == 0 && !ignore_all_gcc)  /* Impossible unless we ignore all `*gcc` */
-     WARN ("No gcc.exe programs returned any LIBRARY_PATH paths!?.\n");
-
-  return (found);
+  /* Found a valid match
+   */
+  py_which = (enum python_variants) v;
 }
 
-/*
- * Check along clang directories
+/**
+ * `getopt_long()` handler for option `-H arg` or `--host arg` used by remote ETP queries.
  */
-static int process_clang_dirs (const char *cc, int *num_dirs)
+static void set_evry_options (const char *arg)
 {
-  int i, found, max = smartlist_len (dir_array);
-
-  for (i = found = 0; i < max; i++)
+  if (arg)
   {
-    const struct directory_array *arr = smartlist_get (dir_array, i);
-
-    DEBUGF (2, "dir: %s\n", arr->dir);
-    found += process_dir (arr->dir, arr->num_dup, arr->exist, arr->check_empty,
-                          arr->is_dir, arr->exp_ok, cc, HKEY_INC_LIB_FILE, FALSE);
+    if (!opt.evry_host)
+       opt.evry_host = smartlist_new();
+    smartlist_add (opt.evry_host, STRDUP(arg));
   }
-  *num_dirs = max;
-  free_dir_array();
-  return (found);
 }
 
-static void clang_popen_warn (const compiler_info *cc, int rc)
+/**
+ * `getopt_long()` handler for option `--signed`.
+ */
+static void set_signed_options (const char *arg)
 {
-  const char *err = popen_last_line();
-
-  if (*err != '\0')
-     err = strstr (err, "error: ");
-
-  WARN ("Calling %s returned %d", cc->full_name, rc);
-  if (err && !opt.quiet)
-     C_printf (":\n  %s.\n", err);
-}
+  static const struct search_list sign_status[] = {
+                    { SIGN_CHECK_ALL,      "SIGN_CHECK_ALL"      },
+                    { SIGN_CHECK_UNSIGNED, "SIGN_CHECK_UNSIGNED" },
+                    { SIGN_CHECK_SIGNED,   "SIGN_CHECK_SIGNED"   },
+                  };
 
-static int setup_clang_includes (const compiler_info *cc)
-{
-  int found;
+  opt.signed_status = SIGN_CHECK_ALL;
 
-  free_dir_array();
+  if (arg)
+  {
+    if (*arg == '1' || !stricmp(arg,"on") || !stricmp(arg,"yes"))
+       opt.signed_status = SIGN_CHECK_SIGNED;
 
-  /* We want the output of stderr only. But that seems impossible on CMD/4NT.
-   * Hence redirect stderr + stdout into the same pipe for us to read.
-   * Also assume that the `*gcc` is on PATH.
-   */
-  found_search_line = FALSE;
+    else if (*arg == '0' || !stricmp(arg,"off") || !stricmp(arg,"no"))
+       opt.signed_status = SIGN_CHECK_UNSIGNED;
+  }
 
-  found = popen_runf (find_include_path_cb, CLANG_DUMP_FMT, cc->full_name);
-  if (found > 0)
-       DEBUGF (1, "found %d include paths for %s.\n", found, cc->full_name);
-  else clang_popen_warn (cc, found);
-  return (found);
+  DEBUGF (2, "got long option \"--signed %s\" -> opt.signed_status: %s\n",
+          arg, list_lookup_name(opt.signed_status,sign_status, DIM(sign_status)));
 }
 
-static int find_clang_library_path_cb (char *buf, int index)
+/**
+ * Add a file-spec to `opt.file_specs`.
+ */
+static void add_file_spec (const char *spec)
 {
-  static const char prefix[] = "libraries: =";
-  char  *p, *tok;
-  int    i = 0;
-
-  if (strncmp(buf,prefix,sizeof(prefix)-1) || strlen(buf) <= sizeof(prefix))
-     return (0);
-
-  p = buf + sizeof(prefix) - 1;
-
-  for (i = 0, tok = strtok(p,";"); tok; tok = strtok(NULL,";"), i++)
-  {
-    char buf1 [_MAX_PATH];
-    char buf2 [_MAX_PATH];
-
-    _strlcpy (buf1, tok, sizeof(buf1));
-    _strlcpy (buf2, buf1, sizeof(buf2));
-
-#ifdef HAVE_STRCAT_S
-    strcat_s (buf1, sizeof(buf1), "\\lib\\windows");
-    strcat_s (buf2, sizeof(buf2), "\\..\\..");
-#else
-    strcat (buf1, "\\lib\\windows");
-    strcat (buf2, "\\..\\..");
-#endif
-
-    _fix_path (buf1, buf1);
-    _fix_path (buf2, buf2);
+  if (!opt.file_specs)
+     opt.file_specs = smartlist_new();
+  smartlist_add (opt.file_specs, STRDUP(spec));
+}
 
-    DEBUGF (2, "buf1: '%s'\n", buf1);
-    add_to_dir_array (buf1, FALSE, __LINE__);
+/**
+ * Callback for `smartlist_read_file()`:
+ * Add a non-empty line in a `--spec-file` as a file-spec.
+ */
+static void spec_file_parse (smartlist_t *sl, const char *line)
+{
+  char buf [_MAX_PATH], *p;
 
-    DEBUGF (2, "buf2: '%s'\n", buf2);
-    add_to_dir_array (buf2, FALSE, __LINE__);
-  }
-  ARGSUSED (index);
-  return (2*i);
+  _strlcpy (buf, line, sizeof(buf));
+  p = str_trim (buf);
+  if (*p)
+     add_file_spec (p);
+  ARGSUSED (sl);
 }
 
-static int setup_clang_library_path (const compiler_info *cc)
+/**
+ * `getopt_long()` handler for option `--spec-file`.
+ * Read file-specs from `fname`; one on each line.
+ */
+static void read_spec_file (const char *fname)
 {
-  int found;
-
-  free_dir_array();
+  smartlist_t *sl = smartlist_read_file (fname, spec_file_parse);
 
-  /* We want the output of stderr only. But that seems impossible on CMD/4NT.
-   * Hence redirect stderr + stdout into the same pipe for us to read.
-   * Also assume that the `*gcc` is on PATH.
-   */
-  found_search_line = FALSE;
+  if (!sl)
+     usage ("Failed to read file-specs from \"%s\".\n", fname);
+  smartlist_free (sl);
+}
 
-  found = popen_runf (find_clang_library_path_cb, "%s -print-search-dirs", cc->full_name);
-  if (found > 0)
-       DEBUGF (1, "found %d library paths for %s.\n", found, cc->full_name);
-  else clang_popen_warn (cc, found);
-  return (found);
+/**
+ * Add an owner-pattern to `opt.owners` and it's compiled form to `owner_specs`.
+ * A leading `!` is not part of the compiled pattern.
+ */
+static void add_owner (const char *owner)
+{
+  smartlist_add (opt.owners, STRDUP(owner));
+  if (*owner == '!')
+     owner++;
+  smartlist_add (owner_specs, fnmatch_compile(owner, FNM_FLAG_NOCASE));
 }
 
 /**
- * Checking of clang include-dirs.
+ * `getopt_long()` handler for option `--owner`.
  */
-static int do_check_clang_includes (void)
+static void set_owner_options (const char *arg)
 {
-  char report [_MAX_PATH+50];
-  int  i, found, num_dirs = 0;
-  int  max = smartlist_len (all_cc);
+  opt.show_owner = 1;
 
-  for (i = found = 0; i < max; i++)
+  if (!opt.owners)
   {
-    const compiler_info *cc = smartlist_get (all_cc, i);
-
-    if (cc->type == CC_CLANG_CL && !cc->ignore &&
-        !stricmp("clang.exe",cc->short_name)   &&   /* Do it for clang.exe only */
-        setup_clang_includes(cc) > 0)
-    {
-      snprintf (report, sizeof(report), "Matches in %s %%INCLUDE%% path:\n", cc->full_name);
-      report_header = report;
-      found += process_clang_dirs (cc->short_name, &num_dirs);
-    }
-    FREE (cygwin_root);
+    opt.owners  = smartlist_new();
+    owner_specs = smartlist_new();
   }
 
-  if (num_dirs == 0)
-     WARN ("No clang.exe programs returned any include paths.\n");
-  return (found);
+  if (arg)
+     add_owner (arg);
+  else
+  if (smartlist_len(opt.owners) == 0)
+     add_owner ("*");
 }
 
 /**
- * Checking of special clang library-dirs.
+ * The handler for short options called from `getopt_long()`.
+ *
+ * \param[in] o    an alphabetical letters given in `c->short_opt` and `getopt_parse(c)`.
+ * \param[in] arg  the optional argument for the option.
  */
-static int do_check_clang_library_paths (void)
+static void set_short_option (int o, const char *arg)
 {
-  char report [_MAX_PATH+50];
-  int  i, found, num_dirs = 0;
-  int  max = smartlist_len (all_cc);
+  DEBUGF (2, "got short option '%c' (%d).\n", o, o);
 
-  for (i = found = 0; i < max; i++)
+  switch (o)
   {
-    const compiler_info *cc = smartlist_get (all_cc, i);
-
-    if (cc->type == CC_CLANG_CL && !cc->ignore &&
-        !stricmp("clang.exe",cc->short_name)   &&   /* Do it for clang.exe only */
-        setup_clang_library_path(cc) > 0)
-    {
-      snprintf (report, sizeof(report), "Matches in %s %%LIB%% path:\n", cc->full_name);
-      report_header = report;
-      found += process_clang_dirs (cc->short_name, &num_dirs);
-    }
-    FREE (cygwin_root);
+    case 'h':
+         opt.help = 1;
+         break;
+    case 'H':
+         set_evry_options (arg);
+         break;
+    case 'V':
+         opt.do_version++;
+         break;
+    case 'v':
+         opt.verbose++;
+         break;
+    case 'd':
+         opt.debug++;
+         break;
+    case 'D':
+         opt.dir_mode = 1;
+         break;
+    case 'c':
+         opt.case_sensitive = 1;
+         break;
+    case 'k':
+         opt.keep_temp = 1;
+         break;
+    case 'r':
+         opt.use_regex = 1;
+         break;
+    case 's':
+         opt.show_size = 1;
+         break;
+    case 'S':
+         if (!set_sort_method(arg, NULL))
+            usage ("Illegal \"-S\" method '%s'. Use one of: %s\n",
+                   arg, get_sort_methods_short());
+         break;
+    case 'T':
+         opt.decimal_timestamp = 1;
+         break;
+    case 't':
+         opt.do_tests++;
+         break;
+    case 'u':
+         opt.show_unix_paths = 1;
+         break;
+    case 'q':
+         opt.quiet = 1;
+         break;
+    case '?':      /* '?' == BADCH || BADARG */
+         usage ("  Use %s \"-h\" / \"--help\" for options\n", who_am_I);
+         break;
+    default:
+         usage ("Illegal option: '%c'\n", optopt);
+         break;
   }
-
-  if (num_dirs == 0)
-     WARN ("\nNo clang.exe programs returned any library paths.\n");
-  return (found);
 }
 
 /**
- * Common stuff for Watcom checking.
+ * The handler for long options called from `getopt_long()`.
+ *
+ * \param[in] o    the index into `long_options[]`.
+ * \param[in] arg  the optional argument for the option.
  */
-static int setup_watcom_dirs (const char *dir0, const char *dir1, const char *dir2)
+static void set_long_option (int o, const char *arg)
 {
-  const compiler_info *cc;
-  int   i, found, ignored, max;
-  BOOL  dir2_found;
+  int new_value, *val_ptr;
 
-  max = smartlist_len (all_cc);
-  for (i = found = ignored = 0; i < max; i++)
-  {
-    cc = smartlist_get (all_cc, i);
-    if (!cc->full_name || cc->type != CC_WATCOM)
-       continue;
+  ASSERT (values_tab[o]);
+  ASSERT (long_options[o].name);
 
-    found++;
-    if (cc->ignore)
-       ignored++;
-  }
+  ASSERT (o >= 0);
+  ASSERT (o < DIM(values_tab));
 
-  if (found == 0)
+  DEBUGF (2, "got long option \"--%s\" with argument \"%s\".\n",
+          long_options[o].name, arg);
+
+  if (!strcmp("evry",long_options[o].name))
   {
-    DEBUGF (1, "No Watcom compilers found.\n");
-    return (0);
+    set_evry_options (arg);
+    opt.do_evry = 1;
+    return;
   }
 
-  if (ignored >= found)
+  if (!strcmp("signed",long_options[o].name))
   {
-    DEBUGF (1, "All Watcom compilers were ignored.\n");
-    return (0);
+    set_signed_options (arg);
+    return;
   }
 
-  if (!getenv("WATCOM"))
+  if (!strcmp("sort",long_options[o].name))
   {
-    DEBUGF (1, "%%WATCOM%% not defined.\n");
-    return (0);
+    if (!set_sort_method(NULL, arg))
+       usage ("Illegal \"-S\" method '%s'. Use one of: %s\n",
+              arg, get_sort_methods_long());
+    return;
   }
 
-  if (!opt.no_cwd)
-     add_to_dir_array (current_dir, 1, __LINE__);
-
-  watcom_dir[0] = getenv_expand (dir0);
-  watcom_dir[1] = getenv_expand (dir1);
-  watcom_dir[2] = getenv_expand (dir2);
-
-  /* This directory exist only on newer Watcom distos.
-   * Like "%WATCOM%\\lh" for Linux headers.
-   */
-  dir2_found = is_directory (watcom_dir[2]);
-
-  add_to_dir_array (watcom_dir[0], 0, __LINE__);
-  add_to_dir_array (watcom_dir[1], 0, __LINE__);
-  if (dir2_found)
-     add_to_dir_array (watcom_dir[2], 0, __LINE__);
-
-  return (1);
-}
-
-static void free_watcom_dirs (void)
-{
-  FREE (watcom_dir[0]);
-  FREE (watcom_dir[1]);
-  FREE (watcom_dir[2]);
-  FREE (watcom_dir[3]);
-}
-
-/**
- * Check in Watcom's include-directories:
- * \code
- *   %WATCOM%\h
- *   %WATCOM%\nt
- *   %WATCOM%\lh    (Linux headers in recent OpenWatcom)
- * \endcode
- *
- * And full path given by `%NT_INCLUDE%`.
- *
- * \note We do not spawn `"wcc*.exe"` to ask for it's internal include-directory
- *   (as we do for `"gcc*"`). Simply search along the above directories.
- *   Does not searches `"%INCLUDE%"`.
- */
-static int do_check_watcom_includes (void)
-{
-  int i, max, save, found = 0;
-
-  watcom_dir[3] = getenv_expand ("%NT_INCLUDE%");
-
-  if (!watcom_dir[3])
-       DEBUGF (1, "Env-var %s not defined.\n", "%NT_INCLUDE%");
-  else split_env_var ("%NT_INCLUDE%", watcom_dir[3]);
-
-  /* This will append to what was inserted in `dir_array` above.
-   * Do not add `".\\"` again (set `opt.no_cwd` to 1).
-   */
-  save = opt.no_cwd;
-  opt.no_cwd = 1;
-  if (!setup_watcom_dirs("%WATCOM%\\h", "%WATCOM%\\h\\nt", "%WATCOM%\\lh"))
-     goto quit;
-
-  /* The above adding of `"%NT_INCLUDE"` will probably create duplicate
-   * entries. Remove them.
-   */
-  make_unique_dir_array ("%NT_INCLUDE%");
-
-  report_header = "Matches in %NT_INCLUDE:\n";
-
-  max = smartlist_len (dir_array);
-  for (i = 0; i < max; i++)
+  if (!strcmp("owner",long_options[o].name))
   {
-    struct directory_array *arr = smartlist_get (dir_array, i);
-
-    found += process_dir (arr->dir, arr->num_dup, arr->exist, TRUE,
-                          arr->is_dir, arr->exp_ok, "WATCOM", HKEY_INC_LIB_FILE, FALSE);
+    set_owner_options (arg);
+    return;
   }
 
-quit:
-  opt.no_cwd = save;
-  free_watcom_dirs();
-  free_dir_array();
-  return (found);
-}
-
-/**
- * Check in Watcom's library-directories:
- * \code
- *   %WATCOM%\lib386
- *   %WATCOM%\lib386\nt
- *   %WATCOM%\lib386\linux    (Linux libs in recent OpenWatcom)
- * \endcode
- */
-static int do_check_watcom_library_paths (void)
-{
-  int i, max, found;
+  if (!strcmp("spec-file",long_options[o].name))
+  {
+    read_spec_file (arg);
+    return;
+  }
 
-  if (!setup_watcom_dirs("%WATCOM%\\lib386", "%WATCOM%\\lib386\\nt", "%WATCOM%\\lib386\\linux"))
-     return (0);
+  if (!strcmp("format",long_options[o].name))
+  {
+    if (!set_sink_format(arg))
+       usage ("Illegal \"--format\" value '%s'. Use one of: %s\n",
+              arg, get_sink_formats());
+    return;
+  }
 
-  report_header = "Matches in %WATCOM libraries:\n";
+  if (!strcmp("output",long_options[o].name))
+  {
+    FREE (opt.sink_file);
+    opt.sink_file = STRDUP (arg);
+    return;
+  }
 
-  max = smartlist_len (dir_array);
-  for (i = found = 0; i < max; i++)
+  if (!strcmp("batch",long_options[o].name))
   {
-    struct directory_array *arr = smartlist_get (dir_array, i);
+    FREE (opt.batch_file);
+    opt.batch_file = STRDUP (arg ? arg : "-");
+    return;
+  }
 
-    found += process_dir (arr->dir, arr->num_dup, arr->exist, TRUE,
-                          arr->is_dir, arr->exp_ok, "WATCOM", HKEY_INC_LIB_FILE, FALSE);
+  if (!strcmp("size-budget",long_options[o].name))
+  {
+    opt.size_budget = atoi (arg);
+    if (opt.size_budget < 0)
+       usage ("Illegal \"--size-budget\" value '%s'.\n", arg);
+    return;
   }
-  dump_dir_array ("Watcom libs", "");
-  free_watcom_dirs();
-  free_dir_array();
-  return (found);
-}
 
-/**
- * Common stuff for Borland checking.
- */
-static char *bcc_root = NULL;
+  if (!strcmp("first",long_options[o].name))
+  {
+    opt.max_matches = 1;
+    return;
+  }
 
-typedef void (*bcc_parser_func) (smartlist_t *sl, char *line);
+  if (!strcmp("max-matches",long_options[o].name))
+  {
+    opt.max_matches = atoi (arg);
+    if (opt.max_matches < 0)
+       usage ("Illegal \"--max-matches\" value '%s'.\n", arg);
+    return;
+  }
 
-/**
- * Check in Borland's include-directories which are given by the format in
- * `<bcc_root>\bcc32c.cfg`:
- * ```
- *  -isystem @\..\include\dinkumware64
- *  -isystem @\..\include\windows\crtl
- * ```
- *
- * Or the older format in `<bcc_root>\bcc32.cfg`:
- * ```
- *  -I<inc_path1>;<inc_path2>...
- * ```
- */
-static void bcc32_cfg_parse_inc (smartlist_t *sl, char *line)
-{
-  const char *isystem = "-isystem @\\..\\";
+  if (!strcmp("sort-mem",long_options[o].name))
+  {
+    opt.sort_mem = atoi (arg);
+    if (opt.sort_mem < 0)
+       usage ("Illegal \"--sort-mem\" value '%s'.\n", arg);
+    return;
+  }
 
-  line = strip_nl (str_ltrim(line));
-  DEBUGF (2, "line: %s.\n", line);
+  if (!strcmp("threads",long_options[o].name))
+  {
+    opt.scan_threads = arg ? atoi (arg) : pool_default_threads();
+    return;
+  }
 
-  if (!strnicmp(line,isystem,strlen(isystem)))
+  if (arg)
   {
-    char dir [MAX_PATH];
+    if (!strcmp("python",long_options[o].name))
+    {
+      opt.do_python++;
+      set_python_variant (arg);
+    }
 
-    snprintf (dir, sizeof(dir), "%s\\%s", bcc_root, line + strlen(isystem));
-    DEBUGF (2, "dir: %s.\n", dir);
-    add_to_dir_array (dir, FALSE, __LINE__);
+    else if (!strcmp("debug",long_options[o].name))
+      opt.debug = atoi (arg);
+
+    else if (!strcmp("host",long_options[o].name))
+      set_evry_options (arg);
   }
-  else if (!strncmp(line,"-I",2))
+  else
   {
-    split_env_var ("Borland INC", str_ltrim(line+2));
+    val_ptr = values_tab [o];
+    new_value = *val_ptr + 1;
+
+    DEBUGF (2, "got long option \"--%s\". Setting value %d -> %d. o: %d.\n",
+            long_options[o].name, *val_ptr, new_value, o);
+
+    *val_ptr = new_value;
   }
-  ARGSUSED (sl);
 }
 
 /**
- * Check in Borland's library-directories which are given by the format in
- * `<bcc_root>\bcc32c.cfg`:
- * ```
- *   -L@\..\lib\win32c\debug
- *   -L@\..\lib\win32c\release
- * ```
- *
- * Or the older format in `<bcc_root>\bcc32.cfg`:
- * ```
- *  -L<lib_path1>;<lib_path2>...
- * ```
+ * Parse the command-line.
  */
-static void bcc32_cfg_parse_lib (smartlist_t *sl, char *line)
+static void parse_cmdline (void)
 {
-  const char *Ldir = "-L@\\..\\";
+  command_line *c = &opt.cmd_line;
+  int           i;
 
-  line = strip_nl (str_ltrim(line));
-  DEBUGF (2, "line: %s.\n", line);
+  c->env_opt       = "ENVTOOL_OPTIONS";
+  c->short_opt     = "+chH:vVdDkrsS:tTuq";
+  c->long_opt      = long_options;
+  c->set_short_opt = set_short_option;
+  c->set_long_opt  = set_long_option;
+  getopt_parse (c);
 
-  if (!strnicmp(line,Ldir,strlen(Ldir)))
-  {
-    char dir [MAX_PATH];
+  /* Several file-specs is a raw query in `--evry` mode.
+   * Otherwise they're all searched for in one pass.
+   */
+  if ((c->argc0 > 0) && (c->argc - c->argc0 >= 2) && opt.do_evry)
+     opt.evry_raw = TRUE;
 
-    snprintf (dir, sizeof(dir), "%s\\%s", bcc_root, line + strlen(Ldir));
-    DEBUGF (2, "dir: %s.\n", dir);
-    add_to_dir_array (dir, FALSE, __LINE__);
+  if (opt.evry_raw)
+     opt.file_spec = _strjoin (c->argv + c->argc0, " ");
+  else
+  {
+    for (i = c->argc0; c->argc0 > 0 && i < c->argc; i++)
+        add_file_spec (c->argv[i]);
+    if (opt.file_specs && smartlist_len(opt.file_specs) >= 1)
+       opt.file_spec = STRDUP (smartlist_get(opt.file_specs, 0));
   }
-  else if (!strncmp(line,"-L",2))
+
+  /* With only one file-spec, `opt.file_spec` is all we need.
+   */
+  if (opt.file_specs && smartlist_len(opt.file_specs) <= 1)
   {
-    split_env_var ("Borland LIB", str_ltrim(line+2));
+    smartlist_free_all (opt.file_specs);
+    opt.file_specs = NULL;
   }
-  ARGSUSED (sl);
+
+  DEBUGF (2, "c->argc0:      %d\n", c->argc0);
+  DEBUGF (2, "opt.file_spec: %s'\n", opt.file_spec);
+  DEBUGF (2, "opt.evry_raw:  %d\n", opt.evry_raw);
+  DEBUGF (2, "file-specs:    %d\n", opt.file_specs ? smartlist_len(opt.file_specs) : 1);
 }
 
 /**
- * Setup Borland directories for either a INC or LIB search.
+ * Evaluate if some combinations of options doesn't make sense.
  */
-static BOOL setup_borland_dirs (const compiler_info *cc, bcc_parser_func parser)
+static int eval_options (void)
 {
-  smartlist_t *dir_list;
-  char        *bin_dir;
-  char         bcc_cfg [_MAX_PATH];
+  if (!(opt.do_lib || opt.do_include) && opt.only_32bit && opt.only_64bit)
+  {
+    WARN ("Specifying both '--32' and '--64' doesn't make sense.\n");
+    return (0);
+  }
 
-  bcc_root = strlwr (STRDUP(cc->full_name));
-  bin_dir =  strrchr (bcc_root, '\\');
-  *bin_dir = '\0';
-  bin_dir =  strrchr (bcc_root, '\\');
-  *bin_dir = '\0';
+  if (!opt.PE_check && (opt.only_32bit || opt.only_64bit))
+     opt.PE_check = TRUE;
 
-  DEBUGF (2, "bcc_root: %s, short_name: %s\n", bcc_root, cc->short_name);
+  C_no_ansi = opt.no_ansi;
 
-  /* Get the `bcc*.cfg` filename:
-   * <bcc_root>\bccX.exe -> <bcc_root>\bccX.cfg
+  /* Use ANSI-sequences under ConEmu or if "%COLOUR_TRACE >= 2".
+   * Nullifies the "--no-ansi" option.
    */
-  snprintf (bcc_cfg, sizeof(bcc_cfg), "%s\\bin\\%.*s.cfg",
-            bcc_root, strrchr(cc->short_name,'.') - cc->short_name, cc->short_name);
+  if (opt.under_conemu || C_trace_level() >= 2)
+     C_use_ansi_colours = 1;
 
-  DEBUGF (2, "bcc_cfg: %s.\n", bcc_cfg);
+  if (opt.no_colours)
+     C_use_colours = C_use_ansi_colours = 0;
 
-  dir_list = smartlist_read_file (bcc_cfg, (smartlist_parse_func)parser);
-  if (!dir_list)
-  {
-    FREE (bcc_root);
-    return (FALSE);
-  }
-  smartlist_free (dir_list);  /* No need for this */
-  return (TRUE);
+  return (1);
 }
 
-static int do_check_borland_inc_lib (const char *inc_lib, const char *matches, bcc_parser_func parser)
+/**
+ * The only `atexit()` function where all cleanup is done.
+ */
+static void MS_CDECL cleanup (void)
 {
-  int   ignored, bcc_found, found = 0;
-  int   i, j, max_i, max_j;
-  const compiler_info *cc;
+  /* If we're called from the SIGINT thread, don't do any Python stuff.
+   * That will probably crash in Py_Finalize().
+   */
+  if (halt_flag == 0)
+     py_exit();
 
-  max_i = smartlist_len (all_cc);
+  free_dir_array();
+  free_scan_spec();
+  scan_memo_exit();
+  sort_exit();
+  sink_close();
+  dir_cache_exit();
+  dir_size_exit();
 
-  for (i = bcc_found = ignored = 0; i < max_i; i++)
+  if (opt.do_profile)
   {
-    cc = smartlist_get (all_cc, i);
-    if (!cc->full_name || cc->type != CC_BORLAND)
-       continue;
+    if (opt.sink_format != SINK_TEXT && !opt.sink_file)
+       C_set_output (stderr);   /* Keep the records on stdout clean */
+    profile_report();
+    profile_exit();
+  }
 
-    bcc_found++;
-    if (cc->ignore)
-       ignored++;
+  FREE (who_am_I);
 
-    if (!cc->ignore && setup_borland_dirs(cc, parser))
-    {
-      char report [_MAX_PATH+50];
+  FREE (system_env_path);
+  FREE (system_env_lib);
+  FREE (system_env_inc);
 
-      snprintf (report, sizeof(report), matches, cc->full_name);
-      report_header = report;
+  FREE (user_env_path);
+  FREE (user_env_lib);
+  FREE (user_env_inc);
+  FREE (vcache_fname);
+  FREE (opt.file_spec);
+  FREE (opt.sink_file);
+  FREE (opt.batch_file);
+  smartlist_free_all (opt.file_specs);
 
-      max_j = smartlist_len (dir_array);
-      for (j = 0; j < max_j; j++)
-      {
-        struct directory_array *arr = smartlist_get (dir_array, j);
+  free_all_compilers();
 
-        DEBUGF (1, "arr->dir: %s.\n", arr->dir);
+  if (re_alloc)
+     regfree (&re_hnd);
+  re_literal_free (re_lit);
+  re_lit = NULL;
 
-        found += process_dir (arr->dir, arr->num_dup, arr->exist, TRUE,
-                              arr->is_dir, arr->exp_ok, inc_lib,
-                              HKEY_INC_LIB_FILE, FALSE);
-      }
-      free_dir_array();
-      FREE (bcc_root);
-    }
-  }
+  vector_exit (&dir_array);
+  vector_exit (&reg_array);
+  dir_set_free (dir_array_set);
 
-  if (bcc_found == 0)
-  {
-    DEBUGF (1, "No Borland compilers found.\n");
-    return (0);
-  }
-  if (ignored >= bcc_found)
+  smartlist_free_all (opt.evry_host);
+  smartlist_free_all (opt.owners);
+  if (owner_specs)
   {
-    DEBUGF (1, "All Borland compilers were ignored.\n");
-    return (0);
+    smartlist_wipe (owner_specs, (void(*)(void*))fnmatch_free);
+    smartlist_free (owner_specs);
   }
-  return (found);
-}
 
-/**
- * Check all `bcc*.exe` found on `PATH` for an `INC` search.
- */
-static int do_check_borland_includes (void)
-{
-  return do_check_borland_inc_lib ("Borland INC", "Matches in %s headers:\n",
-                                   bcc32_cfg_parse_inc);
-}
+  getopt_free (&opt.cmd_line);
 
-/**
- * Check all `bcc*.exe` found on `PATH` for a `LIB` search.
- */
-static int do_check_borland_library_paths (void)
-{
-  return do_check_borland_inc_lib ("Borland LIB", "Matches in %s libraries:\n",
-                                   bcc32_cfg_parse_lib);
-}
+  cfg_ignore_exit();
 
-/**
- * getopt_long() processing.
- */
-static const struct option long_options[] = {
-           { "help",        no_argument,       NULL, 'h' },
-           { "help",        no_argument,       NULL, '?' },  /* 1 */
-           { "version",     no_argument,       NULL, 'V' },
-           { "inc",         no_argument,       NULL, 0 },    /* 3 */
-           { "path",        no_argument,       NULL, 0 },
-           { "lib",         no_argument,       NULL, 0 },    /* 5 */
-           { "python",      optional_argument, NULL, 0 },
-           { "dir",         no_argument,       NULL, 'D' },  /* 7 */
-           { "debug",       optional_argument, NULL, 'd' },
-           { "no-sys",      no_argument,       NULL, 0 },    /* 9 */
-           { "no-usr",      no_argument,       NULL, 0 },
-           { "no-app",      no_argument,       NULL, 0 },    /* 11 */
-           { "test",        no_argument,       NULL, 't' },
-           { "quiet",       no_argument,       NULL, 'q' },  /* 13 */
-           { "no-gcc",      no_argument,       NULL, 0 },
-           { "no-g++",      no_argument,       NULL, 0 },    /* 15 */
-           { "verbose",     no_argument,       NULL, 'v' },
-           { "pe",          no_argument,       NULL, 0 },    /* 17 */
-           { "no-colour",   no_argument,       NULL, 0 },
-           { "no-color",    no_argument,       NULL, 0 },    /* 19 */
-           { "evry",        optional_argument, NULL, 0 },
-           { "regex",       no_argument,       NULL, 0 },    /* 21 */
-           { "size",        no_argument,       NULL, 0 },
-           { "man",         no_argument,       NULL, 0 },    /* 23 */
-           { "cmake",       no_argument,       NULL, 0 },
-           { "pkg",         no_argument,       NULL, 0 },    /* 25 */
-           { "32",          no_argument,       NULL, 0 },
-           { "64",          no_argument,       NULL, 0 },    /* 27 */
-           { "no-prefix",   no_argument,       NULL, 0 },
-           { "no-ansi",     no_argument,       NULL, 0 },    /* 29 */
-           { "host",        required_argument, NULL, 0 },
-           { "buffered-io", no_argument,       NULL, 0 },    /* 31 */
-           { "nonblock-io", no_argument,       NULL, 0 },
-           { "no-watcom",   no_argument,       NULL, 0 },    /* 33 */
-           { "no-borland",  no_argument,       NULL, 0 },
-           { "no-clang",    no_argument,       NULL, 0 },    /* 35 */
-           { "owner",       optional_argument, NULL, 0 },
-           { "check",       no_argument,       NULL, 0 },    /* 37 */
-           { "signed",      optional_argument, NULL, 0 },
-           { "no-cwd",      no_argument,       NULL, 0 },    /* 39 */
-           { "sort",        required_argument, NULL, 0 },
-           { "vcpkg",       no_argument,       NULL, 0 },    /* 41 */
-           { NULL,          no_argument,       NULL, 0 }
-         };
+  netrc_exit();
+  authinfo_exit();
+  envtool_cfg_exit();
+  vcpkg_free();
 
-static int *values_tab[] = {
-            NULL,
-            NULL,                     /* 1 */
-            NULL,
-            &opt.do_include,          /* 3 */
-            &opt.do_path,
-            &opt.do_lib,              /* 5 */
-            &opt.do_python,
-            &opt.dir_mode,            /* 7 */
-            NULL,
-            &opt.no_sys_env,          /* 9 */
-            &opt.no_usr_env,
-            &opt.no_app_path,         /* 11 */
-            NULL,
-            NULL,                     /* 13 */
-            &opt.no_gcc,
-            &opt.no_gpp,              /* 15 */
-            &opt.verbose,
-            &opt.PE_check,            /* 17 */
-            &opt.no_colours,
-            &opt.no_colours,          /* 19 */
-            &opt.do_evry,
-            &opt.use_regex,           /* 21 */
-            &opt.show_size,
-            &opt.do_man,              /* 23 */
-            &opt.do_cmake,
-            &opt.do_pkg,              /* 25 */
-            &opt.only_32bit,
-            &opt.only_64bit,          /* 27 */
-            &opt.gcc_no_prefixed,
-            &opt.no_ansi,             /* 29 */
-            (int*)&opt.evry_host,
-            &opt.use_buffered_io,     /* 31 */
-            &opt.use_nonblock_io,
-            &opt.no_watcom,           /* 33 */
-            &opt.no_borland,
-            &opt.no_clang,            /* 35 */
-            &opt.show_owner,
-            &opt.do_check,            /* 37 */
-            (int*)&opt.signed_status,
-            &opt.no_cwd,              /* 39 */
-            (int*)&opt.sort_method,
-            &opt.do_vcpkg             /* 41 */
-          };
+  exit_misc();
+
+  if (halt_flag == 0 && opt.debug > 0)
+     mem_report();
+
+  if (halt_flag > 0)
+     C_puts ("~5Quitting.\n~0");
+
+  C_exit();
+  crtdbug_exit();
+}
 
 /**
- * `getopt_long()` handler for option `--python=<short_name>`.
- *
- * Accept only a Python `short_name` which is compiled in.
+ * This signal-handler gets called in another thread.
  *
- * Ref. the `all_py_programs[]` array in envtool_py.c.
+ * \param[in] sig the signal to handle.
  */
-static void set_python_variant (const char *arg)
+static void MS_CDECL halt (int sig)
 {
-  const char **py = py_get_variants();
-  unsigned     v  = UNKNOWN_PYTHON;
-  int          i;
+  BOOL quick_exit = FALSE;
 
-  DEBUGF (2, "optarg: '%s'\n", arg);
-  ASSERT (arg);
+  halt_flag++;
+  CRTDBG_CHECK_OFF();
 
-  for (i = 0; py[i]; i++)
-     if (!stricmp(arg,py[i]))
-     {
-       v = py_variant_value (arg, NULL);
-       break;
+  if (opt.do_evry)
+  {
+    if (Everything_hthread && Everything_hthread != INVALID_HANDLE_VALUE)
+    {
+      TerminateThread (Everything_hthread, 1);
+      CloseHandle (Everything_hthread);
     }
+    Everything_hthread = INVALID_HANDLE_VALUE;
+    Everything_Reset();
+  }
 
-  if (v == UNKNOWN_PYTHON)
+#ifdef SIGTRAP
+  if (sig == SIGTRAP)
   {
-    char buf[100], *p = buf;
-    int  left = sizeof(buf)-1;
+    C_puts ("\n~5Got SIGTRAP.~0\n");
+    quick_exit = TRUE;
+  }
+#endif
 
-    for (i = 0; py[i] && left > 4; i++)
-    {
-      p += snprintf (p, left, "\"%s\", ", py[i]);
-      left = (int) (sizeof(buf) - (p - buf));
-    }
-    if (p > buf+2)
-       p[-2] = '\0';
-    usage ("Illegal '--python' option: '%s'.\n"
-           "Use one of these: %s.\n", arg, buf);
+  if (sig == SIGILL)
+  {
+    C_puts ("\n~5Illegal instruction.~0\n");
+    quick_exit = TRUE;
   }
 
-  /* Found a valid match
-   */
-  py_which = (enum python_variants) v;
+  if (quick_exit)
+  {
+    /* Get out as fast as possible */
+    C_exit();
+    ExitProcess (GetCurrentProcessId());
+  }
 }
 
 /**
- * `getopt_long()` handler for option `-H arg` or `--host arg` used by remote ETP queries.
+ * The main initialiser.
  */
-static void set_evry_options (const char *arg)
+static void init_all (const char **argv)
 {
-  if (arg)
+  char buf [_MAX_PATH];
+
+  atexit (cleanup);
+  crtdbug_init();
+
+  tzset();
+  memset (&opt, 0, sizeof(opt));
+  opt.under_conemu = C_conemu_detected();
+
+  if (GetModuleFileName(NULL, buf, sizeof(buf)))
+       who_am_I = STRDUP (buf);
+  else who_am_I = STRDUP (argv[0]);
+
+  program_name = who_am_I;
+
+  C_use_colours = 1;  /* Turned off by "--no-colour" */
+  opt.sort_mem    = 100;
+  opt.size_budget = 10;
+
+  vector_init (&dir_array, sizeof(struct directory_array), 0);
+  vector_init (&reg_array, sizeof(struct registry_array), 0);
+
+#ifdef __CYGWIN__
+  opt.conv_cygdrive = 1;
+#endif
+
+  vcache_fname = getenv_expand ("%TEMP%\\envtool.cache");
+
+  current_dir[0] = '.';
+  current_dir[1] = DIR_SEP;
+  current_dir[2] = '\0';
+  getcwd (current_dir, sizeof(current_dir));
+
+  sys_dir[0] = sys_native_dir[0] = '\0';
+  if (GetSystemDirectory(sys_dir,sizeof(sys_dir)))
   {
-    if (!opt.evry_host)
-       opt.evry_host = smartlist_new();
-    smartlist_add (opt.evry_host, STRDUP(arg));
+    const char *rslash = strrchr (sys_dir,'\\');
+
+    if (rslash > sys_dir)
+    {
+      snprintf (sys_native_dir, sizeof(sys_native_dir), "%.*s\\sysnative",
+                (int)(rslash - sys_dir), sys_dir);
+      snprintf (sys_wow64_dir, sizeof(sys_wow64_dir), "%.*s\\SysWOW64",
+                (int)(rslash - sys_dir), sys_dir);
+    }
   }
 }
 
 /**
- * `getopt_long()` handler for option `--signed`.
+ * Prepare `opt.file_spec` (and `opt.file_specs`) for the search.
+ * Add a suffix to a non-regex spec or compile a regex.
  */
-static void set_signed_options (const char *arg)
+static void compile_file_spec (void)
 {
-  static const struct search_list sign_status[] = {
-                    { SIGN_CHECK_ALL,      "SIGN_CHECK_ALL"      },
-                    { SIGN_CHECK_UNSIGNED, "SIGN_CHECK_UNSIGNED" },
-                    { SIGN_CHECK_SIGNED,   "SIGN_CHECK_SIGNED"   },
-                  };
-
-  opt.signed_status = SIGN_CHECK_ALL;
+  if (!opt.file_spec)
+     return;
 
-  if (arg)
+  if (!opt.evry_raw && !opt.dir_mode)
   {
-    if (*arg == '1' || !stricmp(arg,"on") || !stricmp(arg,"yes"))
-       opt.signed_status = SIGN_CHECK_SIGNED;
+    if (!opt.use_regex)
+    {
+      int i, max = opt.file_specs ? smartlist_len (opt.file_specs) : 0;
 
-    else if (*arg == '0' || !stricmp(arg,"off") || !stricmp(arg,"no"))
-       opt.signed_status = SIGN_CHECK_UNSIGNED;
+      opt.file_spec = fix_file_suffix (opt.file_spec);
+      for (i = 0; i < max; i++)
+          smartlist_set (opt.file_specs, i, fix_file_suffix(smartlist_get(opt.file_specs, i)));
+    }
+    else
+    {
+      re_err = regcomp (&re_hnd, opt.file_spec, opt.case_sensitive ? 0 : REG_ICASE);
+      re_alloc = TRUE;
+      if (re_err)
+      {
+        regerror (re_err, &re_hnd, re_errbuf, sizeof(re_errbuf));
+        WARN ("Invalid regular expression \"%s\": %s\n", opt.file_spec, re_errbuf);
+      }
+      else
+        re_lit = re_literal_new (opt.file_spec, opt.case_sensitive ? 0 : REG_ICASE);
+    }
   }
 
-  DEBUGF (2, "got long option \"--signed %s\" -> opt.signed_status: %s\n",
-          arg, list_lookup_name(opt.signed_status,sign_status, DIM(sign_status)));
 }
 
 /**
- * `getopt_long()` handler for option `--owner`.
+ * Search for `opt.file_spec` in all the modes given.
+ * \retval The number of matches found.
  */
-static void set_owner_options (const char *arg)
+static int do_search (void)
 {
-  opt.show_owner = 1;
+  int found = 0;
 
-  if (!opt.owners)
-     opt.owners = smartlist_new();
+  if (!opt.no_sys_env && !search_halted())
+  {
+    report_mode = "system-env";
+    profile_enter (report_mode);
+    found += scan_system_env();
+    found += report_sorted();
+    profile_leave();
+  }
 
-  if (arg)
-     smartlist_add (opt.owners, STRDUP(arg));
-  else
-  if (smartlist_len(opt.owners) == 0)
-     smartlist_add (opt.owners, STRDUP("*"));
-}
+  if (!opt.no_usr_env && !search_halted())
+  {
+    report_mode = "user-env";
+    profile_enter (report_mode);
+    found += scan_user_env();
+    found += report_sorted();
+    profile_leave();
+  }
 
-/**
- * The handler for short options called from `getopt_long()`.
- *
- * \param[in] o    an alphabetical letters given in `c->short_opt` and `getopt_parse(c)`.
- * \param[in] arg  the optional argument for the option.
- */
-static void set_short_option (int o, const char *arg)
-{
-  DEBUGF (2, "got short option '%c' (%d).\n", o, o);
+  if (opt.do_path && !search_halted())
+  {
+    report_mode = "path";
+    profile_enter (report_mode);
+    if (!opt.no_app_path)
+    {
+      profile_enter ("app-paths");
+      found += do_check_registry();
+      profile_leave();
+    }
 
-  switch (o)
+    report_header = "Matches in %PATH:\n";
+    found += do_check_env ("PATH", FALSE);
+    found += report_sorted();
+    profile_leave();
+  }
+
+  if (opt.do_lib && !search_halted())
   {
-    case 'h':
-         opt.help = 1;
-         break;
-    case 'H':
-         set_evry_options (arg);
-         break;
-    case 'V':
-         opt.do_version++;
-         break;
-    case 'v':
-         opt.verbose++;
-         break;
-    case 'd':
-         opt.debug++;
-         break;
-    case 'D':
-         opt.dir_mode = 1;
-         break;
-    case 'c':
-         opt.case_sensitive = 1;
-         break;
-    case 'k':
-         opt.keep_temp = 1;
-         break;
-    case 'r':
-         opt.use_regex = 1;
-         break;
-    case 's':
-         opt.show_size = 1;
-         break;
-    case 'S':
-         if (!set_sort_method(arg, NULL))
-            usage ("Illegal \"-S\" method '%s'. Use one of: %s\n",
-                   arg, get_sort_methods_short());
-         break;
-    case 'T':
-         opt.decimal_timestamp = 1;
-         break;
-    case 't':
-         opt.do_tests++;
-         break;
-    case 'u':
-         opt.show_unix_paths = 1;
-         break;
-    case 'q':
-         opt.quiet = 1;
-         break;
-    case '?':      /* '?' == BADCH || BADARG */
-         usage ("  Use %s \"-h\" / \"--help\" for options\n", who_am_I);
-         break;
-    default:
-         usage ("Illegal option: '%c'\n", optopt);
-         break;
+    report_mode = "lib";
+    profile_enter (report_mode);
+    report_header = "Matches in %LIB:\n";
+    found += do_check_env ("LIB", FALSE);
+
+    if (!opt.no_watcom)
+       found += do_check_watcom_library_paths();
+
+    if (!opt.no_borland)
+       found += do_check_borland_library_paths();
+
+    if (!(opt.no_gcc && opt.no_gpp))   /* Ignore all 'gcc.exe' and g++.exe' */
+       found += do_check_gcc_library_paths();
+
+    if (!opt.no_clang)
+       found += do_check_clang_library_paths();
+
+    found += report_sorted();
+
+    profile_leave();
   }
-}
 
-/**
- * The handler for long options called from `getopt_long()`.
- *
- * \param[in] o    the index into `long_options[]`.
- * \param[in] arg  the optional argument for the option.
- */
-static void set_long_option (int o, const char *arg)
-{
-  int new_value, *val_ptr;
+  if (opt.do_include && !search_halted())
+  {
+    report_mode = "include";
+    profile_enter (report_mode);
+    report_header = "Matches in %INCLUDE:\n";
+    found += do_check_env ("INCLUDE", FALSE);
+
+    if (!opt.no_watcom)
+       found += do_check_watcom_includes();
+
+    if (!opt.no_borland)
+      found += do_check_borland_includes();
+
+    if (!opt.no_gcc)
+       found += do_check_gcc_includes();
 
-  ASSERT (values_tab[o]);
-  ASSERT (long_options[o].name);
+    if (!opt.no_gpp)
+       found += do_check_gpp_includes();
 
-  ASSERT (o >= 0);
-  ASSERT (o < DIM(values_tab));
+    if (!opt.no_clang)
+       found += do_check_clang_includes();
 
-  DEBUGF (2, "got long option \"--%s\" with argument \"%s\".\n",
-          long_options[o].name, arg);
+    found += report_sorted();
 
-  if (!strcmp("evry",long_options[o].name))
-  {
-    set_evry_options (arg);
-    opt.do_evry = 1;
-    return;
+    profile_leave();
   }
 
-  if (!strcmp("signed",long_options[o].name))
+  if (opt.do_cmake && !search_halted())
   {
-    set_signed_options (arg);
-    return;
+    report_mode = "cmake";
+    profile_enter (report_mode);
+    found += do_check_cmake();
+    found += report_sorted();
+    profile_leave();
   }
 
-  if (!strcmp("sort",long_options[o].name))
+  if (opt.do_man && !search_halted())
   {
-    if (!set_sort_method(NULL, arg))
-       usage ("Illegal \"-S\" method '%s'. Use one of: %s\n",
-              arg, get_sort_methods_long());
-    return;
+    report_mode = "man";
+    profile_enter (report_mode);
+    found += do_check_manpath();
+    found += report_sorted();
+    profile_leave();
   }
 
-  if (!strcmp("owner",long_options[o].name))
+  if (opt.do_pkg && !search_halted())
   {
-    set_owner_options (arg);
-    return;
+    report_mode = "pkg";
+    profile_enter (report_mode);
+    found += do_check_pkg();
+    found += report_sorted();
+    profile_leave();
   }
 
-  if (arg)
+  if (opt.do_vcpkg && !search_halted())
   {
-    if (!strcmp("python",long_options[o].name))
-    {
-      opt.do_python++;
-      set_python_variant (arg);
-    }
+    report_mode = "vcpkg";
+    profile_enter (report_mode);
+    found += do_check_vcpkg();
+    found += report_sorted();
+    profile_leave();
+  }
 
-    else if (!strcmp("debug",long_options[o].name))
-      opt.debug = atoi (arg);
+  if (opt.do_python && !search_halted())
+  {
+    char  report [_MAX_PATH+50];
+    char *py_exe;
 
-    else if (!strcmp("host",long_options[o].name))
-      set_evry_options (arg);
+    py_get_info (&py_exe, NULL, NULL);
+    snprintf (report, sizeof(report), "Matches in \"%s\" sys.path[]:\n", py_exe);
+    report_header = report;
+    report_mode = "python";
+    profile_enter (report_mode);
+    found += py_search();
+    found += report_sorted();
+    profile_leave();
+    FREE (py_exe);
   }
-  else
+
+  /* Mode "--evry" specified.
+   */
+  if (opt.do_evry && !search_halted())
   {
-    val_ptr = values_tab [o];
-    new_value = *val_ptr + 1;
+    int    i, max = 0;
+    UINT64 start;
 
-    DEBUGF (2, "got long option \"--%s\". Setting value %d -> %d. o: %d.\n",
-            long_options[o].name, *val_ptr, new_value, o);
+    report_mode = "evry";
 
-    *val_ptr = new_value;
+    profile_enter (report_mode);
+    if (opt.evry_host)
+       max = smartlist_len (opt.evry_host);
+
+    /* Mode "--evry:host" specified at least once.
+     * Connect and query all hosts.
+     */
+    for (i = 0; i < max && !search_halted(); i++)
+    {
+      const char *host = smartlist_get (opt.evry_host, i);
+      char  buf [200];
+
+      snprintf (buf, sizeof(buf), "Matches from %s:\n", host);
+      report_header = buf;
+      start = profile_start();
+      found += do_check_evry_ept (host);
+      profile_item ("etp", host, start);
+    }
+    if (max  == 0)
+    {
+      report_header = "Matches from EveryThing:\n";
+      found += do_check_evry();
+    }
+    found += report_sorted();
+    profile_leave();
   }
+  return (found);
 }
 
 /**
- * Parse the command-line.
+ * Clear what the previous `--batch` query left behind and
+ * prepare for a search for `spec`.
+ *
+ * The directories probed and the compilers, Python and EveryThing
+ * found at start-up are kept.
  */
-static void parse_cmdline (void)
+static void batch_reset (const char *spec)
 {
-  command_line *c = &opt.cmd_line;
+  FREE (opt.file_spec);
+  opt.file_spec = STRDUP (spec);
+  smartlist_free_all (opt.file_specs);   /* A query is one file-spec only */
+  opt.file_specs = NULL;
 
-  c->env_opt       = "ENVTOOL_OPTIONS";
-  c->short_opt     = "+chH:vVdDkrsS:tTuq";
-  c->long_opt      = long_options;
-  c->set_short_opt = set_short_option;
-  c->set_long_opt  = set_long_option;
-  getopt_parse (c);
+  free_scan_spec();
+  scan_memo_forget();
+  dir_cache_trim();
 
-  if (c->argc0 > 0 && c->argc - c->argc0 >= 1)
-     opt.file_spec = STRDUP (c->argv[c->argc0]);
+  if (re_alloc)
+     regfree (&re_hnd);
+  re_alloc = FALSE;
+  re_literal_free (re_lit);
+  re_lit = NULL;
 
-  if ((c->argc0 > 0) && (c->argc - c->argc0 >= 2))
-     opt.evry_raw = TRUE;
+  num_reported   = 0;
+  total_size     = 0;
+  num_version_ok = num_verified = 0;
+  num_evry_dups  = num_evry_ignored = 0;
+  ETP_num_evry_dups = 0;
 
-  if (opt.evry_raw)
-  {
-    FREE (opt.file_spec);
-    opt.file_spec = _strjoin (c->argv + c->argc0, " ");
-  }
+  found_in_hkey_current_user = found_in_hkey_current_user_env = 0;
+  found_in_hkey_local_machine = found_in_hkey_local_machine_sess_man = 0;
+  found_in_python_egg = found_in_default_env = found_everything_db_dirty = 0;
 
-  DEBUGF (2, "c->argc0:      %d\n", c->argc0);
-  DEBUGF (2, "opt.file_spec: %s'\n", opt.file_spec);
-  DEBUGF (2, "opt.evry_raw:  %d\n", opt.evry_raw);
+  compile_file_spec();
 }
 
 /**
- * Evaluate if some combinations of options doesn't make sense.
+ * Handle the `--batch` option.
+ *
+ * Read one `<file-spec>` on each line of `opt.batch_file` (`"-"` is stdin)
+ * and search for it in all the modes given. Empty lines and lines
+ * starting with `#` are skipped. The start-up cost (finding the compilers,
+ * Python and EveryThing etc.) is paid once for all queries.
+ *
+ * The output of each query starts with a `"# query N: spec"` line and
+ * ends with it's `final_report()` and a `"# end N: found"` line.
+ *
+ * \retval The total number of matches found.
  */
-static int eval_options (void)
+static int do_batch (void)
 {
-  if (!(opt.do_lib || opt.do_include) && opt.only_32bit && opt.only_64bit)
+  FILE *f = strcmp(opt.batch_file, "-") ? fopen (opt.batch_file, "rt") : stdin;
+  char  line [_MAX_PATH];
+  int   found, total = 0, num = 0;
+
+  if (!f)
   {
-    WARN ("Specifying both '--32' and '--64' doesn't make sense.\n");
+    WARN ("Failed to open \"%s\"; %s.\n", opt.batch_file, strerror(errno));
     return (0);
   }
 
-  if (!opt.PE_check && (opt.only_32bit || opt.only_64bit))
-     opt.PE_check = TRUE;
+  while (!halt_flag && fgets(line, sizeof(line), f))
+  {
+    char *spec = str_trim (line);
 
-  C_no_ansi = opt.no_ansi;
+    if (!*spec || *spec == '#')
+       continue;
 
-  /* Use ANSI-sequences under ConEmu or if "%COLOUR_TRACE >= 2".
-   * Nullifies the "--no-ansi" option.
-   */
-  if (opt.under_conemu || C_trace_level() >= 2)
-     C_use_ansi_colours = 1;
+    batch_reset (spec);
+    num++;
 
-  if (opt.no_colours)
-     C_use_colours = C_use_ansi_colours = 0;
+    C_printf ("# query %d: %s\n", num, spec);
+    found = do_search();
+    final_report (found);
+    C_printf ("# end %d: %d\n", num, found);
+    C_flush();
+    total += found;
+  }
+  if (f != stdin)
+     fclose (f);
 
-  return (1);
+  DEBUGF (1, "%d batch queries, %d matches.\n", num, total);
+  return (total);
 }
 
 /**
- * The only `atexit()` function where all cleanup is done.
+ * The environment variables a `--daemon` query depends on.
  */
-static void MS_CDECL cleanup (void)
+static const char *daemon_envs[] = {
+                  "PATH", "PATHEXT", "LIB", "LIBRARY_PATH", "INCLUDE",
+                  "C_INCLUDE_PATH", "CPLUS_INCLUDE_PATH", "MANPATH",
+                  "PKG_CONFIG_PATH", "PYTHONPATH", "CMAKE_MODULE_PATH"
+                };
+
+/**
+ * A reply cached by the `--daemon`.
+ */
+struct daemon_reply {
+       char        *spec;
+       smartlist_t *chunks;    /**< The output as sent; text and colour codes */
+       int          rc;
+     };
+
+/**
+ * The state of the `--daemon`.
+ */
+struct daemon_state {
+       char        *context;      /**< The options, directory and environment served */
+       FILE        *null_out;     /**< Where the output goes while serving */
+       smartlist_t *replies;      /**< Sorted on `daemon_reply::spec`. NULL if replies are not cached */
+       smartlist_t *chunks;       /**< The output of the query being served */
+       dir_watch   *watch;        /**< The directories the cached replies came from */
+       dir_set     *watched;
+       BOOL         rewatch;      /**< A directory can no longer be watched; start a new `watch` */
+       smartlist_t *missing;      /**< Non-existing directories. A reply is stale if one gets created */
+       dir_set     *missing_set;
+       HKEY         reg_key [2];  /**< The system and user environment keys */
+       HANDLE       reg_event [2];
+       unsigned     num_hits;
+       time_t       cache_saved;  /**< When the directory-cache was last saved */
+     };
+
+/**
+ * \def DAEMON_CACHE_SAVE
+ * Seconds between saving the directory-cache in `--daemon` mode.
+ */
+#define DAEMON_CACHE_SAVE  60
+
+static struct daemon_state *daemon_st;
+
+static char *daemon_sock_path (void)
 {
-  /* If we're called from the SIGINT thread, don't do any Python stuff.
-   * That will probably crash in Py_Finalize().
-   */
-  if (halt_flag == 0)
-     py_exit();
+  return getenv_expand ("%LOCALAPPDATA%\\envtool.sock");
+}
 
-  free_dir_array();
+/**
+ * Return the options, the current directory and the environment
+ * a query is run with. A query is only served by a `--daemon` with
+ * the same context.
+ */
+static char *daemon_context (void)
+{
+  const command_line *c = &opt.cmd_line;
+  char  *ctx = STRDUP ("");
+  int    i, last = c->argc0 > 0 ? c->argc0 : c->argc;
 
-  FREE (who_am_I);
+  for (i = 1; i < last; i++)
+  {
+    if (!strcmp(c->argv[i], "--daemon"))
+       continue;
+    ctx = _stracat (ctx, c->argv[i]);
+    ctx = _stracat (ctx, " ");
+  }
+  ctx = _stracat (ctx, "\n");
+  ctx = _stracat (ctx, current_dir);
 
-  FREE (system_env_path);
-  FREE (system_env_lib);
-  FREE (system_env_inc);
+  for (i = 0; i < DIM(daemon_envs); i++)
+  {
+    const char *val = getenv (daemon_envs[i]);
 
-  FREE (user_env_path);
-  FREE (user_env_lib);
-  FREE (user_env_inc);
-  FREE (vcache_fname);
-  FREE (opt.file_spec);
+    ctx = _stracat (ctx, "\n");
+    ctx = _stracat (ctx, val ? val : "");
+  }
+  return (ctx);
+}
 
-  free_all_compilers();
+/**
+ * Called from `check_process_dir()` for a directory that does not exist.
+ */
+static void daemon_add_missing (const char *dir)
+{
+  if (daemon_st && daemon_st->replies && dir_set_add(daemon_st->missing_set, dir) == 0)
+     smartlist_add (daemon_st->missing, STRDUP(dir));
+}
 
-  if (re_alloc)
-     regfree (&re_hnd);
+/**
+ * Can the reply for `spec` be cached?
+ * All directories scanned must be in the `scan_memo`. That is the case
+ * for the `--path`, `--lib` and `--inc` modes. But not for the
+ * `App Paths` registry keys or a `spec` with a sub-directory.
+ */
+static BOOL daemon_cacheable (const char *spec)
+{
+  if (opt.do_python || opt.do_evry || opt.do_cmake || opt.do_man ||
+      opt.do_pkg || opt.do_vcpkg || (opt.do_path && !opt.no_app_path))
+     return (FALSE);
+  if (opt.show_size && opt.dir_mode)
+     return (FALSE);
+  return (strpbrk(spec, "/\\") == NULL);
+}
 
-  smartlist_free (dir_array);
-  smartlist_free (reg_array);
+static void daemon_reg_init (struct daemon_state *ds)
+{
+  static const char *keys[] = {
+                    "SYSTEM\\CurrentControlSet\\Control\\Session Manager\\Environment",
+                    "Environment"
+                  };
+  int i;
 
-  smartlist_free_all (opt.evry_host);
-  smartlist_free_all (opt.owners);
+  for (i = 0; i < DIM(keys); i++)
+  {
+    if (RegOpenKeyEx(i == 0 ? HKEY_LOCAL_MACHINE : HKEY_CURRENT_USER, keys[i], 0,
+                     KEY_NOTIFY, &ds->reg_key[i]) != ERROR_SUCCESS)
+    {
+      ds->reg_key[i] = NULL;
+      continue;
+    }
+    ds->reg_event[i] = CreateEvent (NULL, TRUE, FALSE, NULL);
+    RegNotifyChangeKeyValue (ds->reg_key[i], FALSE, REG_NOTIFY_CHANGE_LAST_SET,
+                             ds->reg_event[i], TRUE);
+  }
+}
 
-  getopt_free (&opt.cmd_line);
+static void daemon_watch_event (const struct watch_event *ev, void *arg)
+{
+  struct daemon_state *ds = arg;
 
-  cfg_ignore_exit();
+  DEBUGF (2, "dir: %d, action: %d, name: %s\n", ev->dir, ev->action, ev->name);
+  if (ev->action == WATCH_STOPPED)
+     ds->rewatch = TRUE;
+}
 
-  netrc_exit();
-  authinfo_exit();
-  envtool_cfg_exit();
-  vcpkg_free();
+static void daemon_free_reply (struct daemon_reply *r)
+{
+  FREE (r->spec);
+  smartlist_free_all (r->chunks);
+  FREE (r);
+}
 
-  exit_misc();
+/**
+ * Drop the cached replies and the `scan_memo` if something they came from changed.
+ * Or if nothing tells when they get stale.
+ *
+ * If a watched directory was e.g. deleted, all are watched again from scratch
+ * by `daemon_watch_memo()`.
+ */
+static void daemon_check_changes (struct daemon_state *ds)
+{
+  BOOL changed = (ds->replies == NULL);
+  int  i, max;
 
-  if (halt_flag == 0 && opt.debug > 0)
-     mem_report();
+  if (ds->replies)
+  {
+    int num = watch_wait (ds->watch, 0, daemon_watch_event, ds);
 
-  if (halt_flag > 0)
-     C_puts ("~5Quitting.\n~0");
+    if (num >= 0 && ds->rewatch)
+    {
+      DEBUGF (1, "A directory can no longer be watched. Watching all again.\n");
+      watch_free (ds->watch);
+      dir_set_free (ds->watched);
+      ds->watch   = watch_new();
+      ds->watched = dir_set_new (!opt.case_sensitive);
+      ds->rewatch = FALSE;
+      if (!ds->watch)
+         num = -1;
+    }
+
+    if (num < 0)
+    {
+      DEBUGF (1, "watch_wait() failed. Not caching replies any more.\n");
+      while (smartlist_len(ds->replies) > 0)
+      {
+        daemon_free_reply (smartlist_get(ds->replies, 0));
+        smartlist_del_keeporder (ds->replies, 0);
+      }
+      smartlist_free (ds->replies);
+      ds->replies = NULL;
+      changed = TRUE;
+    }
+    else if (num > 0)
+      changed = TRUE;
+  }
+
+  for (i = 0; i < DIM(ds->reg_key); i++)
+  {
+    if (ds->reg_key[i] && WaitForSingleObject(ds->reg_event[i], 0) == WAIT_OBJECT_0)
+    {
+      ResetEvent (ds->reg_event[i]);
+      RegNotifyChangeKeyValue (ds->reg_key[i], FALSE, REG_NOTIFY_CHANGE_LAST_SET,
+                               ds->reg_event[i], TRUE);
+      changed = TRUE;
+    }
+  }
+
+  max = ds->replies ? smartlist_len (ds->missing) : 0;
+  for (i = 0; i < max && !changed; i++)
+      if (GetFileAttributes(smartlist_get(ds->missing, i)) != INVALID_FILE_ATTRIBUTES)
+         changed = TRUE;
+
+  if (!changed)
+     return;
+
+  if (ds->replies)
+  {
+    DEBUGF (1, "Dropping %d cached replies.\n", smartlist_len(ds->replies));
+    while (smartlist_len(ds->replies) > 0)
+    {
+      daemon_free_reply (smartlist_get(ds->replies, 0));
+      smartlist_del_keeporder (ds->replies, 0);
+    }
+    smartlist_free_all (ds->missing);
+    dir_set_free (ds->missing_set);
+    ds->missing     = smartlist_new();
+    ds->missing_set = dir_set_new (!opt.case_sensitive);
+  }
+  scan_memo_exit();
+  scan_memo_init();
+}
+
+/**
+ * Watch all the directories in the `scan_memo` not already watched.
+ * A directory known not to exist is in `ds->missing` instead.
+ *
+ * This is called before a query is run; so the directories of earlier
+ * queries are watched before they are scanned again. And after it is run.
+ * If that watches a new directory, it was scanned while not watched and
+ * the reply must not be cached.
+ *
+ * \retval The number of directories now watched. Or -1 if one could
+ *         not be watched.
+ */
+static int daemon_watch_memo (struct daemon_state *ds)
+{
+  int i, max = smartlist_len (scan_memo);
+  int num = 0, rc = 0;
+
+  for (i = 0; i < max; i++)
+  {
+    const struct scan_memo *sm = smartlist_get (scan_memo, i);
+
+    if (sm->probed && !sm->probe.exist)
+       continue;
+    if (dir_set_find(ds->watched, sm->dir) > 0)
+       continue;
+    if (watch_add(ds->watch, sm->dir) < 0)
+    {
+      DEBUGF (1, "Cannot watch \"%s\".\n", sm->dir);
+      rc = -1;
+      continue;
+    }
+    dir_set_add (ds->watched, sm->dir);
+    num++;
+  }
+  return (rc < 0 ? rc : num);
+}
+
+static int compare_reply (const void *key, const void **member)
+{
+  const struct daemon_reply *r = *member;
+
+  return strcmp ((const char*)key, r->spec);
+}
 
-  C_exit();
-  crtdbug_exit();
+/**
+ * The `C_write_hook` while serving. Send the output to the client
+ * and save it for the cached reply.
+ */
+static void daemon_hook (const char *buf)
+{
+  daemon_write (buf, strlen(buf));
+  if (daemon_st->chunks)
+     smartlist_add (daemon_st->chunks, STRDUP(buf));
 }
 
 /**
- * This signal-handler gets called in another thread.
- *
- * \param[in] sig the signal to handle.
+ * Serve one query. The request is the context and the `<file-spec>`
+ * on the last line.
  */
-static void MS_CDECL halt (int sig)
+static int daemon_request (const char *request, void *arg)
 {
-  BOOL quick_exit = FALSE;
+  struct daemon_state *ds = arg;
+  struct daemon_reply *r;
+  const char          *spec = strrchr (request, '\n');
+  size_t               len = spec ? (size_t) (spec - request) : 0;
+  int                  i, max, idx = 0, found, rc;
 
-  halt_flag++;
-  CRTDBG_CHECK_OFF();
+  if (!spec || !spec[1] || len != strlen(ds->context) || strncmp(request, ds->context, len))
+  {
+    DEBUGF (1, "Not serving a query with other options or environment.\n");
+    return (DAEMON_NOT_SERVED);
+  }
+  spec++;
+  DEBUGF (1, "Query: \"%s\".\n", spec);
 
-  if (opt.do_evry)
+  daemon_check_changes (ds);
+
+  if (ds->replies)
   {
-    if (Everything_hthread && Everything_hthread != INVALID_HANDLE_VALUE)
+    idx = smartlist_bsearch_idx (ds->replies, spec, compare_reply, &found);
+    if (found)
     {
-      TerminateThread (Everything_hthread, 1);
-      CloseHandle (Everything_hthread);
+      r = smartlist_get (ds->replies, idx);
+      max = smartlist_len (r->chunks);
+      for (i = 0; i < max; i++)
+      {
+        const char *chunk = smartlist_get (r->chunks, i);
+
+        daemon_write (chunk, strlen(chunk));
+      }
+      ds->num_hits++;
+      return (r->rc);
     }
-    Everything_hthread = INVALID_HANDLE_VALUE;
-    Everything_Reset();
+    if (daemon_cacheable(spec))
+       ds->chunks = smartlist_new();
   }
 
-#ifdef SIGTRAP
-  if (sig == SIGTRAP)
-  {
-    C_puts ("\n~5Got SIGTRAP.~0\n");
-    quick_exit = TRUE;
-  }
-#endif
+  C_flush();
+  C_set_output (ds->null_out);
+  C_write_hook = daemon_hook;
 
-  if (sig == SIGILL)
+  if (ds->chunks)
+     daemon_watch_memo (ds);
+
+  batch_reset (spec);
+  found = do_search();
+  final_report (found);
+
+  C_flush();
+  C_write_hook = NULL;
+  C_set_output (stdout);
+
+  if (time(NULL) - ds->cache_saved >= DAEMON_CACHE_SAVE)
   {
-    C_puts ("\n~5Illegal instruction.~0\n");
-    quick_exit = TRUE;
+    dir_cache_trim();
+    dir_cache_save();
+    ds->cache_saved = time (NULL);
   }
 
-  if (quick_exit)
+  rc = found ? 0 : 1;
+  if (ds->chunks && !halt_flag && daemon_watch_memo(ds) == 0)
   {
-    /* Get out as fast as possible */
-    C_exit();
-    ExitProcess (GetCurrentProcessId());
+    r = MALLOC (sizeof(*r));
+    r->spec   = STRDUP (spec);
+    r->chunks = ds->chunks;
+    r->rc     = rc;
+    smartlist_insert (ds->replies, idx, r);
   }
+  else if (ds->chunks)
+    smartlist_free_all (ds->chunks);
+  ds->chunks = NULL;
+  return (rc);
 }
 
 /**
- * The main initialiser.
+ * Handle the `--daemon` option.
+ *
+ * Serve queries from later `envtool` commands on the socket
+ * `%LOCALAPPDATA%\\envtool.sock` until `^C` is pressed. The compilers,
+ * Python and the directory probes are found once. A query is only served
+ * if the options, current directory and the environment-variables in
+ * `daemon_envs[]` are the same as for the daemon. Otherwise the client
+ * runs it itself.
+ *
+ * In `--path` (with `--no-app`), `--lib` and `--inc` modes the replies are
+ * cached. They are dropped when a file in a directory they came from
+ * changes, a missing directory gets created or the environment in the
+ * registry changes.
+ *
+ * The directory-cache is pruned and saved at most every `DAEMON_CACHE_SAVE`
+ * seconds after a query.
  */
-static void init_all (const char **argv)
+static int do_daemon (void)
 {
-  char buf [_MAX_PATH];
+  struct daemon_state ds;
+  char  *path;
+  int    i, num;
 
-  atexit (cleanup);
-  crtdbug_init();
+  if (opt.sink_format != SINK_TEXT || opt.sink_file)
+  {
+    WARN ("\"--daemon\" works with text output to stdout only.\n");
+    return (1);
+  }
 
-  tzset();
-  memset (&opt, 0, sizeof(opt));
-  opt.under_conemu = C_conemu_detected();
+  memset (&ds, '\0', sizeof(ds));
+  ds.context     = daemon_context();
+  ds.null_out    = fopen (DEV_NULL, "w");
+  ds.cache_saved = time (NULL);
+  if (daemon_cacheable(""))
+  {
+    ds.replies     = smartlist_new();
+    ds.watch       = watch_new();
+    ds.watched     = dir_set_new (!opt.case_sensitive);
+    ds.missing     = smartlist_new();
+    ds.missing_set = dir_set_new (!opt.case_sensitive);
+    daemon_reg_init (&ds);
+  }
+  daemon_st = &ds;
 
-  if (GetModuleFileName(NULL, buf, sizeof(buf)))
-       who_am_I = STRDUP (buf);
-  else who_am_I = STRDUP (argv[0]);
+  path = daemon_sock_path();
+  C_printf ("~3Serving queries on \"%s\"%s. Press ^C to stop.~0\n",
+            path, ds.replies ? " (cached)" : "");
+  C_flush();
 
-  program_name = who_am_I;
+  num = daemon_serve (path, daemon_request, &ds, &halt_flag);
+  if (num >= 0)
+     C_printf ("%d queries served, %u from the cache.\n", num, ds.num_hits);
 
-  C_use_colours = 1;  /* Turned off by "--no-colour" */
+  daemon_st = NULL;
+  if (ds.replies)
+  {
+    for (i = 0; i < smartlist_len(ds.replies); i++)
+        daemon_free_reply (smartlist_get(ds.replies, i));
+    smartlist_free (ds.replies);
+    watch_free (ds.watch);
+    dir_set_free (ds.watched);
+    smartlist_free_all (ds.missing);
+    dir_set_free (ds.missing_set);
+  }
+  for (i = 0; i < DIM(ds.reg_key); i++)
+  {
+    if (ds.reg_key[i])
+       RegCloseKey (ds.reg_key[i]);
+    if (ds.reg_event[i])
+       CloseHandle (ds.reg_event[i]);
+  }
+  if (ds.null_out)
+     fclose (ds.null_out);
+  FREE (ds.context);
+  FREE (path);
+  return (num >= 0 ? 0 : 1);
+}
 
-  dir_array = smartlist_new();
-  reg_array = smartlist_new();
+/**
+ * Print a piece of output from the daemon. The text was printed
+ * by the daemon and may contain a `~` (e.g. in a short file-name).
+ * So only a separate colour code is interpreted.
+ */
+static void daemon_print (const char *buf, size_t len, void *arg)
+{
+  int raw;
 
-#ifdef __CYGWIN__
-  opt.conv_cygdrive = 1;
-#endif
+  if (len == 2 && buf[0] == '~')
+  {
+    C_puts (buf);
+    return;
+  }
+  raw = C_setraw (1);
+  C_puts (buf);
+  C_setraw (raw);
+  ARGSUSED (arg);
+}
 
-  vcache_fname = getenv_expand ("%TEMP%\\envtool.cache");
+/**
+ * Let a running `--daemon` answer this query.
+ *
+ * \retval DAEMON_NO_SERVER or DAEMON_NOT_SERVED if the query must be run here.
+ * \retval The exit-code otherwise.
+ */
+static int daemon_forward (void)
+{
+  char *path, *request;
+  int   rc = DAEMON_NO_SERVER;
 
-  current_dir[0] = '.';
-  current_dir[1] = DIR_SEP;
-  current_dir[2] = '\0';
-  getcwd (current_dir, sizeof(current_dir));
+  if (opt.do_daemon || opt.do_check || opt.do_shadow || opt.do_tests || opt.do_watch ||
+      opt.do_version || opt.help || opt.batch_file || opt.evry_raw || opt.file_specs ||
+      !opt.file_spec || opt.sink_format != SINK_TEXT || opt.sink_file)
+     return (rc);
 
-  sys_dir[0] = sys_native_dir[0] = '\0';
-  if (GetSystemDirectory(sys_dir,sizeof(sys_dir)))
+  path = daemon_sock_path();
+  if (FILE_EXISTS(path))
   {
-    const char *rslash = strrchr (sys_dir,'\\');
-
-    if (rslash > sys_dir)
-    {
-      snprintf (sys_native_dir, sizeof(sys_native_dir), "%.*s\\sysnative",
-                (int)(rslash - sys_dir), sys_dir);
-      snprintf (sys_wow64_dir, sizeof(sys_wow64_dir), "%.*s\\SysWOW64",
-                (int)(rslash - sys_dir), sys_dir);
-    }
+    request = daemon_context();
+    request = _stracat (request, "\n");
+    request = _stracat (request, opt.file_spec);
+    rc = daemon_query (path, request, daemon_print, NULL);
+    C_flush();
+    DEBUGF (1, "daemon_query(): %d.\n", rc);
+    FREE (request);
   }
+  FREE (path);
+  return (rc);
+}
+
+/**
+ * The `popen_hook` for `--profile`.
+ */
+static void profile_popen (const char *cmd, UINT64 start)
+{
+  profile_item ("popen", cmd, start);
 }
 
 /**
@@ -5160,7 +7610,8 @@ static void init_all (const char **argv)
  */
 int MS_CDECL main (int argc, const char **argv)
 {
-  int found = 0;
+  int  found = 0, rc;
+  BOOL sink_ok;
 
   init_all (argv);
 
@@ -5168,7 +7619,30 @@ int MS_CDECL main (int argc, const char **argv)
   if (!eval_options())
      return (1);
 
+  /* Let a running "--daemon" answer the query if it can.
+   */
+  rc = daemon_forward();
+  if (rc >= 0)
+     return (rc);
+
+  if (opt.do_profile)
+  {
+    profile_init();
+    popen_hook = profile_popen;
+  }
+
+  /* Everything up to the first search is the cold-start time of
+   * e.g. "envtool --path foo". Keep it small; subsystems are set up
+   * on first use.
+   */
+  profile_enter ("startup");
+
   cfg_ignore_init ("%APPDATA%\\envtool.cfg");
+
+  if (opt.use_dir_cache)
+     dir_cache_init ("%LOCALAPPDATA%\\envtool-dirs.cache");
+  if (opt.show_size && opt.dir_mode)
+     dir_size_init (opt.scan_threads, 1000 * opt.size_budget);
   check_sys_dirs();
 
   /* Sometimes the IPC connection to the EveryThing Database will hang.
@@ -5184,21 +7658,18 @@ int MS_CDECL main (int argc, const char **argv)
   if (opt.do_version)
      return show_version();
 
-  if (opt.do_python)
-     py_init();
-
   if (opt.do_check)
      return do_check();
 
+  if (opt.do_shadow)
+     return do_shadow();
+
   if (opt.do_tests)
      return do_tests();
 
   if (opt.do_evry && !opt.do_path)
      opt.no_sys_env = opt.no_usr_env = opt.no_app_path = 1;
 
-  if (opt.do_lib || opt.do_include)
-     search_and_add_all_cc (FALSE, FALSE);
-
   if (!(opt.do_path || opt.do_lib || opt.do_include))
      opt.no_sys_env = opt.no_usr_env = 1;
 
@@ -5207,160 +7678,42 @@ int MS_CDECL main (int argc, const char **argv)
      usage ("Use at least one of; \"--evry\", \"--cmake\", \"--inc\", \"--lib\", "
             "\"--man\", \"--path\", \"--pkg\", \"--vcpkg\" and/or \"--python\".\n");
 
-  if (!opt.file_spec)
+  if (!opt.file_spec && !opt.batch_file && !opt.do_daemon)
      usage ("You must give a ~1filespec~0 to search for.\n");
 
-  if (!opt.evry_raw && !opt.dir_mode)
-  {
-    if (!opt.use_regex)
-    {
-      char *end, *dot, *fspec;
-
-      if (strchr(opt.file_spec,'~') > opt.file_spec)
-      {
-        fspec = opt.file_spec;
-        opt.file_spec = _fix_path (fspec, NULL);
-        FREE (fspec);
-      }
-
-      end = strrchr (opt.file_spec, '\0');
-      dot = strrchr (opt.file_spec, '.');
-      if (!dot && !opt.do_vcpkg)
-      {
-        if (opt.do_pkg && end > opt.file_spec && end[-1] != '*')
-           opt.file_spec = _stracat (opt.file_spec, ".pc*");
-
-        else if (opt.do_vcpkg && end > opt.file_spec && end[-1] != '*')
-           opt.file_spec = _stracat (opt.file_spec, "*");
+  if (opt.file_specs)
+     check_file_specs();
 
-        else if (end > opt.file_spec && end[-1] != '*' && end[-1] != '$')
-           opt.file_spec = _stracat (opt.file_spec, ".*");
-      }
-    }
-    else
-    {
-      re_err = regcomp (&re_hnd, opt.file_spec, opt.case_sensitive ? 0 : REG_ICASE);
-      re_alloc = TRUE;
-      if (re_err)
-      {
-        regerror (re_err, &re_hnd, re_errbuf, sizeof(re_errbuf));
-        WARN ("Invalid regular expression \"%s\": %s\n", opt.file_spec, re_errbuf);
-      }
-    }
-  }
+  compile_file_spec();
 
   DEBUGF (1, "opt.file_spec: '%s'\n", opt.file_spec);
 
-  if (!opt.no_sys_env)
-     found += scan_system_env();
-
-  if (!opt.no_usr_env)
-     found += scan_user_env();
-
-  if (opt.do_path)
-  {
-    if (!opt.no_app_path)
-       found += do_check_registry();
-
-    report_header = "Matches in %PATH:\n";
-    found += do_check_env ("PATH", FALSE);
-  }
-
-  if (opt.do_lib)
-  {
-    report_header = "Matches in %LIB:\n";
-    found += do_check_env ("LIB", FALSE);
-
-    if (!opt.no_watcom)
-       found += do_check_watcom_library_paths();
-
-    if (!opt.no_borland)
-       found += do_check_borland_library_paths();
-
-    if (!(opt.no_gcc && opt.no_gpp))   /* Ignore all 'gcc.exe' and g++.exe' */
-       found += do_check_gcc_library_paths();
-
-    if (!opt.no_clang)
-       found += do_check_clang_library_paths();
-  }
-
-  if (opt.do_include)
-  {
-    report_header = "Matches in %INCLUDE:\n";
-    found += do_check_env ("INCLUDE", FALSE);
-
-    if (!opt.no_watcom)
-       found += do_check_watcom_includes();
-
-    if (!opt.no_borland)
-      found += do_check_borland_includes();
-
-    if (!opt.no_gcc)
-       found += do_check_gcc_includes();
-
-    if (!opt.no_gpp)
-       found += do_check_gpp_includes();
-
-    if (!opt.no_clang)
-       found += do_check_clang_includes();
-  }
-
-  if (opt.do_cmake)
-     found += do_check_cmake();
-
-  if (opt.do_man)
-     found += do_check_manpath();
-
-  if (opt.do_pkg)
-     found += do_check_pkg();
+  if (!sink_open(opt.sink_file))
+     return (1);
 
-  if (opt.do_vcpkg)
-     found += do_check_vcpkg();
+  scan_memo_init();
+  profile_leave();
 
-  if (opt.do_python)
+  if (opt.do_daemon)
   {
-    char  report [_MAX_PATH+50];
-    char *py_exe;
-
-    py_get_info (&py_exe, NULL, NULL);
-    snprintf (report, sizeof(report), "Matches in \"%s\" sys.path[]:\n", py_exe);
-    report_header = report;
-    found += py_search();
-    FREE (py_exe);
+    rc = do_daemon();
+    sink_close();
+    return (rc);
   }
 
-  /* Mode "--evry" specified.
-   */
-  if (opt.do_evry)
-  {
-    int i, max = 0;
-
-    if (opt.evry_host)
-       max = smartlist_len (opt.evry_host);
-
-    /* Mode "--evry:host" specified at least once.
-     * Connect and query all hosts.
-     */
-    for (i = 0; i < max; i++)
-    {
-      const char *host = smartlist_get (opt.evry_host, i);
-      char  buf [200];
-
-      snprintf (buf, sizeof(buf), "Matches from %s:\n", host);
-      report_header = buf;
-      found += do_check_evry_ept (host);
-    }
-    if (max  == 0)
-    {
-      report_header = "Matches from EveryThing:\n";
-      found += do_check_evry();
-    }
-  }
+  if (opt.batch_file)
+       found = do_batch();
+  else found = do_search();
 
   ARGSUSED (argc);
 
-  final_report (found);
-  return (found ? 0 : 1);
+  sink_ok = sink_close();
+  if (!opt.batch_file)
+     final_report (found);
+
+  if (opt.do_watch)
+     do_watch();
+  return (found && sink_ok ? 0 : 1);
 }
 
 /**
@@ -5368,7 +7721,7 @@ int MS_CDECL main (int argc, const char **argv)
  */
 static void test_split_env (const char *env)
 {
-  smartlist_t *list;
+  vector_t    *list;
   char        *value;
   int          i, max;
 
@@ -5377,10 +7730,10 @@ static void test_split_env (const char *env)
 
   value = getenv_expand (env);
   list  = split_env_var (env, value);
-  max   = list ? smartlist_len (list) : 0;
+  max   = list ? vector_len (list) : 0;
   for (i = 0; i < max; i++)
   {
-    const struct directory_array *arr = smartlist_get (list, i);
+    const struct directory_array *arr = vector_get (list, i);
     char  buf [_MAX_PATH];
     char *dir = arr->dir;
 
@@ -5421,7 +7774,7 @@ static void test_split_env (const char *env)
  */
 static void test_split_env_cygwin (const char *env)
 {
-  smartlist_t *list;
+  vector_t    *list;
   char        *value, *cyg_value;
   int          i, max, rc, needed, save = opt.conv_cygdrive;
 
@@ -5448,11 +7801,11 @@ static void test_split_env_cygwin (const char *env)
   opt.conv_cygdrive = 0;
   list = split_env_var (env, cyg_value);
 
-  max = list ? smartlist_len (list) : 0;
+  max = list ? vector_len (list) : 0;
 
   for (i = 0; i < max; i++)
   {
-    const struct directory_array *arr = smartlist_get (list, i);
+    const struct directory_array *arr = vector_get (list, i);
     char *dir = arr->dir;
 
     if (arr->exist && arr->is_dir)
@@ -6181,7 +8534,7 @@ void regex_print (const regex_t *re, const regmatch_t *rm, const char *str)
  */
 static void check_env_val (const char *env, int *num, char *status, size_t status_sz)
 {
-  smartlist_t                  *list = NULL;
+  vector_t                     *list = NULL;
   int                           i, errors, max = 0;
   int                           save  = opt.conv_cygdrive;
   char                         *value = getenv_expand (env);
@@ -6204,15 +8557,16 @@ static void check_env_val (const char *env, int *num, char *status, size_t statu
 #endif
 
     list = split_env_var (env, value);
-    *num = max = smartlist_len (list);
+    *num = max = vector_len (list);
   }
 
   for (i = errors = 0; i < max; i++)
   {
     char fbuf [_MAX_PATH];
     const char *start, *end;
+    struct dir_probe probe;
 
-    arr = smartlist_get (list, i);
+    arr = vector_get (list, i);
     start = arr->dir;
     end   = arr->dir + strlen(arr->dir) - 1;
 
@@ -6243,7 +8597,7 @@ static void check_env_val (const char *env, int *num, char *status, size_t statu
       snprintf (status, status_sz, "~5Missing dir~0: ~3\"%s\"~0", fbuf);
       errors++;
     }
-    else if (!arr->is_cwd && dir_is_empty(fbuf))
+    else if (!arr->is_cwd && probe_dir(fbuf, &probe))
     {
       snprintf (status, status_sz, "~5Empty dir~0: ~3\"%s\"~0", fbuf);
       errors++;
@@ -6282,7 +8636,7 @@ static void check_env_val (const char *env, int *num, char *status, size_t statu
  * \param[in] list     a `smartlist_t` of the environment value components.
  * \param[in] env_name The name of the environment variable. E.g. `PATH`.
  */
-static void check_env_val_reg (const smartlist_t *list, const char *env_name)
+static void check_env_val_reg (const vector_t *list, const char *env_name)
 {
   int   i, errors = 0, max = 0;
   int   indent = sizeof("Checking");
@@ -6292,15 +8646,15 @@ static void check_env_val_reg (const smartlist_t *list, const char *env_name)
             "SYSTEM\\CurrentControlSet\\Control\\Session Manager\\Environment", env_name);
 
   if (list)
-     max = smartlist_len (list);
+     max = vector_len (list);
 
   for (i = 0; i < max; i++)
   {
     char  fbuf [_MAX_PATH];
     char  link [_MAX_PATH];
-    DWORD attr;
+    struct dir_probe probe;
 
-    arr = smartlist_get (list, i);
+    arr = vector_get (list, i);
     slashify2 (fbuf, arr->dir, opt.show_unix_paths ? '/' : '\\');
 
     if (opt.verbose)
@@ -6308,9 +8662,8 @@ static void check_env_val_reg (const smartlist_t *list, const char *env_name)
       C_printf ("   [%2d]: ~6", i);
       print_raw (fbuf, "~6", NULL);
 
-      attr = GetFileAttributes (arr->dir);
-      if ((attr != INVALID_FILE_ATTRIBUTES) &&
-          (attr & FILE_ATTRIBUTE_REPARSE_POINT) &&
+      probe_dir (arr->dir, &probe);
+      if (probe.is_reparse &&
           get_disk_type(arr->dir[0]) != DRIVE_REMOTE &&
           get_reparse_point (arr->dir, link, TRUE))
       {
@@ -6332,7 +8685,7 @@ static void check_env_val_reg (const smartlist_t *list, const char *env_name)
       print_raw (fbuf, " ~3", "~0\n");
       errors++;
     }
-    else if (!arr->is_cwd && dir_is_empty(fbuf))
+    else if (!arr->is_cwd && probe_dir(fbuf, &probe))
     {
       C_printf ("%*c~5Empty dir~0:", indent, ' ');
       print_raw (fbuf, " ~3", "~0\n");
@@ -6369,10 +8722,10 @@ static void check_app_paths (HKEY key)
   build_reg_array_app_path (key);
   sort_reg_array();
 
-  max  = smartlist_len (reg_array);
+  max  = vector_len (&reg_array);
   for (i = errors = 0; i < max; i++)
   {
-    const struct registry_array *arr = smartlist_get (reg_array, i);
+    const struct registry_array *arr = vector_get (&reg_array, i);
     char  fqfn [_MAX_PATH];
     char  fbuf [_MAX_PATH];
 
@@ -6428,6 +8781,36 @@ static void check_app_paths (HKEY key)
   free_reg_array();
 }
 
+/**
+ * The handler for mode `"--shadow"`.
+ *
+ * Index the programs and DLLs in all `%PATH%` directories in one pass.
+ * Then report every name found more than once. A duplicated directory
+ * is indexed once only.
+ */
+static int do_shadow (void)
+{
+  shadow_index *idx   = shadow_new();
+  char         *value = getenv_expand ("PATH");
+  vector_t     *list  = split_env_var ("PATH", value);
+  int           i, max = list ? vector_len (list) : 0;
+
+  for (i = 0; i < max && !halt_flag; i++)
+  {
+    const struct directory_array *arr = vector_get (list, i);
+
+    if (arr->num_dup == 0 && arr->exp_ok && arr->exist && arr->is_dir)
+       shadow_add_dir (idx, arr->dir);
+  }
+  if (!halt_flag)
+     shadow_report (idx, "PATH");
+
+  shadow_free (idx);
+  free_dir_array();
+  FREE (value);
+  return (0);
+}
+
 /**
  * The handler for mode `"--check"`.
  * Check the Registry keys even if `opt.no_app_path` is set.
@@ -6463,6 +8846,11 @@ static int do_check (void)
   save = opt.no_cwd;
   opt.no_cwd = 1;
 
+  /* Many directories are in several of the below env-vars and Registry
+   * keys. Probe each only once.
+   */
+  scan_memo_init();
+
   for (i = 0, env = envs[0]; i < DIM(envs) && env; env = envs[++i])
   {
     indent = (int) (sizeof("CPLUS_INCLUDE_PATH") - strlen(env));
@@ -189,6 +189,8 @@
 #endif
 
 #include "getopt_long.h"
+#include "wildcard.h"
+#include "color.h"
 
 #if defined(_DEBUG)
   #define ASSERT(expr) do {                                            \
@@ -356,6 +358,7 @@ typedef enum SignStatus {
       } SignStatus;
 
 #include "sort.h"
+#include "sink.h"
 
 struct prog_options {
        int             debug;
@@ -402,15 +405,28 @@ struct prog_options {
        int             do_pkg;
        int             do_vcpkg;
        int             do_check;
+       int             do_watch;
+       int             do_shadow;
+       int             do_daemon;
+       int             do_profile;
+       int             scan_threads;
+       int             use_dir_cache;
        int             conv_cygdrive;
        int             case_sensitive;
        int             cache_ver_level;
        int             keep_temp;
        int             under_conemu;
        enum SortMethod sort_method;
+       int             size_budget;   /* Max seconds to size one directory with "--size -D" */
+       int             sort_mem;      /* MBytes of matches to sort in memory before spilling to disk */
+       int             max_matches;   /* Stop after N matches with "--max-matches" or "--first". 0 = no limit */
+       enum SinkFormat sink_format;
+       char           *sink_file;     /* The "--output" file; NULL for stdout */
+       char           *batch_file;    /* The "--batch" file with one query on each line; "-" for stdin */
        BOOL            evry_raw;      /* use raw non-regex searches */
        void           *evry_host;     /* A smartlist_t */
        char           *file_spec;
+       void           *file_specs;    /* A smartlist_t; all file-specs if more than one */
        int             remaining_arg_pos;
        command_line    cmd_line;
      };
@@ -422,6 +438,9 @@ extern HANDLE Everything_hthread; /* set by Everything.c */
 
 extern volatile int halt_flag;
 
+extern BOOL     search_halted (void);
+extern unsigned matches_left  (void);
+
 extern char sys_dir        [_MAX_PATH];
 extern char sys_native_dir [_MAX_PATH];
 extern char sys_wow64_dir  [_MAX_PATH];
@@ -717,18 +736,11 @@ int   popen_run  (popen_callback callback, const char *cmd);
 int   popen_runf (popen_callback callback, const char *fmt, ...);
 char *popen_last_line (void);
 
-/* fnmatch() ret-values and flags:
- */
-#define FNM_MATCH          1
-#define FNM_NOMATCH        0
-
-#define FNM_FLAG_NOESCAPE  0x01
-#define FNM_FLAG_PATHNAME  0x02
-#define FNM_FLAG_NOCASE    0x04
+extern void (*popen_hook) (const char *cmd, UINT64 start);
 
-extern int   fnmatch      (const char *pattern, const char *string, int flags);
-extern int   fnmatch_case (int flags);
-extern char *fnmatch_res  (int rc);
+/* fnmatch() and the FNM_x values are in wildcard.h.
+ */
+extern int fnmatch_case (int flags);
 
 /* Handy macros: */
 
@@ -758,12 +770,16 @@ extern char *fnmatch_res  (int rc);
  */
 #define DIM(arr)       (int) (sizeof(arr) / sizeof(arr[0]))
 #define ARGSUSED(foo)  (void)foo
+#define TOUPPER(c)     toupper ((int)(c))
+#define TOLOWER(c)     tolower ((int)(c))
 
 #define DEBUGF(level, ...)  do {                                        \
                               if (opt.debug >= level) {                 \
+                                C_lock();                               \
                                 debug_printf ("%s(%u): ",               \
                                               __FILE(), __LINE__);      \
                                 debug_printf (__VA_ARGS__);             \
+                                C_unlock();                             \
                               }                                         \
                             } while (0)
 
@@ -774,9 +790,11 @@ extern char *fnmatch_res  (int rc);
 
 #define WARN(...)           do {                                        \
                               if (!opt.quiet) {                         \
+                                C_lock();                               \
                                 C_puts ("~5");                          \
                                 C_printf (__VA_ARGS__);                 \
                                 C_puts ("~0");                          \
+                                C_unlock();                             \
                               }                                         \
                             } while (0)
 
@@ -20,6 +20,7 @@
 #include "envtool_py.h"
 #include "dirlist.h"
 #include "smartlist.h"
+#include "profile.h"
 
 /* No need to include <Python.h> just for this:
  */
@@ -410,7 +411,10 @@ const char **py_get_variants (void)
 struct python_info *py_select (enum python_variants which)
 {
   struct python_info *pi;
-  int    i, max = smartlist_len (py_programs);
+  int    i, max;
+
+  py_init();
+  max = smartlist_len (py_programs);
 
   for (i = 0; i < max; i++)
   {
@@ -720,6 +724,7 @@ void py_exit (void)
   {
     smartlist_wipe (py_programs, free_py_program);
     smartlist_free (py_programs);
+    py_programs = NULL;
   }
 
 #if !defined(_DEBUG)
@@ -1463,18 +1468,26 @@ static int report_zip_file (struct python_info *py, const char *zip_file, char *
         "    if debug >= 3:\n"                                                      \
         "      trace ('str: \"%%s\"\\n' %% str)\n"                                  \
         "    print (str)\n"                                                         \
+        "    return True\n"                                                         \
+        "  return False\n"                                                          \
         "\n"                                                                        \
         "zf = zipfile.ZipFile (r\"%s\", 'r')\n"   /* zfile */                       \
+        "num = 0\n"                                                                 \
         "for f in zf.infolist():\n"                                                 \
-        "  print_zline (f, %d)\n"                 /* opt.debug */
+        "  if print_zline (f, %d):\n"             /* opt.debug */                   \
+        "    num += 1\n"                                                            \
+        "    if num == %u:\n"                     /* matches_left(); 0 = no limit */\
+        "      break\n"
 
 static int process_zip (struct python_info *py, const char *zfile)
 {
-  char  cmd [sizeof(PY_ZIP_LIST()) + _MAX_PATH + 100];
-  char *line, *str = NULL;
-  int   found = 0;
-  int   len = snprintf (cmd, sizeof(cmd), PY_ZIP_LIST(),
-                        opt.case_sensitive, opt.file_spec, zfile, opt.debug);
+  char     cmd [sizeof(PY_ZIP_LIST()) + _MAX_PATH + 100];
+  char    *line, *str = NULL;
+  int      found = 0;
+  unsigned left = matches_left();
+  int      len = snprintf (cmd, sizeof(cmd), PY_ZIP_LIST(),
+                           opt.case_sensitive, opt.file_spec, zfile, opt.debug,
+                           left == UINT_MAX ? 0 : left);
   if (len < 0)
      FATAL ("cmd[] buffer too small.\n");
 
@@ -1489,7 +1502,7 @@ static int process_zip (struct python_info *py, const char *zfile)
       DEBUGF (2, "line: \"%s\", found: %d\n", line, found);
       if (!strncmp(line,"str: ",5))   /* if opt.debug >= 3; ignore these from stderr */
          continue;
-      if (!report_zip_file(py, zfile, line))
+      if (!report_zip_file(py, zfile, line) || search_halted())
          break;
     }
   }
@@ -1748,7 +1761,7 @@ int py_search (void)
   found = 0;
   len = smartlist_len (g_py->sys_path);
 
-  for (i = 0; i < len; i++)
+  for (i = 0; i < len && !search_halted(); i++)
   {
     struct python_path *pp = smartlist_get (g_py->sys_path, i);
 
@@ -1911,7 +1924,10 @@ static void enum_pythons_on_path (void)
 int py_test (void)
 {
   struct python_info *pi;
-  int    i, found = 0, max = smartlist_len (py_programs);
+  int    i, found = 0, max;
+
+  py_init();
+  max = smartlist_len (py_programs);
 
   for (i = 0; i < max; i++)
   {
@@ -2012,9 +2028,12 @@ void py_searchpaths (void)
   struct python_info *pi;
   const char *ignored;
   char  fname [_MAX_PATH] = { '\0' };
-  int   i, num = 0, max = smartlist_len (py_programs);
+  int   i, num = 0, max;
   char  slash  = (opt.show_unix_paths ? '/' : '\\');
 
+  py_init();
+  max = smartlist_len (py_programs);
+
   for (i = 0; i < max; i++)
   {
     char  version [12] = { '\0' };
@@ -2205,11 +2224,20 @@ void enum_python_in_registry (const char *key_name)
  *  \li Find the details of all supported Pythons in \ref all_py_programs.
  *  \li Walk the `%PATH` and Registry (not yet) to find this information.
  *  \li Add each Python found to the \ref py_programs smartlist as they are found.
+ *
+ * Called on first use by `py_select()`, `py_test()` and `py_searchpaths()`.
+ * Does nothing if already done.
  */
 void py_init (void)
 {
   size_t f_len = strlen (__FILE());
   int    i, max;
+  UINT64 start;
+
+  if (py_programs)
+     return;
+
+  start = profile_start();
 
 #if !defined(_DEBUG)
   if (exc_hnd == NULL)
@@ -2228,6 +2256,8 @@ void py_init (void)
   enum_python_in_registry ("Software\\Python\\PythonCore");
 #endif
 
+  profile_item ("init", "py_init()", start);
+
   DEBUGF (1, "py_which: %d/%s\n\n", py_which, py_variant_name(py_which));
 
   max = smartlist_len (py_programs);
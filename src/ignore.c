@@ -12,6 +12,7 @@
 #include "color.h"
 #include "smartlist.h"
 #include "ignore.h"
+#include "profile.h"
 
 /**
  * The list of sections we handle here.
@@ -28,8 +29,9 @@ static const struct search_list sections[] = {
 /**\struct ignore_node
  */
 struct ignore_node {
-       const char *section;  /** The section; one of the ones in `sections[]` */
-       char       *value;    /** The value to ignore (allocated by STRDUP()) */
+       const char   *section;  /** The section; one of the ones in `sections[]` */
+       char         *value;    /** The value to ignore (allocated by STRDUP()) */
+       fnmatch_spec *spec;     /** The compiled `value` for a case-insensitive wildcard match */
      };
 
 /** A dynamic array of ignore_node.
@@ -37,6 +39,10 @@ struct ignore_node {
  */
 static smartlist_t *ignore_list = NULL;
 
+/** The config-file given to cfg_ignore_init(). Not parsed until the first lookup.
+ */
+static char *cfg_file = NULL;
+
 /**
  * Callback for smartlist_read_file():
  *
@@ -88,6 +94,7 @@ static void cfg_parse (smartlist_t *sl, const char *line)
     node = MALLOC (sizeof(*node));
     node->section = section;
     node->value   = STRDUP (str_rtrim(ignore));
+    node->spec    = fnmatch_compile (node->value, FNM_FLAG_NOCASE);
     smartlist_add (sl, node);
     DEBUGF (3, "%s: %s: '%s'\n", quoted ? "quoted" : "unquoted", node->section, node->value);
   }
@@ -99,22 +106,38 @@ quit:
 }
 
 /**
- * Try to open and parse a config-file.
+ * Set the config-file to use. It is parsed by cfg_ignore_load() on the first
+ * lookup. Most modes never look up anything.
  *
  * \param[in] fname  the config-file.
+ * \retval TRUE if `fname` could be expanded.
  */
 int cfg_ignore_init (const char *fname)
 {
-  char *file = getenv_expand (fname);
+  FREE (cfg_file);
+  cfg_file = getenv_expand (fname);
+  DEBUGF (3, "file: %s\n", cfg_file);
+  return (cfg_file != NULL);
+}
 
-  DEBUGF (3, "file: %s\n", file);
-  if (file)
-  {
-    ignore_list = smartlist_read_file (file, cfg_parse);
-    FREE (file);
-  }
+/**
+ * Open and parse the config-file from cfg_ignore_init().
+ * Does nothing if already done.
+ */
+static void cfg_ignore_load (void)
+{
+  char  *file = cfg_file;
+  UINT64 start;
+
+  if (!file)
+     return;
+
+  cfg_file = NULL;
+  start = profile_start();
+  ignore_list = smartlist_read_file (file, cfg_parse);
+  profile_item ("init", file, start);
+  FREE (file);
   cfg_ignore_dump();
-  return (ignore_list != NULL);
 }
 
 /**
@@ -130,6 +153,7 @@ int cfg_ignore_lookup (const char *section, const char *value)
 {
   int i, max;
 
+  cfg_ignore_load();
   if (section[0] != '[' || !ignore_list)
      return (0);
 
@@ -153,7 +177,7 @@ int cfg_ignore_lookup (const char *section, const char *value)
 
     /* A wildcard case-insensitive match
      */
-    if (fnmatch(node->value, value, FNM_FLAG_NOCASE) == FNM_MATCH)
+    if (fnmatch_exec(node->spec, value) == FNM_MATCH)
     {
       DEBUGF (3, "Wildcard match for '%s' in %s.\n", value, section);
       return (1);
@@ -179,6 +203,7 @@ const char *cfg_ignore_first (const char *section)
   int   i, max;
   UINT  idx = list_lookup_value (section, sections, DIM(sections));
 
+  cfg_ignore_load();
   if (idx == UINT_MAX)
   {
     DEBUGF (2, "No such section: %s.\n", section);
@@ -262,6 +287,7 @@ void cfg_ignore_exit (void)
 {
   int i, max;
 
+  FREE (cfg_file);
   if (!ignore_list)
      return;
 
@@ -270,6 +296,7 @@ void cfg_ignore_exit (void)
   {
     struct ignore_node *node = smartlist_get (ignore_list, i);
 
+    fnmatch_free (node->spec);
     FREE (node->value);
     FREE (node);
   }
@@ -1,7 +1,7 @@
 /**\file    misc.c
  * \ingroup Misc
  * \brief   Various support functions for EnvTool
- * \note    fnmatch(), basename() and dirname() are taken from djgpp and modified.
+ * \note    basename() and dirname() are taken from djgpp and modified.
  */
 #include <stdio.h>
 #include <stdlib.h>
@@ -53,9 +53,6 @@
  */
 #define VALID_CH(c)   ((c) >= -1 && (c) <= 255)
 
-#define TOUPPER(c)    toupper ((int)(c))
-#define TOLOWER(c)    tolower ((int)(c))
-
 static HANDLE kernel32_hnd, userenv_hnd;
 
 #if !defined(_CRTDBG_MAP_ALLOC)
@@ -84,6 +81,29 @@ static HANDLE kernel32_hnd, userenv_hnd;
   static size_t mem_allocs      = 0;       /**< Number of allocations */
   static size_t mem_frees       = 0;       /**< Number of mem-frees */
 
+  /**
+   * The lock protecting the \ref mem_list and the above counters.
+   * Needed since worker-threads (e.g. `envtool --threads`) allocates memory too.
+   *
+   * It is initialised on the first allocation. That is done by the main-thread
+   * before any worker-thread is started.
+   */
+  static CRITICAL_SECTION mem_lock;
+  static BOOL             mem_lock_init = FALSE;
+
+  static void mem_lock_enter (void)
+  {
+    if (!mem_lock_init)
+    {
+      InitializeCriticalSection (&mem_lock);
+      mem_lock_init = TRUE;
+    }
+    EnterCriticalSection (&mem_lock);
+  }
+
+  #define MEM_LOCK()    mem_lock_enter()
+  #define MEM_UNLOCK()  LeaveCriticalSection (&mem_lock)
+
   /**
    * Add this memory block to the \ref mem_list.
    * \param[in] m    the block to add.
@@ -92,14 +112,17 @@ static HANDLE kernel32_hnd, userenv_hnd;
    */
   static void add_to_mem_list (struct mem_head *m, const char *file, unsigned line)
   {
-    m->next = mem_list;
     m->line = line;
     _strlcpy (m->file, file, sizeof(m->file));
+
+    MEM_LOCK();
+    m->next = mem_list;
     mem_list = m;
     mem_allocated += (DWORD) m->size;
     if (mem_allocated > mem_max)
        mem_max = mem_allocated;
     mem_allocs++;
+    MEM_UNLOCK();
   }
 
   /**
@@ -113,6 +136,7 @@ static HANDLE kernel32_hnd, userenv_hnd;
    * Delete this memory block from the \ref mem_list.
    * \param[in] m    the block to delete.
    * \param[in] line the line where this function was called.
+   * \note The caller must hold the `mem_lock`.
    */
   static void del_from_mem_list (const struct mem_head *m, unsigned line)
   {
@@ -1328,53 +1352,6 @@ const char *plural_str (DWORD val, const char *singular, const char *plural)
   return (singular);
 }
 
-/**
- * Find the first slash in a file-name.
- * \param[in] s the file-name to search in.
- */
-static const char *find_slash (const char *s)
-{
-  while (*s)
-  {
-    if (IS_SLASH(*s))
-       return (s);
-    s++;
-  }
-  return (NULL);
-}
-
-static const char *range_match (const char *pattern, char test, int nocase)
-{
-  char c, c2;
-  int  negate, ok;
-
-  negate = (*pattern == '!');
-  if (negate)
-     ++pattern;
-
-  for (ok = 0; (c = *pattern++) != ']'; )
-  {
-    if (c == 0)
-       return (0);    /* illegal pattern */
-
-    if (*pattern == '-' && (c2 = pattern[1]) != 0 && c2 != ']')
-    {
-      if (c <= test && test <= c2)
-         ok = 1;
-      if (nocase &&
-          TOUPPER(c)    <= TOUPPER(test) &&
-          TOUPPER(test) <= TOUPPER(c2))
-         ok = 1;
-      pattern += 2;
-    }
-    else if (c == test)
-      ok = 1;
-    else if (nocase && (TOUPPER(c) == TOUPPER(test)))
-      ok = 1;
-  }
-  return (ok == negate ? NULL : pattern);
-}
-
 int fnmatch_case (int flags)
 {
   if (opt.case_sensitive == 0)
@@ -1382,112 +1359,6 @@ int fnmatch_case (int flags)
   return (flags);
 }
 
-/**
- * File-name match.
- * Match a `string` against a `pattern` for a match.
- */
-int fnmatch (const char *pattern, const char *string, int flags)
-{
-  char c, test;
-
-  while (1)
-  {
-    c = *pattern++;
-
-    switch (c)
-    {
-      case 0:
-           return (*string == 0 ? FNM_MATCH : FNM_NOMATCH);
-
-      case '?':
-           test = *string++;
-           if (test == 0 || (IS_SLASH(test) && (flags & FNM_FLAG_PATHNAME)))
-              return (FNM_NOMATCH);
-           break;
-
-      case '*':
-           c = *pattern;
-           /* collapse multiple stars */
-           while (c == '*')
-               c = *(++pattern);
-
-           /* optimize for pattern with '*' at end or before '/' */
-           if (c == 0)
-           {
-             if (flags & FNM_FLAG_PATHNAME)
-                return (find_slash(string) ? FNM_NOMATCH : FNM_MATCH);
-             return (FNM_MATCH);
-           }
-           if (IS_SLASH(c) && (flags & FNM_FLAG_PATHNAME))
-           {
-             string = find_slash (string);
-             if (!string)
-                return (FNM_NOMATCH);
-             break;
-           }
-
-           /* general case, use recursion */
-           while ((test = *string) != '\0')
-           {
-             if (fnmatch(pattern, string, flags) == FNM_MATCH)
-                return (FNM_MATCH);
-             if (IS_SLASH(test) && (flags & FNM_FLAG_PATHNAME))
-                break;
-             ++string;
-           }
-           return (FNM_NOMATCH);
-
-      case '[':
-           test = *string++;
-           if (!test || (IS_SLASH(test) && (flags & FNM_FLAG_PATHNAME)))
-              return (FNM_NOMATCH);
-           pattern = range_match (pattern, test, fnmatch_case(flags));
-           if (!pattern)
-              return (FNM_NOMATCH);
-           break;
-
-      case '\\':
-           if (!(flags & FNM_FLAG_NOESCAPE) && pattern[1] && strchr("*?[\\", pattern[1]))
-           {
-             c = *pattern++;
-             if (c == 0)
-             {
-               c = '\\';
-               --pattern;
-             }
-             if (c != *string++)
-                return (FNM_NOMATCH);
-             break;
-           }
-           /* FALLTHROUGH */
-
-      default:
-           if (IS_SLASH(c) && IS_SLASH(*string))
-           {
-             string++;
-             break;
-           }
-           if (flags & FNM_FLAG_NOCASE)
-           {
-             if (TOUPPER(c) != TOUPPER(*string++))
-                return (FNM_NOMATCH);
-           }
-           else
-           {
-             if (c != *string++)
-                return (FNM_NOMATCH);
-           }
-           break;
-    } /* switch (c) */
-  }   /* while (1) */
-}
-
-char *fnmatch_res (int rc)
-{
-  return (rc == FNM_MATCH   ? "FNM_MATCH"   :
-          rc == FNM_NOMATCH ? "FNM_NOMATCH" : "??");
-}
-
 /**
  * Strip drive-letter, directory and suffix from a filename.
  */
@@ -2619,8 +2490,10 @@ void *realloc_at (void *ptr, size_t size, const char *file, unsigned line)
     ptr = malloc_at (size, file, line);
     size = p->size - sizeof(*p);
     memmove (ptr, p+1, size);        /* since memory could be overlapping */
+    MEM_LOCK();
     del_from_mem_list (p, __LINE__);
     mem_reallocs++;
+    MEM_UNLOCK();
     free (p);
   }
   return (ptr);
@@ -2641,8 +2514,10 @@ void free_at (void *ptr, const char *file, unsigned line)
      FATAL ("free() of unknown block at %s, line %u.\n", file, line);
 
   head->marker = MEM_FREED;
+  MEM_LOCK();
   del_from_mem_list (head, __LINE__);
   mem_frees++;
+  MEM_UNLOCK();
   free (head);
 }
 #endif  /* !_CRTDBG_MAP_ALLOC */
@@ -3092,9 +2967,11 @@ int debug_printf (const char *format, ...)
   va_list args;
 
   va_start (args, format);
+  C_lock();
   raw = C_setraw (1);
   rc = C_vprintf (format, args);
   C_setraw (raw);
+  C_unlock();
   va_end (args);
   return (rc);
 }
@@ -3173,6 +3050,12 @@ char *popen_last_line (void)
   return (popen_last);
 }
 
+/**
+ * Called when a `popen_run()` is done. With the command and the
+ * `QueryPerformanceCounter()` value when it started.
+ */
+void (*popen_hook) (const char *cmd, UINT64 start) = NULL;
+
 /**
  * A wrapper for `popen()`.
  *
@@ -3194,7 +3077,9 @@ int popen_run (popen_callback callback, const char *cmd)
   int   j = -1;
   FILE *f;
   char *cmd2 = popen_setup (cmd);
+  LARGE_INTEGER start;
 
+  QueryPerformanceCounter (&start);
   *popen_last_line() = '\0';
 
   if (!cmd2)
@@ -3228,6 +3113,8 @@ int popen_run (popen_callback callback, const char *cmd)
   _pclose (f);
 
 quit:
+  if (popen_hook)
+    (*popen_hook) (cmd, start.QuadPart);
   FREE (cmd2);
   return (j);
 }
@@ -0,0 +1,297 @@
+/**\file    profile.c
+ * \ingroup Misc
+ * \brief
+ *   Timing of the phases in a run. For `envtool --profile`.
+ *
+ * A phase is e.g. the `%PATH%` search or the discovery of the compilers.
+ * Phases are entered and left with `profile_enter()` and `profile_leave()`
+ * and may be nested. The time of a phase includes the phases in it.
+ *
+ * The `startup` phase is everything in `main()` before the first search.
+ * `envtool --path foo --profile` is the benchmark for the cold-start time.
+ * The compilers, the Pythons and the config-file are set up on first use;
+ * in the phase needing them. The `compilers` phase and the `init` items
+ * show that time. `appveyor-script.bat bench` runs both cases.
+ *
+ * An item is a single directory scan, `popen()` or IPC call in a phase.
+ * It is timed with `profile_start()` and `profile_item()`. This may be
+ * called from any thread; it is added to the innermost phase of the main
+ * thread. The slowest items of each phase are kept.
+ *
+ * `profile_report()` prints the phases sorted on time.
+ * Nothing is recorded unless `profile_init()` was called.
+ */
+#include "envtool.h"
+#include "color.h"
+#include "profile.h"
+
+#define PROFILE_MAX_PHASES  32   /**< More distinct phases are not recorded */
+#define PROFILE_MAX_DEPTH   8    /**< The maximum nesting of phases */
+#define PROFILE_MAX_KINDS   4    /**< The number of item kinds counted in a phase */
+#define PROFILE_TOP         3    /**< The number of slowest items kept in a phase */
+
+/**
+ * One of the slowest items in a phase.
+ */
+struct profile_top {
+       const char *kind;
+       char       *name;
+       UINT64      ticks;
+     };
+
+/**
+ * The number of items of one kind in a phase.
+ */
+struct profile_kind {
+       const char *kind;
+       unsigned    count;
+       UINT64      ticks;
+     };
+
+/**
+ * A phase. Entering it again adds to the same record.
+ */
+struct profile_phase {
+       const char         *name;
+       int                 parent;     /**< Index of the enclosing phase. -1 for none */
+       unsigned            calls;
+       UINT64              ticks;
+       struct profile_kind kinds [PROFILE_MAX_KINDS];
+       struct profile_top  top [PROFILE_TOP];   /**< Sorted on `ticks`; the slowest first */
+     };
+
+static struct profile_phase phases [PROFILE_MAX_PHASES];
+static int                  num_phases;
+static int                  stack [PROFILE_MAX_DEPTH];
+static UINT64               stack_start [PROFILE_MAX_DEPTH];
+static int                  depth;
+static UINT64               freq;
+static UINT64               run_start;
+static BOOL                 enabled;
+static CRITICAL_SECTION     lock;
+
+static UINT64 get_ticks (void)
+{
+  LARGE_INTEGER cnt;
+
+  QueryPerformanceCounter (&cnt);
+  return (cnt.QuadPart);
+}
+
+static double ticks_to_msec (UINT64 ticks)
+{
+  return (1000.0 * (double)ticks / (double)freq);
+}
+
+/**
+ * Start recording.
+ */
+void profile_init (void)
+{
+  LARGE_INTEGER f;
+
+  if (enabled)
+     return;
+
+  QueryPerformanceFrequency (&f);
+  freq = f.QuadPart;
+  InitializeCriticalSection (&lock);
+  run_start = get_ticks();
+  enabled = TRUE;
+}
+
+/**
+ * Enter the phase `phase`. Must be a static string.
+ */
+void profile_enter (const char *phase)
+{
+  int i, parent;
+
+  if (!enabled)
+     return;
+
+  EnterCriticalSection (&lock);
+  if (depth >= PROFILE_MAX_DEPTH)
+  {
+    depth++;
+    LeaveCriticalSection (&lock);
+    return;
+  }
+
+  parent = depth > 0 ? stack [depth-1] : -1;
+  for (i = 0; i < num_phases; i++)
+      if (phases[i].parent == parent && !strcmp(phases[i].name, phase))
+         break;
+
+  if (i == num_phases && num_phases < PROFILE_MAX_PHASES)
+  {
+    phases[i].name   = phase;
+    phases[i].parent = parent;
+    num_phases++;
+  }
+  stack [depth] = i < PROFILE_MAX_PHASES ? i : -1;
+  stack_start [depth] = get_ticks();
+  depth++;
+  LeaveCriticalSection (&lock);
+}
+
+/**
+ * Leave the phase entered last.
+ */
+void profile_leave (void)
+{
+  int idx;
+
+  if (!enabled || depth == 0)
+     return;
+
+  EnterCriticalSection (&lock);
+  depth--;
+  idx = depth < PROFILE_MAX_DEPTH ? stack [depth] : -1;
+  if (idx >= 0)
+  {
+    phases[idx].calls++;
+    phases[idx].ticks += get_ticks() - stack_start [depth];
+  }
+  LeaveCriticalSection (&lock);
+}
+
+/**
+ * Return the start-time of an item. 0 if not recording.
+ */
+UINT64 profile_start (void)
+{
+  return (enabled ? get_ticks() : 0);
+}
+
+/**
+ * Add an item started at `start` to the current phase.
+ *
+ * \param[in] kind   the kind of item; `"dir"`, `"popen"`, `"ipc"` etc. Must be a static string.
+ * \param[in] name   the directory, command etc.
+ * \param[in] start  the value from `profile_start()`.
+ */
+void profile_item (const char *kind, const char *name, UINT64 start)
+{
+  struct profile_phase *ph;
+  UINT64 ticks;
+  int    i, idx;
+
+  if (!enabled || start == 0)
+     return;
+
+  ticks = get_ticks() - start;
+
+  EnterCriticalSection (&lock);
+  idx = (depth > 0 && depth <= PROFILE_MAX_DEPTH) ? stack [depth-1] : -1;
+  if (idx < 0)
+  {
+    LeaveCriticalSection (&lock);
+    return;
+  }
+  ph = phases + idx;
+
+  for (i = 0; i < PROFILE_MAX_KINDS; i++)
+  {
+    if (!ph->kinds[i].kind)
+       ph->kinds[i].kind = kind;
+    if (!strcmp(ph->kinds[i].kind, kind))
+    {
+      ph->kinds[i].count++;
+      ph->kinds[i].ticks += ticks;
+      break;
+    }
+  }
+
+  /* Insert into the sorted `top[]` if slow enough.
+   */
+  for (i = 0; i < PROFILE_TOP; i++)
+      if (ticks > ph->top[i].ticks)
+         break;
+
+  if (i < PROFILE_TOP)
+  {
+    FREE (ph->top[PROFILE_TOP-1].name);
+    memmove (ph->top+i+1, ph->top+i, (PROFILE_TOP-i-1) * sizeof(ph->top[0]));
+    ph->top[i].kind  = kind;
+    ph->top[i].name  = STRDUP (name);
+    ph->top[i].ticks = ticks;
+  }
+  LeaveCriticalSection (&lock);
+}
+
+static int compare_phase (const void *_a, const void *_b)
+{
+  const struct profile_phase *a = *(const struct profile_phase**) _a;
+  const struct profile_phase *b = *(const struct profile_phase**) _b;
+
+  if (a->ticks == b->ticks)
+     return (0);
+  return (a->ticks < b->ticks ? 1 : -1);
+}
+
+/**
+ * Print the phases; the slowest first.
+ */
+void profile_report (void)
+{
+  struct profile_phase *sorted [PROFILE_MAX_PHASES];
+  int    i, j, raw;
+
+  if (!enabled)
+     return;
+
+  /* Leave the phases still open. E.g. "startup" after an early return from main().
+   */
+  while (depth > 0)
+     profile_leave();
+
+  for (i = 0; i < num_phases; i++)
+      sorted[i] = phases + i;
+  qsort (sorted, num_phases, sizeof(sorted[0]), compare_phase);
+
+  C_printf ("\n~3Profile:~0 %.3f ms total.\n", ticks_to_msec(get_ticks() - run_start));
+  C_printf ("  %-24s %12s %6s  %s\n", "Phase", "Time (ms)", "Calls", "Items");
+
+  for (i = 0; i < num_phases; i++)
+  {
+    const struct profile_phase *ph = sorted [i];
+    char  name [100];
+
+    if (ph->parent >= 0)
+         snprintf (name, sizeof(name), "%s/%s", phases[ph->parent].name, ph->name);
+    else _strlcpy (name, ph->name, sizeof(name));
+
+    C_printf ("  ~6%-24s~0 %12.3f %6u ", name, ticks_to_msec(ph->ticks), ph->calls);
+    for (j = 0; j < PROFILE_MAX_KINDS && ph->kinds[j].kind; j++)
+        C_printf (" %u %s (%.3f ms)", ph->kinds[j].count, ph->kinds[j].kind,
+                  ticks_to_msec(ph->kinds[j].ticks));
+    C_putc ('\n');
+
+    for (j = 0; j < PROFILE_TOP && ph->top[j].name; j++)
+    {
+      C_printf ("    %10.3f ms %-6s ", ticks_to_msec(ph->top[j].ticks), ph->top[j].kind);
+      raw = C_setraw (1);
+      C_puts (ph->top[j].name);
+      C_setraw (raw);
+      C_putc ('\n');
+    }
+  }
+}
+
+/**
+ * Free the recorded items.
+ */
+void profile_exit (void)
+{
+  int i, j;
+
+  if (!enabled)
+     return;
+
+  for (i = 0; i < num_phases; i++)
+      for (j = 0; j < PROFILE_TOP; j++)
+          FREE (phases[i].top[j].name);
+  DeleteCriticalSection (&lock);
+  enabled = FALSE;
+}
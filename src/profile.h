@@ -0,0 +1,15 @@
+/** \file profile.h
+ *  \ingroup Misc
+ */
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+extern void   profile_init  (void);
+extern void   profile_enter (const char *phase);
+extern void   profile_leave (void);
+extern UINT64 profile_start (void);
+extern void   profile_item  (const char *kind, const char *name, UINT64 start);
+extern void   profile_report (void);
+extern void   profile_exit  (void);
+
+#endif  /* _PROFILE_H */
@@ -0,0 +1,448 @@
+/**\file    re_literal.c
+ * \ingroup Misc
+ * \brief
+ *   A literal-substring prefilter for regular expressions.
+ *
+ * Most regular expressions used with `envtool --regex` have a part that
+ * any match must contain. E.g. `"qt5"` and `".dll"` in `".*qt5.*\\.dll"`.
+ * `re_literal_new()` finds the longest such literal when the pattern is
+ * compiled. Then `re_literal_exec()` rejects a string without it before
+ * `regexec()` is called. The `regexec()` in regex.c tries a match at every
+ * position in a string (it has no fastmap), so this saves a lot.
+ *
+ * The pattern is parsed in the same syntax as `regcomp()` uses; POSIX basic
+ * or extended (with `REG_EXTENDED`). Only literals outside of groups, not
+ * followed by a repeat operator and in a pattern with no alternation (`|`)
+ * are required. Anything not understood ends the current literal. So the
+ * found literal may be shorter than possible, but it is never wrong.
+ *
+ * Build the benchmark program with `-DRE_LITERAL_TEST`. It checks that the
+ * prefilter does not change the result of `regexec()` on a large list of
+ * synthetic file-names and times both. E.g. on Linux (using the C-library's
+ * `regcomp()` and `regexec()`):
+ * ```
+ *  gcc -O2 -DRE_LITERAL_TEST -o re_literal re_literal.c
+ * ```
+ */
+#include "test_util.h"
+
+#if defined(_WIN32) || defined(__CYGWIN__)
+  #include "regex.h"
+#else
+  #include <regex.h>
+#endif
+
+#include "re_literal.h"
+
+#define RE_LITERAL_MIN  2    /**< Shorter literals are not worth checking */
+
+struct re_literal {
+       int           icase;       /**< Compare case-insensitive */
+       size_t        len;         /**< The length of `str` */
+       unsigned char fold [256];  /**< Folds to lower-case if `icase` */
+       char          str [1];     /**< The literal; folded if `icase`. Must be last */
+     };
+
+/**
+ * The kind of the next element in a pattern.
+ */
+enum re_token {
+     RE_TOK_LITERAL,
+     RE_TOK_REPEAT,      /**< `*`, `+`, `?` or an interval `{m,n}` */
+     RE_TOK_OPEN,        /**< Start of a group */
+     RE_TOK_CLOSE,       /**< End of a group */
+     RE_TOK_ALT,         /**< An alternation `|` */
+     RE_TOK_OTHER,       /**< `.`, `^`, `$`, a bracket, `\w` etc. */
+     RE_TOK_ERROR
+   };
+
+/**
+ * Skip a bracket-expression. `p` points past the `[`.
+ * \retval a pointer past the closing `]` or NULL if not found.
+ */
+static const char *skip_bracket (const char *p)
+{
+  if (*p == '^')
+     p++;
+  if (*p == ']')
+     p++;
+
+  while (*p && *p != ']')
+  {
+    if (*p == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '='))
+    {
+      char end = p[1];
+
+      for (p += 2; *p && !(p[0] == end && p[1] == ']'); p++)
+          ;
+      if (!*p)
+         return (NULL);
+      p += 2;
+    }
+    else
+      p++;
+  }
+  return (*p ? p + 1 : NULL);
+}
+
+/**
+ * Get the next element in `*pp` and advance `*pp` past it.
+ * For `RE_TOK_LITERAL`, the character is set in `*ch`.
+ */
+static enum re_token next_token (const char **pp, int ere, int *ch)
+{
+  const char *p = *pp;
+  int         c = (unsigned char) *p++;
+
+  if (c == '\\')
+  {
+    c = (unsigned char) *p++;
+    if (c == '\0')
+       return (RE_TOK_ERROR);
+    *pp = p;
+
+    if (!ere && c == '(')
+       return (RE_TOK_OPEN);
+    if (!ere && c == ')')
+       return (RE_TOK_CLOSE);
+    if (c == '|')
+       return (RE_TOK_ALT);
+    if (!ere && (c == '+' || c == '?'))
+       return (RE_TOK_REPEAT);
+    if (!ere && c == '{')
+    {
+      for ( ; *p && !(p[0] == '\\' && p[1] == '}'); p++)
+          ;
+      if (!*p)
+         return (RE_TOK_ERROR);
+      *pp = p + 2;
+      return (RE_TOK_REPEAT);
+    }
+    if (strchr(".[]^$*\\/{}()+?", c))
+    {
+      *ch = c;
+      return (RE_TOK_LITERAL);
+    }
+    return (RE_TOK_OTHER);   /* `\w`, `\<`, `\1` etc. */
+  }
+
+  *pp = p;
+
+  switch (c)
+  {
+    case '.':
+    case '^':
+    case '$':
+         return (RE_TOK_OTHER);
+    case '[':
+         p = skip_bracket (p);
+         if (!p)
+            return (RE_TOK_ERROR);
+         *pp = p;
+         return (RE_TOK_OTHER);
+    case '*':
+         return (RE_TOK_REPEAT);
+    case '|':
+         return (RE_TOK_ALT);
+    case '+':
+    case '?':
+         /* Literals in a basic RE. But play safe.
+          */
+         return (RE_TOK_REPEAT);
+    case '{':
+         if (!ere)
+            return (RE_TOK_REPEAT);
+         for ( ; *p && *p != '}'; p++)
+             ;
+         if (!*p)
+            return (RE_TOK_ERROR);
+         *pp = p + 1;
+         return (RE_TOK_REPEAT);
+    case '(':
+         if (ere)
+            return (RE_TOK_OPEN);
+         break;
+    case ')':
+         if (ere)
+            return (RE_TOK_CLOSE);
+         break;
+    case '}':
+         return (RE_TOK_OTHER);
+  }
+  *ch = c;
+  return (RE_TOK_LITERAL);
+}
+
+/**
+ * Find the longest literal any match of `pattern` must contain.
+ *
+ * \param[in] pattern  the pattern as given to `regcomp()`.
+ * \param[in] cflags   the flags as given to `regcomp()`. Only `REG_EXTENDED`
+ *                     and `REG_ICASE` are used.
+ *
+ * \retval NULL if no such literal (of at least 2 characters) was found.
+ */
+re_literal *re_literal_new (const char *pattern, int cflags)
+{
+  struct re_literal *lit;
+  const char        *p = pattern;
+  char              *run, *best;
+  size_t             run_len = 0, best_len = 0;
+  int                i, ch = 0, depth = 0;
+  int                ere   = (cflags & REG_EXTENDED) != 0;
+  int                icase = (cflags & REG_ICASE) != 0;
+
+  run  = MALLOC (2 * strlen(pattern) + 2);
+  best = run + strlen (pattern) + 1;
+
+  while (*p)
+  {
+    enum re_token tok = next_token (&p, ere, &ch);
+
+    if (tok == RE_TOK_ERROR || tok == RE_TOK_ALT)
+    {
+      best_len = 0;
+      break;
+    }
+
+    /* The last literal is optional (or the end of one) with a repeat.
+     */
+    if (tok == RE_TOK_REPEAT && run_len > 0)
+       run_len--;
+
+    if (tok == RE_TOK_LITERAL && depth == 0 && ch < 0x80 && ch >= ' ')
+    {
+      run [run_len++] = (char) (icase ? tolower(ch) : ch);
+      continue;
+    }
+
+    if (run_len > best_len)
+    {
+      memcpy (best, run, run_len);
+      best_len = run_len;
+    }
+    run_len = 0;
+
+    if (tok == RE_TOK_OPEN)
+       depth++;
+    else if (tok == RE_TOK_CLOSE && --depth < 0)
+    {
+      best_len = 0;
+      break;
+    }
+  }
+
+  if (*p == '\0' && run_len > best_len)
+  {
+    memcpy (best, run, run_len);
+    best_len = run_len;
+  }
+
+  if (best_len < RE_LITERAL_MIN)
+  {
+    FREE (run);
+    return (NULL);
+  }
+
+  lit = CALLOC (1, sizeof(*lit) + best_len);
+  memcpy (lit->str, best, best_len);
+  lit->str [best_len] = '\0';
+  lit->len   = best_len;
+  lit->icase = icase;
+  for (i = 0; i < 256; i++)
+      lit->fold[i] = (unsigned char) ((icase && i < 0x80) ? tolower(i) : i);
+
+  FREE (run);
+  DEBUGF (1, "Required literal in \"%s\": \"%s\".\n", pattern, lit->str);
+  return (lit);
+}
+
+/**
+ * Check if `str` contains the literal.
+ *
+ * \retval 1 if it does; `regexec()` could match `str`.
+ * \retval 0 if it does not; `regexec()` can not match `str`.
+ */
+int re_literal_exec (const re_literal *lit, const char *str)
+{
+  const unsigned char *s = (const unsigned char*) str;
+  const unsigned char *l = (const unsigned char*) lit->str;
+  unsigned char        first = l[0];
+  size_t               i;
+
+  if (!lit->icase)
+     return (strstr(str, lit->str) != NULL);
+
+  /* Look for the first character (in both cases) in a tight loop.
+   * Then compare the rest.
+   */
+  if (first >= 'a' && first <= 'z')
+  {
+    for ( ; *s; s++)
+    {
+      if ((*s | 0x20) != first)
+         continue;
+      for (i = 1; i < lit->len && lit->fold[s[i]] == l[i]; i++)
+          ;
+      if (i == lit->len)
+         return (1);
+    }
+  }
+  else
+  {
+    for ( ; *s; s++)
+    {
+      if (*s != first)
+         continue;
+      for (i = 1; i < lit->len && lit->fold[s[i]] == l[i]; i++)
+          ;
+      if (i == lit->len)
+         return (1);
+    }
+  }
+  return (0);
+}
+
+/**
+ * \retval the literal; in lower-case if `REG_ICASE` was used.
+ */
+const char *re_literal_str (const re_literal *lit)
+{
+  return (lit->str);
+}
+
+void re_literal_free (re_literal *lit)
+{
+  FREE (lit);
+}
+
+#if defined(RE_LITERAL_TEST)
+
+#define TEST_UTIL_MAIN
+#include "test_util.h"
+
+/**
+ * Patterns and the literal expected from them.
+ */
+static const struct {
+       const char *pattern;
+       int         cflags;
+       const char *literal;
+     } tests[] = {
+       { ".*qt5.*\\.dll",        REG_ICASE,                ".dll"    },
+       { "Qt5Core",              REG_ICASE,                "qt5core" },
+       { "Qt5Core",              0,                        "Qt5Core" },
+       { "lib.*ssl.*",           REG_ICASE,                "lib"     },
+       { "python3[0-9]\\.dll$",  REG_ICASE,                "python3" },
+       { "foox*bar",             0,                        "foo"     },
+       { "foo\\(bar\\)*baz",     0,                        "foo"     },
+       { "(foo)+barbaz",         REG_EXTENDED,             "barbaz"  },
+       { "foo|barbaz",           REG_EXTENDED,             NULL      },
+       { "foo\\|barbaz",         0,                        NULL      },
+       { "ab{2,3}cdef",          REG_EXTENDED,             "cdef"    },
+       { "ab\\{2,3\\}cdef",      0,                        "cdef"    },
+       { "[a-z]*\\.exe",         REG_ICASE,                ".exe"    },
+       { "[[:alpha:]]+gcc",      REG_EXTENDED,             "gcc"     },
+       { "\\wlibfoo\\b",         0,                        "libfoo"  },
+       { ".*",                   0,                        NULL      },
+       { "x?",                   REG_EXTENDED,             NULL      }
+     };
+
+/**
+ * The benchmark patterns. Matched case-insensitive as `envtool -r` does.
+ */
+static const char *bench_patterns[] = {
+       ".*qt5.*\\.dll",
+       "Qt5Core",
+       "python3[0-9]\\.dll$",
+       "lib.*ssl.*\\.dll"
+     };
+
+static const char *names[] = {
+       "kernel32.dll", "Qt5Core.dll", "libssl-1_1.dll", "python37.dll", "notepad.exe",
+       "Qt5Widgets.dll", "libcrypto-1_1.dll", "cmd.exe", "msvcp140.dll", "zlib1.dll",
+       "readme.txt", "python3.dll", "libgcc_s_dw2-1.dll", "foo.h", "bar.lib"
+     };
+
+static int check_literals (void)
+{
+  int i, errors = 0;
+
+  for (i = 0; i < (int)(sizeof(tests) / sizeof(tests[0])); i++)
+  {
+    re_literal *lit = re_literal_new (tests[i].pattern, tests[i].cflags);
+    const char *got = lit ? re_literal_str (lit) : NULL;
+    int         ok  = (!got && !tests[i].literal) ||
+                      (got && tests[i].literal && !strcmp(got, tests[i].literal));
+
+    printf ("  %-22s -> %-10s %s\n", tests[i].pattern, got ? got : "<none>", ok ? "OK" : "FAILED");
+    if (!ok)
+       errors++;
+    re_literal_free (lit);
+  }
+  return (errors);
+}
+
+int main (int argc, char **argv)
+{
+  int     i, j, max = (argc > 1) ? atoi (argv[1]) : 200000;
+  char  **files = CALLOC (max, sizeof(char*));
+  int     errors;
+
+  printf ("Required literals:\n");
+  errors = check_literals();
+
+  for (i = 0; i < max; i++)
+  {
+    char buf [300];
+
+    snprintf (buf, sizeof(buf), "c:\\Program Files\\Vendor%d\\bin\\%s%s",
+              i % 1000, (i % 7) ? "" : "x", names [i % (sizeof(names)/sizeof(names[0]))]);
+    files[i] = MALLOC (strlen(buf)+1);
+    strcpy (files[i], buf);
+  }
+
+  printf ("\n%d file-names:\n", max);
+
+  for (j = 0; j < (int)(sizeof(bench_patterns)/sizeof(bench_patterns[0])); j++)
+  {
+    regex_t     re;
+    re_literal *lit;
+    double      t0, t_plain, t_lit;
+    int         num_plain = 0, num_lit = 0;
+
+    if (regcomp(&re, bench_patterns[j], REG_ICASE) != 0)
+    {
+      printf ("regcomp (\"%s\") failed.\n", bench_patterns[j]);
+      errors++;
+      continue;
+    }
+    lit = re_literal_new (bench_patterns[j], REG_ICASE);
+
+    t0 = get_time();
+    for (i = 0; i < max; i++)
+        if (regexec(&re, files[i], 0, NULL, 0) == 0)
+           num_plain++;
+    t_plain = get_time() - t0;
+
+    t0 = get_time();
+    for (i = 0; i < max; i++)
+        if ((!lit || re_literal_exec(lit, files[i])) && regexec(&re, files[i], 0, NULL, 0) == 0)
+           num_lit++;
+    t_lit = get_time() - t0;
+
+    printf ("  %-22s literal: %-8s %6d matches: regexec(): %.3f sec, prefilter: %.3f sec (%.1f times faster)%s\n",
+            bench_patterns[j], lit ? re_literal_str(lit) : "<none>", num_lit, t_plain, t_lit,
+            t_lit > 0.0 ? t_plain / t_lit : 0.0, num_plain == num_lit ? "" : "  FAILED");
+    if (num_plain != num_lit)
+       errors++;
+    re_literal_free (lit);
+    regfree (&re);
+  }
+
+  for (i = 0; i < max; i++)
+      FREE (files[i]);
+  FREE (files);
+  return (errors ? 1 : 0);
+}
+#endif  /* RE_LITERAL_TEST */
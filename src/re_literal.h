@@ -0,0 +1,17 @@
+/** \file re_literal.h
+ *  \ingroup Misc
+ */
+#ifndef _RE_LITERAL_H
+#define _RE_LITERAL_H
+
+/**
+ * The longest literal a regular expression needs to match. Opaque to the user.
+ */
+typedef struct re_literal re_literal;
+
+extern re_literal *re_literal_new  (const char *pattern, int cflags);
+extern int         re_literal_exec (const re_literal *lit, const char *str);
+extern const char *re_literal_str  (const re_literal *lit);
+extern void        re_literal_free (re_literal *lit);
+
+#endif  /* _RE_LITERAL_H */
@@ -0,0 +1,365 @@
+/**\file    shadow.c
+ * \ingroup Misc
+ * \brief
+ *   Find programs and DLLs that shadow each other. For `envtool --shadow`.
+ *
+ * Each directory in e.g. `%PATH%` is enumerated once. Every program
+ * (an extension in `%PATHEXT%`) and DLL is added to a hash-index keyed on
+ * the case-folded base-name. So building the index is linear in the total
+ * number of files.
+ *
+ * A name with more than one copy is reported. The first copy (in the
+ * order of the directories) is the one `cmd.exe` and `CreateProcess()`
+ * will use. For each copy, the size, PE-version and PE-checksum is shown.
+ * And if the copies differ in any of these.
+ *
+ * \note The DLL search-order of the Windows loader starts in the
+ *       directory of the program and the System directories. Only
+ *       after that is `%PATH%` searched. So for a DLL, the first copy
+ *       on `%PATH%` is not always the one used.
+ */
+#include <windows.h>
+
+/*
+ * Suppress warning:
+ *   imagehlp.h(1873): warning C4091: 'typedef ': ignored on left of '' when no variable is declared
+ */
+#ifdef _MSC_VER
+#pragma warning (disable:4091)
+#endif
+
+#include <imagehlp.h>
+
+#include "envtool.h"
+#include "color.h"
+#include "smartlist.h"
+#include "dirscan.h"
+#include "shadow.h"
+
+#define SHADOW_START     1024   /**< The initial number of buckets. Must be a power of 2 */
+#define SHADOW_PATHEXT   ".COM;.EXE;.BAT;.CMD"   /**< If `%PATHEXT%` is not set */
+
+/**
+ * One copy of a name.
+ */
+struct shadow_copy {
+       int                 dir;     /**< Index into `shadow_index::dirs` */
+       UINT64              fsize;
+       struct shadow_copy *next;    /**< The next copy in directory order */
+     };
+
+/**
+ * A bucket in the index. `name == NULL` means an empty bucket.
+ */
+struct shadow_name {
+       char               *name;        /**< The base-name as in the first copy */
+       unsigned            hash;        /**< The FNV-1a hash of the upper-cased `name` */
+       unsigned            num_copies;
+       struct shadow_copy *first;
+       struct shadow_copy *last;
+     };
+
+/**
+ * The index. Open addressing with linear probing.
+ */
+struct shadow_index {
+       struct shadow_name *buckets;
+       unsigned            size;        /**< Number of buckets; a power of 2 */
+       unsigned            used;        /**< Number of unique names */
+       unsigned            num_files;
+       smartlist_t        *dirs;        /**< The directories added; `char *` */
+       smartlist_t        *exts;        /**< The extensions to index; `char *` */
+     };
+
+/**
+ * What is reported for one copy of a name.
+ */
+struct shadow_info {
+       const char     *dir;
+       UINT64          fsize;
+       BOOL            is_PE;
+       struct ver_info ver;
+       DWORD           chksum;          /**< Calculated by `MapFileAndCheckSum()`; 0 if it failed */
+     };
+
+static unsigned shadow_hash (const char *name)
+{
+  unsigned h = 2166136261U;
+
+  for ( ; *name; name++)
+  {
+    h ^= (unsigned char) TOUPPER (*name);
+    h *= 16777619U;
+  }
+  return (h);
+}
+
+/**
+ * Double the number of buckets and re-insert all names.
+ */
+static void shadow_grow (struct shadow_index *idx)
+{
+  struct shadow_name *old = idx->buckets;
+  unsigned            i, old_size = idx->size;
+
+  idx->size *= 2;
+  idx->buckets = CALLOC (idx->size, sizeof(*idx->buckets));
+
+  for (i = 0; i < old_size; i++)
+  {
+    unsigned j;
+
+    if (!old[i].name)
+       continue;
+    for (j = old[i].hash & (idx->size-1); idx->buckets[j].name; j = (j+1) & (idx->size-1))
+        ;
+    idx->buckets[j] = old[i];
+  }
+  FREE (old);
+}
+
+/**
+ * Check if `name` has an extension we should index.
+ */
+static BOOL shadow_ext_ok (const struct shadow_index *idx, const char *name)
+{
+  const char *dot = strrchr (name, '.');
+  int   i, max;
+
+  if (!dot)
+     return (FALSE);
+
+  max = smartlist_len (idx->exts);
+  for (i = 0; i < max; i++)
+      if (!stricmp(dot, smartlist_get(idx->exts, i)))
+         return (TRUE);
+  return (FALSE);
+}
+
+static void shadow_insert (struct shadow_index *idx, const char *name, int dir, UINT64 fsize)
+{
+  struct shadow_copy *copy = CALLOC (1, sizeof(*copy));
+  struct shadow_name *sn;
+  unsigned            i, h = shadow_hash (name);
+
+  copy->dir   = dir;
+  copy->fsize = fsize;
+
+  for (i = h & (idx->size-1); idx->buckets[i].name; i = (i+1) & (idx->size-1))
+  {
+    sn = idx->buckets + i;
+    if (sn->hash == h && !stricmp(sn->name, name))
+    {
+      sn->last->next = copy;
+      sn->last = copy;
+      sn->num_copies++;
+      return;
+    }
+  }
+
+  sn = idx->buckets + i;
+  sn->name       = STRDUP (name);
+  sn->hash       = h;
+  sn->num_copies = 1;
+  sn->first      = sn->last = copy;
+
+  if (2 * ++idx->used >= idx->size)
+     shadow_grow (idx);
+}
+
+/**
+ * Create a new empty index.
+ * The extensions indexed are those in `%PATHEXT%` and `.dll`.
+ */
+shadow_index *shadow_new (void)
+{
+  struct shadow_index *idx = CALLOC (1, sizeof(*idx));
+  const char          *env = getenv ("PATHEXT");
+  char                *exts, *tok, *end;
+
+  idx->size    = SHADOW_START;
+  idx->buckets = CALLOC (idx->size, sizeof(*idx->buckets));
+  idx->dirs    = smartlist_new();
+  idx->exts    = smartlist_new();
+
+  exts = STRDUP (env ? env : SHADOW_PATHEXT);
+  for (tok = _strtok_r(exts, ";", &end); tok; tok = _strtok_r(NULL, ";", &end))
+      if (*tok == '.')
+         smartlist_add (idx->exts, STRDUP(tok));
+  smartlist_add (idx->exts, STRDUP(".DLL"));
+  FREE (exts);
+  return (idx);
+}
+
+/**
+ * Enumerate `dir` and add the programs and DLLs in it to the index.
+ * Must be called in the order the directories are searched.
+ *
+ * \retval The number of files added.
+ */
+int shadow_add_dir (shadow_index *idx, const char *dir)
+{
+  DIRSCAN                    *ds;
+  const struct dirscan_entry *de;
+  int                         dir_idx, num = 0;
+
+  ds = dirscan_open (dir, "*");
+  if (!ds)
+     return (0);
+
+  dir_idx = smartlist_len (idx->dirs);
+  smartlist_add (idx->dirs, STRDUP(dir));
+
+  while ((de = dirscan_next(ds)) != NULL)
+  {
+    if (dirscan_stat(ds, DS_HAVE_TYPE | DS_HAVE_SIZE) != 0 || de->is_dir)
+       continue;
+    if (!shadow_ext_ok(idx, de->name))
+       continue;
+    shadow_insert (idx, de->name, dir_idx, de->fsize);
+    num++;
+  }
+  dirscan_close (ds);
+  idx->num_files += num;
+  DEBUGF (2, "%d files indexed in \"%s\".\n", num, dir);
+  return (num);
+}
+
+static int compare_shadow_name (const void **_a, const void **_b)
+{
+  const struct shadow_name *a = *_a;
+  const struct shadow_name *b = *_b;
+
+  return stricmp (a->name, b->name);
+}
+
+/**
+ * Get the size, PE-version and checksum of a copy.
+ */
+static void shadow_get_info (const struct shadow_index *idx, const char *name,
+                             const struct shadow_copy *copy, struct shadow_info *info)
+{
+  char  file [_MAX_PATH];
+  DWORD header_sum;
+
+  memset (info, '\0', sizeof(*info));
+  info->dir   = smartlist_get (idx->dirs, copy->dir);
+  info->fsize = copy->fsize;
+
+  snprintf (file, sizeof(file), "%s\\%s", info->dir, name);
+  info->is_PE = check_if_PE (file, NULL);
+  if (info->is_PE)
+     get_PE_version_info (file, &info->ver);
+
+  if (MapFileAndCheckSum((PTSTR)file, &header_sum, &info->chksum) != CHECKSUM_SUCCESS)
+     info->chksum = 0;
+}
+
+/**
+ * Print one shadowed name and all copies of it.
+ * \retval TRUE if the copies differ.
+ */
+static BOOL shadow_report_name (const struct shadow_index *idx, const struct shadow_name *sn)
+{
+  const struct shadow_copy *copy;
+  struct shadow_info       *info = CALLOC (sn->num_copies, sizeof(*info));
+  BOOL                      diff_size = FALSE, diff_ver = FALSE, diff_sum = FALSE;
+  unsigned                  i;
+
+  for (i = 0, copy = sn->first; copy; copy = copy->next, i++)
+  {
+    shadow_get_info (idx, sn->name, copy, info + i);
+    if (i == 0)
+       continue;
+    if (info[i].fsize != info[0].fsize)
+       diff_size = TRUE;
+    if (info[i].is_PE != info[0].is_PE || memcmp(&info[i].ver, &info[0].ver, sizeof(info[0].ver)))
+       diff_ver = TRUE;
+    if (info[i].chksum != info[0].chksum)
+       diff_sum = TRUE;
+  }
+
+  C_printf ("~6%s~0: %u copies", sn->name, sn->num_copies);
+  if (diff_size || diff_ver || diff_sum)
+     C_printf (", ~5differ in%s%s%s~0.\n", diff_size ? " size" : "",
+               diff_ver ? " version" : "", diff_sum ? " checksum" : "");
+  else
+     C_puts (", ~2identical~0.\n");
+
+  for (i = 0; i < sn->num_copies; i++)
+  {
+    int raw;
+
+    C_printf ("  %s ~3", i == 0 ? "~2used    ~0" : "~5shadowed~0");
+    raw = C_setraw (1);    /* In case the directory contains a "~" */
+    C_puts (info[i].dir);
+    C_setraw (raw);
+    C_printf ("~0\n             %" U64_FMT " bytes", info[i].fsize);
+    if (info[i].is_PE)
+       C_printf (", ver %u.%u.%u.%u", info[i].ver.val_1, info[i].ver.val_2,
+                 info[i].ver.val_3, info[i].ver.val_4);
+    if (info[i].chksum)
+       C_printf (", chksum 0x%08lX", (u_long)info[i].chksum);
+    C_putc ('\n');
+  }
+  FREE (info);
+  return (diff_size || diff_ver || diff_sum);
+}
+
+/**
+ * Report every name with more than one copy in the index.
+ *
+ * \param[in] idx  the index.
+ * \param[in] env  the env-var the directories came from. Only used in the summary.
+ *
+ * \retval The number of shadowed names.
+ */
+int shadow_report (shadow_index *idx, const char *env)
+{
+  smartlist_t *names = smartlist_new();
+  int          i, max, num_diff = 0;
+
+  for (i = 0; i < (int)idx->size; i++)
+      if (idx->buckets[i].name && idx->buckets[i].num_copies > 1)
+         smartlist_add (names, idx->buckets + i);
+
+  smartlist_sort (names, compare_shadow_name);
+
+  max = smartlist_len (names);
+  for (i = 0; i < max && !halt_flag; i++)
+      if (shadow_report_name(idx, smartlist_get(names, i)))
+         num_diff++;
+
+  C_printf ("%u files (%u unique names) in %d directories on %%%s%%. "
+            "%d names are shadowed, %d of these with different copies.\n",
+            idx->num_files, idx->used, smartlist_len(idx->dirs), env, max, num_diff);
+  smartlist_free (names);
+  return (max);
+}
+
+/**
+ * Free the index.
+ */
+void shadow_free (shadow_index *idx)
+{
+  unsigned i;
+
+  if (!idx)
+     return;
+
+  for (i = 0; i < idx->size; i++)
+  {
+    struct shadow_copy *copy, *next;
+
+    for (copy = idx->buckets[i].first; copy; copy = next)
+    {
+      next = copy->next;
+      FREE (copy);
+    }
+    FREE (idx->buckets[i].name);
+  }
+  FREE (idx->buckets);
+  smartlist_free_all (idx->dirs);
+  smartlist_free_all (idx->exts);
+  FREE (idx);
+}
@@ -0,0 +1,18 @@
+/** \file shadow.h
+ *  \ingroup Misc
+ */
+#ifndef _SHADOW_H
+#define _SHADOW_H
+
+/**
+ * An index of the programs and DLLs in a list of directories.
+ * Opaque to the user.
+ */
+typedef struct shadow_index shadow_index;
+
+extern shadow_index *shadow_new     (void);
+extern int           shadow_add_dir (shadow_index *idx, const char *dir);
+extern int           shadow_report  (shadow_index *idx, const char *env);
+extern void          shadow_free    (shadow_index *idx);
+
+#endif  /* _SHADOW_H */
@@ -0,0 +1,320 @@
+/**
+ * \file    sink.c
+ * \ingroup Misc
+ * \brief
+ *   Writing the matches as records for other programs to read.
+ *   Handling of the `"--format"` and `"--output"` options.
+ *
+ * The records are streamed; nothing is kept in memory.
+ *
+ * The `ndjson` format is a JSON-object on each line like:
+ * ```
+ *   {"mode":"path","source":"hklm-app-path","file":"c:\\bin\\foo.exe","is_dir":false,"mtime":1546300800,"size":1234}
+ * ```
+ *
+ * A string is written only if it is known. So is `"mtime"` and `"size"`.
+ * Non-ASCII characters are written as `\uXXXX`.
+ *
+ * The `binary` format starts with the 4 bytes `"ETR1"`. Then for each match:
+ * ```
+ *   DWORD  length   the number of bytes following
+ *   BYTE   flags    bit 0: is a directory. bit 1: is a junction
+ *   INT64  mtime    0 if unknown
+ *   UINT64 fsize    0xFFFFFFFFFFFFFFFF if unknown
+ *   6 strings: mode, source, spec, file, owner and version
+ * ```
+ *
+ * A string is a `WORD` length (`0xFFFF` if not known) followed by the
+ * characters; not 0-terminated. All numbers are little-endian.
+ */
+#include <errno.h>
+#include <fcntl.h>
+
+#include "envtool.h"
+#include "color.h"
+#include "sink.h"
+
+#define SINK_BINARY_MAGIC  "ETR1"
+#define SINK_NO_STRING     0xFFFF
+
+static const struct search_list sink_formats[] = {
+           { SINK_TEXT,   "text"   },
+           { SINK_NDJSON, "ndjson" },
+           { SINK_BINARY, "binary" }
+         };
+
+static FILE  *sink_file;
+static BOOL   sink_is_stdout;
+static BOOL   sink_failed;    /* A write failed; e.g. a full disk or a closed pipe */
+static DWORD  num_records;
+static UINT64 num_bytes;
+
+/**
+ * Return a comma separated list of the accepted formats.
+ * \retval currently `"text,ndjson,binary"`.
+ */
+const char *get_sink_formats (void)
+{
+  static char formats [100];
+  size_t i;
+
+  formats[0] = '\0';
+  for (i = 0; i < DIM(sink_formats); i++)
+  {
+    if (i > 0)
+       strcat (formats, ",");
+    strcat (formats, sink_formats[i].name);
+  }
+  return (formats);
+}
+
+/**
+ * Called from `set_long_option()` in envtool.c to set `opt.sink_format`.
+ *
+ * \retval TRUE if `format` is one of `sink_formats[]`.
+ */
+BOOL set_sink_format (const char *format)
+{
+  unsigned f = list_lookup_value (format, sink_formats, DIM(sink_formats));
+
+  if (f == UINT_MAX)
+     return (FALSE);
+  opt.sink_format = (SinkFormat) f;
+  return (TRUE);
+}
+
+static void put_bytes (const void *buf, size_t len)
+{
+  if (len > 0 && fwrite(buf, 1, len, sink_file) != len)
+     sink_failed = TRUE;
+  num_bytes += len;
+}
+
+static void put_le (UINT64 val, int size)
+{
+  BYTE buf [8];
+  int  i;
+
+  for (i = 0; i < size; i++, val >>= 8)
+      buf[i] = (BYTE) val;
+  put_bytes (buf, size);
+}
+
+static size_t binary_str_len (const char *str)
+{
+  size_t len = str ? strlen (str) : 0;
+
+  return (len < SINK_NO_STRING ? len : SINK_NO_STRING - 1);
+}
+
+static void binary_str (const char *str)
+{
+  size_t len = binary_str_len (str);
+
+  put_le (str ? len : SINK_NO_STRING, 2);
+  put_bytes (str, len);
+}
+
+static void binary_write (const struct sink_rec *rec)
+{
+  const char *str[6];
+  size_t i, len = 1 + 8 + 8;
+
+  str[0] = rec->mode;
+  str[1] = rec->source;
+  str[2] = rec->spec;
+  str[3] = rec->file;
+  str[4] = rec->owner;
+  str[5] = rec->version;
+
+  for (i = 0; i < DIM(str); i++)
+      len += 2 + binary_str_len (str[i]);
+
+  put_le (len, 4);
+  put_le ((rec->is_dir ? 1 : 0) | (rec->is_junction ? 2 : 0), 1);
+  put_le ((UINT64)(INT64)rec->mtime, 8);
+  put_le (rec->fsize, 8);
+  for (i = 0; i < DIM(str); i++)
+      binary_str (str[i]);
+}
+
+/**
+ * Write a wide character as JSON. Escapes what must be escaped and
+ * all non-ASCII characters.
+ */
+static void json_char (unsigned ch)
+{
+  char buf [10];
+
+  if (ch == '"' || ch == '\\')
+  {
+    buf[0] = '\\';
+    buf[1] = (char) ch;
+    put_bytes (buf, 2);
+  }
+  else if (ch < 0x20 || ch >= 0x7F)
+  {
+    snprintf (buf, sizeof(buf), "\\u%04X", ch);
+    put_bytes (buf, 6);
+  }
+  else
+  {
+    buf[0] = (char) ch;
+    put_bytes (buf, 1);
+  }
+}
+
+/**
+ * Write `str` as a JSON string.
+ * If `str` has non-ASCII characters, these are converted from the ANSI
+ * code-page. A surrogate pair becomes 2 `\uXXXX` escapes; as JSON wants.
+ */
+static void json_string (const char *str)
+{
+  const BYTE *s;
+
+  put_bytes ("\"", 1);
+  for (s = (const BYTE*)str; *s; s++)
+  {
+    if (*s >= 0x80)
+    {
+      wchar_t  wbuf [2*_MAX_PATH], *w = wbuf;
+      int      len = MultiByteToWideChar (CP_ACP, 0, (const char*)s, -1, NULL, 0);
+
+      if (len > (int)DIM(wbuf))
+         w = MALLOC (len * sizeof(*w));
+      if (len > 0 && MultiByteToWideChar(CP_ACP, 0, (const char*)s, -1, w, len) > 0)
+      {
+        int i;
+
+        for (i = 0; w[i]; i++)
+            json_char (w[i]);
+      }
+      if (w != wbuf)
+         FREE (w);
+      break;
+    }
+    json_char (*s);
+  }
+  put_bytes ("\"", 1);
+}
+
+static void json_member (const char *name, const char *str)
+{
+  if (str)
+  {
+    if (fprintf(sink_file, ",\"%s\":", name) < 0)
+       sink_failed = TRUE;
+    num_bytes += strlen (name) + 4;
+    json_string (str);
+  }
+}
+
+static void ndjson_write (const struct sink_rec *rec)
+{
+  char buf [100];
+  int  len;
+
+  put_bytes ("{\"mode\":", 8);
+  json_string (rec->mode ? rec->mode : "");
+  json_member ("source", rec->source);
+  json_member ("spec", rec->spec);
+  json_member ("file", rec->file);
+
+  len = snprintf (buf, sizeof(buf), ",\"is_dir\":%s", rec->is_dir ? "true" : "false");
+  put_bytes (buf, len);
+  if (rec->is_junction)
+     put_bytes (",\"is_junction\":true", 19);
+  if (rec->mtime > 0)
+  {
+    len = snprintf (buf, sizeof(buf), ",\"mtime\":%" S64_FMT, (INT64)rec->mtime);
+    put_bytes (buf, len);
+  }
+  if (rec->fsize != (UINT64)-1)
+  {
+    len = snprintf (buf, sizeof(buf), ",\"size\":%" U64_FMT, rec->fsize);
+    put_bytes (buf, len);
+  }
+  json_member ("owner", rec->owner);
+  json_member ("version", rec->version);
+  put_bytes ("}\n", 2);
+}
+
+/**
+ * Open the sink for `opt.sink_format`.
+ *
+ * \param[in] fname  the file to write to. If NULL or `"-"`, write to `stdout`.
+ *                   Then all other output is written to `stderr`.
+ * \retval FALSE if `fname` could not be created.
+ */
+BOOL sink_open (const char *fname)
+{
+  if (opt.sink_format == SINK_TEXT || sink_file)
+     return (TRUE);
+
+  if (!fname || !strcmp(fname, "-"))
+  {
+    sink_file = stdout;
+    sink_is_stdout = TRUE;
+    _setmode (_fileno(stdout), O_BINARY);
+    C_set_output (stderr);
+  }
+  else
+  {
+    sink_file = fopen (fname, "wb");
+    if (!sink_file)
+    {
+      WARN ("Failed to create \"%s\"; %s.\n", fname, strerror(errno));
+      return (FALSE);
+    }
+  }
+  setvbuf (sink_file, NULL, _IOFBF, 64*1024);
+
+  num_records = 0;
+  num_bytes = 0;
+  sink_failed = FALSE;
+  if (opt.sink_format == SINK_BINARY)
+     put_bytes (SINK_BINARY_MAGIC, 4);
+  return (TRUE);
+}
+
+/**
+ * Write a match to the sink.
+ */
+void sink_write (const struct sink_rec *rec)
+{
+  if (!sink_file)
+     return;
+
+  if (opt.sink_format == SINK_NDJSON)
+       ndjson_write (rec);
+  else binary_write (rec);
+  num_records++;
+}
+
+/**
+ * Flush and close the sink.
+ *
+ * \retval FALSE if writing the records failed. A warning is printed.
+ */
+BOOL sink_close (void)
+{
+  BOOL ok;
+
+  if (!sink_file)
+     return (TRUE);
+
+  ok = (fflush(sink_file) == 0 && !ferror(sink_file) && !sink_failed);
+  if (!sink_is_stdout && fclose(sink_file) != 0)
+     ok = FALSE;
+
+  if (ok)
+       DEBUGF (1, "Wrote %lu records, %" U64_FMT " bytes.\n", (unsigned long)num_records, num_bytes);
+  else WARN ("Failed to write the records; %s.\n", strerror(errno));
+
+  sink_file = NULL;
+  sink_is_stdout = FALSE;
+  sink_failed = FALSE;
+  num_records = 0;
+  return (ok);
+}
@@ -0,0 +1,40 @@
+/** \file sink.h
+ */
+#ifndef _SINK_H
+#define _SINK_H
+
+/** \enum SinkFormat
+ *
+ * Used with the "--format" cmd-line option to write the matches
+ * as records instead of the coloured text from `report_file()`.
+ */
+typedef enum SinkFormat {
+        SINK_TEXT,
+        SINK_NDJSON,
+        SINK_BINARY
+      } SinkFormat;
+
+/**
+ * A match written to a sink. A NULL string is not written.
+ */
+struct sink_rec {
+       const char *mode;         /**< The search-mode; `"path"`, `"lib"`, `"evry"` etc. */
+       const char *source;       /**< Where it was found; E.g. `"hkcu-env"` (or NULL) */
+       const char *spec;         /**< The file-spec that matched (or NULL) */
+       const char *file;         /**< The file, directory or vcpkg package */
+       const char *owner;        /**< The account-name with `--owner` (or NULL) */
+       const char *version;      /**< The version of a vcpkg package (or NULL) */
+       time_t      mtime;        /**< 0 if unknown */
+       UINT64      fsize;        /**< `(UINT64)-1` if unknown */
+       BOOL        is_dir;
+       BOOL        is_junction;
+     };
+
+extern BOOL        set_sink_format  (const char *format);
+extern const char *get_sink_formats (void);
+
+extern BOOL  sink_open  (const char *fname);
+extern void  sink_write (const struct sink_rec *rec);
+extern BOOL  sink_close (void);
+
+#endif
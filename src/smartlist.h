@@ -12,6 +12,7 @@ typedef struct smartlist_t smartlist_t;  /* Opaque struct; defined in smartlist.
 typedef int  (*smartlist_sort_func) (const void **a, const void **b);
 typedef int  (*smartlist_compare_func) (const void *key, const void **member);
 typedef void (*smartlist_parse_func) (smartlist_t *sl, const char *line);
+typedef int  (*smartlist_match_func) (const void *member, void *arg);
 
 
 int          smartlist_len (const smartlist_t *sl);
@@ -35,6 +36,9 @@ void  smartlist_wipe (smartlist_t *sl, void (*free_fn)(void *a));
 
 int   smartlist_duplicates (smartlist_t *sl, smartlist_sort_func compare);
 void  smartlist_make_uniq (smartlist_t *sl, smartlist_sort_func compare, void (*free_fn)(void *a));
+int   smartlist_remove_if (smartlist_t *sl, smartlist_match_func match, void *arg, void (*free_fn)(void *a));
+
+smartlist_t *smartlist_filter (const smartlist_t *sl, smartlist_match_func match, void *arg);
 
 void  smartlist_sort (smartlist_t *sl, smartlist_sort_func compare);
 
@@ -3,6 +3,11 @@
  * \ingroup Misc
  * \brief
  *   Handling of sort options `-S` and `"--sort"`.
+ *   And sorting of the matches before they are reported.
+ *
+ * Build the test program with `-DSORT_TEST`. It checks that all matches
+ * are reported in order and with their spec when sorted in memory, when
+ * spilled to run-files and when a spill fails.
  */
 #include "envtool.h"
 #include "sort.h"
@@ -97,3 +102,849 @@ BOOL set_sort_method (const char *short_opt, const char *long_opt)
 }
 
 
+
+/**
+ * \def SORT_IS_DIR
+ *   The `sort_rec::flags` bit for a directory.
+ *
+ * \def SORT_IS_JUNCTION
+ *   The `sort_rec::flags` bit for a junction.
+ */
+#define SORT_IS_DIR       0x01
+#define SORT_IS_JUNCTION  0x02
+
+/**
+ * A compact record of a match to report later.
+ * The strings and keys are stored only once elsewhere. So a record is 32 bytes
+ * (plus the file-name) and 1 million Everything results is no problem.
+ */
+struct sort_rec {
+       UINT64  fsize;
+       INT64   mtime;
+       DWORD   file;      /**< The offset of the file-name in `pool` */
+       WORD    section;   /**< The index into `sections[]` */
+       WORD    spec;      /**< The index into `specs[]` */
+       BYTE    hkey;      /**< The index into `hkeys[]` */
+       BYTE    flags;     /**< `SORT_IS_DIR` and/or `SORT_IS_JUNCTION` */
+     };
+
+/**
+ * What is radix-sorted. The records themselves are not moved.
+ */
+struct sort_item {
+       UINT64  key;       /**< `fsize`, `mtime` or the start of the folded name */
+       DWORD   rec;       /**< The index into `recs` */
+       DWORD   section;
+     };
+
+static struct sort_rec *recs;
+static DWORD            num_recs, max_recs;
+
+static char            *pool;              /* All file-names; 0-terminated */
+static size_t           pool_len, pool_size;
+
+/**
+ * The `sort_rec::section` and `sort_rec::spec` indices are a `WORD`.
+ * More sections or specs than this are reported under the last one.
+ */
+#define SORT_MAX_INDEX  0xFFFF
+
+static char           **sections;          /* The report-headers; "" for none */
+static DWORD            num_sections, max_sections;
+
+static const char     **specs;             /* The file-specs; `specs[0]` is NULL */
+static DWORD            num_specs = 1, max_specs;
+static BOOL             index_warned;
+
+static HKEY             hkeys [256];
+static DWORD            num_hkeys;
+
+/**
+ * Return the new size of the `sections[]` or `specs[]` array when `num`
+ * elements are used and it's full. Warn once if it cannot grow anymore.
+ *
+ * \retval 0 if `SORT_MAX_INDEX` elements are already used.
+ */
+static DWORD grow_index (DWORD num, const char *what)
+{
+  if (num >= SORT_MAX_INDEX)
+  {
+    if (!index_warned)
+       WARN ("More than %u %s to sort; the rest are reported under the last one.\n",
+             SORT_MAX_INDEX, what);
+    index_warned = TRUE;
+    return (0);
+  }
+  return (min(2 * num + 256, SORT_MAX_INDEX));
+}
+
+/**
+ * Return the index of `header`. A new section is started only when
+ * the header is different from the current one.
+ */
+static WORD add_section (const char *header)
+{
+  if (!header)
+     header = "";
+
+  if (num_sections > 0 && !strcmp(sections[num_sections-1], header))
+     return (WORD) (num_sections - 1);
+
+  if (num_sections == max_sections)
+  {
+    DWORD max = grow_index (num_sections, "sections");
+
+    if (max == 0)
+       return (WORD) (num_sections - 1);
+    max_sections = max;
+    sections = REALLOC (sections, max_sections * sizeof(sections[0]));
+  }
+
+  sections [num_sections] = STRDUP (header);
+  return (WORD) num_sections++;
+}
+
+static WORD add_spec (const char *spec)
+{
+  DWORD i;
+
+  if (!spec)
+     return (0);
+  for (i = num_specs; i > 1; i--)
+      if (specs[i-1] == spec)
+         return (WORD) (i - 1);
+  if (num_specs >= max_specs)
+  {
+    DWORD max = grow_index (num_specs, "file-specs");
+
+    if (max == 0)
+       return (WORD) (num_specs - 1);
+    max_specs = max;
+    specs = REALLOC (specs, max_specs * sizeof(specs[0]));
+    specs [0] = NULL;
+  }
+  specs [num_specs] = spec;
+  return (WORD) num_specs++;
+}
+
+static BYTE add_hkey (HKEY key)
+{
+  DWORD i;
+
+  for (i = 0; i < num_hkeys; i++)
+      if (hkeys[i] == key)
+         return (BYTE) i;
+  if (num_hkeys == DIM(hkeys))
+     return (0);   /* Never happens; there are only a few pseudo-keys */
+  hkeys [num_hkeys] = key;
+  return (BYTE) num_hkeys++;
+}
+
+static DWORD add_file (const char *file)
+{
+  size_t len = strlen (file) + 1;
+  DWORD  ofs;
+
+  if (pool_len + len > pool_size)
+  {
+    pool_size = 2 * pool_size + len + 64*1024;
+    pool = REALLOC (pool, pool_size);
+  }
+  ofs = (DWORD) pool_len;
+  memcpy (pool + pool_len, file, len);
+  pool_len += len;
+  return (ofs);
+}
+
+/**
+ * A sorted run spilled to a temporary file. Or the sorted matches still
+ * in memory when they could not be spilled.
+ * When a run is merged, `head` is the next match read from it.
+ */
+struct sort_run {
+       char   *fname;
+       FILE   *file;
+       BOOL    eof;
+       DWORD   idx;                  /**< The order the run was created in */
+       struct sort_item item;        /**< `head` as an item to compare */
+       struct sort_rec  head;
+       char   name [2*_MAX_PATH];    /**< The file-name of `head` */
+       const struct sort_item *mem;  /**< The sorted items in memory. `file` is NULL */
+       DWORD   mem_num, mem_pos;
+     };
+
+/**
+ * A record as written to a run-file. The file-name follows.
+ */
+struct run_rec {
+       UINT64  key;
+       UINT64  fsize;
+       INT64   mtime;
+       WORD    section;
+       WORD    spec;
+       BYTE    hkey;
+       BYTE    flags;
+       WORD    name_len;
+     };
+
+static struct sort_run *runs [256];
+static DWORD            num_runs;
+static DWORD            max_runs = DIM(runs);
+static BOOL             no_spill;      /* A spill failed; keep the rest in memory */
+static DWORD            num_total;     /* Since the last `sort_flush()`; including spilled matches */
+static size_t           mem_peak;
+static UINT64           time_start;
+
+static UINT64 get_ticks (void)
+{
+  LARGE_INTEGER cnt;
+
+  QueryPerformanceCounter (&cnt);
+  return (cnt.QuadPart);
+}
+
+static double ticks_to_sec (UINT64 ticks)
+{
+  LARGE_INTEGER freq;
+
+  QueryPerformanceFrequency (&freq);
+  return ((double)ticks / (double)freq.QuadPart);
+}
+
+/**
+ * Return the memory used now; including what `sort_items()` would need.
+ */
+static size_t mem_used (void)
+{
+  return (max_recs * sizeof(struct sort_rec) + pool_size + 2 * num_recs * sizeof(struct sort_item));
+}
+
+static BOOL spill_run (void);
+
+/**
+ * Add a match to report later. Called from `report_file()` when a
+ * sort-method is used. The strings are copied; except `spec` which must
+ * live until `sort_flush()` is called.
+ *
+ * When the matches in memory exceed `opt.sort_mem` MBytes, they are sorted
+ * and spilled to a temporary file. If that fails, the rest are kept in memory.
+ *
+ * \param[in] header  the report-header in effect for this match (or NULL).
+ * \param[in] spec    the file-spec that matched (or NULL).
+ * \param[in] the rest as for `report_file()`.
+ */
+void sort_add (const char *header, const char *file, time_t mtime,
+               UINT64 fsize, BOOL is_dir, BOOL is_junction,
+               HKEY key, const char *spec)
+{
+  struct sort_rec *r;
+
+  if (num_total == 0)
+     time_start = get_ticks();
+
+  if (num_recs == max_recs)
+  {
+    if (!no_spill && opt.sort_mem > 0 && num_recs > 0 &&
+        mem_used() >= (size_t)opt.sort_mem * 1024 * 1024 && spill_run())
+       ;
+    else
+    {
+      max_recs = 2 * max_recs + 1024;
+      recs = REALLOC (recs, max_recs * sizeof(*recs));
+    }
+  }
+  r = recs + num_recs++;
+  r->fsize   = fsize;
+  r->mtime   = (INT64) mtime;
+  r->file    = add_file (file);
+  r->section = add_section (header);
+  r->spec    = add_spec (spec);
+  r->hkey    = add_hkey (key);
+  r->flags   = (is_dir ? SORT_IS_DIR : 0) | (is_junction ? SORT_IS_JUNCTION : 0);
+  num_total++;
+}
+
+/**
+ * Return the number of matches added since the last `sort_flush()`.
+ */
+int sort_count (void)
+{
+  return (int) num_total;
+}
+
+/**
+ * Return the part of a file-name to sort on with `SORT_FILE_NAME`
+ * or `SORT_FILE_EXTENSION`.
+ */
+static const char *sort_name (const char *file)
+{
+  const char *base = file, *p;
+
+  for (p = file; *p; p++)
+      if (IS_SLASH(*p) && p[1])
+         base = p + 1;
+
+  if (opt.sort_method == SORT_FILE_EXTENSION)
+  {
+    p = strrchr (base, '.');
+    return (p ? p + 1 : "");
+  }
+  return (base);
+}
+
+/**
+ * Return the first 8 characters of `name` folded to upper-case as a
+ * big-endian number. So comparing these keys is comparing the names.
+ */
+static UINT64 fold_key (const char *name)
+{
+  UINT64 key = 0;
+  int    i;
+
+  for (i = 0; i < 8; i++)
+  {
+    key <<= 8;
+    if (*name)
+       key |= (BYTE) toupper ((BYTE)*name++);
+  }
+  return (key);
+}
+
+/**
+ * Return the key to radix-sort a match on.
+ */
+static UINT64 sort_key (const struct sort_rec *r, const char *file)
+{
+  if (opt.sort_method == SORT_FILE_SIZE)
+     return (r->fsize);
+  if (opt.sort_method == SORT_FILE_DATETIME)
+     return ((UINT64)r->mtime ^ ((UINT64)1 << 63));   /* so a negative time is lower */
+  if (opt.sort_method == SORT_FILE_NAME || opt.sort_method == SORT_FILE_EXTENSION)
+     return fold_key (sort_name(file));
+  return (0);
+}
+
+/**
+ * Return the byte of an item to sort on in a radix-sort `pass`.
+ * The 8 bytes of the `key` first, then the 2 bytes of the `section`.
+ */
+static BYTE radix_byte (const struct sort_item *it, int pass)
+{
+  if (pass < 8)
+     return (BYTE) (it->key >> (8 * pass));
+  return (BYTE) (it->section >> (8 * (pass - 8)));
+}
+
+/**
+ * Stable LSD radix-sort of `num` items on `key` and then `section`.
+ * A pass is skipped if all items have the same byte at that position.
+ * E.g. the upper bytes of a file-size.
+ *
+ * \retval `items` or `tmp`; whichever has the sorted result.
+ */
+static struct sort_item *radix_sort (struct sort_item *items, struct sort_item *tmp, size_t num)
+{
+  int pass;
+
+  for (pass = 0; pass < 8 + 2; pass++)
+  {
+    struct sort_item *swap;
+    size_t count [256], i, sum;
+
+    memset (count, '\0', sizeof(count));
+    for (i = 0; i < num; i++)
+        count [radix_byte(items+i, pass)]++;
+
+    if (count [radix_byte(items, pass)] == num)
+       continue;
+
+    for (i = sum = 0; i < 256; i++)
+    {
+      size_t c = count[i];
+
+      count[i] = sum;
+      sum += c;
+    }
+    for (i = 0; i < num; i++)
+        tmp [count[radix_byte(items+i, pass)]++] = items[i];
+
+    swap  = items;
+    items = tmp;
+    tmp   = swap;
+  }
+  return (items);
+}
+
+static int compare_names (const void *_a, const void *_b)
+{
+  const struct sort_item *a = _a;
+  const struct sort_item *b = _b;
+  int   rc = stricmp (sort_name(pool + recs[a->rec].file), sort_name(pool + recs[b->rec].file));
+
+  if (rc == 0)   /* keep it stable */
+     rc = (a->rec < b->rec) ? -1 : 1;
+  return (rc);
+}
+
+/**
+ * Sort the matches in memory.
+ *
+ * The sorting is a radix-sort on the size, the time or the first 8 folded
+ * characters of the name or extension. Names or extensions with equal keys
+ * are then sorted on the whole name or extension.
+ *
+ * \param[out] sorted  the sorted items.
+ * \retval     The allocated items. The caller must `FREE()` it.
+ */
+static struct sort_item *sort_items (struct sort_item **sorted_out)
+{
+  struct sort_item *items, *sorted;
+  DWORD  i, j;
+
+  items = MALLOC (2 * num_recs * sizeof(*items));
+
+  for (i = 0; i < num_recs; i++)
+  {
+    items[i].key     = sort_key (recs + i, pool + recs[i].file);
+    items[i].rec     = i;
+    items[i].section = recs[i].section;
+  }
+
+  sorted = radix_sort (items, items + num_recs, num_recs);
+
+  if (opt.sort_method == SORT_FILE_NAME || opt.sort_method == SORT_FILE_EXTENSION)
+  {
+    for (i = 0; i < num_recs; i = j)
+    {
+      for (j = i + 1; j < num_recs; j++)
+          if (sorted[j].key != sorted[i].key || sorted[j].section != sorted[i].section)
+             break;
+      if (j - i > 1)
+         qsort (sorted + i, j - i, sizeof(*sorted), compare_names);
+    }
+  }
+
+  if (mem_used() > mem_peak)
+     mem_peak = mem_used();
+  *sorted_out = sorted;
+  return (items);
+}
+
+/**
+ * Sort the matches in memory and write them to a new run-file.
+ * Then the memory is reused for the next matches.
+ *
+ * \retval FALSE if the run-file cannot be created or written. The matches are
+ *         kept in memory and no more spills are done until `sort_exit()`.
+ */
+static BOOL spill_run (void)
+{
+  struct sort_item *items, *sorted;
+  struct sort_run  *run;
+  DWORD  i;
+  BOOL   ok = TRUE;
+
+  if (num_runs >= max_runs)
+  {
+    DEBUGF (1, "Too many runs; using more memory.\n");
+    no_spill = TRUE;
+    return (FALSE);
+  }
+
+  run = CALLOC (sizeof(*run), 1);
+  run->fname = create_temp_file();
+  run->file  = run->fname ? fopen (run->fname, "w+b") : NULL;
+  if (!run->file)
+  {
+    DEBUGF (1, "Failed to create a run-file; using more memory.\n");
+    FREE (run->fname);
+    FREE (run);
+    no_spill = TRUE;
+    return (FALSE);
+  }
+
+  items = sort_items (&sorted);
+  for (i = 0; i < num_recs; i++)
+  {
+    const struct sort_rec *r = recs + sorted[i].rec;
+    const char *name = pool + r->file;
+    struct run_rec rr;
+
+    rr.key      = sorted[i].key;
+    rr.fsize    = r->fsize;
+    rr.mtime    = r->mtime;
+    rr.section  = r->section;
+    rr.spec     = r->spec;
+    rr.hkey     = r->hkey;
+    rr.flags    = r->flags;
+    rr.name_len = (WORD) strlen (name);
+    if (fwrite(&rr, sizeof(rr), 1, run->file) != 1 ||
+        (rr.name_len > 0 && fwrite(name, rr.name_len, 1, run->file) != 1))
+    {
+      ok = FALSE;
+      break;
+    }
+  }
+  FREE (items);
+
+  /* A short write (e.g. a full disk) would silently drop matches from the merge.
+   */
+  if (ok && (fflush(run->file) != 0 || ferror(run->file)))
+     ok = FALSE;
+
+  if (!ok)
+  {
+    DEBUGF (1, "Failed to write \"%s\"; using more memory.\n", run->fname);
+    fclose (run->file);
+    DeleteFile (run->fname);
+    FREE (run->fname);
+    FREE (run);
+    no_spill = TRUE;
+    return (FALSE);
+  }
+
+  DEBUGF (2, "Spilled %lu matches to \"%s\".\n", (unsigned long)num_recs, run->fname);
+  run->idx = num_runs;
+  runs [num_runs++] = run;
+  num_recs = 0;
+  pool_len = 0;
+  return (TRUE);
+}
+
+/**
+ * Read the next match of a run into it's `head`.
+ */
+static void run_read (struct sort_run *run)
+{
+  struct run_rec rr;
+  size_t len;
+
+  if (run->mem)
+  {
+    if (run->mem_pos >= run->mem_num)
+    {
+      run->eof = TRUE;
+      return;
+    }
+    run->item = run->mem [run->mem_pos++];
+    run->head = recs [run->item.rec];
+    _strlcpy (run->name, pool + run->head.file, sizeof(run->name));
+    return;
+  }
+
+  if (fread(&rr, sizeof(rr), 1, run->file) != 1)
+  {
+    run->eof = TRUE;
+    return;
+  }
+  len = rr.name_len;
+  if (len >= sizeof(run->name))
+  {
+    fseek (run->file, (long)(len - sizeof(run->name) + 1), SEEK_CUR);
+    len = sizeof(run->name) - 1;
+    fread (run->name, len, 1, run->file);
+  }
+  else if (fread(run->name, len, 1, run->file) != 1 && len > 0)
+  {
+    run->eof = TRUE;
+    return;
+  }
+  run->name [len]    = '\0';
+  run->head.fsize    = rr.fsize;
+  run->head.mtime    = rr.mtime;
+  run->head.section  = rr.section;
+  run->head.spec     = rr.spec;
+  run->head.hkey     = rr.hkey;
+  run->head.flags    = rr.flags;
+  run->item.key      = rr.key;
+  run->item.section  = rr.section;
+}
+
+/**
+ * Compare the heads of 2 runs in the same order as `sort_items()`.
+ * The order of the runs keeps the merge stable.
+ */
+static int compare_runs (const struct sort_run *a, const struct sort_run *b)
+{
+  int rc;
+
+  if (a->item.section != b->item.section)
+     return (a->item.section < b->item.section ? -1 : 1);
+  if (a->item.key != b->item.key)
+     return (a->item.key < b->item.key ? -1 : 1);
+  if (opt.sort_method == SORT_FILE_NAME || opt.sort_method == SORT_FILE_EXTENSION)
+  {
+    rc = stricmp (sort_name(a->name), sort_name(b->name));
+    if (rc)
+       return (rc);
+  }
+  return (a->idx < b->idx ? -1 : 1);
+}
+
+/**
+ * Restore the min-heap property of `heap` from `i` and down.
+ */
+static void heap_down (struct sort_run **heap, DWORD num, DWORD i)
+{
+  while (1)
+  {
+    DWORD min = i, l = 2*i + 1, r = 2*i + 2;
+    struct sort_run *swap;
+
+    if (l < num && compare_runs(heap[l], heap[min]) < 0)
+       min = l;
+    if (r < num && compare_runs(heap[r], heap[min]) < 0)
+       min = r;
+    if (min == i)
+       break;
+    swap = heap[i];
+    heap[i] = heap[min];
+    heap[min] = swap;
+    i = min;
+  }
+}
+
+/**
+ * Merge all runs with a k-way min-heap and call `report` for each match.
+ * The matches still in memory (if a spill failed) are merged as the last run.
+ */
+static int merge_runs (sort_report_func report)
+{
+  struct sort_run  *heap [DIM(runs)+1];
+  struct sort_run   mem_run;
+  struct sort_item *items = NULL, *sorted;
+  DWORD  i, num = 0, last_section = (DWORD)-1;
+  int    found = 0;
+
+  for (i = 0; i < num_runs; i++)
+  {
+    struct sort_run *run = runs[i];
+
+    rewind (run->file);
+    setvbuf (run->file, NULL, _IOFBF, 64*1024);
+    run_read (run);
+    if (!run->eof)
+       heap [num++] = run;
+  }
+
+  if (num_recs > 0)
+  {
+    memset (&mem_run, '\0', sizeof(mem_run));
+    items = sort_items (&sorted);
+    mem_run.mem     = sorted;
+    mem_run.mem_num = num_recs;
+    mem_run.idx     = num_runs;
+    run_read (&mem_run);
+    heap [num++] = &mem_run;
+  }
+
+  for (i = num; i > 0; i--)
+      heap_down (heap, num, i-1);
+
+  while (num > 0 && !search_halted())
+  {
+    struct sort_run *run = heap[0];
+    const struct sort_rec *r = &run->head;
+    const char *header = NULL;
+
+    if (r->section != last_section)   /* A new section; "" if it has no header */
+    {
+      header = sections [r->section];
+      last_section = r->section;
+    }
+    found += (*report) (header, run->name, (time_t)r->mtime, r->fsize,
+                        (r->flags & SORT_IS_DIR) != 0, (r->flags & SORT_IS_JUNCTION) != 0,
+                        hkeys[r->hkey], r->spec ? specs[r->spec] : NULL);
+
+    run_read (run);
+    if (run->eof)
+       heap[0] = heap[--num];
+    heap_down (heap, num, 0);
+  }
+  FREE (items);
+  return (found);
+}
+
+/**
+ * Free all matches added by `sort_add()` and delete the run-files.
+ */
+void sort_exit (void)
+{
+  DWORD i;
+
+  for (i = 0; i < num_runs; i++)
+  {
+    fclose (runs[i]->file);
+    DeleteFile (runs[i]->fname);
+    FREE (runs[i]->fname);
+    FREE (runs[i]);
+  }
+  for (i = 0; i < num_sections; i++)
+      FREE (sections[i]);
+  FREE (sections);
+  FREE (specs);
+  FREE (recs);
+  FREE (pool);
+  num_recs = max_recs = num_sections = max_sections = num_hkeys = num_runs = num_total = 0;
+  num_specs = 1;
+  max_specs = 0;
+  index_warned = FALSE;
+  pool_len = pool_size = mem_peak = 0;
+  no_spill = FALSE;
+}
+
+/**
+ * Sort the matches added by `sort_add()` on `opt.sort_method` and
+ * call `report` for each in sorted order. The matches are kept in the
+ * sections they were added in. All is freed afterwards.
+ *
+ * If some matches were spilled to run-files, the rest is spilled too
+ * and all runs are merged. If that last spill fails, the rest is merged
+ * from memory.
+ *
+ * \retval The sum of what `report` returned. I.e. the number of matches
+ *         reported.
+ */
+int sort_flush (sort_report_func report)
+{
+  struct sort_item *items, *sorted;
+  DWORD  i, last_section = (DWORD)-1, total = num_total;
+  int    found = 0;
+  double sec;
+
+  if (total == 0)
+  {
+    sort_exit();
+    return (0);
+  }
+
+  if (num_runs > 0 && num_recs > 0 && !no_spill)
+     spill_run();
+
+  if (num_runs > 0)
+     found = merge_runs (report);
+  else
+  {
+    items = sort_items (&sorted);
+    for (i = 0; i < num_recs && !search_halted(); i++)
+    {
+      const struct sort_rec *r = recs + sorted[i].rec;
+      const char *header = NULL;
+
+      if (r->section != last_section)   /* A new section; "" if it has no header */
+      {
+        header = sections [r->section];
+        last_section = r->section;
+      }
+      found += (*report) (header, pool + r->file, (time_t)r->mtime, r->fsize,
+                          (r->flags & SORT_IS_DIR) != 0, (r->flags & SORT_IS_JUNCTION) != 0,
+                          hkeys[r->hkey], r->spec ? specs[r->spec] : NULL);
+    }
+    FREE (items);
+  }
+
+  sec = ticks_to_sec (get_ticks() - time_start);
+  DEBUGF (1, "Sorted %lu matches in %lu sections and %lu runs; %.3f sec (%.0f matches/sec). "
+             "Peak memory: %sytes.\n",
+          (unsigned long)total, (unsigned long)num_sections, (unsigned long)num_runs,
+          sec, sec > 0.0 ? (double)total / sec : 0.0, str_trim((char*)get_file_size_str(mem_peak)));
+  sort_exit();
+  return (found);
+}
+
+#if defined(SORT_TEST)
+
+#define TEST_UTIL_MAIN
+#include "test_util.h"
+
+BOOL search_halted (void)
+{
+  return (FALSE);
+}
+
+#define TEST_SPECS  5000   /* More than the old fixed `specs[]` held */
+#define TEST_BLOCK  40     /* Matches added in a row for the same spec */
+
+static UINT64 last_size;
+static DWORD  num_reported;
+static int    num_errors;
+static char   test_specs [TEST_SPECS][20];
+
+static int check_order (const char *header, const char *file, time_t mtime,
+                        UINT64 fsize, BOOL is_dir, BOOL is_junction,
+                        HKEY key, const char *spec)
+{
+  if (num_reported > 0 && fsize < last_size)
+  {
+    printf ("\"%s\" (%" U64_FMT ") reported after a size of %" U64_FMT ".\n", file, fsize, last_size);
+    num_errors++;
+  }
+  if (!spec || (strtoul(strrchr(file,'-')+1, NULL, 10) / TEST_BLOCK) % TEST_SPECS != strtoul(spec+5, NULL, 10))
+  {
+    printf ("\"%s\" reported with spec \"%s\".\n", file, spec ? spec : "<none>");
+    num_errors++;
+  }
+  last_size = fsize;
+  num_reported++;
+  ARGSUSED (header);
+  ARGSUSED (mtime);
+  ARGSUSED (is_dir);
+  ARGSUSED (is_junction);
+  ARGSUSED (key);
+  return (1);
+}
+
+/**
+ * Add `num` matches with pseudo-random sizes and sort them on size with
+ * `sort_mem` MBytes of memory. Check that all are reported in order and
+ * with the spec they were added with. A `limit` of run-files forces a
+ * spill to fail.
+ */
+static void test_sort (const char *what, DWORD num, int sort_mem, DWORD limit)
+{
+  DWORD  i, seed = 1, spilled;
+  int    found;
+  double start = get_time();
+
+  opt.sort_mem = sort_mem;
+  max_runs     = limit;
+  num_reported = 0;
+
+  for (i = 0; i < num; i++)
+  {
+    char file [_MAX_PATH];
+
+    seed = seed * 1103515245 + 12345;
+    snprintf (file, sizeof(file), "c:\\some\\directory\\file-%lu.dll", (unsigned long)i);
+    sort_add (NULL, file, 0, (UINT64)(seed >> 8), FALSE, FALSE, NULL, test_specs[(i / TEST_BLOCK) % TEST_SPECS]);
+  }
+  spilled = num_runs;
+  found = sort_flush (check_order);
+
+  if (found != (int)num || num_reported != num)
+  {
+    printf ("%s: %d of %lu matches reported.\n", what, found, (unsigned long)num);
+    num_errors++;
+  }
+  printf ("%-16s %7lu matches in %3lu runs: %.3f sec.\n",
+          what, (unsigned long)num, (unsigned long)spilled, get_time() - start);
+}
+
+int main (void)
+{
+  int i;
+
+  for (i = 0; i < TEST_SPECS; i++)
+      snprintf (test_specs[i], sizeof(test_specs[i]), "spec-%d", i);
+
+  opt.sort_method = SORT_FILE_SIZE;
+
+  test_sort ("in memory:",     200000, 0, DIM(runs));
+  test_sort ("spilled:",       200000, 1, DIM(runs));
+  test_sort ("spill failed:",  200000, 1, 2);
+  test_sort ("no run-files:",  200000, 1, 0);
+
+  printf ("%d errors.\n", num_errors);
+  return (num_errors ? 1 : 0);
+}
+#endif  /* SORT_TEST */
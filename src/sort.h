@@ -21,5 +21,21 @@ extern BOOL        set_sort_method (const char *short_opt, const char *long_opt)
 extern const char *get_sort_methods_short (void);
 extern const char *get_sort_methods_long (void);
 
+/**
+ * The callback for `sort_flush()`. Called for each match in sorted order.
+ * `header` is the report-header for the first match in a section and NULL
+ * for the rest. It is `""` for a section without a report-header.
+ */
+typedef int (*sort_report_func) (const char *header, const char *file, time_t mtime,
+                                 UINT64 fsize, BOOL is_dir, BOOL is_junction,
+                                 HKEY key, const char *spec);
+
+extern void sort_add   (const char *header, const char *file, time_t mtime,
+                        UINT64 fsize, BOOL is_dir, BOOL is_junction,
+                        HKEY key, const char *spec);
+extern int  sort_flush (sort_report_func report);
+extern int  sort_count (void);
+extern void sort_exit  (void);
+
 #endif
 
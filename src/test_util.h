@@ -0,0 +1,71 @@
+/**\file    test_util.h
+ * \ingroup Misc
+ * \brief
+ *   Common code for the stand-alone test programs (built with `-DXX_TEST`).
+ *
+ * A module that can be built as a test program on non-Windows too includes
+ * this instead of `envtool.h`. On Windows (and CygWin) it simply includes
+ * `envtool.h`. Elsewhere it defines the few `envtool.h` macros such a
+ * module needs.
+ *
+ * The `XX_TEST` section of a module defines `TEST_UTIL_MAIN` and includes
+ * this header again. That adds the global `opt` that `misc.c` needs (on
+ * Windows) and `get_time()`.
+ */
+#ifndef _TEST_UTIL_H
+#define _TEST_UTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#if defined(_WIN32) || defined(__CYGWIN__)
+  #include "envtool.h"
+#else
+  #include <assert.h>
+
+  #define IS_SLASH(c)         ((c) == '\\' || (c) == '/')
+  #define ASSERT(expr)        assert (expr)
+  #define MALLOC              malloc
+  #define CALLOC              calloc
+  #define REALLOC             realloc
+  #define STRDUP              strdup
+  #define FREE(p)             (p ? (void) (free(p), p = NULL) : (void)0)
+  #define TOUPPER(c)          toupper ((int)(c))
+  #define TOLOWER(c)          tolower ((int)(c))
+  #define DEBUGF(level, ...)  (void)0
+  #define WARN(...)           fprintf (stderr, __VA_ARGS__)
+  #define MS_CDECL
+#endif
+#endif  /* _TEST_UTIL_H */
+
+#if defined(TEST_UTIL_MAIN) && !defined(_TEST_UTIL_MAIN_H)
+#define _TEST_UTIL_MAIN_H
+
+#if defined(_WIN32) || defined(__CYGWIN__)
+  struct prog_options opt;
+
+  /**
+   * Return a monotonic time in seconds.
+   */
+  static double get_time (void)
+  {
+    LARGE_INTEGER cnt, freq;
+
+    QueryPerformanceFrequency (&freq);
+    QueryPerformanceCounter (&cnt);
+    return ((double)cnt.QuadPart / (double)freq.QuadPart);
+  }
+#else
+  #include <time.h>
+
+  static double get_time (void)
+  {
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ((double)ts.tv_sec + (double)ts.tv_nsec / 1E9);
+  }
+#endif
+#endif  /* TEST_UTIL_MAIN */
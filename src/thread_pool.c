@@ -0,0 +1,187 @@
+/**\file    thread_pool.c
+ * \ingroup Misc
+ * \brief
+ *   A simple pool of worker-threads with a FIFO task-queue.
+ *
+ * Used to do blocking file-system work (like `FindFirstFile()` on
+ * network directories) concurrently. The tasks themselves must not print
+ * anything; all output should be done by the main thread.
+ */
+#include <limits.h>
+#include <windows.h>
+
+#include "envtool.h"
+#include "thread_pool.h"
+
+/**
+ * \def POOL_MAX_THREADS
+ * The max number of threads in a pool.
+ */
+#define POOL_MAX_THREADS  32
+
+/**
+ * A queued task.
+ */
+struct pool_task {
+       pool_func         func;
+       void             *arg;
+       struct pool_task *next;
+     };
+
+/**
+ * The pool structure. Opaque to the user.
+ */
+struct thread_pool {
+       CRITICAL_SECTION  lock;         /**< protects `head` and `tail` */
+       HANDLE            sema;         /**< counts queued tasks + quit signals */
+       HANDLE           *threads;
+       int               num_threads;
+       struct pool_task *head;
+       struct pool_task *tail;
+     };
+
+static DWORD WINAPI pool_worker (void *arg)
+{
+  thread_pool *pool = (thread_pool*) arg;
+
+  while (1)
+  {
+    struct pool_task *task;
+
+    WaitForSingleObject (pool->sema, INFINITE);
+
+    EnterCriticalSection (&pool->lock);
+    task = pool->head;
+    if (task)
+    {
+      pool->head = task->next;
+      if (!pool->head)
+         pool->tail = NULL;
+    }
+    LeaveCriticalSection (&pool->lock);
+
+    /* An empty queue means `pool_destroy()` told us to quit.
+     */
+    if (!task)
+       break;
+
+    (*task->func) (task->arg);
+    FREE (task);
+  }
+  return (0);
+}
+
+/**
+ * Return a suitable number of threads for I/O-bound work.
+ * I.e. twice the number of processors, but at least 4.
+ */
+int pool_default_threads (void)
+{
+  SYSTEM_INFO si;
+  int         num;
+
+  GetSystemInfo (&si);
+  num = 2 * (int) si.dwNumberOfProcessors;
+  if (num < 4)
+     num = 4;
+  if (num > POOL_MAX_THREADS)
+     num = POOL_MAX_THREADS;
+  return (num);
+}
+
+/**
+ * Create a pool with `num_threads` worker-threads.
+ *
+ * \param[in] num_threads  The number of threads. If <= 0, use `pool_default_threads()`.
+ * \retval NULL  if no threads could be created.
+ */
+thread_pool *pool_create (int num_threads)
+{
+  thread_pool *pool;
+  int          i;
+
+  if (num_threads <= 0)
+     num_threads = pool_default_threads();
+  if (num_threads > POOL_MAX_THREADS)
+     num_threads = POOL_MAX_THREADS;
+
+  pool = CALLOC (sizeof(*pool), 1);
+  pool->threads = CALLOC (sizeof(HANDLE), num_threads);
+  pool->sema    = CreateSemaphore (NULL, 0, LONG_MAX, NULL);
+  InitializeCriticalSection (&pool->lock);
+
+  for (i = 0; pool->sema && i < num_threads; i++)
+  {
+    DWORD  tid;
+    HANDLE hnd = CreateThread (NULL, 0, pool_worker, pool, 0, &tid);
+
+    if (!hnd)
+    {
+      DEBUGF (1, "CreateThread() failed; %s\n", win_strerror(GetLastError()));
+      break;
+    }
+    pool->threads [pool->num_threads++] = hnd;
+  }
+
+  DEBUGF (2, "Created a pool with %d threads.\n", pool->num_threads);
+
+  if (pool->num_threads == 0)
+  {
+    pool_destroy (pool);
+    return (NULL);
+  }
+  return (pool);
+}
+
+/**
+ * Queue a task for the pool.
+ */
+void pool_submit (thread_pool *pool, pool_func func, void *arg)
+{
+  struct pool_task *task = CALLOC (sizeof(*task), 1);
+
+  task->func = func;
+  task->arg  = arg;
+
+  EnterCriticalSection (&pool->lock);
+  if (pool->tail)
+       pool->tail->next = task;
+  else pool->head = task;
+  pool->tail = task;
+  LeaveCriticalSection (&pool->lock);
+
+  ReleaseSemaphore (pool->sema, 1, NULL);
+}
+
+/**
+ * Let the workers finish all queued tasks, then free the pool.
+ */
+void pool_destroy (thread_pool *pool)
+{
+  int i;
+
+  if (!pool)
+     return;
+
+  /* Since the queue is FIFO, a worker sees an empty queue only
+   * after all tasks are taken.
+   */
+  if (pool->num_threads > 0)
+     ReleaseSemaphore (pool->sema, pool->num_threads, NULL);
+
+  for (i = 0; i < pool->num_threads; i++)
+  {
+    WaitForSingleObject (pool->threads[i], INFINITE);
+    CloseHandle (pool->threads[i]);
+  }
+  if (pool->sema)
+     CloseHandle (pool->sema);
+  DeleteCriticalSection (&pool->lock);
+  FREE (pool->threads);
+  FREE (pool);
+}
+
+int pool_num_threads (const thread_pool *pool)
+{
+  return (pool ? pool->num_threads : 0);
+}
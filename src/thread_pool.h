@@ -0,0 +1,20 @@
+/** \file thread_pool.h
+ *  \ingroup Misc
+ */
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H
+
+/**
+ * The function a worker-thread runs for each submitted task.
+ */
+typedef void (*pool_func) (void *arg);
+
+typedef struct thread_pool thread_pool;
+
+extern thread_pool *pool_create          (int num_threads);
+extern void         pool_submit          (thread_pool *pool, pool_func func, void *arg);
+extern void         pool_destroy         (thread_pool *pool);
+extern int          pool_num_threads     (const thread_pool *pool);
+extern int          pool_default_threads (void);
+
+#endif  /* _THREAD_POOL_H */
@@ -7,6 +7,7 @@
  */
 #include "envtool.h"
 #include "smartlist.h"
+#include "vector.h"
 #include "color.h"
 #include "dirlist.h"
 #include "regex.h"
@@ -35,9 +36,10 @@
 
 /**
  * The list of `CONTROL` and `portfile.cmake` file entries.
- * A smartlist of `struct vcpkg_node`.
+ * A vector of `struct vcpkg_node`. The `vcpkg_package::link` pointers
+ * point into it; nothing is added after `vcpkg_get_list()`.
  */
-static smartlist_t *vcpkg_nodes;
+static vector_t *vcpkg_nodes;
 
 /**
  * A list of installable packages found in `CONTROL` files.
@@ -560,19 +562,17 @@ static void build_vcpkg_nodes (const char *dir)
   snprintf (file, sizeof(file), "%s\\CONTROL", dir);
   if (FILE_EXISTS(file))
   {
-    node = CALLOC (sizeof(*node), 1);
+    node = VECTOR_ADD (vcpkg_nodes, struct vcpkg_node);
     node->have_CONTROL = TRUE;
     CONTROL_parse (node, file);
-    smartlist_add (vcpkg_nodes, node);
   }
 
   snprintf (file, sizeof(file), "%s\\portfile.cmake", dir);
   if (FILE_EXISTS(file))
   {
-    node = CALLOC (sizeof(*node), 1);
+    node = VECTOR_ADD (vcpkg_nodes, struct vcpkg_node);
     _strlcpy (node->package, basename(dir), sizeof(node->package));
     portfile_cmake_parse (node, file);
-    smartlist_add (vcpkg_nodes, node);
   }
 }
 
@@ -663,7 +663,7 @@ static const struct vcpkg_package *get_install_info (int *index_p, const char *p
  */
 static void nodes_debug_dump (void)
 {
-  int i, i_max = smartlist_len (vcpkg_nodes);
+  int i, i_max = vector_len (vcpkg_nodes);
   int j, j_max, num, indent;
   int width = (int) C_screen_width();
 
@@ -682,7 +682,7 @@ static void nodes_debug_dump (void)
 
   for (i = num = 0; i < i_max; i++)
   {
-    const struct vcpkg_node   *node = smartlist_get (vcpkg_nodes, i);
+    const struct vcpkg_node   *node = vector_get (vcpkg_nodes, i);
     const struct vcpkg_depend *dep;
     const char                *feature;
 
@@ -729,7 +729,7 @@ static void nodes_debug_dump (void)
 }
 
 /**
- * Traverse the smartlist `vcpkg_nodes` and
+ * Traverse the vector `vcpkg_nodes` and
  * return the number of nodes where `node->have_CONTROL == have_CONTROL`.
  */
 unsigned vcpkg_get_num (BOOL have_CONTROL)
@@ -737,11 +737,11 @@ unsigned vcpkg_get_num (BOOL have_CONTROL)
   int      i, max;
   unsigned num = 0;
 
-  max = vcpkg_nodes ? smartlist_len (vcpkg_nodes) : 0;
+  max = vcpkg_nodes ? vector_len (vcpkg_nodes) : 0;
 
   for (i = 0; i < max; i++)
   {
-    const struct vcpkg_node *node = smartlist_get (vcpkg_nodes, i);
+    const struct vcpkg_node *node = vector_get (vcpkg_nodes, i);
 
     if (node->have_CONTROL == have_CONTROL)
        num++;
@@ -765,15 +765,35 @@ unsigned vcpkg_get_num_portfile (void)
   return vcpkg_get_num (FALSE);
 }
 
+/**
+ * `smartlist_remove_if()` helper for `build_vcpkg_installed_packages()`.
+ * A directory in `<vcpkg_root>\packages` must be a `"<package>_<platform>"`.
+ */
+static int not_package_dir (const void *dir, void *arg)
+{
+  const char *p = (const char*)dir + *(const size_t*)arg;
+  const char *q;
+
+  ASSERT (*p == '\\');
+  q = strchr (++p, '_');
+  return (!q || q - p >= VCPKG_MAX_NAME);
+}
+
+static void free_dir (void *dir)
+{
+  FREE (dir);
+}
+
 /**
  * Build the list of installed packages; `vcpkg_installed_packages`.
  */
 static void build_vcpkg_installed_packages (void)
 {
   smartlist_t *dirs;
-  char packages_dir [_MAX_PATH];
-  char installed_dir [_MAX_PATH];
-  int  i, max;
+  char         packages_dir [_MAX_PATH];
+  char         installed_dir [_MAX_PATH];
+  size_t       prefix_len;
+  int          i, max;
 
   snprintf (packages_dir, sizeof(packages_dir), "%s\\packages", vcpkg_root);
   snprintf (installed_dir, sizeof(installed_dir), "%s\\installed", vcpkg_root);
@@ -797,6 +817,9 @@ static void build_vcpkg_installed_packages (void)
     return;
   }
 
+  prefix_len = strlen (packages_dir);
+  smartlist_remove_if (dirs, not_package_dir, &prefix_len, free_dir);
+
   ASSERT (vcpkg_installed_packages == NULL);
   vcpkg_installed_packages = smartlist_new();
 
@@ -806,6 +829,7 @@ static void build_vcpkg_installed_packages (void)
   {
     struct vcpkg_package *node;
     char  *p, *q;
+    int    j = 0;
 
     /**
      * If e.g. `dirs` contains "<vcpkg_root>\packages\sqlite3_x86-windows", add a node
@@ -815,23 +839,18 @@ static void build_vcpkg_installed_packages (void)
      *   `node->link`    = a pointer into `vcpkg_nodes` for more detailed info.
      */
     p = smartlist_get (dirs, i);
-    p += strlen (packages_dir);
-    ASSERT (*p == '\\');
-    q = strchr (++p, '_');
-    if (q && q - p < sizeof(node->package))
-    {
-      int j = 0;
-
-      node = CALLOC (sizeof(*node), 1);
-      _strlcpy (node->package, p, q - p + 1);
-      node->platform = make_package_platform (q+1, TRUE);
-      vcpkg_get_control(&j, (const struct vcpkg_node**)&node->link, node->package);
-      smartlist_add (vcpkg_installed_packages, node);
+    p += prefix_len + 1;
+    q = strchr (p, '_');
 
-      DEBUGF (2, "package: '%s', platform: 0x%04X (%s).\n",
-              node->package, node->platform,
-              flags_decode(node->platform, platforms, DIM(platforms)));
-    }
+    node = CALLOC (sizeof(*node), 1);
+    _strlcpy (node->package, p, q - p + 1);
+    node->platform = make_package_platform (q+1, TRUE);
+    vcpkg_get_control(&j, (const struct vcpkg_node**)&node->link, node->package);
+    smartlist_add (vcpkg_installed_packages, node);
+
+    DEBUGF (2, "package: '%s', platform: 0x%04X (%s).\n",
+            node->package, node->platform,
+            flags_decode(node->platform, platforms, DIM(platforms)));
   }
   smartlist_free_all (dirs);
 }
@@ -1002,7 +1021,7 @@ unsigned vcpkg_list_installed (void)
 }
 
 /**
- * Build the smartlist `vcpkg_nodes`.
+ * Build the vector `vcpkg_nodes`.
  *
  * \retval The number of all node types.
  */
@@ -1027,7 +1046,7 @@ unsigned vcpkg_get_list (void)
   ASSERT (vcpkg_nodes == NULL);
   ASSERT (vcpkg_packages == NULL);
 
-  vcpkg_nodes    = smartlist_new();
+  vcpkg_nodes    = vector_new (sizeof(struct vcpkg_node), 0);
   vcpkg_packages = smartlist_new();
 
   dirs = get_dir_list (ports_dir);
@@ -1040,7 +1059,7 @@ unsigned vcpkg_get_list (void)
     smartlist_free_all (dirs);
   }
 
-  len = smartlist_len (vcpkg_nodes);
+  len = vector_len (vcpkg_nodes);
   if (len == 0)
   {
     _strlcpy (last_err_str, "No ~5VCPKG~0 packages found", sizeof(last_err_str));
@@ -1082,18 +1101,17 @@ static void free_nodes (void)
   if (!vcpkg_nodes)
      return;
 
-  max = smartlist_len (vcpkg_nodes);
+  max = vector_len (vcpkg_nodes);
   for (i = 0; i < max; i++)
   {
-    struct vcpkg_node *node = smartlist_get (vcpkg_nodes, i);
+    struct vcpkg_node *node = vector_get (vcpkg_nodes, i);
 
     if (node->deps)
        smartlist_free (node->deps);
     smartlist_free_all (node->features);
     FREE (node->description);
-    FREE (node);
   }
-  smartlist_free (vcpkg_nodes);
+  vector_free (vcpkg_nodes);
   vcpkg_nodes = NULL;
 }
 
@@ -1115,13 +1133,13 @@ void vcpkg_free (void)
  */
 BOOL vcpkg_get_control (int *index_p, const struct vcpkg_node **node_p, const char *package_spec)
 {
-  int i, index, max = vcpkg_nodes ? smartlist_len (vcpkg_nodes) : 0;
+  int i, index, max = vcpkg_nodes ? vector_len (vcpkg_nodes) : 0;
 
   *node_p = NULL;
   index   = *index_p;
   for (i = index; i < max; i++)
   {
-    const struct vcpkg_node *node = smartlist_get (vcpkg_nodes, i);
+    const struct vcpkg_node *node = vector_get (vcpkg_nodes, i);
 
     if (node->have_CONTROL && fnmatch(package_spec, node->package, FNM_FLAG_NOCASE) == FNM_MATCH)
     {
@@ -0,0 +1,439 @@
+/**\file    vector.c
+ * \ingroup Misc
+ * \brief
+ *   Functions for dynamic arrays of elements stored contiguously.
+ *
+ * A `smartlist_t` is an array of pointers; each element is a separate
+ * heap-block. A `vector_t` stores the elements themselves. So adding an
+ * element is no allocation (except when growing) and iterating over the
+ * elements does not chase pointers.
+ *
+ * The first `VECTOR_SMALL_SIZE` bytes of elements are stored inline in
+ * the `vector_t`. A short list (e.g. `%INCLUDE%` with a few directories)
+ * needs no heap allocation at all.
+ *
+ * \note Adding or inserting an element may move all elements. A pointer from
+ *       `vector_get()` or `vector_add()` is only valid until the next
+ *       `vector_add()` or `vector_insert()`.
+ *
+ * Build the benchmark program with `-DVECTOR_TEST`. It checks the functions
+ * and compares the allocations and iteration time with an array of pointers
+ * to separately allocated elements (like a `smartlist_t`). E.g. on Linux:
+ * ```
+ *  gcc -O2 -DVECTOR_TEST -o vector vector.c
+ * ```
+ */
+#include "test_util.h"
+#include "vector.h"
+
+/** \def VECTOR_DEFAULT_CAPACITY
+ *
+ * The capacity of the first heap-block if the growth policy is to double.
+ */
+#define VECTOR_DEFAULT_CAPACITY  16
+
+/** \def VECTOR_DATA
+ *
+ * The start of the elements; in `vector_t::small` or on the heap.
+ */
+#define VECTOR_DATA(v)  ((v)->heap ? (v)->heap : (v)->small.buf)
+
+/**
+ * Allocate and initialise a new vector.
+ *
+ * \param[in] elem_size  the size of each element.
+ * \param[in] grow       the growth policy. 0 doubles the capacity when full.
+ *                       Otherwise add room for `grow` elements.
+ */
+vector_t *vector_new (size_t elem_size, int grow)
+{
+  vector_t *v = MALLOC (sizeof(*v));
+
+  return vector_init (v, elem_size, grow);
+}
+
+/**
+ * Initialise a vector. E.g. a static one.
+ */
+vector_t *vector_init (vector_t *v, size_t elem_size, int grow)
+{
+  ASSERT (elem_size > 0);
+  ASSERT (grow >= 0);
+
+  if (v)
+  {
+    v->heap      = NULL;
+    v->elem_size = elem_size;
+    v->num_used  = 0;
+    v->capacity  = (int) (VECTOR_SMALL_SIZE / elem_size);
+    v->grow      = grow;
+  }
+  return (v);
+}
+
+/**
+ * Release the heap-block of the elements of `v`. Does not release storage
+ * associated with the elements. `v` can be used again.
+ */
+void vector_exit (vector_t *v)
+{
+  if (v)
+  {
+    FREE (v->heap);
+    vector_init (v, v->elem_size, v->grow);
+  }
+}
+
+/**
+ * Deallocate a vector from `vector_new()`.
+ */
+void vector_free (vector_t *v)
+{
+  if (v)
+  {
+    vector_exit (v);
+    FREE (v);
+  }
+}
+
+/**
+ * Return the number of elements in `v`.
+ */
+int vector_len (const vector_t *v)
+{
+  ASSERT (v);
+  return (v->num_used);
+}
+
+/**
+ * Return a pointer to the `idx`-th element of `v`.
+ */
+void *vector_get (const vector_t *v, int idx)
+{
+  ASSERT (v);
+  ASSERT (idx >= 0);
+  ASSERT (idx < v->num_used);
+  return ((char*)VECTOR_DATA(v) + (size_t)idx * v->elem_size);
+}
+
+/**
+ * Make sure that `v` can hold at least `num` elements.
+ * Grows according to the `vector_t::grow` policy.
+ */
+void vector_ensure_capacity (vector_t *v, int num)
+{
+  int higher;
+
+  ASSERT (v);
+  ASSERT (num >= 0);
+
+  if (num <= v->capacity)
+     return;
+
+  higher = v->capacity;
+  if (v->grow == 0)
+  {
+    if (higher < VECTOR_DEFAULT_CAPACITY)
+       higher = VECTOR_DEFAULT_CAPACITY;
+    while (num > higher)
+       higher *= 2;
+  }
+  else
+  {
+    while (num > higher)
+       higher += v->grow;
+  }
+
+  if (v->heap)
+     v->heap = REALLOC (v->heap, v->elem_size * higher);
+  else
+  {
+    v->heap = MALLOC (v->elem_size * higher);
+    memcpy (v->heap, v->small.buf, v->elem_size * v->num_used);
+  }
+  v->capacity = higher;
+}
+
+/**
+ * Append a zero-filled element to the end of `v`.
+ * Return a pointer to it.
+ */
+void *vector_add (vector_t *v)
+{
+  void *elem;
+
+  vector_ensure_capacity (v, v->num_used + 1);
+  elem = VECTOR_DATA (v) + (size_t)v->num_used * v->elem_size;
+  memset (elem, '\0', v->elem_size);
+  v->num_used++;
+  return (elem);
+}
+
+/**
+ * Insert a zero-filled element as the new `idx`-th element of `v`,
+ * moving all elements previously at `idx` or later forward one space.
+ * Return a pointer to it.
+ */
+void *vector_insert (vector_t *v, int idx)
+{
+  char *elem;
+
+  ASSERT (idx >= 0);
+  ASSERT (idx <= v->num_used);
+
+  vector_ensure_capacity (v, v->num_used + 1);
+  elem = VECTOR_DATA (v) + (size_t)idx * v->elem_size;
+  memmove (elem + v->elem_size, elem, (size_t)(v->num_used - idx) * v->elem_size);
+  memset (elem, '\0', v->elem_size);
+  v->num_used++;
+  return (elem);
+}
+
+/**
+ * Remove the `idx`-th element of `v` and move all subsequent elements
+ * back one space.
+ */
+void vector_del_keeporder (vector_t *v, int idx)
+{
+  char *elem;
+
+  ASSERT (idx >= 0);
+  ASSERT (idx < v->num_used);
+
+  elem = vector_get (v, idx);
+  --v->num_used;
+  memmove (elem, elem + v->elem_size, (size_t)(v->num_used - idx) * v->elem_size);
+}
+
+/**
+ * Remove all elements from `v`. Keep the storage for later use.
+ */
+void vector_clear (vector_t *v)
+{
+  ASSERT (v);
+  v->num_used = 0;
+}
+
+/**
+ * Like `vector_clear()`, but call a `free_fn` for all elements first.
+ */
+void vector_wipe (vector_t *v, vector_free_func free_fn)
+{
+  int i;
+
+  ASSERT (v);
+  for (i = 0; i < v->num_used; i++)
+     (*free_fn) (vector_get(v, i));
+  vector_clear (v);
+}
+
+/**
+ * Remove all elements of `v` for which `match` returns non-zero. <br>
+ * If `free_fn` is provided, calls `free_fn` on each removed element first. <br>
+ * Preserves the order. Done in one pass.
+ *
+ * \retval the number of elements removed.
+ */
+int vector_remove_if (vector_t *v, vector_match_func match, void *arg, vector_free_func free_fn)
+{
+  char *data;
+  int   i, j;
+
+  ASSERT (v);
+  data = VECTOR_DATA (v);
+
+  for (i = j = 0; i < v->num_used; i++)
+  {
+    char *elem = data + (size_t)i * v->elem_size;
+
+    if ((*match)(elem, arg))
+    {
+      if (free_fn)
+        (*free_fn) (elem);
+    }
+    else
+    {
+      if (i != j)
+         memcpy (data + (size_t)j * v->elem_size, elem, v->elem_size);
+      j++;
+    }
+  }
+  v->num_used = j;
+  return (i - j);
+}
+
+/** The actual pointer to the user's compare function.
+ *  Used as in `smartlist_sort()`.
+ */
+static vector_sort_func user_compare;
+
+static int MS_CDECL local_compare (const void *a, const void *b)
+{
+  return (*user_compare) (a, b);
+}
+
+/**
+ * Sort the elements of `v` into an order defined by `compare`.
+ * It gets pointers to 2 elements.
+ */
+void vector_sort (vector_t *v, vector_sort_func compare)
+{
+  if (v->num_used > 1)
+  {
+    user_compare = compare;
+    qsort (VECTOR_DATA(v), v->num_used, v->elem_size, local_compare);
+    user_compare = NULL;
+  }
+}
+
+#if defined(VECTOR_TEST)
+
+#define TEST_UTIL_MAIN
+#include "test_util.h"
+
+/**
+ * An element about the size of a `struct directory_array`.
+ */
+struct test_elem {
+       char *dir;
+       char *cyg_dir;
+       int   exist;
+       int   is_native;
+       int   is_dir;
+       int   is_cwd;
+       int   exp_ok;
+       int   num_dup;
+       int   check_empty;
+       int   value;
+     };
+
+static int compare_value (const void *a, const void *b)
+{
+  return ((const struct test_elem*)a)->value - ((const struct test_elem*)b)->value;
+}
+
+static int match_odd (const void *elem, void *arg)
+{
+  (void) arg;
+  return (((const struct test_elem*)elem)->value & 1);
+}
+
+static int check_functions (void)
+{
+  vector_t v;
+  int      i, errors = 0;
+
+  vector_init (&v, sizeof(struct test_elem), 0);
+  for (i = 0; i < 100; i++)
+  {
+    VECTOR_ADD (&v, struct test_elem)->value = 99 - i;
+    if (i == 0 && v.heap)
+    {
+      puts ("The first element is not inline.");
+      errors++;
+    }
+  }
+
+  vector_sort (&v, compare_value);
+  for (i = 0; i < 100; i++)
+      if (VECTOR_GET(&v, struct test_elem, i)->value != i)
+         errors++;
+
+  ((struct test_elem*)vector_insert(&v, 10))->value = 1000;
+  if (vector_len(&v) != 101 || VECTOR_GET(&v, struct test_elem, 10)->value != 1000 ||
+      VECTOR_GET(&v, struct test_elem, 11)->value != 10)
+  {
+    puts ("vector_insert() failed.");
+    errors++;
+  }
+
+  vector_del_keeporder (&v, 10);
+  if (vector_remove_if(&v, match_odd, NULL, NULL) != 50 || vector_len(&v) != 50)
+  {
+    puts ("vector_remove_if() failed.");
+    errors++;
+  }
+  for (i = 0; i < vector_len(&v); i++)
+      if (VECTOR_GET(&v, struct test_elem, i)->value != 2*i)
+         errors++;
+
+  vector_exit (&v);
+  if (v.heap || v.num_used)
+  {
+    puts ("vector_exit() failed.");
+    errors++;
+  }
+  return (errors);
+}
+
+int main (int argc, char **argv)
+{
+  struct test_elem **list = NULL;
+  vector_t          *v;
+  double             t0, t_list_add, t_list_iter, t_vec_add, t_vec_iter;
+  long               sum_list = 0, sum_vec = 0;
+  int                i, j, capacity = 0, loops = 100;
+  int                list_allocs = 0, vec_allocs = 0, errors;
+  int                max = (argc > 1) ? atoi (argv[1]) : 100000;
+
+  errors = check_functions();
+
+  /* An array of pointers; a `smartlist_t` in all but name.
+   */
+  t0 = get_time();
+  for (i = 0; i < max; i++)
+  {
+    if (i == capacity)
+    {
+      capacity = capacity ? 2*capacity : 16;
+      list = realloc (list, capacity * sizeof(*list));
+      list_allocs++;
+    }
+    list[i] = calloc (1, sizeof(**list));
+    list[i]->value = i;
+    list_allocs++;
+  }
+  t_list_add = get_time() - t0;
+
+  t0 = get_time();
+  for (j = 0; j < loops; j++)
+      for (i = 0; i < max; i++)
+          sum_list += list[i]->value;
+  t_list_iter = get_time() - t0;
+
+  t0 = get_time();
+  v = vector_new (sizeof(struct test_elem), 0);
+  vec_allocs++;
+  for (i = 0; i < max; i++)
+  {
+    int old_capacity = v->capacity;
+
+    VECTOR_ADD (v, struct test_elem)->value = i;
+    if (v->capacity != old_capacity)
+       vec_allocs++;
+  }
+  t_vec_add = get_time() - t0;
+
+  t0 = get_time();
+  for (j = 0; j < loops; j++)
+      for (i = 0; i < max; i++)
+          sum_vec += VECTOR_GET(v, struct test_elem, i)->value;
+  t_vec_iter = get_time() - t0;
+
+  if (sum_list != sum_vec)
+     errors++;
+
+  printf ("%d elements of %u bytes:\n", max, (unsigned)sizeof(struct test_elem));
+  printf ("  array of pointers: %7d allocations, add: %.3f sec, %d iterations: %.3f sec\n",
+          list_allocs, t_list_add, loops, t_list_iter);
+  printf ("  vector:            %7d allocations, add: %.3f sec, %d iterations: %.3f sec\n",
+          vec_allocs, t_vec_add, loops, t_vec_iter);
+  printf ("%d errors.\n", errors);
+
+  for (i = 0; i < max; i++)
+      free (list[i]);
+  free (list);
+  vector_free (v);
+  return (errors ? 1 : 0);
+}
+#endif  /* VECTOR_TEST */
@@ -0,0 +1,65 @@
+/** \file vector.h
+ *  \ingroup Misc
+ */
+#ifndef _VECTOR_H
+#define _VECTOR_H
+
+/** \def VECTOR_SMALL_SIZE
+ *
+ * The number of bytes stored inline in a `vector_t`. A vector with
+ * elements fitting in this needs no heap allocation.
+ */
+#define VECTOR_SMALL_SIZE  256
+
+/**
+ * A resizeable array of elements of the same size. Unlike a `smartlist_t`,
+ * the elements are stored in the array; not as pointers to elements.
+ *
+ * The members are exposed only so a vector can be declared statically or
+ * as part of another struct. All access should go through the functions
+ * and macros below.
+ */
+typedef struct vector_t {
+        char  *heap;         /**< The elements if not in `small`. Otherwise NULL */
+        size_t elem_size;    /**< The size of each element */
+        int    num_used;     /**< The number of elements used */
+        int    capacity;     /**< The number of elements there is room for */
+        int    grow;         /**< The growth policy; 0 doubles the capacity, otherwise adds `grow` elements */
+        union {
+          char   buf [VECTOR_SMALL_SIZE];
+          double align_double;
+          void  *align_ptr;
+        } small;             /**< Inline storage for the first elements */
+      } vector_t;
+
+typedef int  (*vector_sort_func) (const void *a, const void *b);
+typedef int  (*vector_match_func) (const void *elem, void *arg);
+typedef void (*vector_free_func) (void *elem);
+
+/** \def VECTOR_GET
+ * Get a pointer to element `idx` of type `type`.
+ */
+#define VECTOR_GET(v, type, idx)  ((type*) vector_get (v, idx))
+
+/** \def VECTOR_ADD
+ * Add an element of type `type` and return a pointer to it.
+ */
+#define VECTOR_ADD(v, type)       ((type*) vector_add (v))
+
+vector_t *vector_new  (size_t elem_size, int grow);
+vector_t *vector_init (vector_t *v, size_t elem_size, int grow);
+
+void  vector_free (vector_t *v);
+void  vector_exit (vector_t *v);
+int   vector_len (const vector_t *v);
+void *vector_get (const vector_t *v, int idx);
+void  vector_ensure_capacity (vector_t *v, int num);
+void *vector_add (vector_t *v);
+void *vector_insert (vector_t *v, int idx);
+void  vector_del_keeporder (vector_t *v, int idx);
+void  vector_clear (vector_t *v);
+void  vector_wipe (vector_t *v, vector_free_func free_fn);
+int   vector_remove_if (vector_t *v, vector_match_func match, void *arg, vector_free_func free_fn);
+void  vector_sort (vector_t *v, vector_sort_func compare);
+
+#endif  /* _VECTOR_H */
@@ -0,0 +1,557 @@
+/**\file    watch.c
+ * \ingroup Misc
+ * \brief
+ *   Change-notifications for a set of directories.
+ *
+ * Used by `envtool --watch` to learn which files were added to or
+ * removed from the directories in e.g. `%PATH%`. Only the changed
+ * names are reported, so nothing needs to be re-scanned. Sub-directories
+ * are not watched.
+ *
+ * A directory that can no longer be watched (e.g. an installer deleted or
+ * renamed it) gets a `WATCH_STOPPED` event. The others are still watched.
+ *
+ * On Windows, each directory is opened for overlapped `ReadDirectoryChangesW()`
+ * and all are bound to one I/O completion-port. Hence there is no limit
+ * on the number of directories (as with `WaitForMultipleObjects()`).
+ *
+ * With `-DWATCH_INOTIFY`, a Linux backend using `inotify` is used instead.
+ * This is mainly to be able to test the same event-handling on other systems.
+ *
+ * Build the test program with `-DWATCH_TEST`. E.g. on Linux:
+ * ```
+ *  gcc -O2 -DWATCH_INOTIFY -DWATCH_TEST -o watch watch.c
+ * ```
+ */
+#include "test_util.h"
+#include "watch.h"
+
+#if defined(WATCH_INOTIFY)
+  #include <errno.h>
+  #include <poll.h>
+  #include <unistd.h>
+  #include <sys/inotify.h>
+#endif
+
+/**
+ * The size of the buffer for the change-records of one directory.
+ * Must be DWORD-aligned for `ReadDirectoryChangesW()`.
+ */
+#define WATCH_BUF_SIZE  (16*1024)
+
+#if defined(WATCH_INOTIFY)
+
+struct watch_dir {
+       char *dir;
+       int   wd;           /**< The inotify watch-descriptor */
+     };
+
+struct dir_watch {
+       int               fd;
+       struct watch_dir *dirs;
+       int               num_dirs;
+     };
+
+dir_watch *watch_new (void)
+{
+  struct dir_watch *w = CALLOC (1, sizeof(*w));
+
+  w->fd = inotify_init();
+  if (w->fd < 0)
+  {
+    FREE (w);
+    return (NULL);
+  }
+  return (w);
+}
+
+/**
+ * Add a directory to the watch-set.
+ *
+ * \retval the index of `dir` passed in `watch_event::dir`.
+ * \retval -1 on error.
+ */
+int watch_add (dir_watch *w, const char *dir)
+{
+  int wd = inotify_add_watch (w->fd, dir, IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                          IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB |
+                                          IN_MOVE_SELF | IN_ONLYDIR);
+  if (wd < 0)
+  {
+    DEBUGF (1, "inotify_add_watch (\"%s\") failed: %s.\n", dir, strerror(errno));
+    return (-1);
+  }
+  w->dirs = REALLOC (w->dirs, (w->num_dirs + 1) * sizeof(*w->dirs));
+  w->dirs [w->num_dirs].dir = STRDUP (dir);
+  w->dirs [w->num_dirs].wd  = wd;
+  return (w->num_dirs++);
+}
+
+static int watch_lookup (const dir_watch *w, int wd)
+{
+  int i;
+
+  for (i = 0; i < w->num_dirs; i++)
+      if (w->dirs[i].wd == wd)
+         return (i);
+  return (-1);
+}
+
+/**
+ * Wait up to `timeout_ms` for changes. Call `func` for each change.
+ *
+ * \retval The number of events. 0 on timeout and -1 if the whole watch-set failed.
+ */
+int watch_wait (dir_watch *w, int timeout_ms, watch_func func, void *arg)
+{
+  struct pollfd pfd;
+  char   buf [WATCH_BUF_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+  int    num = 0;
+
+  pfd.fd     = w->fd;
+  pfd.events = POLLIN;
+
+  while (poll(&pfd, 1, num == 0 ? timeout_ms : 0) > 0)
+  {
+    ssize_t len = read (w->fd, buf, sizeof(buf));
+    char   *p;
+
+    if (len <= 0)
+       return (num > 0 ? num : -1);
+
+    for (p = buf; p < buf + len; )
+    {
+      const struct inotify_event *ie = (const struct inotify_event*) p;
+      struct watch_event ev;
+
+      p += sizeof(*ie) + ie->len;
+
+      if (ie->mask & IN_Q_OVERFLOW)
+      {
+        int i;
+
+        ev.action = WATCH_OVERFLOW;
+        ev.name   = NULL;
+        for (i = 0; i < w->num_dirs; i++)
+        {
+          ev.dir = i;
+          (*func) (&ev, arg);
+        }
+        num++;
+        continue;
+      }
+
+      ev.dir = watch_lookup (w, ie->wd);
+      if (ev.dir < 0)
+         continue;
+
+      /* A deleted directory gets `IN_IGNORED`. A renamed one gets it when
+       * the watch is removed here.
+       */
+      if (ie->mask & IN_MOVE_SELF)
+      {
+        inotify_rm_watch (w->fd, ie->wd);
+        continue;
+      }
+      if (ie->mask & IN_IGNORED)
+      {
+        w->dirs [ev.dir].wd = -1;
+        ev.action = WATCH_STOPPED;
+        ev.name   = NULL;
+        (*func) (&ev, arg);
+        num++;
+        continue;
+      }
+      if (ie->len == 0)
+         continue;
+
+      if (ie->mask & (IN_CREATE | IN_MOVED_TO))
+         ev.action = WATCH_ADDED;
+      else if (ie->mask & (IN_DELETE | IN_MOVED_FROM))
+         ev.action = WATCH_REMOVED;
+      else
+         ev.action = WATCH_MODIFIED;
+      ev.name = ie->name;
+      (*func) (&ev, arg);
+      num++;
+    }
+  }
+  return (num);
+}
+
+void watch_free (dir_watch *w)
+{
+  int i;
+
+  if (!w)
+     return;
+  for (i = 0; i < w->num_dirs; i++)
+      FREE (w->dirs[i].dir);
+  FREE (w->dirs);
+  close (w->fd);
+  FREE (w);
+}
+
+#else   /* WATCH_INOTIFY */
+
+struct watch_dir {
+       char      *dir;
+       HANDLE     hnd;
+       OVERLAPPED ov;
+       DWORD      buf [WATCH_BUF_SIZE / sizeof(DWORD)];
+     };
+
+struct dir_watch {
+       HANDLE             port;       /**< The I/O completion-port */
+       struct watch_dir **dirs;
+       int                num_dirs;
+     };
+
+#define WATCH_FILTER (FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | \
+                      FILE_NOTIFY_CHANGE_SIZE      | FILE_NOTIFY_CHANGE_LAST_WRITE | \
+                      FILE_NOTIFY_CHANGE_ATTRIBUTES)
+
+static BOOL watch_read (struct watch_dir *wd)
+{
+  memset (&wd->ov, '\0', sizeof(wd->ov));
+  if (!ReadDirectoryChangesW(wd->hnd, wd->buf, sizeof(wd->buf), FALSE, WATCH_FILTER,
+                             NULL, &wd->ov, NULL))
+  {
+    DEBUGF (1, "ReadDirectoryChangesW (\"%s\") failed: %s.\n", wd->dir, win_strerror(GetLastError()));
+    return (FALSE);
+  }
+  return (TRUE);
+}
+
+dir_watch *watch_new (void)
+{
+  struct dir_watch *w = CALLOC (1, sizeof(*w));
+
+  w->port = CreateIoCompletionPort (INVALID_HANDLE_VALUE, NULL, 0, 1);
+  if (!w->port)
+  {
+    FREE (w);
+    return (NULL);
+  }
+  return (w);
+}
+
+/**
+ * Add a directory to the watch-set.
+ *
+ * \retval the index of `dir` passed in `watch_event::dir`.
+ * \retval -1 on error.
+ */
+int watch_add (dir_watch *w, const char *dir)
+{
+  struct watch_dir *wd = CALLOC (1, sizeof(*wd));
+
+  wd->hnd = CreateFile (dir, FILE_LIST_DIRECTORY,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+  if (wd->hnd == INVALID_HANDLE_VALUE)
+  {
+    DEBUGF (1, "CreateFile (\"%s\") failed: %s.\n", dir, win_strerror(GetLastError()));
+    FREE (wd);
+    return (-1);
+  }
+
+  wd->dir = STRDUP (dir);
+  if (!CreateIoCompletionPort(wd->hnd, w->port, (ULONG_PTR)w->num_dirs, 0) || !watch_read(wd))
+  {
+    CloseHandle (wd->hnd);
+    FREE (wd->dir);
+    FREE (wd);
+    return (-1);
+  }
+  w->dirs = REALLOC (w->dirs, (w->num_dirs + 1) * sizeof(*w->dirs));
+  w->dirs [w->num_dirs] = wd;
+  return (w->num_dirs++);
+}
+
+/**
+ * Call `func` for each record in the completed buffer of `wd`.
+ */
+static int watch_parse (const struct watch_dir *wd, int idx, DWORD size, watch_func func, void *arg)
+{
+  const BYTE *p = (const BYTE*) wd->buf;
+  int         num = 0;
+
+  while (size > 0)
+  {
+    const FILE_NOTIFY_INFORMATION *fni = (const FILE_NOTIFY_INFORMATION*) p;
+    struct watch_event ev;
+    char   name [_MAX_PATH];
+    int    len = WideCharToMultiByte (CP_ACP, 0, fni->FileName, fni->FileNameLength / sizeof(WCHAR),
+                                      name, sizeof(name)-1, NULL, NULL);
+
+    if (len > 0)
+    {
+      name[len] = '\0';
+      if (fni->Action == FILE_ACTION_ADDED || fni->Action == FILE_ACTION_RENAMED_NEW_NAME)
+         ev.action = WATCH_ADDED;
+      else if (fni->Action == FILE_ACTION_REMOVED || fni->Action == FILE_ACTION_RENAMED_OLD_NAME)
+         ev.action = WATCH_REMOVED;
+      else
+         ev.action = WATCH_MODIFIED;
+      ev.dir  = idx;
+      ev.name = name;
+      (*func) (&ev, arg);
+      num++;
+    }
+    if (fni->NextEntryOffset == 0)
+       break;
+    p += fni->NextEntryOffset;
+  }
+  return (num);
+}
+
+/**
+ * Stop watching the directory `idx` after it failed and report it.
+ */
+static void watch_stop (dir_watch *w, int idx, watch_func func, void *arg)
+{
+  struct watch_dir  *wd = w->dirs [idx];
+  struct watch_event ev;
+
+  DEBUGF (1, "Cannot watch \"%s\" any more.\n", wd->dir);
+  CloseHandle (wd->hnd);
+  wd->hnd = INVALID_HANDLE_VALUE;
+
+  ev.dir    = idx;
+  ev.action = WATCH_STOPPED;
+  ev.name   = NULL;
+  (*func) (&ev, arg);
+}
+
+/**
+ * Wait up to `timeout_ms` for changes. Call `func` for each change.
+ * When the first directory has changed, all other pending changes are
+ * handled too.
+ *
+ * A failed completion (e.g. the directory was deleted or a share dropped)
+ * stops the watch of that directory only.
+ *
+ * \retval The number of events. 0 on timeout and -1 if the whole watch-set failed.
+ */
+int watch_wait (dir_watch *w, int timeout_ms, watch_func func, void *arg)
+{
+  int num = 0;
+
+  while (1)
+  {
+    struct watch_dir *wd;
+    OVERLAPPED       *ov;
+    ULONG_PTR         key;
+    DWORD             size;
+    int               idx;
+
+    if (!GetQueuedCompletionStatus(w->port, &size, &key, &ov, num == 0 ? (DWORD)timeout_ms : 0))
+    {
+      DWORD err = GetLastError();
+
+      if (!ov)
+      {
+        if (err == WAIT_TIMEOUT)
+           break;
+        DEBUGF (1, "GetQueuedCompletionStatus() failed: %s.\n", win_strerror(err));
+        return (num > 0 ? num : -1);
+      }
+      DEBUGF (1, "Watching \"%s\" failed: %s.\n", w->dirs[key]->dir, win_strerror(err));
+      watch_stop (w, (int)key, func, arg);
+      num++;
+      continue;
+    }
+
+    idx = (int) key;
+    wd  = w->dirs [idx];
+    if (size == 0)   /* the buffer overflowed */
+    {
+      struct watch_event ev;
+
+      ev.dir    = idx;
+      ev.action = WATCH_OVERFLOW;
+      ev.name   = NULL;
+      (*func) (&ev, arg);
+      num++;
+    }
+    else
+      num += watch_parse (wd, idx, size, func, arg);
+
+    if (!watch_read(wd))
+    {
+      watch_stop (w, idx, func, arg);
+      num++;
+    }
+  }
+  return (num);
+}
+
+void watch_free (dir_watch *w)
+{
+  int i;
+
+  if (!w)
+     return;
+
+  for (i = 0; i < w->num_dirs; i++)
+  {
+    struct watch_dir *wd = w->dirs[i];
+
+    if (wd->hnd == INVALID_HANDLE_VALUE)   /* stopped by watch_stop() */
+       continue;
+    CancelIo (wd->hnd);
+    CloseHandle (wd->hnd);
+  }
+
+  /* Drain the cancelled requests before the buffers are freed.
+   */
+  for (i = 0; i < w->num_dirs; i++)
+  {
+    OVERLAPPED *ov;
+    ULONG_PTR   key;
+    DWORD       size;
+
+    if (!GetQueuedCompletionStatus(w->port, &size, &key, &ov, 100) && !ov)
+       break;
+  }
+
+  for (i = 0; i < w->num_dirs; i++)
+  {
+    FREE (w->dirs[i]->dir);
+    FREE (w->dirs[i]);
+  }
+  FREE (w->dirs);
+  CloseHandle (w->port);
+  FREE (w);
+}
+#endif  /* WATCH_INOTIFY */
+
+#if defined(WATCH_TEST)
+
+#define TEST_UTIL_MAIN
+#include "test_util.h"
+
+#if defined(WATCH_INOTIFY)
+  #define DIR_SEP '/'
+
+  static char *make_temp_dir (void)
+  {
+    char tmpl[] = "/tmp/watch-XXXXXX";
+
+    return (mkdtemp(tmpl) ? STRDUP(tmpl) : NULL);
+  }
+  #define remove_dir(d)  rmdir (d)
+#else
+  static char *make_temp_dir (void)
+  {
+    static int num = 0;
+    char dir [_MAX_PATH];
+
+    GetTempPath (sizeof(dir), dir);
+    snprintf (dir + strlen(dir), sizeof(dir) - strlen(dir), "watch-%lu-%d", GetCurrentProcessId(), num++);
+    return (CreateDirectory(dir, NULL) ? STRDUP(dir) : NULL);
+  }
+  #define remove_dir(d)  RemoveDirectory (d)
+#endif
+
+static const char *action_name (WatchAction action)
+{
+  return (action == WATCH_ADDED    ? "added"    :
+          action == WATCH_REMOVED  ? "removed"  :
+          action == WATCH_MODIFIED ? "modified" :
+          action == WATCH_STOPPED  ? "stopped"  : "overflow");
+}
+
+static int num_added, num_removed, num_stopped;
+
+static void print_event (const struct watch_event *ev, void *arg)
+{
+  printf ("  dir %d: %-8s %s\n", ev->dir, action_name(ev->action), ev->name ? ev->name : "");
+  if (ev->action == WATCH_ADDED)
+     num_added++;
+  else if (ev->action == WATCH_REMOVED)
+     num_removed++;
+  else if (ev->action == WATCH_STOPPED)
+     num_stopped++;
+  (void) arg;
+}
+
+static void make_file (const char *dir, const char *name)
+{
+  char  path [1000];
+  FILE *f;
+
+  snprintf (path, sizeof(path), "%s%c%s", dir, DIR_SEP, name);
+  f = fopen (path, "w");
+  if (f)
+  {
+    fputs ("hello\n", f);
+    fclose (f);
+  }
+}
+
+static void delete_file (const char *dir, const char *name)
+{
+  char path [1000];
+
+  snprintf (path, sizeof(path), "%s%c%s", dir, DIR_SEP, name);
+  remove (path);
+}
+
+int main (void)
+{
+  dir_watch *w = watch_new();
+  char      *dir = make_temp_dir();
+  char      *gone = make_temp_dir();
+  int        num, idx, ok;
+  double     start;
+
+  if (!w || !dir || !gone)
+  {
+    printf ("Failed to create a watch or a temp-dir.\n");
+    return (1);
+  }
+
+  idx = watch_add (w, dir);
+  printf ("Watching %s (dir %d).\n", dir, idx);
+  idx = watch_add (w, gone);
+  printf ("Watching %s (dir %d).\n", gone, idx);
+
+  make_file (dir, "foo.dll");
+  make_file (dir, "bar.exe");
+  delete_file (dir, "foo.dll");
+
+  num = watch_wait (w, 1000, print_event, NULL);
+  printf ("%d events.\n", num);
+
+  start = get_time();
+  num = watch_wait (w, 100, print_event, NULL);
+  printf ("%d events after a timeout of %.0f msec.\n", num, 1E3 * (get_time() - start));
+
+  delete_file (dir, "bar.exe");
+  num = watch_wait (w, 1000, print_event, NULL);
+  printf ("%d events.\n", num);
+
+  /* A deleted directory must not stop the watch of the others.
+   */
+  remove_dir (gone);
+  num = watch_wait (w, 1000, print_event, NULL);
+  printf ("%d events after deleting dir %d.\n", num, idx);
+
+  make_file (dir, "baz.exe");
+  num = watch_wait (w, 1000, print_event, NULL);
+  printf ("%d events.\n", num);
+  delete_file (dir, "baz.exe");
+
+  watch_free (w);
+  remove_dir (dir);
+  FREE (dir);
+  FREE (gone);
+
+  ok = (num_added == 3 && num_removed == 2 && num_stopped == 1);
+  printf ("added: %d, removed: %d, stopped: %d; %s\n", num_added, num_removed, num_stopped,
+          ok ? "OK" : "FAILED");
+  return (ok ? 0 : 1);
+}
+#endif  /* WATCH_TEST */
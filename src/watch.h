@@ -0,0 +1,40 @@
+/** \file watch.h
+ *  \ingroup Misc
+ */
+#ifndef _WATCH_H
+#define _WATCH_H
+
+/**
+ * What happened to a file in a watched directory.
+ */
+typedef enum WatchAction {
+        WATCH_ADDED,      /**< Created or renamed to this name */
+        WATCH_REMOVED,    /**< Deleted or renamed from this name */
+        WATCH_MODIFIED,   /**< Written to or attributes changed */
+        WATCH_OVERFLOW,   /**< Events were lost; the directory must be re-scanned */
+        WATCH_STOPPED     /**< The directory can no longer be watched (deleted, renamed or
+                           *   the share is gone). No more events come for it */
+      } WatchAction;
+
+/**
+ * An event passed to the `watch_func` callback.
+ */
+struct watch_event {
+       int          dir;      /**< The index returned from `watch_add()` */
+       WatchAction  action;
+       const char  *name;     /**< The file-name in the directory. NULL for `WATCH_OVERFLOW` and `WATCH_STOPPED` */
+     };
+
+typedef void (*watch_func) (const struct watch_event *ev, void *arg);
+
+/**
+ * A set of watched directories. Opaque to the user.
+ */
+typedef struct dir_watch dir_watch;
+
+extern dir_watch *watch_new  (void);
+extern int        watch_add  (dir_watch *w, const char *dir);
+extern int        watch_wait (dir_watch *w, int timeout_ms, watch_func func, void *arg);
+extern void       watch_free (dir_watch *w);
+
+#endif  /* _WATCH_H */
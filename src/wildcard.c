@@ -0,0 +1,991 @@
+/**\file    wildcard.c
+ * \ingroup Misc
+ * \brief
+ *   Wildcard matching of file-names and other strings.
+ *
+ * `fnmatch()` is taken from djgpp and modified. It interprets the pattern
+ * for each string to test.
+ *
+ * For a pattern that is tested against many strings, `fnmatch_compile()`
+ * classifies it once:
+ *  + `"foo"`     -> an exact match.
+ *  + `"foo*"`    -> a prefix match.
+ *  + `"*foo"`    -> a suffix match. This includes the common `"*.ext"`.
+ *  + `"*foo*"`   -> a sub-string match.
+ *  + `"foo*bar"` -> a prefix and suffix match. E.g. `"lib*.dll"`.
+ *  + `"*"`       -> matches all.
+ *  + the rest    -> a general glob; `fnmatch_exec()` calls `fnmatch()`.
+ *
+ * The literal parts are case-folded (if `FNM_FLAG_NOCASE`) and slash-folded
+ * at compile-time. `fnmatch_exec()` gives the same result as `fnmatch()`
+ * with the same pattern and flags.
+ *
+ * Many patterns can be matched against a string in one go with a
+ * `fnmatch_set`. Only the patterns that could match are tested.
+ *
+ * Build the benchmark program with `-DWILDCARD_TEST`. It also checks
+ * `fnmatch()` against the old recursive version and times a pathological
+ * pattern. E.g. on Linux:
+ * ```
+ *  gcc -O2 -DWILDCARD_TEST -o wildcard wildcard.c
+ * ```
+ */
+#include "test_util.h"
+#include "wildcard.h"
+
+/**
+ * The classes of a compiled pattern.
+ */
+enum fnmatch_kind {
+     FNM_KIND_EXACT,
+     FNM_KIND_PREFIX,
+     FNM_KIND_SUFFIX,
+     FNM_KIND_SUBSTR,
+     FNM_KIND_AFFIX,
+     FNM_KIND_ALL,
+     FNM_KIND_GLOB
+   };
+
+/**
+ * A compiled pattern.
+ */
+struct fnmatch_spec {
+       enum fnmatch_kind kind;
+       int               flags;
+       char             *pattern;   /**< A copy of the pattern; used for `FNM_KIND_GLOB` */
+       char             *literal;   /**< The folded literal part */
+       size_t            lit_len;
+       size_t            pre_len;   /**< For `FNM_KIND_AFFIX`; the length of the prefix in `literal` */
+     };
+
+/**
+ * Tables to fold a character the same way `fnmatch()` compares a literal
+ * character. I.e. all slashes are equal and possibly case-insensitive.
+ * `fold_tab[0]` is for case-sensitive and `fold_tab[1]` for `FNM_FLAG_NOCASE`.
+ */
+static unsigned char fold_tab [2][256];
+static int           fold_tab_done = 0;
+
+#define FOLD(c, flags)  fold_tab [((flags) & FNM_FLAG_NOCASE) ? 1 : 0] [(unsigned char)(c)]
+
+/**
+ * Find the first slash in a file-name.
+ * \param[in] s the file-name to search in.
+ */
+static const char *find_slash (const char *s)
+{
+  while (*s)
+  {
+    if (IS_SLASH(*s))
+       return (s);
+    s++;
+  }
+  return (NULL);
+}
+
+static const char *range_match (const char *pattern, char test, int nocase)
+{
+  char c, c2;
+  int  negate, ok;
+
+  negate = (*pattern == '!');
+  if (negate)
+     ++pattern;
+
+  for (ok = 0; (c = *pattern++) != ']'; )
+  {
+    if (c == 0)
+       return (0);    /* illegal pattern */
+
+    if (*pattern == '-' && (c2 = pattern[1]) != 0 && c2 != ']')
+    {
+      if (c <= test && test <= c2)
+         ok = 1;
+      if (nocase &&
+          TOUPPER(c)    <= TOUPPER(test) &&
+          TOUPPER(test) <= TOUPPER(c2))
+         ok = 1;
+      pattern += 2;
+    }
+    else if (c == test)
+      ok = 1;
+    else if (nocase && (TOUPPER(c) == TOUPPER(test)))
+      ok = 1;
+  }
+  return (ok == negate ? NULL : pattern);
+}
+
+/**
+ * File-name match.
+ * Match a `string` against a `pattern` for a match.
+ *
+ * This is iterative. On a mismatch, it backtracks to the last `'*'` only
+ * and lets that consume one more character. An earlier `'*'` need never
+ * be retried; whatever it could match, the last `'*'` can match too.
+ * And with `FNM_FLAG_PATHNAME`, no `'*'` can consume a slash. Hence the
+ * worst case is `O(strlen(pattern) * strlen(string))`. The old recursive
+ * version was exponential in the number of `'*'` for a pattern like
+ * `"*a*a*a*a*b"`.
+ */
+int fnmatch (const char *pattern, const char *string, int flags)
+{
+  const char *star_pattern = NULL;  /* the pattern after the last '*' */
+  const char *star_string  = NULL;  /* where that '*' match was last tried */
+  char  c, test;
+
+  while (1)
+  {
+    c = *pattern++;
+
+    switch (c)
+    {
+      case 0:
+           if (*string == 0)
+              return (FNM_MATCH);
+           goto backtrack;
+
+      case '?':
+           test = *string++;
+           if (test == 0 || (IS_SLASH(test) && (flags & FNM_FLAG_PATHNAME)))
+              goto backtrack;
+           break;
+
+      case '*':
+           c = *pattern;
+           /* collapse multiple stars */
+           while (c == '*')
+               c = *(++pattern);
+
+           /* optimize for pattern with '*' at end */
+           if (c == 0)
+           {
+             if (flags & FNM_FLAG_PATHNAME)
+                return (find_slash(string) ? FNM_NOMATCH : FNM_MATCH);
+             return (FNM_MATCH);
+           }
+
+           /* Let this '*' match nothing for now
+            */
+           star_pattern = pattern;
+           star_string  = string;
+           break;
+
+      case '[':
+           test = *string++;
+           if (!test || (IS_SLASH(test) && (flags & FNM_FLAG_PATHNAME)))
+              goto backtrack;
+           pattern = range_match (pattern, test, flags & FNM_FLAG_NOCASE);
+           if (!pattern)
+              goto backtrack;
+           break;
+
+      case '\\':
+           if (!(flags & FNM_FLAG_NOESCAPE) && pattern[0] && pattern[1] && strchr("*?[\\", pattern[1]))
+           {
+             c = *pattern++;
+             if (c != *string++)
+                goto backtrack;
+             break;
+           }
+           /* FALLTHROUGH */
+
+      default:
+           if (IS_SLASH(c) && IS_SLASH(*string))
+           {
+             string++;
+             break;
+           }
+           if (flags & FNM_FLAG_NOCASE)
+           {
+             if (TOUPPER(c) != TOUPPER(*string++))
+                goto backtrack;
+           }
+           else
+           {
+             if (c != *string++)
+                goto backtrack;
+           }
+           break;
+    } /* switch (c) */
+    continue;
+
+backtrack:
+    /* Let the last '*' consume one more character. It cannot
+     * consume the end of `string` or a slash with `FNM_FLAG_PATHNAME`.
+     */
+    if (!star_pattern)
+       return (FNM_NOMATCH);
+
+    test = *star_string;
+    if (test == 0 || (IS_SLASH(test) && (flags & FNM_FLAG_PATHNAME)))
+       return (FNM_NOMATCH);
+
+    pattern = star_pattern;
+    string  = ++star_string;
+  }   /* while (1) */
+}
+
+char *fnmatch_res (int rc)
+{
+  return (rc == FNM_MATCH   ? "FNM_MATCH"   :
+          rc == FNM_NOMATCH ? "FNM_NOMATCH" : "??");
+}
+
+static void init_fold_tab (void)
+{
+  int c;
+
+  for (c = 0; c < 256; c++)
+  {
+    fold_tab [0][c] = (unsigned char) c;
+    fold_tab [1][c] = (unsigned char) TOUPPER (c);
+  }
+  fold_tab [0]['/'] = fold_tab [1]['/'] = '\\';
+  fold_tab_done = 1;
+}
+
+/**
+ * Compare `len` characters of `str` against the folded literal `lit`.
+ * Stops at the end of `str` (since `lit` has no 0-characters).
+ */
+static int lit_equal (const char *lit, const char *str, size_t len, int flags)
+{
+  const unsigned char *tab = fold_tab [(flags & FNM_FLAG_NOCASE) ? 1 : 0];
+  size_t i;
+
+  for (i = 0; i < len; i++)
+      if ((unsigned char)lit[i] != tab[(unsigned char)str[i]])
+         return (0);
+  return (1);
+}
+
+/**
+ * Return 1 if the first `len` characters in `str` has no slash.
+ */
+static int no_slash_n (const char *str, size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++)
+      if (IS_SLASH(str[i]))
+         return (0);
+  return (1);
+}
+
+/**
+ * Compile a `fnmatch()` pattern for repeated use with `fnmatch_exec()`.
+ *
+ * \param[in] pattern  the wildcard pattern.
+ * \param[in] flags    the `FNM_FLAG_x` flags as for `fnmatch()`.
+ */
+fnmatch_spec *fnmatch_compile (const char *pattern, int flags)
+{
+  fnmatch_spec *spec = CALLOC (sizeof(*spec), 1);
+  const char   *start = pattern;
+  const char   *end   = pattern + strlen (pattern);
+  const char   *p, *star = NULL;
+  int           lead_star = 0, trail_star = 0;
+  size_t        i;
+
+  if (!fold_tab_done)
+     init_fold_tab();
+
+  spec->pattern = STRDUP (pattern);
+  spec->flags   = flags;
+  spec->kind    = FNM_KIND_GLOB;
+
+  while (*start == '*')
+  {
+    start++;
+    lead_star = 1;
+  }
+  if (lead_star && start == end)
+  {
+    spec->kind = FNM_KIND_ALL;
+    return (spec);
+  }
+  while (end > start && end[-1] == '*')
+  {
+    end--;
+    trail_star = 1;
+  }
+
+  /* Anything else than a plain literal between the stars is a general glob.
+   * Except for one star inside a pattern without leading and trailing stars.
+   */
+  for (p = start; p < end; p++)
+  {
+    if (*p == '*' && !star && !lead_star && !trail_star)
+    {
+      star = p;
+      continue;
+    }
+    if (*p == '*' || *p == '?' || *p == '[')
+       return (spec);
+    if (*p == '\\' && !(flags & FNM_FLAG_NOESCAPE))
+       return (spec);
+  }
+
+  /* With `FNM_FLAG_PATHNAME`, neither star may match a slash.
+   * Not worth the trouble for a sub-string match.
+   */
+  if (lead_star && trail_star && (flags & FNM_FLAG_PATHNAME))
+     return (spec);
+
+  /* The literal of a `"foo*bar"` pattern is `"foobar"`.
+   */
+  spec->literal = MALLOC (end - start + 1);
+  for (p = start, i = 0; p < end; p++)
+      if (p != star)
+         spec->literal [i++] = (char) FOLD (*p, flags);
+  spec->literal [i] = '\0';
+  spec->lit_len = i;
+
+  if (star)
+  {
+    spec->kind    = FNM_KIND_AFFIX;
+    spec->pre_len = star - start;
+  }
+  else if (lead_star && trail_star)
+       spec->kind = FNM_KIND_SUBSTR;
+  else if (lead_star)
+       spec->kind = FNM_KIND_SUFFIX;
+  else if (trail_star)
+       spec->kind = FNM_KIND_PREFIX;
+  else spec->kind = FNM_KIND_EXACT;
+  return (spec);
+}
+
+/**
+ * Match a `string` against a pattern compiled by `fnmatch_compile()`.
+ *
+ * \retval FNM_MATCH or FNM_NOMATCH.
+ */
+int fnmatch_exec (const fnmatch_spec *spec, const char *string)
+{
+  const char *lit   = spec->literal;
+  size_t      len   = spec->lit_len;
+  int         flags = spec->flags;
+  size_t      str_len, i;
+
+  switch (spec->kind)
+  {
+    case FNM_KIND_ALL:
+         if ((flags & FNM_FLAG_PATHNAME) && find_slash(string))
+            return (FNM_NOMATCH);
+         return (FNM_MATCH);
+
+    case FNM_KIND_EXACT:
+         if (lit_equal(lit, string, len, flags) && string[len] == '\0')
+            return (FNM_MATCH);
+         return (FNM_NOMATCH);
+
+    case FNM_KIND_PREFIX:
+         if (!lit_equal(lit, string, len, flags))
+            return (FNM_NOMATCH);
+         if ((flags & FNM_FLAG_PATHNAME) && find_slash(string+len))
+            return (FNM_NOMATCH);
+         return (FNM_MATCH);
+
+    case FNM_KIND_SUFFIX:
+         str_len = strlen (string);
+         if (str_len < len || !lit_equal(lit, string + str_len - len, len, flags))
+            return (FNM_NOMATCH);
+         if ((flags & FNM_FLAG_PATHNAME) && !no_slash_n(string, str_len - len))
+            return (FNM_NOMATCH);
+         return (FNM_MATCH);
+
+    case FNM_KIND_SUBSTR:
+         str_len = strlen (string);
+         for (i = 0; i + len <= str_len; i++)
+             if (lit_equal(lit, string + i, len, flags))
+                return (FNM_MATCH);
+         return (FNM_NOMATCH);
+
+    case FNM_KIND_AFFIX:
+         i = spec->pre_len;
+         if (!lit_equal(lit, string, i, flags))
+            return (FNM_NOMATCH);
+         str_len = strlen (string);
+         if (str_len < len || !lit_equal(lit + i, string + str_len - (len - i), len - i, flags))
+            return (FNM_NOMATCH);
+         if ((flags & FNM_FLAG_PATHNAME) && !no_slash_n(string + i, str_len - len))
+            return (FNM_NOMATCH);
+         return (FNM_MATCH);
+
+    case FNM_KIND_GLOB:
+    default:
+         return fnmatch (spec->pattern, string, flags);
+  }
+}
+
+void fnmatch_free (fnmatch_spec *spec)
+{
+  if (spec)
+  {
+    FREE (spec->pattern);
+    FREE (spec->literal);
+    FREE (spec);
+  }
+}
+
+/**
+ * A node in one of the lists of a `fnmatch_set`.
+ * Each list is sorted on `idx`.
+ */
+struct set_node {
+       int                 idx;
+       const fnmatch_spec *spec;
+       struct set_node    *next;
+     };
+
+#define SET_HASH_SIZE 256
+
+/**
+ * A set of compiled patterns.
+ *
+ * A pattern is put in the list it's class can be looked up by. So for a
+ * string, only a few patterns are tested:
+ *  + an exact pattern; in a hash-table on the folded pattern.
+ *  + a prefix, affix or glob pattern starting with a literal character;
+ *    in `by_first[]` indexed by that character.
+ *  + a suffix pattern; in `by_last[]` indexed by it's last character.
+ *  + the rest (sub-string, match-all and other globs); in `others`.
+ */
+struct fnmatch_set {
+       int               flags;
+       int               num_specs;
+       fnmatch_spec    **specs;
+       struct set_node  *exact    [SET_HASH_SIZE];
+       struct set_node  *by_first [256];
+       struct set_node  *by_last  [256];
+       struct set_node  *others;
+     };
+
+static unsigned set_hash (const char *str, int flags)
+{
+  unsigned hash = 2166136261U;   /* FNV-1a */
+
+  while (*str)
+     hash = (hash ^ FOLD(*str++, flags)) * 16777619U;
+  return (hash % SET_HASH_SIZE);
+}
+
+static void set_append (struct set_node **list, int idx, const fnmatch_spec *spec)
+{
+  struct set_node *node = MALLOC (sizeof(*node));
+
+  node->idx  = idx;
+  node->spec = spec;
+  node->next = NULL;
+  while (*list)
+     list = &(*list)->next;
+  *list = node;
+}
+
+static void set_free_list (struct set_node *node)
+{
+  while (node)
+  {
+    struct set_node *next = node->next;
+
+    FREE (node);
+    node = next;
+  }
+}
+
+/**
+ * Create an empty pattern-set.
+ *
+ * \param[in] flags  the `FNM_FLAG_x` flags for all patterns in the set.
+ */
+fnmatch_set *fnmatch_set_new (int flags)
+{
+  fnmatch_set *set = CALLOC (sizeof(*set), 1);
+
+  if (!fold_tab_done)
+     init_fold_tab();
+  set->flags = flags;
+  return (set);
+}
+
+/**
+ * Compile and add a `pattern` to a pattern-set.
+ *
+ * \retval The index of the pattern in the set. The first is 0.
+ */
+int fnmatch_set_add (fnmatch_set *set, const char *pattern)
+{
+  fnmatch_spec *spec = fnmatch_compile (pattern, set->flags);
+  int           idx  = set->num_specs++;
+
+  set->specs = REALLOC (set->specs, set->num_specs * sizeof(fnmatch_spec*));
+  set->specs [idx] = spec;
+
+  switch (spec->kind)
+  {
+    case FNM_KIND_EXACT:
+         set_append (&set->exact[set_hash(spec->literal,0)], idx, spec);
+         break;
+    case FNM_KIND_PREFIX:
+    case FNM_KIND_AFFIX:
+         set_append (&set->by_first[(unsigned char)spec->literal[0]], idx, spec);
+         break;
+    case FNM_KIND_SUFFIX:
+         set_append (&set->by_last[(unsigned char)spec->literal[spec->lit_len-1]], idx, spec);
+         break;
+    case FNM_KIND_GLOB:
+         if (*pattern && !strchr("*?[\\", *pattern))
+         {
+           set_append (&set->by_first[FOLD(*pattern,set->flags)], idx, spec);
+           break;
+         }
+         /* FALLTHROUGH */
+    default:
+         set_append (&set->others, idx, spec);
+         break;
+  }
+  return (idx);
+}
+
+/**
+ * Return the lowest index of the patterns in `list` matching `string`.
+ * Or `best` if none of them are lower than `best`.
+ */
+static int set_match_list (const struct set_node *node, const char *string, int best)
+{
+  for ( ; node && (best < 0 || node->idx < best); node = node->next)
+      if (fnmatch_exec(node->spec, string) == FNM_MATCH)
+         return (node->idx);
+  return (best);
+}
+
+/**
+ * Match a `string` against all patterns in a pattern-set.
+ *
+ * \retval The index of the first pattern that matches.
+ * \retval -1 if none matches.
+ */
+int fnmatch_set_exec (const fnmatch_set *set, const char *string)
+{
+  size_t len  = strlen (string);
+  int    best = -1;
+
+  best = set_match_list (set->exact[set_hash(string,set->flags)], string, best);
+  if (len > 0)
+  {
+    best = set_match_list (set->by_first[FOLD(string[0],set->flags)], string, best);
+    best = set_match_list (set->by_last[FOLD(string[len-1],set->flags)], string, best);
+  }
+  return set_match_list (set->others, string, best);
+}
+
+/**
+ * Return the number of patterns in a pattern-set.
+ */
+int fnmatch_set_len (const fnmatch_set *set)
+{
+  return (set->num_specs);
+}
+
+void fnmatch_set_free (fnmatch_set *set)
+{
+  int i;
+
+  if (!set)
+     return;
+
+  for (i = 0; i < SET_HASH_SIZE; i++)
+      set_free_list (set->exact[i]);
+  for (i = 0; i < 256; i++)
+  {
+    set_free_list (set->by_first[i]);
+    set_free_list (set->by_last[i]);
+  }
+  set_free_list (set->others);
+
+  for (i = 0; i < set->num_specs; i++)
+      fnmatch_free (set->specs[i]);
+  FREE (set->specs);
+  FREE (set);
+}
+
+/**
+ * Return the name of the class of a compiled pattern.
+ */
+const char *fnmatch_class (const fnmatch_spec *spec)
+{
+  switch (spec->kind)
+  {
+    case FNM_KIND_EXACT:
+         return ("exact");
+    case FNM_KIND_PREFIX:
+         return ("prefix");
+    case FNM_KIND_SUFFIX:
+         return ("suffix");
+    case FNM_KIND_SUBSTR:
+         return ("sub-string");
+    case FNM_KIND_AFFIX:
+         return ("affix");
+    case FNM_KIND_ALL:
+         return ("all");
+    case FNM_KIND_GLOB:
+    default:
+         return ("glob");
+  }
+}
+
+#if defined(WILDCARD_TEST)
+
+#define TEST_UTIL_MAIN
+#include "test_util.h"
+
+/**
+ * The file-names to match against. Roughly what a `%PATH%` directory has.
+ */
+static const char *names[] = {
+       "kernel32.dll", "KERNELBASE.dll", "user32.dll", "notepad.exe", "cmd.exe",
+       "python37.dll", "Python.exe", "libgcc_s_dw2-1.dll", "libstdc++-6.dll",
+       "gcc.exe", "g++.exe", "i686-w64-mingw32-gcc.exe", "openssl.exe", "README",
+       "readme.txt", "Makefile", "envtool.exe", "envtool.map", "zlib1.dll",
+       "msvcp140.dll", "vcruntime140.dll", "api-ms-win-crt-runtime-l1-1-0.dll",
+       "sub/dir/file.h", "a_very_long_file_name_with_many_parts_in_it.dll"
+     };
+
+static const struct {
+       const char *pattern;
+       int         flags;
+     } patterns[] = {
+       { "notepad.exe",    FNM_FLAG_NOCASE                     },
+       { "python*",        FNM_FLAG_NOCASE                     },
+       { "*.dll",          FNM_FLAG_NOCASE                     },
+       { "*-gcc.exe",      0                                   },
+       { "*crt*",          FNM_FLAG_NOCASE                     },
+       { "*",              FNM_FLAG_NOCASE | FNM_FLAG_PATHNAME },
+       { "lib*.dll",       FNM_FLAG_NOCASE                     },
+       { "[a-k]*.exe",     FNM_FLAG_NOCASE                     },
+       { "sub/*.h",        FNM_FLAG_NOCASE | FNM_FLAG_PATHNAME },
+       { "*.H",            FNM_FLAG_PATHNAME                   },
+       { "s*",             FNM_FLAG_NOCASE | FNM_FLAG_PATHNAME },
+       { "*\\file.h",      FNM_FLAG_NOCASE | FNM_FLAG_NOESCAPE }
+     };
+
+/**
+ * The old recursive `fnmatch()`. For comparision only.
+ */
+static int fnmatch_recursive (const char *pattern, const char *string, int flags)
+{
+  char c, test;
+
+  while (1)
+  {
+    c = *pattern++;
+
+    switch (c)
+    {
+      case 0:
+           return (*string == 0 ? FNM_MATCH : FNM_NOMATCH);
+
+      case '?':
+           test = *string++;
+           if (test == 0 || (IS_SLASH(test) && (flags & FNM_FLAG_PATHNAME)))
+              return (FNM_NOMATCH);
+           break;
+
+      case '*':
+           c = *pattern;
+           /* collapse multiple stars */
+           while (c == '*')
+               c = *(++pattern);
+
+           /* optimize for pattern with '*' at end or before '/' */
+           if (c == 0)
+           {
+             if (flags & FNM_FLAG_PATHNAME)
+                return (find_slash(string) ? FNM_NOMATCH : FNM_MATCH);
+             return (FNM_MATCH);
+           }
+           if (IS_SLASH(c) && (flags & FNM_FLAG_PATHNAME))
+           {
+             string = find_slash (string);
+             if (!string)
+                return (FNM_NOMATCH);
+             break;
+           }
+
+           /* general case, use recursion */
+           while ((test = *string) != '\0')
+           {
+             if (fnmatch_recursive(pattern, string, flags) == FNM_MATCH)
+                return (FNM_MATCH);
+             if (IS_SLASH(test) && (flags & FNM_FLAG_PATHNAME))
+                break;
+             ++string;
+           }
+           return (FNM_NOMATCH);
+
+      case '[':
+           test = *string++;
+           if (!test || (IS_SLASH(test) && (flags & FNM_FLAG_PATHNAME)))
+              return (FNM_NOMATCH);
+           pattern = range_match (pattern, test, flags & FNM_FLAG_NOCASE);
+           if (!pattern)
+              return (FNM_NOMATCH);
+           break;
+
+      case '\\':
+           if (!(flags & FNM_FLAG_NOESCAPE) && pattern[0] && pattern[1] && strchr("*?[\\", pattern[1]))
+           {
+             c = *pattern++;
+             if (c == 0)
+             {
+               c = '\\';
+               --pattern;
+             }
+             if (c != *string++)
+                return (FNM_NOMATCH);
+             break;
+           }
+           /* FALLTHROUGH */
+
+      default:
+           if (IS_SLASH(c) && IS_SLASH(*string))
+           {
+             string++;
+             break;
+           }
+           if (flags & FNM_FLAG_NOCASE)
+           {
+             if (TOUPPER(c) != TOUPPER(*string++))
+                return (FNM_NOMATCH);
+           }
+           else
+           {
+             if (c != *string++)
+                return (FNM_NOMATCH);
+           }
+           break;
+    } /* switch (c) */
+  }   /* while (1) */
+}
+
+/**
+ * Cross-check `fnmatch()` against `fnmatch_recursive()` on random
+ * patterns and strings made of the characters that matter.
+ */
+static int check_random (int rounds)
+{
+  static const char pat_chars[] = "ab*?/\\[]!-";
+  static const char str_chars[] = "abAB/\\*?";
+  static const int  flags[] = { 0,
+                                FNM_FLAG_NOCASE,
+                                FNM_FLAG_PATHNAME,
+                                FNM_FLAG_NOESCAPE,
+                                FNM_FLAG_NOCASE | FNM_FLAG_PATHNAME | FNM_FLAG_NOESCAPE
+                              };
+  char pattern [12], string [12];
+  int  i, j, errors = 0;
+
+  srand (1);
+  for (i = 0; i < rounds; i++)
+  {
+    int p_len = rand() % (sizeof(pattern) - 1);
+    int s_len = rand() % (sizeof(string) - 1);
+    int f     = flags [i % (sizeof(flags)/sizeof(flags[0]))];
+    int rc1, rc2;
+
+    for (j = 0; j < p_len; j++)
+        pattern[j] = pat_chars [rand() % (sizeof(pat_chars) - 1)];
+    pattern[j] = '\0';
+    for (j = 0; j < s_len; j++)
+        string[j] = str_chars [rand() % (sizeof(str_chars) - 1)];
+    string[j] = '\0';
+
+    /* With `FNM_FLAG_PATHNAME`, the recursive version took an escaping
+     * `'\\'` after a `'*'` as a slash. That was a bug; skip these.
+     */
+    if ((f & FNM_FLAG_PATHNAME) && !(f & FNM_FLAG_NOESCAPE) && strstr(pattern, "*\\"))
+       continue;
+
+    rc1 = fnmatch_recursive (pattern, string, f);
+    rc2 = fnmatch (pattern, string, f);
+    if (rc1 != rc2 && errors++ < 10)
+       printf ("Mismatch for \"%s\" on \"%s\" (flags 0x%02X): %s vs %s.\n",
+               pattern, string, f, fnmatch_res(rc1), fnmatch_res(rc2));
+  }
+  printf ("%d random patterns checked; %d mismatches.\n\n", rounds, errors);
+  return (errors);
+}
+
+/**
+ * Time the pathological pattern `"*a*a*a*a*b"` against strings of `'a'`.
+ * The time of `fnmatch()` should grow linearly with the length. The time
+ * of `fnmatch_recursive()` grows with the length to the power of 4; it is
+ * skipped once it gets too slow.
+ */
+static void bench_pathological (void)
+{
+  static const char *pattern = "*a*a*a*a*b";
+  static char  string [1 << 16];
+  int          do_recursive = 1;
+  size_t       len;
+
+  printf ("%-12s %8s %14s %14s\n", "Pattern", "Length", "fnmatch()", "recursive");
+
+  for (len = 16; len < sizeof(string); len *= 2)
+  {
+    double start, t_iter, t_recur = 0.0;
+    int    rc;
+
+    memset (string, 'a', len);
+    string [len] = '\0';
+
+    start = get_time();
+    rc = fnmatch (pattern, string, 0);
+    t_iter = get_time() - start;
+
+    if (do_recursive)
+    {
+      start = get_time();
+      if (fnmatch_recursive(pattern, string, 0) != rc)
+         printf ("Mismatch at length %u.\n", (unsigned)len);
+      t_recur = get_time() - start;
+      do_recursive = (t_recur < 0.5);
+    }
+
+    if (t_recur > 0.0)
+         printf ("%-12s %8u %11.3f ms %11.3f ms\n", pattern, (unsigned)len, 1E3*t_iter, 1E3*t_recur);
+    else printf ("%-12s %8u %11.3f ms %14s\n", pattern, (unsigned)len, 1E3*t_iter, "-");
+  }
+  putchar ('\n');
+}
+
+/**
+ * The patterns for `bench_set()`. As many as a build-script could look for.
+ */
+static const char *set_patterns[] = {
+       "kernel32.dll", "user32.dll", "gdi32.dll", "advapi32.dll", "ws2_32.dll",
+       "ole32.dll", "oleaut32.dll", "shell32.dll", "comctl32.dll", "crypt32.dll",
+       "msvcp140.dll", "vcruntime140.dll", "ucrtbase.dll", "zlib1.dll",
+       "libssl-1_1.dll", "libcrypto-1_1.dll", "python3*.dll", "lib*.dll",
+       "*.pdb", "*.manifest", "api-ms-win-*", "*crt*", "[a-c]*.exe",
+       "notepad.exe", "cmd.exe", "gcc.exe", "openssl.exe", "readme*", "*.map",
+       "g++.exe"
+     };
+
+/**
+ * Time a `fnmatch_set` against testing each pattern with `fnmatch_exec()`.
+ */
+static int bench_set (int loops)
+{
+  fnmatch_spec *specs [sizeof(set_patterns)/sizeof(set_patterns[0])];
+  fnmatch_set  *set = fnmatch_set_new (FNM_FLAG_NOCASE);
+  int           num_pat = (int) (sizeof(set_patterns)/sizeof(set_patterns[0]));
+  int           num_names = (int) (sizeof(names)/sizeof(names[0]));
+  int           i, j, k, errors = 0;
+  volatile int  sum = 0;
+  double        start, t_each, t_set;
+
+  for (i = 0; i < num_pat; i++)
+  {
+    specs[i] = fnmatch_compile (set_patterns[i], FNM_FLAG_NOCASE);
+    fnmatch_set_add (set, set_patterns[i]);
+  }
+
+  for (j = 0; j < num_names; j++)
+  {
+    int idx1 = -1, idx2 = fnmatch_set_exec (set, names[j]);
+
+    for (i = 0; i < num_pat && idx1 < 0; i++)
+        if (fnmatch_exec(specs[i], names[j]) == FNM_MATCH)
+           idx1 = i;
+    if (idx1 != idx2)
+    {
+      printf ("Set mismatch on \"%s\": %d vs %d.\n", names[j], idx1, idx2);
+      errors++;
+    }
+  }
+
+  start = get_time();
+  for (k = 0; k < loops; k++)
+      for (j = 0; j < num_names; j++)
+          for (i = 0; i < num_pat; i++)
+              if (fnmatch_exec(specs[i], names[j]) == FNM_MATCH)
+              {
+                sum += i;
+                break;
+              }
+  t_each = get_time() - start;
+
+  start = get_time();
+  for (k = 0; k < loops; k++)
+      for (j = 0; j < num_names; j++)
+          sum += fnmatch_set_exec (set, names[j]);
+  t_set = get_time() - start;
+
+  printf ("%d patterns: each %9.3f ms, set %9.3f ms %7.1fx\n\n",
+          num_pat, 1E3*t_each, 1E3*t_set, t_set > 0.0 ? t_each/t_set : 0.0);
+
+  for (i = 0; i < num_pat; i++)
+      fnmatch_free (specs[i]);
+  fnmatch_set_free (set);
+  return (errors);
+}
+
+int main (int argc, char **argv)
+{
+  int    i, j, k, loops = 100000, errors = 0;
+  double start, t_plain, t_comp;
+
+  if (argc > 1)
+     loops = atoi (argv[1]);
+  if (loops <= 0)
+  {
+    printf ("Usage: wildcard [loops]\n");
+    return (1);
+  }
+
+  errors += check_random (1000000);
+  bench_pathological();
+  errors += bench_set (loops);
+
+  printf ("%-12s %-10s %12s %12s %8s\n", "Pattern", "Class", "fnmatch()", "compiled", "Speedup");
+
+  for (i = 0; i < (int)(sizeof(patterns)/sizeof(patterns[0])); i++)
+  {
+    fnmatch_spec *spec = fnmatch_compile (patterns[i].pattern, patterns[i].flags);
+    volatile int  sum = 0;
+
+    for (j = 0; j < (int)(sizeof(names)/sizeof(names[0])); j++)
+    {
+      int rc1 = fnmatch (patterns[i].pattern, names[j], patterns[i].flags);
+      int rc2 = fnmatch_exec (spec, names[j]);
+
+      if (rc1 != rc2)
+      {
+        printf ("Mismatch for \"%s\" on \"%s\": %s vs %s.\n",
+                patterns[i].pattern, names[j], fnmatch_res(rc1), fnmatch_res(rc2));
+        errors++;
+      }
+    }
+
+    start = get_time();
+    for (k = 0; k < loops; k++)
+        for (j = 0; j < (int)(sizeof(names)/sizeof(names[0])); j++)
+            sum += fnmatch (patterns[i].pattern, names[j], patterns[i].flags);
+    t_plain = get_time() - start;
+
+    start = get_time();
+    for (k = 0; k < loops; k++)
+        for (j = 0; j < (int)(sizeof(names)/sizeof(names[0])); j++)
+            sum += fnmatch_exec (spec, names[j]);
+    t_comp = get_time() - start;
+
+    printf ("%-12s %-10s %9.3f ms %9.3f ms %7.1fx\n",
+            patterns[i].pattern, fnmatch_class(spec), 1E3*t_plain, 1E3*t_comp,
+            t_comp > 0.0 ? t_plain/t_comp : 0.0);
+    fnmatch_free (spec);
+  }
+  return (errors ? 1 : 0);
+}
+#endif  /* WILDCARD_TEST */
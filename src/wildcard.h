@@ -0,0 +1,40 @@
+/** \file wildcard.h
+ *  \ingroup Misc
+ */
+#ifndef _WILDCARD_H
+#define _WILDCARD_H
+
+/* fnmatch() ret-values and flags:
+ */
+#define FNM_MATCH          1
+#define FNM_NOMATCH        0
+
+#define FNM_FLAG_NOESCAPE  0x01
+#define FNM_FLAG_PATHNAME  0x02
+#define FNM_FLAG_NOCASE    0x04
+
+extern int   fnmatch     (const char *pattern, const char *string, int flags);
+extern char *fnmatch_res (int rc);
+
+/**
+ * A compiled `fnmatch()` pattern. Opaque to the user.
+ */
+typedef struct fnmatch_spec fnmatch_spec;
+
+extern fnmatch_spec *fnmatch_compile (const char *pattern, int flags);
+extern int           fnmatch_exec    (const fnmatch_spec *spec, const char *string);
+extern void          fnmatch_free    (fnmatch_spec *spec);
+extern const char   *fnmatch_class   (const fnmatch_spec *spec);
+
+/**
+ * A set of compiled `fnmatch()` patterns. Opaque to the user.
+ */
+typedef struct fnmatch_set fnmatch_set;
+
+extern fnmatch_set *fnmatch_set_new  (int flags);
+extern int          fnmatch_set_add  (fnmatch_set *set, const char *pattern);
+extern int          fnmatch_set_exec (const fnmatch_set *set, const char *string);
+extern int          fnmatch_set_len  (const fnmatch_set *set);
+extern void         fnmatch_set_free (fnmatch_set *set);
+
+#endif  /* _WILDCARD_H */